@@ -39,3 +39,18 @@ SELECT gin_metapage_info(decode(repeat('00', :block_size), 'hex'));
 SELECT gin_page_opaque_info(decode(repeat('00', :block_size), 'hex'));
 
 DROP TABLE test1;
+
+-- With autocleanup, an insertion that overflows the pending list leaves it
+-- for autovacuum instead of cleaning it up itself.
+\x
+CREATE TABLE test2 (y int[]) WITH (autovacuum_enabled = off);
+CREATE INDEX test2_y_idx ON test2 USING gin (y)
+  WITH (fastupdate = on, gin_pending_list_limit = 64, autocleanup = on);
+INSERT INTO test2 SELECT ARRAY[1, x] FROM generate_series(1, 3000) x;
+SELECT n_pending_pages * current_setting('block_size')::int > 64 * 1024 AS overflowed,
+       n_pending_tuples
+  FROM gin_metapage_info(get_raw_page('test2_y_idx', 0));
+SELECT gin_clean_pending_list('test2_y_idx') > 0 AS cleaned;
+SELECT n_pending_pages, n_pending_tuples
+  FROM gin_metapage_info(get_raw_page('test2_y_idx', 0));
+DROP TABLE test2;
@@ -106,3 +106,42 @@ SELECT hash_page_stats(decode(repeat('00', :block_size), 'hex'));
 SELECT hash_page_type(decode(repeat('00', :block_size), 'hex'));
 
 DROP TABLE test_hash;
+
+-- COPY hands hash indexes whole batches of rows.  Put enough rows into one
+-- bucket that it needs overflow pages, and enough into the index that it
+-- needs several bucket splits, all within a single batch.  Autovacuum is
+-- off for the table, so that it leaves the deferred splits alone.
+\x
+CREATE TABLE test_hash_copy (a int) WITH (autovacuum_enabled = off);
+VACUUM test_hash_copy;
+CREATE INDEX test_hash_copy_split ON test_hash_copy USING hash (a)
+  WITH (fillfactor = 10);
+CREATE INDEX test_hash_copy_autosplit ON test_hash_copy USING hash (a)
+  WITH (fillfactor = 50, autosplit = on);
+SELECT c.relname, m.ntuples, m.maxbucket,
+       m.ntuples <= m.ffactor * (m.maxbucket + 1) AS within_ffactor
+  FROM pg_class c, hash_metapage_info(get_raw_page(c.relname, 0)) m
+  WHERE c.relname LIKE 'test_hash_copy_%' ORDER BY c.relname;
+\copy (SELECT 1 FROM generate_series(1, 450) UNION ALL SELECT generate_series(2, 51)) TO 'results/hash_copy.data'
+\copy test_hash_copy FROM 'results/hash_copy.data'
+-- Without autosplit, the batch splits buckets until the index is within its
+-- fill factor again.  With it, the splits are left to autovacuum, which
+-- skips tables it is disabled for.
+SELECT c.relname, m.ntuples, m.maxbucket,
+       m.ntuples <= m.ffactor * (m.maxbucket + 1) AS within_ffactor
+  FROM pg_class c, hash_metapage_info(get_raw_page(c.relname, 0)) m
+  WHERE c.relname LIKE 'test_hash_copy_%' ORDER BY c.relname;
+SELECT c.relname,
+       count(*) FILTER (WHERE hash_page_type(get_raw_page(c.relname, b)) = 'overflow') > 0
+         AS has_overflow
+  FROM pg_class c,
+       generate_series(0, pg_relation_size(c.oid) / current_setting('block_size')::int - 1) b
+  WHERE c.relname LIKE 'test_hash_copy_%' GROUP BY c.relname ORDER BY c.relname;
+SET enable_seqscan = off;
+SELECT count(*) FROM test_hash_copy WHERE a = 1;
+SELECT count(*) FROM test_hash_copy WHERE a = 30;
+DROP INDEX test_hash_copy_split;
+SELECT count(*) FROM test_hash_copy WHERE a = 1;
+SELECT count(*) FROM test_hash_copy WHERE a = 30;
+RESET enable_seqscan;
+DROP TABLE test_hash_copy;
@@ -19,27 +19,132 @@
 #include "access/brin_page.h"
 #include "access/brin_pageops.h"
 #include "access/brin_xlog.h"
+#include "access/parallel.h"
 #include "access/relation.h"
 #include "access/reloptions.h"
 #include "access/relscan.h"
 #include "access/table.h"
 #include "access/tableam.h"
+#include "access/xact.h"
 #include "access/xloginsert.h"
 #include "catalog/index.h"
 #include "catalog/pg_am.h"
 #include "commands/vacuum.h"
+#include "executor/instrument.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "postmaster/autovacuum.h"
+#include "storage/buffile.h"
 #include "storage/bufmgr.h"
+#include "storage/condition_variable.h"
 #include "storage/freespace.h"
+#include "storage/lmgr.h"
+#include "storage/proc.h"
+#include "storage/sharedfileset.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"		/* pgrminclude ignore */
 #include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/datum.h"
 #include "utils/index_selfuncs.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/snapmgr.h"
 
+/* Magic numbers for parallel state sharing */
+#define PARALLEL_KEY_BRIN_SHARED		UINT64CONST(0xD000000000000001)
+#define PARALLEL_KEY_QUERY_TEXT			UINT64CONST(0xD000000000000002)
+#define PARALLEL_KEY_WAL_USAGE			UINT64CONST(0xD000000000000003)
+#define PARALLEL_KEY_BUFFER_USAGE		UINT64CONST(0xD000000000000004)
+
+/*
+ * DISABLE_LEADER_PARTICIPATION disables the leader's participation in
+ * parallel index builds.  This may be useful as a debugging aid.
+#undef DISABLE_LEADER_PARTICIPATION
+ */
+
+/*
+ * Status for index builds performed in parallel.  This is allocated in a
+ * dynamic shared memory segment.
+ *
+ * The heap is scanned without synchronized scans, so each participant sees
+ * its share of the blocks in increasing order.  A participant summarizes the
+ * page ranges it encounters and writes the summary tuples, in range order,
+ * to its own file in the shared fileset.  A range whose blocks were handed
+ * out to several participants gets several partial summaries.  The leader
+ * then merges all files by block number, unions the partial summaries of
+ * each range and inserts the result into the index, so that only the leader
+ * ever writes index pages.
+ */
+typedef struct BrinShared
+{
+	/*
+	 * These fields are not modified during the build.
+	 */
+	Oid			heaprelid;
+	Oid			indexrelid;
+	bool		isconcurrent;
+	BlockNumber pagesPerRange;
+	int			scanparticipants;
+
+	/* Summary files written by participants */
+	SharedFileSet fileset;
+
+	/*
+	 * workersdonecv is used to monitor the progress of workers.  All parallel
+	 * participants must indicate that they are done before leader can read
+	 * their summaries.
+	 */
+	ConditionVariable workersdonecv;
+
+	/*
+	 * mutex protects all fields below.
+	 */
+	slock_t		mutex;
+
+	/*
+	 * Mutable state that is maintained by workers, and reported back to
+	 * leader at end of parallel scan.
+	 */
+	int			nparticipantsdone;
+	double		reltuples;
+	bool		brokenhotchain;
+
+	/*
+	 * ParallelTableScanDescData data follows. Can't directly embed here, as
+	 * implementations of the parallel table scan desc interface might need
+	 * stronger alignment.
+	 */
+} BrinShared;
+
+/*
+ * Return pointer to a BrinShared's parallel table scan.
+ *
+ * c.f. shm_toc_allocate as to why BUFFERALIGN is used, rather than just
+ * MAXALIGN.
+ */
+#define ParallelTableScanFromBrinShared(shared) \
+	(ParallelTableScanDesc) ((char *) (shared) + BUFFERALIGN(sizeof(BrinShared)))
+
+/*
+ * Status for leader in parallel index build.
+ */
+typedef struct BrinLeader
+{
+	/* parallel context itself */
+	ParallelContext *pcxt;
+
+	/*
+	 * Leader process convenience pointers to shared state (leader avoids TOC
+	 * lookups).
+	 */
+	BrinShared *brinshared;
+	int			nparticipants;
+	bool		leaderparticipates;
+	Snapshot	snapshot;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+} BrinLeader;
 
 /*
  * We use a BrinBuildState during initial construction of a BRIN index.
@@ -55,8 +160,22 @@ typedef struct BrinBuildState
 	BrinRevmap *bs_rmAccess;
 	BrinDesc   *bs_bdesc;
 	BrinMemTuple *bs_dtuple;
+
+	/* Only set in a participant of a parallel build */
+	BufFile    *bs_spill;
 } BrinBuildState;
 
+/*
+ * Leader's read position in one participant's summary file, holding the next
+ * summary tuple of that participant.
+ */
+typedef struct BrinSpillReader
+{
+	BufFile    *file;
+	BrinTuple  *tup;
+	Size		size;
+} BrinSpillReader;
+
 /*
  * Struct used as "opaque" during index scans
  */
@@ -81,6 +200,19 @@ static void brin_vacuum_scan(Relation idxrel, BufferAccessStrategy strategy);
 static bool add_values_to_range(Relation idxRel, BrinDesc *bdesc,
 								BrinMemTuple *dtup, Datum *values, bool *nulls);
 static bool check_null_keys(BrinValues *bval, ScanKey *nullkeys, int nnullkeys);
+static bool brin_summarize_new_range(Relation idxRel, Relation heapRel,
+									 BrinRevmap *revmap, BlockNumber heapBlk);
+static BrinLeader *_brin_begin_parallel(Relation heap, Relation index,
+										bool isconcurrent, int request,
+										BlockNumber pagesPerRange);
+static void _brin_end_parallel(BrinLeader *brinleader);
+static Size _brin_parallel_estimate_shared(Relation heap, Snapshot snapshot);
+static double _brin_parallel_merge(BrinBuildState *state,
+								   BrinLeader *brinleader,
+								   bool *brokenhotchain);
+static void _brin_parallel_scan_and_spill(Relation heap, Relation index,
+										  BrinShared *brinshared,
+										  int participant, bool progress);
 
 /*
  * BRIN handler function: return IndexAmRoutine with access method parameters
@@ -106,6 +238,7 @@ brinhandler(PG_FUNCTION_ARGS)
 	amroutine->amclusterable = false;
 	amroutine->ampredlocks = false;
 	amroutine->amcanparallel = false;
+	amroutine->amcanbuildparallel = true;
 	amroutine->amcaninclude = false;
 	amroutine->amusemaintenanceworkmem = false;
 	amroutine->amparallelvacuumoptions =
@@ -115,6 +248,7 @@ brinhandler(PG_FUNCTION_ARGS)
 	amroutine->ambuild = brinbuild;
 	amroutine->ambuildempty = brinbuildempty;
 	amroutine->aminsert = brininsert;
+	amroutine->aminsertmulti = NULL;
 	amroutine->ambulkdelete = brinbulkdelete;
 	amroutine->amvacuumcleanup = brinvacuumcleanup;
 	amroutine->amcanreturn = NULL;
@@ -145,7 +279,7 @@ brinhandler(PG_FUNCTION_ARGS)
  * the summary tuple, we need to update the index tuple.
  *
  * If autosummarization is enabled, check if we need to summarize the previous
- * page range.
+ * page range, and summarize a new range as soon as its first tuple arrives.
  *
  * If the range is not currently summarized (i.e. the revmap returns NULL for
  * it), there's nothing to do for this tuple.
@@ -166,6 +300,7 @@ brininsert(Relation idxRel, Datum *values, bool *nulls,
 	MemoryContext tupcxt = NULL;
 	MemoryContext oldcxt = CurrentMemoryContext;
 	bool		autosummarize = BrinGetAutoSummarize(idxRel);
+	bool		firstInRange;
 
 	revmap = brinRevmapInitialize(idxRel, &pagesPerRange, NULL);
 
@@ -175,6 +310,8 @@ brininsert(Relation idxRel, Datum *values, bool *nulls,
 	 */
 	origHeapBlk = ItemPointerGetBlockNumber(heaptid);
 	heapBlk = (origHeapBlk / pagesPerRange) * pagesPerRange;
+	firstInRange = (heapBlk == origHeapBlk &&
+					ItemPointerGetOffsetNumber(heaptid) == FirstOffsetNumber);
 
 	for (;;)
 	{
@@ -190,10 +327,7 @@ brininsert(Relation idxRel, Datum *values, bool *nulls,
 		 * tuple into the first block of a new non-first page range, request a
 		 * summarization run of the previous range.
 		 */
-		if (autosummarize &&
-			heapBlk > 0 &&
-			heapBlk == origHeapBlk &&
-			ItemPointerGetOffsetNumber(heaptid) == FirstOffsetNumber)
+		if (autosummarize && heapBlk > 0 && firstInRange)
 		{
 			BlockNumber lastPageRange = heapBlk - 1;
 			BrinTuple  *lastPageTuple;
@@ -222,6 +356,20 @@ brininsert(Relation idxRel, Datum *values, bool *nulls,
 		brtup = brinGetTupleForHeapBlock(revmap, heapBlk, &buf, &off,
 										 NULL, BUFFER_LOCK_SHARE, NULL);
 
+		/*
+		 * Likewise, the first tuple of a range that isn't summarized yet
+		 * summarizes it right away, so that scans can skip the range without
+		 * waiting for a work item or vacuum.  Later insertions then just
+		 * widen the summary below.  The range holds only this tuple so far,
+		 * so this is cheap; we only try once.
+		 */
+		if (!brtup && autosummarize && firstInRange)
+		{
+			firstInRange = false;
+			if (brin_summarize_new_range(idxRel, heapRel, revmap, heapBlk))
+				continue;
+		}
+
 		/* if range is unsummarized, there's nothing to do */
 		if (!brtup)
 			break;
@@ -834,6 +982,7 @@ brinbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	BrinBuildState *state;
 	Buffer		meta;
 	BlockNumber pagesPerRange;
+	BrinLeader *brinleader = NULL;
 
 	/*
 	 * We expect to be called exactly once for any index relation.
@@ -882,15 +1031,36 @@ brinbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	revmap = brinRevmapInitialize(index, &pagesPerRange, NULL);
 	state = initialize_brin_buildstate(index, revmap, pagesPerRange);
 
-	/*
-	 * Now scan the relation.  No syncscan allowed here because we want the
-	 * heap blocks in physical order.
-	 */
-	reltuples = table_index_build_scan(heap, index, indexInfo, false, true,
-									   brinbuildCallback, (void *) state, NULL);
+	/* Attempt to launch parallel worker scan when required */
+	if (indexInfo->ii_ParallelWorkers > 0)
+		brinleader = _brin_begin_parallel(heap, index,
+										  indexInfo->ii_Concurrent,
+										  indexInfo->ii_ParallelWorkers,
+										  pagesPerRange);
 
-	/* process the final batch */
-	form_and_insert_tuple(state);
+	if (brinleader)
+	{
+		/*
+		 * Participants have summarized the heap; merge their summaries into
+		 * the index.
+		 */
+		reltuples = _brin_parallel_merge(state, brinleader,
+										 &indexInfo->ii_BrokenHotChain);
+		_brin_end_parallel(brinleader);
+	}
+	else
+	{
+		/*
+		 * Now scan the relation.  No syncscan allowed here because we want
+		 * the heap blocks in physical order.
+		 */
+		reltuples = table_index_build_scan(heap, index, indexInfo, false, true,
+										   brinbuildCallback, (void *) state,
+										   NULL);
+
+		/* process the final batch */
+		form_and_insert_tuple(state);
+	}
 
 	/* release resources */
 	idxtuples = state->bs_numtuples;
@@ -908,6 +1078,558 @@ brinbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	return result;
 }
 
+/*
+ * Parallel index build support
+ */
+
+/*
+ * Name of the summary file written by a parallel build participant.
+ */
+static void
+brinSpillFileName(char *name, int participant)
+{
+	snprintf(name, MAXPGPATH, "brin.p%d", participant);
+}
+
+/*
+ * Write the summary of the current range of a parallel build participant to
+ * its file.  Ranges without tuples are not written; the leader takes care of
+ * those.
+ */
+static void
+brinSpillCurrentRange(BrinBuildState *state)
+{
+	BrinTuple  *tup;
+	Size		size;
+
+	if (state->bs_dtuple->bt_empty_range)
+		return;
+
+	tup = brin_form_tuple(state->bs_bdesc, state->bs_currRangeStart,
+						  state->bs_dtuple, &size);
+	BufFileWrite(state->bs_spill, &size, sizeof(size));
+	BufFileWrite(state->bs_spill, tup, size);
+	state->bs_numtuples++;
+
+	pfree(tup);
+}
+
+/*
+ * Per-heap-tuple callback for the table_index_build_scan of a parallel build
+ * participant.
+ *
+ * This is brinbuildCallback, except that the completed ranges are written to
+ * the participant's file.  The participant only sees the blocks handed out to
+ * it, so rather than stepping through the ranges in between, we go straight
+ * to the range of the current tuple.
+ */
+static void
+brinbuildCallbackParallel(Relation index,
+						  ItemPointer tid,
+						  Datum *values,
+						  bool *isnull,
+						  bool tupleIsAlive,
+						  void *brstate)
+{
+	BrinBuildState *state = (BrinBuildState *) brstate;
+	BlockNumber thisblock;
+
+	thisblock = ItemPointerGetBlockNumber(tid);
+
+	if (thisblock > state->bs_currRangeStart + state->bs_pagesPerRange - 1)
+	{
+		brinSpillCurrentRange(state);
+
+		state->bs_currRangeStart = thisblock - thisblock % state->bs_pagesPerRange;
+		brin_memtuple_initialize(state->bs_dtuple, state->bs_bdesc);
+	}
+
+	/* Accumulate the current tuple into the running state */
+	(void) add_values_to_range(index, state->bs_bdesc, state->bs_dtuple,
+							   values, isnull);
+}
+
+/*
+ * Load the next summary tuple of a participant's file into the reader.
+ * Returns false, and closes the file, once it is exhausted.
+ */
+static bool
+brinReadSpilledTuple(BrinSpillReader *reader)
+{
+	Size		size;
+
+	if (reader->tup)
+	{
+		pfree(reader->tup);
+		reader->tup = NULL;
+	}
+
+	if (BufFileRead(reader->file, &size, sizeof(size)) != sizeof(size))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from BRIN build temporary file")));
+	if (size == 0)
+	{
+		BufFileClose(reader->file);
+		reader->file = NULL;
+		return false;
+	}
+
+	reader->tup = palloc(size);
+	reader->size = size;
+	if (BufFileRead(reader->file, reader->tup, size) != size)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from BRIN build temporary file")));
+
+	return true;
+}
+
+/*
+ * Within leader, wait for all participants to finish scanning the heap, then
+ * merge the summaries they wrote and insert the result into the index.
+ *
+ * Each participant's file is in range order, so the files are merged on the
+ * fly.  The participant count is small, so we just look for the lowest range
+ * among all of them each time.  Like the serial build, we insert empty
+ * summaries for ranges without any tuples, up to the last range that has
+ * some.
+ *
+ * Returns the total number of heap tuples scanned.
+ */
+static double
+_brin_parallel_merge(BrinBuildState *state, BrinLeader *brinleader,
+					 bool *brokenhotchain)
+{
+	BrinShared *brinshared = brinleader->brinshared;
+	BrinSpillReader *readers;
+	double		reltuples;
+	int			nreaders;
+	int			i;
+
+	for (;;)
+	{
+		SpinLockAcquire(&brinshared->mutex);
+		if (brinshared->nparticipantsdone == brinleader->nparticipants)
+		{
+			*brokenhotchain = brinshared->brokenhotchain;
+			reltuples = brinshared->reltuples;
+			SpinLockRelease(&brinshared->mutex);
+			break;
+		}
+		SpinLockRelease(&brinshared->mutex);
+
+		ConditionVariableSleep(&brinshared->workersdonecv,
+							   WAIT_EVENT_PARALLEL_CREATE_INDEX_SCAN);
+	}
+
+	ConditionVariableCancelSleep();
+
+	/* Open every participant's file, and load its first summary */
+	readers = palloc0(sizeof(BrinSpillReader) * brinleader->nparticipants);
+	nreaders = 0;
+	for (i = 0; i <= brinleader->pcxt->nworkers; i++)
+	{
+		char		name[MAXPGPATH];
+
+		/* launched workers are numbered from 0, the leader comes last */
+		if (i < brinleader->pcxt->nworkers_launched)
+			brinSpillFileName(name, i);
+		else if (i == brinleader->pcxt->nworkers &&
+				 brinleader->leaderparticipates)
+			brinSpillFileName(name, i);
+		else
+			continue;
+
+		readers[nreaders].file = BufFileOpenShared(&brinshared->fileset, name,
+												   O_RDONLY);
+		if (brinReadSpilledTuple(&readers[nreaders]))
+			nreaders++;
+	}
+
+	for (;;)
+	{
+		BlockNumber rangeStart = InvalidBlockNumber;
+
+		CHECK_FOR_INTERRUPTS();
+
+		for (i = 0; i < nreaders; i++)
+		{
+			if (readers[i].tup && readers[i].tup->bt_blkno < rangeStart)
+				rangeStart = readers[i].tup->bt_blkno;
+		}
+		if (rangeStart == InvalidBlockNumber)
+			break;
+
+		/* fill in the ranges nobody saw any tuples in */
+		while (state->bs_currRangeStart < rangeStart)
+		{
+			form_and_insert_tuple(state);
+			state->bs_currRangeStart += state->bs_pagesPerRange;
+		}
+
+		/* combine all the partial summaries of this range */
+		for (i = 0; i < nreaders; i++)
+		{
+			if (readers[i].tup && readers[i].tup->bt_blkno == rangeStart)
+			{
+				union_tuples(state->bs_bdesc, state->bs_dtuple, readers[i].tup);
+				brinReadSpilledTuple(&readers[i]);
+			}
+		}
+
+		form_and_insert_tuple(state);
+		state->bs_currRangeStart += state->bs_pagesPerRange;
+		brin_memtuple_initialize(state->bs_dtuple, state->bs_bdesc);
+	}
+
+	/* An empty table still gets a summary for its first range */
+	if (state->bs_numtuples == 0)
+		form_and_insert_tuple(state);
+
+	pfree(readers);
+
+	return reltuples;
+}
+
+/*
+ * Create parallel context, and launch workers for leader.
+ *
+ * heap and index are the relations to build a BRIN index on.
+ *
+ * isconcurrent indicates if operation is CREATE INDEX CONCURRENTLY.
+ *
+ * request is the target number of parallel worker processes to launch.
+ *
+ * Returns the leader state, which caller must pass to _brin_parallel_merge()
+ * and then to _brin_end_parallel().  If not even a single worker process can
+ * be launched, returns NULL, and caller should proceed with a serial build.
+ */
+static BrinLeader *
+_brin_begin_parallel(Relation heap, Relation index, bool isconcurrent,
+					 int request, BlockNumber pagesPerRange)
+{
+	ParallelContext *pcxt;
+	int			scanparticipants;
+	Snapshot	snapshot;
+	Size		estbrinshared;
+	BrinShared *brinshared;
+	BrinLeader *brinleader = (BrinLeader *) palloc0(sizeof(BrinLeader));
+	ParallelTableScanDesc pscan;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+	bool		leaderparticipates = true;
+	int			querylen;
+
+#ifdef DISABLE_LEADER_PARTICIPATION
+	leaderparticipates = false;
+#endif
+
+	/*
+	 * Enter parallel mode, and create context for parallel build of brin
+	 * index
+	 */
+	EnterParallelMode();
+	Assert(request > 0);
+	pcxt = CreateParallelContext("postgres", "_brin_parallel_build_main",
+								 request);
+
+	scanparticipants = leaderparticipates ? request + 1 : request;
+
+	/*
+	 * Prepare for scan of the base relation.  In a normal index build, we use
+	 * SnapshotAny because we must retrieve all tuples and do our own time
+	 * qual checks (because we have to index RECENTLY_DEAD tuples).  In a
+	 * concurrent build, we take a regular MVCC snapshot and index whatever's
+	 * live according to that.
+	 */
+	if (!isconcurrent)
+		snapshot = SnapshotAny;
+	else
+		snapshot = RegisterSnapshot(GetTransactionSnapshot());
+
+	/*
+	 * Estimate size for our own PARALLEL_KEY_BRIN_SHARED workspace.
+	 */
+	estbrinshared = _brin_parallel_estimate_shared(heap, snapshot);
+	shm_toc_estimate_chunk(&pcxt->estimator, estbrinshared);
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/*
+	 * Estimate space for WalUsage and BufferUsage -- PARALLEL_KEY_WAL_USAGE
+	 * and PARALLEL_KEY_BUFFER_USAGE.
+	 */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Finally, estimate PARALLEL_KEY_QUERY_TEXT space */
+	if (debug_query_string)
+	{
+		querylen = strlen(debug_query_string);
+		shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+	else
+		querylen = 0;			/* keep compiler quiet */
+
+	/* Everyone's had a chance to ask for space, so now create the DSM */
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out (do serial build) */
+	if (pcxt->seg == NULL)
+	{
+		if (IsMVCCSnapshot(snapshot))
+			UnregisterSnapshot(snapshot);
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		pfree(brinleader);
+		return NULL;
+	}
+
+	/* Store shared build state, for which we reserved space */
+	brinshared = (BrinShared *) shm_toc_allocate(pcxt->toc, estbrinshared);
+	/* Initialize immutable state */
+	brinshared->heaprelid = RelationGetRelid(heap);
+	brinshared->indexrelid = RelationGetRelid(index);
+	brinshared->isconcurrent = isconcurrent;
+	brinshared->pagesPerRange = pagesPerRange;
+	brinshared->scanparticipants = scanparticipants;
+	SharedFileSetInit(&brinshared->fileset, pcxt->seg);
+	ConditionVariableInit(&brinshared->workersdonecv);
+	SpinLockInit(&brinshared->mutex);
+	/* Initialize mutable state */
+	brinshared->nparticipantsdone = 0;
+	brinshared->reltuples = 0.0;
+	brinshared->brokenhotchain = false;
+	pscan = ParallelTableScanFromBrinShared(brinshared);
+	table_parallelscan_initialize(heap, pscan, snapshot);
+
+	/*
+	 * Participants rely on seeing their blocks in increasing order, so don't
+	 * let the scan start in the middle of the table.
+	 */
+	pscan->phs_syncscan = false;
+
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BRIN_SHARED, brinshared);
+
+	/* Store query string for workers */
+	if (debug_query_string)
+	{
+		char	   *sharedquery;
+
+		sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+		memcpy(sharedquery, debug_query_string, querylen + 1);
+		shm_toc_insert(pcxt->toc, PARALLEL_KEY_QUERY_TEXT, sharedquery);
+	}
+
+	/*
+	 * Allocate space for each worker's WalUsage and BufferUsage; no need to
+	 * initialize.
+	 */
+	walusage = shm_toc_allocate(pcxt->toc,
+								mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_WAL_USAGE, walusage);
+	bufferusage = shm_toc_allocate(pcxt->toc,
+								   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BUFFER_USAGE, bufferusage);
+
+	/* Launch workers, saving status for leader/caller */
+	LaunchParallelWorkers(pcxt);
+	brinleader->pcxt = pcxt;
+	brinleader->nparticipants = pcxt->nworkers_launched;
+	if (leaderparticipates)
+		brinleader->nparticipants++;
+	brinleader->leaderparticipates = leaderparticipates;
+	brinleader->brinshared = brinshared;
+	brinleader->snapshot = snapshot;
+	brinleader->walusage = walusage;
+	brinleader->bufferusage = bufferusage;
+
+	/* If no workers were successfully launched, back out (do serial build) */
+	if (pcxt->nworkers_launched == 0)
+	{
+		_brin_end_parallel(brinleader);
+		pfree(brinleader);
+		return NULL;
+	}
+
+	/* Join heap scan ourselves */
+	if (leaderparticipates)
+		_brin_parallel_scan_and_spill(heap, index, brinshared,
+									  pcxt->nworkers, true);
+
+	/*
+	 * Caller needs to wait for all launched workers when we return.  Make
+	 * sure that the failure-to-start case will not hang forever.
+	 */
+	WaitForParallelWorkersToAttach(pcxt);
+
+	return brinleader;
+}
+
+/*
+ * Shut down workers, destroy parallel context, and end parallel mode.
+ *
+ * This also removes the summary files, so the leader must be done merging
+ * them.
+ */
+static void
+_brin_end_parallel(BrinLeader *brinleader)
+{
+	int			i;
+
+	/* Shutdown worker processes */
+	WaitForParallelWorkersToFinish(brinleader->pcxt);
+
+	/*
+	 * Next, accumulate WAL usage.  (This must wait for the workers to finish,
+	 * or we might get incomplete data.)
+	 */
+	for (i = 0; i < brinleader->pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&brinleader->bufferusage[i], &brinleader->walusage[i]);
+
+	/* Free last reference to MVCC snapshot, if one was used */
+	if (IsMVCCSnapshot(brinleader->snapshot))
+		UnregisterSnapshot(brinleader->snapshot);
+	DestroyParallelContext(brinleader->pcxt);
+	ExitParallelMode();
+}
+
+/*
+ * Returns size of shared memory required to store state for a parallel
+ * brin index build based on the snapshot its parallel scan will use.
+ */
+static Size
+_brin_parallel_estimate_shared(Relation heap, Snapshot snapshot)
+{
+	/* c.f. shm_toc_allocate as to why BUFFERALIGN is used */
+	return add_size(BUFFERALIGN(sizeof(BrinShared)),
+					table_parallelscan_estimate(heap, snapshot));
+}
+
+/*
+ * Perform work within a launched parallel process.
+ */
+void
+_brin_parallel_build_main(dsm_segment *seg, shm_toc *toc)
+{
+	char	   *sharedquery;
+	BrinShared *brinshared;
+	Relation	heapRel;
+	Relation	indexRel;
+	LOCKMODE	heapLockmode;
+	LOCKMODE	indexLockmode;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+
+	/*
+	 * The only possible status flag that can be set to the parallel worker is
+	 * PROC_IN_SAFE_IC.
+	 */
+	Assert((MyProc->statusFlags == 0) ||
+		   (MyProc->statusFlags == PROC_IN_SAFE_IC));
+
+	/* Set debug_query_string for individual workers first */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_KEY_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+
+	/* Report the query string from leader */
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	/* Look up brin shared state */
+	brinshared = shm_toc_lookup(toc, PARALLEL_KEY_BRIN_SHARED, false);
+
+	/* Open relations using lock modes known to be obtained by index.c */
+	if (!brinshared->isconcurrent)
+	{
+		heapLockmode = ShareLock;
+		indexLockmode = AccessExclusiveLock;
+	}
+	else
+	{
+		heapLockmode = ShareUpdateExclusiveLock;
+		indexLockmode = RowExclusiveLock;
+	}
+
+	/* Open relations within worker */
+	heapRel = table_open(brinshared->heaprelid, heapLockmode);
+	indexRel = index_open(brinshared->indexrelid, indexLockmode);
+
+	/* Summary files must outlive us, until the leader has merged them */
+	SharedFileSetAttach(&brinshared->fileset, seg);
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	_brin_parallel_scan_and_spill(heapRel, indexRel, brinshared,
+								  ParallelWorkerNumber, false);
+
+	/* Report WAL/buffer usage during parallel execution */
+	bufferusage = shm_toc_lookup(toc, PARALLEL_KEY_BUFFER_USAGE, false);
+	walusage = shm_toc_lookup(toc, PARALLEL_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&bufferusage[ParallelWorkerNumber],
+						  &walusage[ParallelWorkerNumber]);
+
+	index_close(indexRel, indexLockmode);
+	table_close(heapRel, heapLockmode);
+}
+
+/*
+ * Perform a participant's portion of a parallel build: scan its share of the
+ * heap, and write the summaries of the ranges it saw to its file.
+ */
+static void
+_brin_parallel_scan_and_spill(Relation heap, Relation index,
+							  BrinShared *brinshared, int participant,
+							  bool progress)
+{
+	BrinBuildState *state;
+	TableScanDesc scan;
+	double		reltuples;
+	IndexInfo  *indexInfo;
+	char		name[MAXPGPATH];
+	Size		endmarker = 0;
+
+	/* Participants never touch the index, so they need no revmap */
+	state = initialize_brin_buildstate(index, NULL, brinshared->pagesPerRange);
+	brinSpillFileName(name, participant);
+	state->bs_spill = BufFileCreateShared(&brinshared->fileset, name);
+
+	/* Join parallel scan */
+	indexInfo = BuildIndexInfo(index);
+	indexInfo->ii_Concurrent = brinshared->isconcurrent;
+	scan = table_beginscan_parallel(heap,
+									ParallelTableScanFromBrinShared(brinshared));
+	reltuples = table_index_build_scan(heap, index, indexInfo, true, progress,
+									   brinbuildCallbackParallel,
+									   (void *) state, scan);
+
+	/* write out the last range, and terminate the file */
+	brinSpillCurrentRange(state);
+	BufFileWrite(state->bs_spill, &endmarker, sizeof(endmarker));
+	BufFileClose(state->bs_spill);
+
+	/*
+	 * Done.  Record ambuild statistics, and whether we encountered a broken
+	 * HOT chain.
+	 */
+	SpinLockAcquire(&brinshared->mutex);
+	brinshared->nparticipantsdone++;
+	brinshared->reltuples += reltuples;
+	if (indexInfo->ii_BrokenHotChain)
+		brinshared->brokenhotchain = true;
+	SpinLockRelease(&brinshared->mutex);
+
+	/* Notify leader */
+	ConditionVariableSignal(&brinshared->workersdonecv);
+
+	terminate_brin_buildstate(state);
+}
+
 void
 brinbuildempty(Relation index)
 {
@@ -1309,6 +2031,7 @@ initialize_brin_buildstate(Relation idxRel, BrinRevmap *revmap,
 	state->bs_pagesPerRange = pagesPerRange;
 	state->bs_currRangeStart = 0;
 	state->bs_rmAccess = revmap;
+	state->bs_spill = NULL;
 	state->bs_bdesc = brin_build_desc(idxRel);
 	state->bs_dtuple = brin_new_memtuple(state->bs_bdesc);
 
@@ -1585,6 +2308,62 @@ brinsummarize(Relation index, Relation heapRel, BlockNumber pageRange,
 	}
 }
 
+/*
+ * Summarize the page range starting at heapBlk on behalf of brininsert, which
+ * has just put the first tuple into it.  Returns true if the range has a
+ * summary tuple now, false if we didn't get to summarize it.
+ *
+ * Summarization relies on ShareUpdateExclusiveLock on the table to keep
+ * concurrent summarizers out of each other's way (see summarize_range).  An
+ * inserter must not wait for that, so if somebody else is summarizing or
+ * vacuuming the table we give up and leave the range to them, or to a later
+ * summarization run.
+ */
+static bool
+brin_summarize_new_range(Relation idxRel, Relation heapRel,
+						 BrinRevmap *revmap, BlockNumber heapBlk)
+{
+	IndexInfo  *indexInfo;
+	BrinBuildState *state;
+	MemoryContext cxt;
+	MemoryContext oldcxt;
+	Buffer		buf = InvalidBuffer;
+	OffsetNumber off;
+	BlockNumber pagesPerRange;
+
+	if (!ConditionalLockRelation(heapRel, ShareUpdateExclusiveLock))
+		return false;
+
+	cxt = AllocSetContextCreate(CurrentMemoryContext,
+								"brin insert summarize",
+								ALLOCSET_DEFAULT_SIZES);
+	oldcxt = MemoryContextSwitchTo(cxt);
+
+	pagesPerRange = BrinGetPagesPerRange(idxRel);
+
+	/* Somebody might have beaten us to it before we got the lock */
+	if (brinGetTupleForHeapBlock(revmap, heapBlk, &buf, &off, NULL,
+								 BUFFER_LOCK_SHARE, NULL) != NULL)
+		LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+	else
+	{
+		indexInfo = BuildIndexInfo(idxRel);
+		state = initialize_brin_buildstate(idxRel, revmap, pagesPerRange);
+		summarize_range(indexInfo, state, heapRel, heapBlk,
+						RelationGetNumberOfBlocks(heapRel));
+		terminate_brin_buildstate(state);
+	}
+	if (BufferIsValid(buf))
+		ReleaseBuffer(buf);
+
+	MemoryContextSwitchTo(oldcxt);
+	MemoryContextDelete(cxt);
+
+	UnlockRelation(heapRel, ShareUpdateExclusiveLock);
+
+	return true;
+}
+
 /*
  * Given a deformed tuple in the build state, convert it into the on-disk
  * format and insert it into the index, making the revmap point to it.
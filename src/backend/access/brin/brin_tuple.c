@@ -212,6 +212,21 @@ brin_form_tuple(BrinDesc *brdesc, BlockNumber blkno, BrinMemTuple *tuple,
 				free_value = true;
 			}
 
+			/* Don't keep values that need a zstd dictionary; see index_form_tuple */
+			if (VARATT_IS_COMPRESSED(DatumGetPointer(value)) &&
+				toast_compressed_needs_dictionary((struct varlena *)
+												  DatumGetPointer(value)))
+			{
+				Datum		plain;
+
+				plain = PointerGetDatum(detoast_attr((struct varlena *)
+													 DatumGetPointer(value)));
+				if (free_value)
+					pfree(DatumGetPointer(value));
+				value = plain;
+				free_value = true;
+			}
+
 			/*
 			 * If value is above size target, and is of a compressible
 			 * datatype, try to compress it in-line.
@@ -237,7 +252,8 @@ brin_form_tuple(BrinDesc *brdesc, BlockNumber blkno, BrinMemTuple *tuple,
 				else
 					compression = InvalidCompressionMethod;
 
-				cvalue = toast_compress_datum(value, compression);
+				cvalue = toast_compress_datum(value, compression,
+											  InvalidOid, InvalidAttrNumber);
 
 				if (DatumGetPointer(cvalue) != NULL)
 				{
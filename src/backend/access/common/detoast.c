@@ -28,6 +28,12 @@ static struct varlena *toast_fetch_datum_slice(struct varlena *attr,
 											   int32 slicelength);
 static struct varlena *toast_decompress_datum(struct varlena *attr);
 static struct varlena *toast_decompress_datum_slice(struct varlena *attr, int32 slicelength);
+static struct varlena *toast_fetch_datum_range(struct varlena *attr,
+												int32 offset, int32 length);
+static bool toast_external_is_segmented(struct varlena *attr);
+static struct varlena *toast_fetch_segmented_slice(struct varlena *attr,
+												   int32 sliceoffset,
+												   int32 slicelength);
 
 /* ----------
  * detoast_external_attr -
@@ -233,6 +239,10 @@ detoast_attr_slice(struct varlena *attr,
 		if (!VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer))
 			return toast_fetch_datum_slice(attr, sliceoffset, slicelength);
 
+		/* values compressed in segments need only the overlapping segments */
+		if (slicelimit >= 0 && toast_external_is_segmented(attr))
+			return toast_fetch_segmented_slice(attr, sliceoffset, slicelength);
+
 		/*
 		 * For compressed values, we need to fetch enough slices to decompress
 		 * at least the requested part (when a prefix is requested).
@@ -246,8 +256,8 @@ detoast_attr_slice(struct varlena *attr,
 			 * Determine maximum amount of compressed data needed for a prefix
 			 * of a given length (after decompression).
 			 *
-			 * At least for now, if it's LZ4 data, we'll have to fetch the
-			 * whole thing, because there doesn't seem to be an API call to
+			 * At least for now, if it's LZ4 or zstd data, we'll have to fetch
+			 * the whole thing, because there doesn't seem to be an API call to
 			 * determine how much compressed data we need to be sure of being
 			 * able to decompress the required slice.
 			 */
@@ -290,6 +300,16 @@ detoast_attr_slice(struct varlena *attr,
 	{
 		struct varlena *tmp = preslice;
 
+		/* Segments not overlapping the slice can be skipped altogether */
+		if (slicelimit >= 0 && TOAST_COMPRESS_IS_SEGMENTED(tmp))
+		{
+			result = segmented_decompress_datum_slice(tmp, sliceoffset,
+													  slicelength);
+			if (tmp != attr)
+				pfree(tmp);
+			return result;
+		}
+
 		/* Decompress enough to encompass the slice and the offset */
 		if (slicelimit >= 0)
 			preslice = toast_decompress_datum_slice(tmp, slicelimit);
@@ -332,6 +352,41 @@ detoast_attr_slice(struct varlena *attr,
 	return result;
 }
 
+/* ----------
+ * detoast_attr_is_seekable -
+ *
+ *	True if detoast_attr_slice can fetch any part of the datum at a cost
+ *	proportional to the slice rather than to its offset: that holds for
+ *	external values that are stored uncompressed or compressed in segments.
+ *	Callers that would otherwise need only a few scattered pieces of a large
+ *	value can use this to decide whether to fetch them piecewise.  For a
+ *	compressed external value, this reads its first toast chunk.
+ * ----------
+ */
+bool
+detoast_attr_is_seekable(struct varlena *attr)
+{
+	if (VARATT_IS_EXTERNAL_ONDISK(attr))
+	{
+		struct varatt_external toast_pointer;
+
+		VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
+
+		return !VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer) ||
+			toast_external_is_segmented(attr);
+	}
+	else if (VARATT_IS_EXTERNAL_INDIRECT(attr))
+	{
+		struct varatt_indirect redirect;
+
+		VARATT_EXTERNAL_GET_POINTER(redirect, attr);
+
+		return detoast_attr_is_seekable(redirect.pointer);
+	}
+
+	return false;
+}
+
 /* ----------
  * toast_fetch_datum -
  *
@@ -462,6 +517,167 @@ toast_fetch_datum_slice(struct varlena *attr, int32 sliceoffset,
 	return result;
 }
 
+/* ----------
+ * toast_fetch_datum_range -
+ *
+ *	Fetch a range of the bytes stored in the toast relation for an
+ *	external datum, as a plain varlena.  For a compressed datum this is
+ *	the compressed data, starting with its tcinfo word; unlike
+ *	toast_fetch_datum_slice, the range needn't be a prefix.
+ * ----------
+ */
+static struct varlena *
+toast_fetch_datum_range(struct varlena *attr, int32 offset, int32 length)
+{
+	Relation	toastrel;
+	struct varlena *result;
+	struct varatt_external toast_pointer;
+	int32		attrsize;
+
+	if (!VARATT_IS_EXTERNAL_ONDISK(attr))
+		elog(ERROR, "toast_fetch_datum_range shouldn't be called for non-ondisk datums");
+
+	/* Must copy to access aligned fields */
+	VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
+
+	attrsize = VARATT_EXTERNAL_GET_EXTSIZE(toast_pointer);
+
+	if (offset < 0 || length < 0 || offset > attrsize ||
+		length > attrsize - offset)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("requested range %d..%d of toast value %u is out of bounds",
+								 offset, offset + length,
+								 toast_pointer.va_valueid)));
+
+	result = (struct varlena *) palloc(length + VARHDRSZ);
+	SET_VARSIZE(result, length + VARHDRSZ);
+
+	if (length == 0)
+		return result;
+
+	toastrel = table_open(toast_pointer.va_toastrelid, AccessShareLock);
+
+	table_relation_fetch_toast_slice(toastrel, toast_pointer.va_valueid,
+									 attrsize, offset, length, result);
+
+	table_close(toastrel, AccessShareLock);
+
+	return result;
+}
+
+/* ----------
+ * toast_external_is_segmented -
+ *
+ *	Is a compressed external datum compressed in segments?  That is only
+ *	recorded in its data, so this reads the first byte after the tcinfo
+ *	word from the toast relation.
+ * ----------
+ */
+static bool
+toast_external_is_segmented(struct varlena *attr)
+{
+	struct varlena *first;
+	bool		result;
+
+	first = toast_fetch_datum_range(attr, sizeof(uint32), 1);
+	result = TOAST_DATA_IS_SEGMENTED(VARDATA(first));
+	pfree(first);
+
+	return result;
+}
+
+/* ----------
+ * toast_fetch_segmented_slice -
+ *
+ *	Fetch and decompress a slice of an external datum that was compressed
+ *	in segments.  Only the segment header and the segments overlapping the
+ *	slice are read from the toast relation.
+ * ----------
+ */
+static struct varlena *
+toast_fetch_segmented_slice(struct varlena *attr, int32 sliceoffset,
+							int32 slicelength)
+{
+	struct varatt_external toast_pointer;
+	struct varlena *result;
+	struct varlena *stored;
+	toast_segment_header *hdr;
+	int32		rawsize;
+	int32		extsize;
+	int32		fetched;
+	uint32		segsize;
+	int			nsegments;
+	int32		hdrend;
+	uint32		cstart;
+	uint32		cend;
+
+	VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
+	rawsize = toast_pointer.va_rawsize - VARHDRSZ;
+	extsize = VARATT_EXTERNAL_GET_EXTSIZE(toast_pointer);
+
+	if (sliceoffset >= rawsize)
+		sliceoffset = slicelength = 0;
+	else if (slicelength > rawsize - sliceoffset)
+		slicelength = rawsize - sliceoffset;
+
+	result = (struct varlena *) palloc(slicelength + VARHDRSZ);
+	SET_VARSIZE(result, slicelength + VARHDRSZ);
+	if (slicelength == 0)
+		return result;
+
+	/*
+	 * Read the tcinfo word and the segment header, guessing the header's
+	 * size from the segment size we compress with today.
+	 */
+	fetched = Min(extsize, sizeof(uint32) +
+				  TOAST_SEGMENT_HEADER_SIZE(TOAST_SEGMENT_COUNT(rawsize,
+																TOAST_SEGMENT_SIZE)));
+	stored = toast_fetch_datum_range(attr, 0, fetched);
+	if (fetched < sizeof(uint32) + TOAST_SEGMENT_HEADER_SIZE(1))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("compressed segment data is corrupt")));
+	memcpy(&segsize,
+		   VARDATA(stored) + sizeof(uint32) +
+		   offsetof(toast_segment_header, tsh_segsize),
+		   sizeof(uint32));
+	if (segsize == 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("compressed segment data is corrupt")));
+	nsegments = TOAST_SEGMENT_COUNT(rawsize, segsize);
+	hdrend = sizeof(uint32) + TOAST_SEGMENT_HEADER_SIZE(nsegments);
+	if (hdrend > fetched)
+	{
+		pfree(stored);
+		stored = toast_fetch_datum_range(attr, 0, hdrend);
+	}
+	hdr = (toast_segment_header *) palloc(TOAST_SEGMENT_HEADER_SIZE(nsegments));
+	memcpy(hdr, VARDATA(stored) + sizeof(uint32),
+		   TOAST_SEGMENT_HEADER_SIZE(nsegments));
+	pfree(stored);
+
+	/* Now read the data of the segments that overlap the slice */
+	cstart = sliceoffset < segsize ? 0 :
+		hdr->tsh_ends[sliceoffset / segsize - 1];
+	cend = hdr->tsh_ends[(sliceoffset + slicelength - 1) / segsize];
+	if (cend < cstart || cend > extsize - hdrend)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("compressed segment data is corrupt")));
+	stored = toast_fetch_datum_range(attr, hdrend + cstart, cend - cstart);
+
+	segmented_decompress_range(VARATT_EXTERNAL_GET_COMPRESS_METHOD(toast_pointer),
+							   hdr, rawsize, VARDATA(stored),
+							   sliceoffset, slicelength, VARDATA(result));
+
+	pfree(stored);
+	pfree(hdr);
+
+	return result;
+}
+
 /* ----------
  * toast_decompress_datum -
  *
@@ -478,6 +694,9 @@ toast_decompress_datum(struct varlena *attr)
 	 * Fetch the compression method id stored in the compression header and
 	 * decompress the data using the appropriate decompression routine.
 	 */
+	if (TOAST_COMPRESS_IS_SEGMENTED(attr))
+		return segmented_decompress_datum(attr);
+
 	cmid = TOAST_COMPRESS_METHOD(attr);
 	switch (cmid)
 	{
@@ -485,6 +704,8 @@ toast_decompress_datum(struct varlena *attr)
 			return pglz_decompress_datum(attr);
 		case TOAST_LZ4_COMPRESSION_ID:
 			return lz4_decompress_datum(attr);
+		case TOAST_ZSTD_COMPRESSION_ID:
+			return zstd_decompress_datum(attr);
 		default:
 			elog(ERROR, "invalid compression method id %d", cmid);
 			return NULL;		/* keep compiler quiet */
@@ -521,6 +742,9 @@ toast_decompress_datum_slice(struct varlena *attr, int32 slicelength)
 	 * Fetch the compression method id stored in the compression header and
 	 * decompress the data slice using the appropriate decompression routine.
 	 */
+	if (TOAST_COMPRESS_IS_SEGMENTED(attr))
+		return segmented_decompress_datum_slice(attr, 0, slicelength);
+
 	cmid = TOAST_COMPRESS_METHOD(attr);
 	switch (cmid)
 	{
@@ -528,6 +752,8 @@ toast_decompress_datum_slice(struct varlena *attr, int32 slicelength)
 			return pglz_decompress_datum_slice(attr, slicelength);
 		case TOAST_LZ4_COMPRESSION_ID:
 			return lz4_decompress_datum_slice(attr, slicelength);
+		case TOAST_ZSTD_COMPRESSION_ID:
+			return zstd_decompress_datum_slice(attr, slicelength);
 		default:
 			elog(ERROR, "invalid compression method id %d", cmid);
 			return NULL;		/* keep compiler quiet */
@@ -94,6 +94,26 @@ index_form_tuple(TupleDesc tupleDescriptor,
 			untoasted_free[i] = true;
 		}
 
+		/*
+		 * Don't keep values compressed with a zstd dictionary, since index
+		 * tuples are decompressed with buffer locks held, where the
+		 * dictionary can't be looked up.  They may be compressed again
+		 * below, without one.
+		 */
+		if (VARATT_IS_COMPRESSED(DatumGetPointer(untoasted_values[i])) &&
+			toast_compressed_needs_dictionary((struct varlena *)
+											  DatumGetPointer(untoasted_values[i])))
+		{
+			Datum		plain;
+
+			plain = PointerGetDatum(detoast_attr((struct varlena *)
+												 DatumGetPointer(untoasted_values[i])));
+			if (untoasted_free[i])
+				pfree(DatumGetPointer(untoasted_values[i]));
+			untoasted_values[i] = plain;
+			untoasted_free[i] = true;
+		}
+
 		/*
 		 * If value is above size target, and is of a compressible datatype,
 		 * try to compress it in-line.
@@ -106,7 +126,8 @@ index_form_tuple(TupleDesc tupleDescriptor,
 			Datum		cvalue;
 
 			cvalue = toast_compress_datum(untoasted_values[i],
-										  att->attcompression);
+										  att->attcompression,
+										  InvalidOid, InvalidAttrNumber);
 
 			if (DatumGetPointer(cvalue) != NULL)
 			{
@@ -24,6 +24,7 @@
 #include "access/nbtree.h"
 #include "access/reloptions.h"
 #include "access/spgist_private.h"
+#include "access/toast_compression.h"
 #include "catalog/pg_type.h"
 #include "commands/defrem.h"
 #include "commands/tablespace.h"
@@ -76,6 +77,9 @@
  * so the ANALYZE will not be affected by in-flight changes. Changing those
  * values has no effect until the next ANALYZE, so no need for stronger lock.
  *
+ * compression_level can be set at ShareUpdateExclusiveLock because it only
+ * affects how values written from now on are compressed.
+ *
  * Planner-related parameters can be set with ShareUpdateExclusiveLock because
  * they only affect planning and not the correctness of the execution. Plans
  * cannot be changed in mid-flight, so changes here could not easily result in
@@ -131,6 +135,25 @@ static relopt_bool boolRelOpts[] =
 		},
 		true
 	},
+	{
+		{
+			"autocleanup",
+			"Enables pending list cleanup by autovacuum for this GIN index",
+			RELOPT_KIND_GIN,
+			AccessExclusiveLock
+		},
+		false
+	},
+	{
+		{
+			"autosplit",
+			"Enables bucket splitting by autovacuum for this hash index",
+			RELOPT_KIND_HASH,
+			ShareUpdateExclusiveLock	/* since it applies only to later
+										 * inserts */
+		},
+		false
+	},
 	{
 		{
 			"security_barrier",
@@ -373,6 +396,15 @@ static relopt_int intRelOpts[] =
 		},
 		-1, 0, 1024
 	},
+	{
+		{
+			"compression_level",
+			"Sets the compression level used when values of a column are compressed with zstd.",
+			RELOPT_KIND_ATTRIBUTE,
+			ShareUpdateExclusiveLock
+		},
+		TOAST_ZSTD_DEFAULT_LEVEL, 1, TOAST_ZSTD_MAX_LEVEL
+	},
 
 	/* list terminator */
 	{{NULL}}
@@ -2065,7 +2097,8 @@ attribute_reloptions(Datum reloptions, bool validate)
 {
 	static const relopt_parse_elt tab[] = {
 		{"n_distinct", RELOPT_TYPE_REAL, offsetof(AttributeOpts, n_distinct)},
-		{"n_distinct_inherited", RELOPT_TYPE_REAL, offsetof(AttributeOpts, n_distinct_inherited)}
+		{"n_distinct_inherited", RELOPT_TYPE_REAL, offsetof(AttributeOpts, n_distinct_inherited)},
+		{"compression_level", RELOPT_TYPE_INT, offsetof(AttributeOpts, compression_level)}
 	};
 
 	return (bytea *) build_reloptions(reloptions, validate,
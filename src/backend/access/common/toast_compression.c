@@ -16,15 +16,36 @@
 #ifdef USE_LZ4
 #include <lz4.h>
 #endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#include <zdict.h>
+#endif
 
 #include "access/detoast.h"
+#include "access/table.h"
+#include "access/tableam.h"
 #include "access/toast_compression.h"
+#include "access/toast_internals.h"
+#include "catalog/catalog.h"
+#include "catalog/objectaddress.h"
+#include "catalog/pg_zstd_dictionary.h"
 #include "common/pg_lzcompress.h"
 #include "fmgr.h"
+#include "miscadmin.h"
+#include "utils/acl.h"
+#include "utils/attoptcache.h"
 #include "utils/builtins.h"
+#include "utils/hsearch.h"
+#include "utils/inval.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/sampling.h"
+#include "utils/snapmgr.h"
 
 /* GUC */
 int			default_toast_compression = TOAST_PGLZ_COMPRESSION;
+int			toast_segmented_min_size = 0;
 
 #define NO_LZ4_SUPPORT() \
 	ereport(ERROR, \
@@ -33,6 +54,67 @@ int			default_toast_compression = TOAST_PGLZ_COMPRESSION;
 			 errdetail("This functionality requires the server to be built with lz4 support."), \
 			 errhint("You need to rebuild PostgreSQL using %s.", "--with-lz4")))
 
+#define NO_ZSTD_SUPPORT() \
+	ereport(ERROR, \
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED), \
+			 errmsg("compression method zstd not supported"), \
+			 errdetail("This functionality requires the server to be built with zstd support."), \
+			 errhint("You need to rebuild PostgreSQL using %s.", "--with-zstd")))
+
+/*
+ * Limits for pg_zstd_train_dictionary.  Dictionaries help most with small
+ * values, so only the first ZSTD_TRAIN_MAX_SAMPLE_SIZE bytes of each sampled
+ * value are used for training.
+ */
+#define ZSTD_MIN_DICT_SIZE			256
+#define ZSTD_MAX_DICT_SIZE			(1024 * 1024)
+#define ZSTD_TRAIN_SAMPLE_ROWS		10000
+#define ZSTD_TRAIN_MAX_SAMPLE_SIZE	4096
+
+#ifdef USE_ZSTD
+/*
+ * Dictionaries loaded by this backend, keyed by dictionary OID.  A stored
+ * dictionary never changes, so entries are never invalidated.
+ */
+typedef struct ZstdDictEntry
+{
+	Oid			dictid;			/* hash key; must be first */
+	bytea	   *data;			/* dictionary contents, or NULL if not loaded */
+	ZSTD_DDict *ddict;			/* digested for decompression, or NULL */
+	ZSTD_CDict *cdict;			/* digested for compression, or NULL */
+	int			cdict_level;	/* compression level cdict was built for */
+} ZstdDictEntry;
+
+/*
+ * Dictionary to use when compressing each column.  Entries are dropped on
+ * relcache invalidation of their table, which pg_zstd_train_dictionary
+ * sends after storing a new dictionary.
+ */
+typedef struct ZstdColumnKey
+{
+	Oid			relid;
+	AttrNumber	attnum;
+} ZstdColumnKey;
+
+typedef struct ZstdColumnEntry
+{
+	ZstdColumnKey key;			/* hash key; must be first */
+	Oid			dictid;			/* InvalidOid if the column has none */
+} ZstdColumnEntry;
+
+static HTAB *ZstdDictHash = NULL;
+static HTAB *ZstdColumnHash = NULL;
+static ZSTD_CCtx *zstd_cctx = NULL;
+static ZSTD_DCtx *zstd_dctx = NULL;
+
+static void zstd_init_caches(void);
+static void zstd_invalidate_columns(Datum arg, Oid relid);
+static ZstdDictEntry *zstd_get_dictionary(Oid dictid);
+static ZSTD_CDict *zstd_get_column_cdict(Oid relid, AttrNumber attnum,
+										 int level);
+static ZSTD_DCtx *zstd_prepare_dctx(const char *src, size_t srcsize);
+#endif
+
 /*
  * Compress a varlena using PGLZ.
  *
@@ -247,6 +329,875 @@ lz4_decompress_datum_slice(const struct varlena *value, int32 slicelength)
 #endif
 }
 
+/*
+ * Compress a varlena using zstd.
+ *
+ * relid and attnum identify the column the value is stored in, if any; its
+ * compression_level option and most recently trained dictionary are used.
+ *
+ * Returns the compressed varlena, or NULL if compression fails.
+ */
+struct varlena *
+zstd_compress_datum(const struct varlena *value, Oid relid, AttrNumber attnum)
+{
+#ifndef USE_ZSTD
+	NO_ZSTD_SUPPORT();
+	return NULL;				/* keep compiler quiet */
+#else
+	int32		valsize;
+	size_t		len;
+	size_t		max_size;
+	int			level = TOAST_ZSTD_DEFAULT_LEVEL;
+	ZSTD_CDict *cdict = NULL;
+	struct varlena *tmp = NULL;
+
+	/*
+	 * Per-column settings only exist for user tables; system catalogs are
+	 * compressed with the defaults so that this never recurses into the
+	 * catalogs it reads.
+	 */
+	if (OidIsValid(relid) && !IsCatalogRelationOid(relid))
+	{
+		AttributeOpts *aopts = get_attribute_options(relid, attnum);
+
+		if (aopts != NULL)
+		{
+			level = aopts->compression_level;
+			pfree(aopts);
+		}
+		cdict = zstd_get_column_cdict(relid, attnum, level);
+	}
+
+	if (zstd_cctx == NULL)
+	{
+		zstd_cctx = ZSTD_createCCtx();
+		if (zstd_cctx == NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_OUT_OF_MEMORY),
+					 errmsg("out of memory")));
+	}
+
+	valsize = VARSIZE_ANY_EXHDR(value);
+
+	/*
+	 * Figure out the maximum possible size of the zstd output, add the bytes
+	 * that will be needed for varlena overhead, and allocate that amount.
+	 */
+	max_size = ZSTD_compressBound(valsize);
+	tmp = (struct varlena *) palloc(max_size + VARHDRSZ_COMPRESSED);
+
+	if (cdict != NULL)
+		len = ZSTD_compress_usingCDict(zstd_cctx,
+									   (char *) tmp + VARHDRSZ_COMPRESSED,
+									   max_size,
+									   VARDATA_ANY(value), valsize,
+									   cdict);
+	else
+		len = ZSTD_compressCCtx(zstd_cctx,
+								(char *) tmp + VARHDRSZ_COMPRESSED,
+								max_size,
+								VARDATA_ANY(value), valsize,
+								level);
+	if (ZSTD_isError(len))
+		elog(ERROR, "zstd compression failed: %s", ZSTD_getErrorName(len));
+
+	/* data is incompressible so just free the memory and return NULL */
+	if (len > valsize)
+	{
+		pfree(tmp);
+		return NULL;
+	}
+
+	SET_VARSIZE_COMPRESSED(tmp, len + VARHDRSZ_COMPRESSED);
+
+	return tmp;
+#endif
+}
+
+/*
+ * Decompress a varlena that was compressed using zstd.
+ */
+struct varlena *
+zstd_decompress_datum(const struct varlena *value)
+{
+#ifndef USE_ZSTD
+	NO_ZSTD_SUPPORT();
+	return NULL;				/* keep compiler quiet */
+#else
+	const char *src = (const char *) value + VARHDRSZ_COMPRESSED;
+	size_t		srcsize = VARSIZE(value) - VARHDRSZ_COMPRESSED;
+	size_t		rawsize;
+	ZSTD_DCtx  *dctx;
+	struct varlena *result;
+
+	dctx = zstd_prepare_dctx(src, srcsize);
+
+	/* allocate memory for the uncompressed data */
+	result = (struct varlena *) palloc(VARDATA_COMPRESSED_GET_EXTSIZE(value) + VARHDRSZ);
+
+	/* decompress the data, using the dictionary attached to dctx if any */
+	rawsize = ZSTD_decompressDCtx(dctx,
+								  VARDATA(result),
+								  VARDATA_COMPRESSED_GET_EXTSIZE(value),
+								  src, srcsize);
+	if (ZSTD_isError(rawsize))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("compressed zstd data is corrupt")));
+
+	SET_VARSIZE(result, rawsize + VARHDRSZ);
+
+	return result;
+#endif
+}
+
+/*
+ * Decompress part of a varlena that was compressed using zstd.
+ */
+struct varlena *
+zstd_decompress_datum_slice(const struct varlena *value, int32 slicelength)
+{
+#ifndef USE_ZSTD
+	NO_ZSTD_SUPPORT();
+	return NULL;				/* keep compiler quiet */
+#else
+	const char *src = (const char *) value + VARHDRSZ_COMPRESSED;
+	size_t		srcsize = VARSIZE(value) - VARHDRSZ_COMPRESSED;
+	ZSTD_DCtx  *dctx;
+	ZSTD_inBuffer in;
+	ZSTD_outBuffer out;
+	struct varlena *result;
+
+	dctx = zstd_prepare_dctx(src, srcsize);
+
+	/* allocate memory for the uncompressed data */
+	result = (struct varlena *) palloc(slicelength + VARHDRSZ);
+
+	/*
+	 * Stream the frame into an output buffer that only has room for the
+	 * slice; decompression stops as soon as the buffer is full.
+	 */
+	in.src = src;
+	in.size = srcsize;
+	in.pos = 0;
+	out.dst = VARDATA(result);
+	out.size = slicelength;
+	out.pos = 0;
+
+	while (out.pos < out.size && in.pos < in.size)
+	{
+		size_t		ret = ZSTD_decompressStream(dctx, &out, &in);
+
+		if (ZSTD_isError(ret))
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg_internal("compressed zstd data is corrupt")));
+		if (ret == 0)
+			break;				/* end of frame */
+	}
+
+	SET_VARSIZE(result, out.pos + VARHDRSZ);
+
+	return result;
+#endif
+}
+
+/*
+ * Stamp a dictionary ID into a trained zstd dictionary.
+ *
+ * The Zstandard format stores the ID right after the dictionary's magic
+ * number, as a little-endian 32-bit value, and copies it into the header of
+ * every frame compressed with the dictionary.  That lets decompression find
+ * the dictionary it needs from the compressed data alone.
+ */
+void
+zstd_set_dictionary_id(bytea *dict, Oid dictid)
+{
+#ifndef USE_ZSTD
+	NO_ZSTD_SUPPORT();
+#else
+	unsigned char *p = (unsigned char *) VARDATA(dict);
+	uint32		magic;
+
+	if (VARSIZE(dict) - VARHDRSZ < 8)
+		elog(ERROR, "zstd dictionary is too short");
+
+	magic = (uint32) p[0] | ((uint32) p[1] << 8) |
+		((uint32) p[2] << 16) | ((uint32) p[3] << 24);
+	if (magic != ZSTD_MAGIC_DICTIONARY)
+		elog(ERROR, "zstd dictionary has invalid magic number %08X", magic);
+
+	p[4] = dictid & 0xFF;
+	p[5] = (dictid >> 8) & 0xFF;
+	p[6] = (dictid >> 16) & 0xFF;
+	p[7] = (dictid >> 24) & 0xFF;
+#endif
+}
+
+#ifdef USE_ZSTD
+/*
+ * Set up the backend's dictionary caches on first use.
+ */
+static void
+zstd_init_caches(void)
+{
+	HASHCTL		ctl;
+
+	if (ZstdDictHash != NULL)
+		return;
+
+	ctl.keysize = sizeof(Oid);
+	ctl.entrysize = sizeof(ZstdDictEntry);
+	ctl.hcxt = CacheMemoryContext;
+	ZstdDictHash = hash_create("zstd dictionaries", 16, &ctl,
+							   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	ctl.keysize = sizeof(ZstdColumnKey);
+	ctl.entrysize = sizeof(ZstdColumnEntry);
+	ZstdColumnHash = hash_create("zstd column dictionaries", 64, &ctl,
+								 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	CacheRegisterRelcacheCallback(zstd_invalidate_columns, (Datum) 0);
+}
+
+/*
+ * Relcache invalidation callback: forget which dictionary the columns of
+ * the invalidated table use.
+ */
+static void
+zstd_invalidate_columns(Datum arg, Oid relid)
+{
+	HASH_SEQ_STATUS status;
+	ZstdColumnEntry *entry;
+
+	hash_seq_init(&status, ZstdColumnHash);
+	while ((entry = (ZstdColumnEntry *) hash_seq_search(&status)) != NULL)
+	{
+		if (relid == InvalidOid || entry->key.relid == relid)
+			hash_search(ZstdColumnHash, &entry->key, HASH_REMOVE, NULL);
+	}
+}
+
+/*
+ * Look up a dictionary by OID, loading its contents from pg_zstd_dictionary
+ * if this backend hasn't used it yet.
+ */
+static ZstdDictEntry *
+zstd_get_dictionary(Oid dictid)
+{
+	ZstdDictEntry *entry;
+	bool		found;
+
+	zstd_init_caches();
+
+	entry = (ZstdDictEntry *) hash_search(ZstdDictHash, &dictid,
+										  HASH_FIND, NULL);
+	if (entry == NULL)
+	{
+		bytea	   *data;
+		bytea	   *cached;
+
+		/*
+		 * Read the catalog in the caller's context, and keep only a copy of
+		 * the dictionary itself, so that whatever the scan leaks doesn't
+		 * accumulate in CacheMemoryContext.  As for attoptcache, the catalog
+		 * is read before the entry is created.
+		 */
+		data = ZstdDictionaryGetData(dictid);
+		if (data == NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("zstd dictionary %u does not exist", dictid)));
+		cached = MemoryContextAlloc(CacheMemoryContext, VARSIZE(data));
+		memcpy(cached, data, VARSIZE(data));
+		pfree(data);
+
+		entry = (ZstdDictEntry *) hash_search(ZstdDictHash, &dictid,
+											  HASH_ENTER, &found);
+		if (!found)
+		{
+			entry->data = cached;
+			entry->ddict = NULL;
+			entry->cdict = NULL;
+			entry->cdict_level = 0;
+		}
+		else
+			pfree(cached);
+	}
+
+	return entry;
+}
+
+/*
+ * Return the digested compression dictionary to use for a column, or NULL
+ * if no dictionary has been trained for it.
+ */
+static ZSTD_CDict *
+zstd_get_column_cdict(Oid relid, AttrNumber attnum, int level)
+{
+	ZstdColumnKey key;
+	ZstdColumnEntry *column;
+	ZstdDictEntry *dict;
+	Oid			dictid;
+
+	zstd_init_caches();
+
+	key.relid = relid;
+	key.attnum = attnum;
+	column = (ZstdColumnEntry *) hash_search(ZstdColumnHash, &key,
+											 HASH_FIND, NULL);
+	if (column != NULL)
+		dictid = column->dictid;
+	else
+	{
+		dictid = ZstdDictionaryGetLatest(relid, attnum);
+		column = (ZstdColumnEntry *) hash_search(ZstdColumnHash, &key,
+												 HASH_ENTER, NULL);
+		column->dictid = dictid;
+	}
+
+	if (!OidIsValid(dictid))
+		return NULL;
+
+	dict = zstd_get_dictionary(dictid);
+	if (dict->cdict == NULL || dict->cdict_level != level)
+	{
+		if (dict->cdict != NULL)
+			ZSTD_freeCDict(dict->cdict);
+		dict->cdict = ZSTD_createCDict(VARDATA(dict->data),
+									   VARSIZE(dict->data) - VARHDRSZ,
+									   level);
+		if (dict->cdict == NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_OUT_OF_MEMORY),
+					 errmsg("out of memory")));
+		dict->cdict_level = level;
+	}
+
+	return dict->cdict;
+}
+
+/*
+ * Get the backend's decompression context ready for a new frame, attaching
+ * the dictionary named in the frame header, if there is one.
+ */
+static ZSTD_DCtx *
+zstd_prepare_dctx(const char *src, size_t srcsize)
+{
+	unsigned	dictid;
+	ZSTD_DDict *ddict = NULL;
+
+	if (zstd_dctx == NULL)
+	{
+		zstd_dctx = ZSTD_createDCtx();
+		if (zstd_dctx == NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_OUT_OF_MEMORY),
+					 errmsg("out of memory")));
+	}
+
+	dictid = ZSTD_getDictID_fromFrame(src, srcsize);
+	if (dictid != 0)
+	{
+		ZstdDictEntry *dict = zstd_get_dictionary((Oid) dictid);
+
+		if (dict->ddict == NULL)
+		{
+			dict->ddict = ZSTD_createDDict(VARDATA(dict->data),
+										   VARSIZE(dict->data) - VARHDRSZ);
+			if (dict->ddict == NULL)
+				ereport(ERROR,
+						(errcode(ERRCODE_OUT_OF_MEMORY),
+						 errmsg("out of memory")));
+		}
+		ddict = dict->ddict;
+	}
+
+	ZSTD_DCtx_reset(zstd_dctx, ZSTD_reset_session_and_parameters);
+	ZSTD_DCtx_refDDict(zstd_dctx, ddict);
+
+	return zstd_dctx;
+}
+#endif							/* USE_ZSTD */
+
+/*
+ * pg_zstd_train_dictionary
+ *
+ * Train a zstd dictionary on a sample of a column's values and store it in
+ * pg_zstd_dictionary.  Values of the column compressed with zstd from now on
+ * use the new dictionary.  Returns the dictionary's OID.
+ */
+Datum
+pg_zstd_train_dictionary(PG_FUNCTION_ARGS)
+{
+#ifndef USE_ZSTD
+	NO_ZSTD_SUPPORT();
+	PG_RETURN_NULL();			/* keep compiler quiet */
+#else
+	Oid			relid = PG_GETARG_OID(0);
+	Name		attname = PG_GETARG_NAME(1);
+	int32		dictsize = PG_GETARG_INT32(2);
+	Relation	rel;
+	AttrNumber	attnum;
+	TableScanDesc scan;
+	TupleTableSlot *slot;
+	SamplerRandomState randstate;
+	bytea	  **samples;
+	int			nsamples = 0;
+	double		nseen = 0;
+	size_t		totalsize = 0;
+	char	   *samplebuf;
+	size_t	   *samplesizes;
+	size_t		pos;
+	bytea	   *dict;
+	size_t		len;
+	Oid			dictid;
+	MemoryContext traincxt;
+	MemoryContext oldcxt;
+	int			i;
+
+	if (dictsize < ZSTD_MIN_DICT_SIZE || dictsize > ZSTD_MAX_DICT_SIZE)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("dictionary size must be between %d and %d bytes",
+						ZSTD_MIN_DICT_SIZE, ZSTD_MAX_DICT_SIZE)));
+
+	rel = table_open(relid, ShareUpdateExclusiveLock);
+
+	if (rel->rd_rel->relkind != RELKIND_RELATION &&
+		rel->rd_rel->relkind != RELKIND_MATVIEW)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("\"%s\" is not a table or materialized view",
+						RelationGetRelationName(rel))));
+
+	if (IsSystemRelation(rel))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot train a compression dictionary for system catalog \"%s\"",
+						RelationGetRelationName(rel))));
+
+	if (!pg_class_ownercheck(relid, GetUserId()))
+		aclcheck_error(ACLCHECK_NOT_OWNER,
+					   get_relkind_objtype(rel->rd_rel->relkind),
+					   RelationGetRelationName(rel));
+
+	attnum = get_attnum(relid, NameStr(*attname));
+	if (attnum == InvalidAttrNumber)
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_COLUMN),
+				 errmsg("column \"%s\" of relation \"%s\" does not exist",
+						NameStr(*attname), RelationGetRelationName(rel))));
+	if (attnum < 0 ||
+		TupleDescAttr(RelationGetDescr(rel), attnum - 1)->attlen != -1)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("column \"%s\" does not have a variable-length data type",
+						NameStr(*attname))));
+
+	traincxt = AllocSetContextCreate(CurrentMemoryContext,
+									 "zstd dictionary training",
+									 ALLOCSET_DEFAULT_SIZES);
+	oldcxt = MemoryContextSwitchTo(traincxt);
+
+	/*
+	 * Collect a random sample of the column's values, using reservoir
+	 * sampling over a full scan of the table.
+	 */
+	samples = palloc0(sizeof(bytea *) * ZSTD_TRAIN_SAMPLE_ROWS);
+	sampler_random_init_state(random(), randstate);
+
+	scan = table_beginscan(rel, GetActiveSnapshot(), 0, NULL);
+	slot = table_slot_create(rel, NULL);
+
+	while (table_scan_getnextslot(scan, ForwardScanDirection, slot))
+	{
+		Datum		value;
+		bool		isnull;
+		struct varlena *detoasted;
+		int32		size;
+		bytea	   *sample;
+		int			k;
+
+		CHECK_FOR_INTERRUPTS();
+
+		value = slot_getattr(slot, attnum, &isnull);
+		if (isnull)
+			continue;
+
+		if (nsamples < ZSTD_TRAIN_SAMPLE_ROWS)
+			k = nsamples++;
+		else
+		{
+			/* replace a random sample with probability N / (nseen + 1) */
+			k = (int) ((nseen + 1) * sampler_random_fract(randstate));
+			if (k >= ZSTD_TRAIN_SAMPLE_ROWS)
+			{
+				nseen += 1;
+				continue;
+			}
+			totalsize -= VARSIZE(samples[k]) - VARHDRSZ;
+			pfree(samples[k]);
+		}
+		nseen += 1;
+
+		detoasted = pg_detoast_datum_packed((struct varlena *) DatumGetPointer(value));
+		size = Min(VARSIZE_ANY_EXHDR(detoasted), ZSTD_TRAIN_MAX_SAMPLE_SIZE);
+		sample = palloc(size + VARHDRSZ);
+		SET_VARSIZE(sample, size + VARHDRSZ);
+		memcpy(VARDATA(sample), VARDATA_ANY(detoasted), size);
+		if ((Pointer) detoasted != DatumGetPointer(value))
+			pfree(detoasted);
+
+		samples[k] = sample;
+		totalsize += size;
+	}
+
+	ExecDropSingleTupleTableSlot(slot);
+	table_endscan(scan);
+
+	if (nsamples == 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("column \"%s\" has no values to train a dictionary on",
+						NameStr(*attname))));
+
+	/* ZDICT wants the samples concatenated, with a separate array of sizes */
+	samplebuf = palloc(Max(totalsize, 1));
+	samplesizes = palloc(sizeof(size_t) * nsamples);
+	pos = 0;
+	for (i = 0; i < nsamples; i++)
+	{
+		samplesizes[i] = VARSIZE(samples[i]) - VARHDRSZ;
+		memcpy(samplebuf + pos, VARDATA(samples[i]), samplesizes[i]);
+		pos += samplesizes[i];
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+
+	dict = palloc(dictsize + VARHDRSZ);
+	len = ZDICT_trainFromBuffer(VARDATA(dict), dictsize,
+								samplebuf, samplesizes, nsamples);
+	if (ZDICT_isError(len))
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not train zstd dictionary for column \"%s\": %s",
+						NameStr(*attname), ZDICT_getErrorName(len)),
+				 errhint("Training needs a larger number of sample values, or a smaller dictionary size.")));
+	SET_VARSIZE(dict, len + VARHDRSZ);
+
+	MemoryContextDelete(traincxt);
+
+	dictid = ZstdDictionaryCreate(relid, attnum, dict);
+
+	table_close(rel, NoLock);
+
+	PG_RETURN_OID(dictid);
+#endif
+}
+
+/*
+ * Compress one segment of a value with the given method.
+ */
+static struct varlena *
+segment_compress(const struct varlena *segment, ToastCompressionId cmid,
+				 Oid relid, AttrNumber attnum)
+{
+	switch (cmid)
+	{
+		case TOAST_PGLZ_COMPRESSION_ID:
+			return pglz_compress_datum(segment);
+		case TOAST_LZ4_COMPRESSION_ID:
+			return lz4_compress_datum(segment);
+		case TOAST_ZSTD_COMPRESSION_ID:
+			return zstd_compress_datum(segment, relid, attnum);
+		default:
+			elog(ERROR, "invalid compression method id %d", cmid);
+			return NULL;		/* keep compiler quiet */
+	}
+}
+
+/*
+ * Decompress the first 'length' bytes of a segment whose raw size is
+ * 'rawlen', from its 'complen' bytes of data at 'src', into 'dest'.
+ */
+static void
+segment_decompress(ToastCompressionId cmid, const char *src, int32 complen,
+				   int32 rawlen, int32 length, char *dest)
+{
+	struct varlena *tmp;
+	struct varlena *result;
+
+	if (complen == rawlen)
+	{
+		/* stored uncompressed */
+		memcpy(dest, src, length);
+		return;
+	}
+	if (complen > rawlen)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("compressed segment data is corrupt")));
+
+	/* Wrap the segment in a compressed varlena of its own */
+	tmp = (struct varlena *) palloc(complen + VARHDRSZ_COMPRESSED);
+	SET_VARSIZE_COMPRESSED(tmp, complen + VARHDRSZ_COMPRESSED);
+	TOAST_COMPRESS_SET_SIZE_AND_COMPRESS_METHOD(tmp, rawlen, cmid);
+	memcpy((char *) tmp + VARHDRSZ_COMPRESSED, src, complen);
+
+	switch (cmid)
+	{
+		case TOAST_PGLZ_COMPRESSION_ID:
+			result = length < rawlen ?
+				pglz_decompress_datum_slice(tmp, length) :
+				pglz_decompress_datum(tmp);
+			break;
+		case TOAST_LZ4_COMPRESSION_ID:
+			result = length < rawlen ?
+				lz4_decompress_datum_slice(tmp, length) :
+				lz4_decompress_datum(tmp);
+			break;
+		case TOAST_ZSTD_COMPRESSION_ID:
+			result = length < rawlen ?
+				zstd_decompress_datum_slice(tmp, length) :
+				zstd_decompress_datum(tmp);
+			break;
+		default:
+			elog(ERROR, "invalid compression method id %d", cmid);
+			result = NULL;		/* keep compiler quiet */
+	}
+
+	if (VARSIZE(result) - VARHDRSZ < length)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("compressed segment data is corrupt")));
+	memcpy(dest, VARDATA(result), length);
+
+	pfree(result);
+	pfree(tmp);
+}
+
+/*
+ * Compress a varlena in segments, using the given method for each of them.
+ *
+ * Returns the compressed varlena, or NULL if compression fails.  The caller
+ * sets the size and method in its compression header, as for a value
+ * compressed as a whole.
+ */
+struct varlena *
+segmented_compress_datum(const struct varlena *value, ToastCompressionId cmid,
+						 Oid relid, AttrNumber attnum)
+{
+	int32		valsize = VARSIZE_ANY_EXHDR(value);
+	const char *src = VARDATA_ANY(value);
+	int			nsegments = TOAST_SEGMENT_COUNT(valsize, TOAST_SEGMENT_SIZE);
+	Size		hdrsize = TOAST_SEGMENT_HEADER_SIZE(nsegments);
+	toast_segment_header *hdr;
+	struct varlena *segment;
+	struct varlena *result;
+	char	   *dest;
+	uint32		end = 0;
+	int			i;
+
+	/* Build the header separately, since it's not aligned in the result */
+	hdr = (toast_segment_header *) palloc0(hdrsize);
+	hdr->tsh_marker = TOAST_SEGMENTED_MARKER;
+	hdr->tsh_segsize = TOAST_SEGMENT_SIZE;
+
+	/* We give up as soon as the result would be no smaller than the input */
+	result = (struct varlena *) palloc(VARHDRSZ_COMPRESSED + valsize);
+	dest = (char *) result + VARHDRSZ_COMPRESSED + hdrsize;
+
+	segment = (struct varlena *) palloc(TOAST_SEGMENT_SIZE + VARHDRSZ);
+
+	for (i = 0; i < nsegments; i++)
+	{
+		int32		seglen = Min(TOAST_SEGMENT_SIZE,
+								 valsize - i * TOAST_SEGMENT_SIZE);
+		struct varlena *tmp;
+		const char *data;
+		int32		datalen;
+
+		SET_VARSIZE(segment, seglen + VARHDRSZ);
+		memcpy(VARDATA(segment), src + i * TOAST_SEGMENT_SIZE, seglen);
+
+		tmp = segment_compress(segment, cmid, relid, attnum);
+		if (tmp != NULL && VARSIZE(tmp) - VARHDRSZ_COMPRESSED < seglen)
+		{
+			data = (char *) tmp + VARHDRSZ_COMPRESSED;
+			datalen = VARSIZE(tmp) - VARHDRSZ_COMPRESSED;
+		}
+		else
+		{
+			data = VARDATA(segment);
+			datalen = seglen;
+		}
+
+		if (hdrsize + end + datalen >= valsize)
+		{
+			if (tmp != NULL)
+				pfree(tmp);
+			pfree(segment);
+			pfree(result);
+			pfree(hdr);
+			return NULL;
+		}
+
+		memcpy(dest + end, data, datalen);
+		end += datalen;
+		hdr->tsh_ends[i] = end;
+
+		if (tmp != NULL)
+			pfree(tmp);
+	}
+
+	memcpy((char *) result + VARHDRSZ_COMPRESSED, hdr, hdrsize);
+	SET_VARSIZE_COMPRESSED(result, VARHDRSZ_COMPRESSED + hdrsize + end);
+
+	pfree(segment);
+	pfree(hdr);
+
+	return result;
+}
+
+/*
+ * Decompress 'length' raw bytes starting at 'offset' of a value compressed
+ * in segments with method 'cmid', into 'dest'.
+ *
+ * 'hdr' is the value's segment header (suitably aligned) and 'rawsize' its
+ * decompressed size.  'data' points to the stored data of the segment that
+ * contains 'offset', and must extend at least to the end of the segment that
+ * contains the last requested byte; detoast.c uses this to fetch only the
+ * segments it needs from the TOAST table.  The requested range must lie
+ * within the value.
+ */
+void
+segmented_decompress_range(ToastCompressionId cmid,
+						   const toast_segment_header *hdr, int32 rawsize,
+						   const char *data, int32 offset, int32 length,
+						   char *dest)
+{
+	uint32		segsize = hdr->tsh_segsize;
+	int			nsegments;
+	int			seg;
+	uint32		datastart;
+
+	if (segsize == 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("compressed segment data is corrupt")));
+	nsegments = TOAST_SEGMENT_COUNT(rawsize, segsize);
+
+	Assert(offset >= 0 && length >= 0 && offset + length <= rawsize);
+
+	seg = offset / segsize;
+	datastart = seg == 0 ? 0 : hdr->tsh_ends[seg - 1];
+
+	while (length > 0)
+	{
+		int32		segstart = seg * segsize;
+		int32		seglen = Min(segsize, rawsize - segstart);
+		uint32		cstart = seg == 0 ? 0 : hdr->tsh_ends[seg - 1];
+		int32		skip = offset - segstart;
+		int32		n = Min(length, seglen - skip);
+		char	   *buf;
+
+		if (seg >= nsegments || hdr->tsh_ends[seg] < cstart)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg_internal("compressed segment data is corrupt")));
+
+		if (skip == 0)
+			segment_decompress(cmid, data + (cstart - datastart),
+							   hdr->tsh_ends[seg] - cstart, seglen,
+							   n, dest);
+		else
+		{
+			buf = palloc(skip + n);
+			segment_decompress(cmid, data + (cstart - datastart),
+							   hdr->tsh_ends[seg] - cstart, seglen,
+							   skip + n, buf);
+			memcpy(dest, buf + skip, n);
+			pfree(buf);
+		}
+
+		dest += n;
+		offset += n;
+		length -= n;
+		seg++;
+	}
+}
+
+/*
+ * Decompress a varlena that was compressed in segments.
+ */
+struct varlena *
+segmented_decompress_datum(const struct varlena *value)
+{
+	return segmented_decompress_datum_slice(value, 0,
+											VARDATA_COMPRESSED_GET_EXTSIZE(value));
+}
+
+/*
+ * Decompress part of a varlena that was compressed in segments.  Unlike the
+ * other methods' slice routines, the slice needn't be a prefix: only the
+ * segments it overlaps are decompressed.
+ */
+struct varlena *
+segmented_decompress_datum_slice(const struct varlena *value,
+								 int32 sliceoffset, int32 slicelength)
+{
+	int32		rawsize = VARDATA_COMPRESSED_GET_EXTSIZE(value);
+	const char *stored = (const char *) value + VARHDRSZ_COMPRESSED;
+	toast_segment_header *hdr;
+	uint32		segsize;
+	int			nsegments;
+	Size		hdrsize;
+	struct varlena *result;
+
+	if (sliceoffset >= rawsize)
+		sliceoffset = slicelength = 0;
+	else if (slicelength > rawsize - sliceoffset)
+		slicelength = rawsize - sliceoffset;
+
+	result = (struct varlena *) palloc(slicelength + VARHDRSZ);
+	SET_VARSIZE(result, slicelength + VARHDRSZ);
+	if (slicelength == 0)
+		return result;
+
+	/* copy the header, to get it aligned */
+	memcpy(&segsize, stored + offsetof(toast_segment_header, tsh_segsize),
+		   sizeof(uint32));
+	if (segsize == 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("compressed segment data is corrupt")));
+	nsegments = TOAST_SEGMENT_COUNT(rawsize, segsize);
+	hdrsize = TOAST_SEGMENT_HEADER_SIZE(nsegments);
+	if (hdrsize > VARSIZE(value) - VARHDRSZ_COMPRESSED)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("compressed segment data is corrupt")));
+	hdr = (toast_segment_header *) palloc(hdrsize);
+	memcpy(hdr, stored, hdrsize);
+	if (hdr->tsh_ends[nsegments - 1] >
+		VARSIZE(value) - VARHDRSZ_COMPRESSED - hdrsize)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("compressed segment data is corrupt")));
+
+	segmented_decompress_range(VARDATA_COMPRESSED_GET_COMPRESS_METHOD(value),
+							   hdr, rawsize,
+							   stored + hdrsize +
+							   (sliceoffset < segsize ? 0 :
+								hdr->tsh_ends[sliceoffset / segsize - 1]),
+							   sliceoffset, slicelength, VARDATA(result));
+
+	pfree(hdr);
+
+	return result;
+}
+
 /*
  * Extract compression ID from a varlena.
  *
@@ -277,6 +1228,33 @@ toast_get_compression_id(struct varlena *attr)
 	return cmid;
 }
 
+/*
+ * Does decompressing an in-line compressed varlena need a zstd dictionary?
+ *
+ * Dictionaries are read from pg_zstd_dictionary on first use.  Index tuples
+ * can be decompressed while buffer locks are held, when that isn't safe, so
+ * index_form_tuple uses this to keep such values out of them.
+ */
+bool
+toast_compressed_needs_dictionary(struct varlena *attr)
+{
+#ifdef USE_ZSTD
+	Assert(VARATT_IS_COMPRESSED(attr));
+
+	if (toast_get_compression_id(attr) != TOAST_ZSTD_COMPRESSION_ID)
+		return false;
+
+	/* For segmented values, don't bother to look at each segment */
+	if (TOAST_COMPRESS_IS_SEGMENTED(attr))
+		return true;
+
+	return ZSTD_getDictID_fromFrame((char *) attr + VARHDRSZ_COMPRESSED,
+									VARSIZE(attr) - VARHDRSZ_COMPRESSED) != 0;
+#else
+	return false;
+#endif
+}
+
 /*
  * CompressionNameToMethod - Get compression method from compression name
  *
@@ -295,6 +1273,13 @@ CompressionNameToMethod(const char *compression)
 #endif
 		return TOAST_LZ4_COMPRESSION;
 	}
+	else if (strcmp(compression, "zstd") == 0)
+	{
+#ifndef USE_ZSTD
+		NO_ZSTD_SUPPORT();
+#endif
+		return TOAST_ZSTD_COMPRESSION;
+	}
 
 	return InvalidCompressionMethod;
 }
@@ -311,6 +1296,8 @@ GetCompressionMethodName(char method)
 			return "pglz";
 		case TOAST_LZ4_COMPRESSION:
 			return "lz4";
+		case TOAST_ZSTD_COMPRESSION:
+			return "zstd";
 		default:
 			elog(ERROR, "invalid compression method %c", method);
 			return NULL;		/* keep compiler quiet */
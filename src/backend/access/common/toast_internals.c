@@ -41,10 +41,14 @@ static bool toastid_valueid_exists(Oid toastrelid, Oid valueid);
  *
  *	We use VAR{SIZE,DATA}_ANY so we can handle short varlenas here without
  *	copying them.  But we can't handle external or compressed datums.
+ *
+ *	relid and attnum identify the table column the value belongs to, if
+ *	any; zstd uses them to look up the column's compression level and
+ *	dictionary.  Pass InvalidOid when there is no such column.
  * ----------
  */
 Datum
-toast_compress_datum(Datum value, char cmethod)
+toast_compress_datum(Datum value, char cmethod, Oid relid, AttrNumber attnum)
 {
 	struct varlena *tmp = NULL;
 	int32		valsize;
@@ -60,22 +64,37 @@ toast_compress_datum(Datum value, char cmethod)
 		cmethod = default_toast_compression;
 
 	/*
-	 * Call appropriate compression routine for the compression method.
+	 * Call the appropriate compression routine for the compression method.
+	 * Large values are compressed in segments, if enabled, so that parts of
+	 * them can be decompressed on their own.
 	 */
 	switch (cmethod)
 	{
 		case TOAST_PGLZ_COMPRESSION:
-			tmp = pglz_compress_datum((const struct varlena *) value);
 			cmid = TOAST_PGLZ_COMPRESSION_ID;
 			break;
 		case TOAST_LZ4_COMPRESSION:
-			tmp = lz4_compress_datum((const struct varlena *) value);
 			cmid = TOAST_LZ4_COMPRESSION_ID;
 			break;
+		case TOAST_ZSTD_COMPRESSION:
+			cmid = TOAST_ZSTD_COMPRESSION_ID;
+			break;
 		default:
 			elog(ERROR, "invalid compression method %c", cmethod);
 	}
 
+	if (toast_segmented_min_size > 0 &&
+		valsize >= (int64) toast_segmented_min_size * 1024)
+		tmp = segmented_compress_datum((const struct varlena *) value,
+									   cmid, relid, attnum);
+	else if (cmid == TOAST_PGLZ_COMPRESSION_ID)
+		tmp = pglz_compress_datum((const struct varlena *) value);
+	else if (cmid == TOAST_LZ4_COMPRESSION_ID)
+		tmp = lz4_compress_datum((const struct varlena *) value);
+	else
+		tmp = zstd_compress_datum((const struct varlena *) value,
+								  relid, attnum);
+
 	if (tmp == NULL)
 		return PointerGetDatum(NULL);
 
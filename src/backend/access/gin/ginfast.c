@@ -41,6 +41,12 @@ int			gin_pending_list_limit = 0;
 #define GIN_PAGE_FREESIZE \
 	( BLCKSZ - MAXALIGN(SizeOfPageHeaderData) - MAXALIGN(sizeof(GinPageOpaqueData)) )
 
+/*
+ * With autocleanup, inserters leave the pending list to autovacuum until it
+ * reaches this multiple of the cleanup threshold.
+ */
+#define GIN_AUTOCLEANUP_FALLBACK	4
+
 typedef struct KeyArray
 {
 	Datum	   *keys;			/* expansible array */
@@ -228,6 +234,7 @@ ginHeapTupleFastInsert(GinState *ginstate, GinTupleCollector *collector)
 	bool		separateList = false;
 	bool		needCleanup = false;
 	int			cleanupSize;
+	int64		pendingSize;
 	bool		needWal;
 
 	if (collector->ntuples == 0)
@@ -455,13 +462,36 @@ ginHeapTupleFastInsert(GinState *ginstate, GinTupleCollector *collector)
 	 * ginInsertCleanup() should not be called inside our CRIT_SECTION.
 	 */
 	cleanupSize = GinGetPendingListCleanupSize(index);
-	if (metadata->nPendingPages * GIN_PAGE_FREESIZE > cleanupSize * 1024L)
+	pendingSize = metadata->nPendingPages * GIN_PAGE_FREESIZE;
+	if (pendingSize > cleanupSize * 1024L)
 		needCleanup = true;
 
 	UnlockReleaseBuffer(metabuffer);
 
 	END_CRIT_SECTION();
 
+	/*
+	 * With autocleanup, hand the work to autovacuum, which drains the whole
+	 * list in large sorted batches using maintenance_work_mem, and keep the
+	 * inserting backend out of it.  We still clean up ourselves if the
+	 * request can't be queued, or if the list has grown so far past the
+	 * limit that autovacuum evidently isn't keeping up.
+	 */
+	if (needCleanup && GinGetAutoCleanup(index) &&
+		!RelationUsesLocalBuffers(index) &&
+		pendingSize <= GIN_AUTOCLEANUP_FALLBACK * cleanupSize * 1024L)
+	{
+		if (AutoVacuumRequestWork(AVW_GINCleanupPendingList,
+								  RelationGetRelid(index),
+								  InvalidBlockNumber))
+			needCleanup = false;
+		else
+			ereport(LOG,
+					(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+					 errmsg("request for GIN pending list cleanup for index \"%s\" was not recorded",
+							RelationGetRelationName(index))));
+	}
+
 	/*
 	 * Since it could contend with concurrent cleanup process we cleanup
 	 * pending list not forcibly.
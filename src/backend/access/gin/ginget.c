@@ -792,6 +792,51 @@ entryLoadMoreItems(GinState *ginstate, GinScanEntry entry,
 #define gin_rand() (((double) random()) / ((double) MAX_RANDOM_VALUE))
 #define dropItem(e) ( gin_rand() > ((double)GinFuzzySearchLimit)/((double)((e)->predictNumberResult)) )
 
+/*
+ * Advance entry->offset to the first item in entry->list that is >
+ * advancePast, or to entry->nlist if there is none.
+ *
+ * When intersecting a frequent entry with a rare one, most of the frequent
+ * entry's items are skipped, so rather than stepping through them one at a
+ * time we gallop: probe at exponentially growing distances until we
+ * overshoot, then binary search the last interval.
+ */
+static inline void
+entrySkipPast(GinScanEntry entry, ItemPointerData advancePast)
+{
+	int			lo = entry->offset;
+	int			hi;
+	int			step = 1;
+
+	if (lo >= entry->nlist ||
+		ginCompareItemPointers(&entry->list[lo], &advancePast) > 0)
+		return;
+
+	/* list[lo] <= advancePast; find hi with list[hi] > advancePast */
+	hi = lo + 1;
+	while (hi < entry->nlist &&
+		   ginCompareItemPointers(&entry->list[hi], &advancePast) <= 0)
+	{
+		lo = hi;
+		step *= 2;
+		hi = lo + step;
+	}
+	hi = Min(hi, entry->nlist);
+
+	/* Now list[lo] <= advancePast, and list[hi] > advancePast if it exists */
+	while (hi - lo > 1)
+	{
+		int			mid = lo + (hi - lo) / 2;
+
+		if (ginCompareItemPointers(&entry->list[mid], &advancePast) <= 0)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	entry->offset = hi;
+}
+
 /*
  * Sets entry->curItem to next heap item pointer > advancePast, for one entry
  * of one scan key, or sets entry->isFinished to true if there are no more.
@@ -912,6 +957,8 @@ entryGetItem(GinState *ginstate, GinScanEntry entry,
 		 */
 		for (;;)
 		{
+			entrySkipPast(entry, advancePast);
+
 			if (entry->offset >= entry->nlist)
 			{
 				ItemPointerSetInvalid(&entry->curItem);
@@ -920,10 +967,7 @@ entryGetItem(GinState *ginstate, GinScanEntry entry,
 			}
 
 			entry->curItem = entry->list[entry->offset++];
-
-			/* If we're not past advancePast, keep scanning */
-			if (ginCompareItemPointers(&entry->curItem, &advancePast) <= 0)
-				continue;
+			Assert(ginCompareItemPointers(&entry->curItem, &advancePast) > 0);
 
 			/* Done unless we need to reduce the result */
 			if (!entry->reduceResult || !dropItem(entry))
@@ -947,12 +991,14 @@ entryGetItem(GinState *ginstate, GinScanEntry entry,
 				}
 			}
 
-			entry->curItem = entry->list[entry->offset++];
-
-			/* If we're not past advancePast, keep scanning */
-			if (ginCompareItemPointers(&entry->curItem, &advancePast) <= 0)
+			/* If the whole batch is <= advancePast, load the next one */
+			entrySkipPast(entry, advancePast);
+			if (entry->offset >= entry->nlist)
 				continue;
 
+			entry->curItem = entry->list[entry->offset++];
+			Assert(ginCompareItemPointers(&entry->curItem, &advancePast) > 0);
+
 			/* Done unless we need to reduce the result */
 			if (!entry->reduceResult || !dropItem(entry))
 				break;
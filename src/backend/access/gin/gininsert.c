@@ -16,16 +16,126 @@
 
 #include "access/gin_private.h"
 #include "access/ginxlog.h"
+#include "access/parallel.h"
+#include "access/table.h"
 #include "access/tableam.h"
+#include "access/xact.h"
 #include "access/xloginsert.h"
 #include "catalog/index.h"
+#include "executor/instrument.h"
+#include "lib/binaryheap.h"
 #include "miscadmin.h"
+#include "pgstat.h"
+#include "storage/buffile.h"
 #include "storage/bufmgr.h"
+#include "storage/condition_variable.h"
 #include "storage/indexfsm.h"
 #include "storage/predicate.h"
+#include "storage/proc.h"
+#include "storage/sharedfileset.h"
 #include "storage/smgr.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"		/* pgrminclude ignore */
+#include "utils/datum.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/snapmgr.h"
+
+/* Magic numbers for parallel state sharing */
+#define PARALLEL_KEY_GIN_SHARED			UINT64CONST(0xB000000000000001)
+#define PARALLEL_KEY_GIN_RUNS			UINT64CONST(0xB000000000000002)
+#define PARALLEL_KEY_QUERY_TEXT			UINT64CONST(0xB000000000000003)
+#define PARALLEL_KEY_WAL_USAGE			UINT64CONST(0xB000000000000004)
+#define PARALLEL_KEY_BUFFER_USAGE		UINT64CONST(0xB000000000000005)
+
+/*
+ * DISABLE_LEADER_PARTICIPATION disables the leader's participation in
+ * parallel index builds.  This may be useful as a debugging aid.
+#undef DISABLE_LEADER_PARTICIPATION
+ */
+
+/*
+ * Status for index builds performed in parallel.  This is allocated in a
+ * dynamic shared memory segment.
+ *
+ * Each participant scans part of the heap, accumulating entries in its own
+ * BuildAccumulator.  Whenever that fills up, the accumulated entries are
+ * written out in key order as a "run" to a file in the shared fileset.  Once
+ * the scan is done, the leader merges all runs and inserts each key's
+ * complete posting list into the index, so that only the leader ever writes
+ * index pages.
+ */
+typedef struct GinShared
+{
+	/*
+	 * These fields are not modified during the build.
+	 */
+	Oid			heaprelid;
+	Oid			indexrelid;
+	bool		isconcurrent;
+	int			scanparticipants;
+
+	/* Run files written by participants */
+	SharedFileSet fileset;
+
+	/*
+	 * workersdonecv is used to monitor the progress of workers.  All parallel
+	 * participants must indicate that they are done before leader can read
+	 * their runs.
+	 */
+	ConditionVariable workersdonecv;
+
+	/*
+	 * mutex protects all fields below, and the per-participant run counts
+	 * stored under PARALLEL_KEY_GIN_RUNS.
+	 */
+	slock_t		mutex;
+
+	/*
+	 * Mutable state that is maintained by workers, and reported back to
+	 * leader at end of parallel scan.
+	 */
+	int			nparticipantsdone;
+	double		reltuples;
+	double		indtuples;
+	bool		brokenhotchain;
+
+	/*
+	 * ParallelTableScanDescData data follows. Can't directly embed here, as
+	 * implementations of the parallel table scan desc interface might need
+	 * stronger alignment.
+	 */
+} GinShared;
+
+/*
+ * Return pointer to a GinShared's parallel table scan.
+ *
+ * c.f. shm_toc_allocate as to why BUFFERALIGN is used, rather than just
+ * MAXALIGN.
+ */
+#define ParallelTableScanFromGinShared(shared) \
+	(ParallelTableScanDesc) ((char *) (shared) + BUFFERALIGN(sizeof(GinShared)))
+
+/*
+ * Status for leader in parallel index build.
+ */
+typedef struct GinLeader
+{
+	/* parallel context itself */
+	ParallelContext *pcxt;
+
+	/*
+	 * Leader process convenience pointers to shared state (leader avoids TOC
+	 * lookups).  nruns has one slot per requested worker, plus a last one
+	 * for the leader.
+	 */
+	GinShared  *ginshared;
+	int		   *nruns;
+	int			nparticipants;
+	Snapshot	snapshot;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+} GinLeader;
 
 typedef struct
 {
@@ -35,8 +145,58 @@ typedef struct
 	MemoryContext tmpCtx;
 	MemoryContext funcCtx;
 	BuildAccumulator accum;
+	int			workMem;		/* accumulator memory limit, in KB */
+
+	/* Only set in a participant of a parallel build */
+	GinShared  *ginshared;
+	int			participant;
+	int			nruns;
 } GinBuildState;
 
+/*
+ * Header of one entry of a run file.  It is followed by the entry's key, in
+ * datumSerialize() format, and then by its item pointers.  A header with an
+ * invalid attnum ends the run.
+ */
+typedef struct GinRunEntry
+{
+	OffsetNumber attnum;
+	GinNullCategory category;
+	uint32		nitems;
+	Size		keysize;
+} GinRunEntry;
+
+/*
+ * Leader's read position in one run, holding the run's current entry.
+ */
+typedef struct GinRunReader
+{
+	BufFile    *file;
+	OffsetNumber attnum;
+	GinNullCategory category;
+	Datum		key;
+	ItemPointerData *items;
+	uint32		nitems;
+} GinRunReader;
+
+typedef struct GinRunMerge
+{
+	GinState   *ginstate;
+	GinRunReader *readers;
+} GinRunMerge;
+
+static void ginWriteBuildRun(GinBuildState *buildstate);
+static GinLeader *_gin_begin_parallel(Relation heap, Relation index,
+									  bool isconcurrent, int request);
+static void _gin_end_parallel(GinLeader *ginleader);
+static Size _gin_parallel_estimate_shared(Relation heap, Snapshot snapshot);
+static double _gin_parallel_merge(GinBuildState *buildstate,
+								  GinLeader *ginleader, bool *brokenhotchain);
+static void _gin_parallel_scan_and_spill(Relation heap, Relation index,
+										 GinShared *ginshared, int *nruns,
+										 int participant, int workmem,
+										 bool progress);
+
 
 /*
  * Adds array of item pointers to tuple's posting list, or
@@ -290,23 +450,31 @@ ginBuildCallback(Relation index, ItemPointer tid, Datum *values,
 		ginHeapTupleBulkInsert(buildstate, (OffsetNumber) (i + 1),
 							   values[i], isnull[i], tid);
 
-	/* If we've maxed out our available memory, dump everything to the index */
-	if (buildstate->accum.allocatedMemory >= (Size) maintenance_work_mem * 1024L)
+	/*
+	 * If we've maxed out our available memory, dump everything to the index,
+	 * or to a new run if we're a participant in a parallel build
+	 */
+	if (buildstate->accum.allocatedMemory >= (Size) buildstate->workMem * 1024L)
 	{
-		ItemPointerData *list;
-		Datum		key;
-		GinNullCategory category;
-		uint32		nlist;
-		OffsetNumber attnum;
-
-		ginBeginBAScan(&buildstate->accum);
-		while ((list = ginGetBAEntry(&buildstate->accum,
-									 &attnum, &key, &category, &nlist)) != NULL)
+		if (buildstate->ginshared)
+			ginWriteBuildRun(buildstate);
+		else
 		{
-			/* there could be many entries, so be willing to abort here */
-			CHECK_FOR_INTERRUPTS();
-			ginEntryInsert(&buildstate->ginstate, attnum, key, category,
-						   list, nlist, &buildstate->buildStats);
+			ItemPointerData *list;
+			Datum		key;
+			GinNullCategory category;
+			uint32		nlist;
+			OffsetNumber attnum;
+
+			ginBeginBAScan(&buildstate->accum);
+			while ((list = ginGetBAEntry(&buildstate->accum,
+										 &attnum, &key, &category, &nlist)) != NULL)
+			{
+				/* there could be many entries, so be willing to abort here */
+				CHECK_FOR_INTERRUPTS();
+				ginEntryInsert(&buildstate->ginstate, attnum, key, category,
+							   list, nlist, &buildstate->buildStats);
+			}
 		}
 
 		MemoryContextReset(buildstate->tmpCtx);
@@ -330,6 +498,7 @@ ginbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	uint32		nlist;
 	MemoryContext oldCtx;
 	OffsetNumber attnum;
+	GinLeader  *ginleader = NULL;
 
 	if (RelationGetNumberOfBlocks(index) != 0)
 		elog(ERROR, "index \"%s\" already contains data",
@@ -379,27 +548,53 @@ ginbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 
 	buildstate.accum.ginstate = &buildstate.ginstate;
 	ginInitBA(&buildstate.accum);
+	buildstate.workMem = maintenance_work_mem;
+	buildstate.ginshared = NULL;
+	buildstate.participant = -1;
+	buildstate.nruns = 0;
 
-	/*
-	 * Do the heap scan.  We disallow sync scan here because dataPlaceToPage
-	 * prefers to receive tuples in TID order.
-	 */
-	reltuples = table_index_build_scan(heap, index, indexInfo, false, true,
-									   ginBuildCallback, (void *) &buildstate,
-									   NULL);
+	/* Attempt to launch parallel worker scan when required */
+	if (indexInfo->ii_ParallelWorkers > 0)
+		ginleader = _gin_begin_parallel(heap, index, indexInfo->ii_Concurrent,
+										indexInfo->ii_ParallelWorkers);
 
-	/* dump remaining entries to the index */
-	oldCtx = MemoryContextSwitchTo(buildstate.tmpCtx);
-	ginBeginBAScan(&buildstate.accum);
-	while ((list = ginGetBAEntry(&buildstate.accum,
-								 &attnum, &key, &category, &nlist)) != NULL)
+	if (ginleader)
 	{
-		/* there could be many entries, so be willing to abort here */
-		CHECK_FOR_INTERRUPTS();
-		ginEntryInsert(&buildstate.ginstate, attnum, key, category,
-					   list, nlist, &buildstate.buildStats);
+		ereport(DEBUG1,
+				(errmsg_internal("merging runs of parallel workers into GIN index \"%s\"",
+								 RelationGetRelationName(index))));
+
+		/*
+		 * Participants have scanned the heap into sorted runs; merge them
+		 * into the index.
+		 */
+		reltuples = _gin_parallel_merge(&buildstate, ginleader,
+										&indexInfo->ii_BrokenHotChain);
+		_gin_end_parallel(ginleader);
+	}
+	else
+	{
+		/*
+		 * Do the heap scan.  We disallow sync scan here because
+		 * dataPlaceToPage prefers to receive tuples in TID order.
+		 */
+		reltuples = table_index_build_scan(heap, index, indexInfo, false, true,
+										   ginBuildCallback, (void *) &buildstate,
+										   NULL);
+
+		/* dump remaining entries to the index */
+		oldCtx = MemoryContextSwitchTo(buildstate.tmpCtx);
+		ginBeginBAScan(&buildstate.accum);
+		while ((list = ginGetBAEntry(&buildstate.accum,
+									 &attnum, &key, &category, &nlist)) != NULL)
+		{
+			/* there could be many entries, so be willing to abort here */
+			CHECK_FOR_INTERRUPTS();
+			ginEntryInsert(&buildstate.ginstate, attnum, key, category,
+						   list, nlist, &buildstate.buildStats);
+		}
+		MemoryContextSwitchTo(oldCtx);
 	}
-	MemoryContextSwitchTo(oldCtx);
 
 	MemoryContextDelete(buildstate.funcCtx);
 	MemoryContextDelete(buildstate.tmpCtx);
@@ -547,3 +742,675 @@ gininsert(Relation index, Datum *values, bool *isnull,
 
 	return false;
 }
+
+/*
+ * Parallel index build support
+ */
+
+/*
+ * Name of run number "run" written by a parallel build participant.
+ */
+static void
+ginRunFileName(char *name, int participant, int run)
+{
+	snprintf(name, MAXPGPATH, "gin.p%d.r%d", participant, run);
+}
+
+/*
+ * Write the accumulated entries of a parallel build participant out as a new
+ * run, in key order.  The caller resets the accumulator afterwards.
+ */
+static void
+ginWriteBuildRun(GinBuildState *buildstate)
+{
+	GinState   *ginstate = &buildstate->ginstate;
+	char		name[MAXPGPATH];
+	BufFile    *file;
+	GinRunEntry hdr;
+	ItemPointerData *list;
+	Datum		key;
+	GinNullCategory category;
+	uint32		nlist;
+	OffsetNumber attnum;
+
+	ginRunFileName(name, buildstate->participant, buildstate->nruns);
+	file = BufFileCreateShared(&buildstate->ginshared->fileset, name);
+
+	ginBeginBAScan(&buildstate->accum);
+	while ((list = ginGetBAEntry(&buildstate->accum,
+								 &attnum, &key, &category, &nlist)) != NULL)
+	{
+		Form_pg_attribute attr = TupleDescAttr(ginstate->origTupdesc,
+											   attnum - 1);
+		bool		isnull = (category != GIN_CAT_NORM_KEY);
+		char	   *keybuf;
+		char	   *ptr;
+
+		/* there could be many entries, so be willing to abort here */
+		CHECK_FOR_INTERRUPTS();
+
+		memset(&hdr, 0, sizeof(hdr));
+		hdr.attnum = attnum;
+		hdr.category = category;
+		hdr.nitems = nlist;
+		hdr.keysize = datumEstimateSpace(key, isnull, attr->attbyval,
+										 attr->attlen);
+
+		keybuf = ptr = palloc(hdr.keysize);
+		datumSerialize(key, isnull, attr->attbyval, attr->attlen, &ptr);
+
+		BufFileWrite(file, &hdr, sizeof(hdr));
+		BufFileWrite(file, keybuf, hdr.keysize);
+		BufFileWrite(file, list, sizeof(ItemPointerData) * nlist);
+
+		pfree(keybuf);
+	}
+
+	/* terminate the run */
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.attnum = InvalidOffsetNumber;
+	BufFileWrite(file, &hdr, sizeof(hdr));
+
+	BufFileClose(file);
+	buildstate->nruns++;
+}
+
+/*
+ * Read exactly "size" bytes of a run file, or error out.
+ */
+static void
+ginReadRunData(GinRunReader *reader, void *ptr, size_t size)
+{
+	if (BufFileRead(reader->file, ptr, size) != size)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from GIN build temporary file")));
+}
+
+/*
+ * Load the next entry of a run into the reader.  Returns false, and closes
+ * the run, once the run is exhausted.
+ *
+ * The key and item pointers of the previous entry are not freed; they now
+ * belong to the caller.
+ */
+static bool
+ginReadRunEntry(GinRunReader *reader)
+{
+	GinRunEntry hdr;
+	char	   *keybuf;
+	char	   *ptr;
+	bool		isnull;
+
+	ginReadRunData(reader, &hdr, sizeof(hdr));
+	if (hdr.attnum == InvalidOffsetNumber)
+	{
+		BufFileClose(reader->file);
+		reader->file = NULL;
+		return false;
+	}
+
+	keybuf = ptr = palloc(hdr.keysize);
+	ginReadRunData(reader, keybuf, hdr.keysize);
+	reader->key = datumRestore(&ptr, &isnull);
+	pfree(keybuf);
+
+	reader->attnum = hdr.attnum;
+	reader->category = hdr.category;
+	reader->nitems = hdr.nitems;
+	reader->items = palloc(sizeof(ItemPointerData) * hdr.nitems);
+	ginReadRunData(reader, reader->items,
+				   sizeof(ItemPointerData) * hdr.nitems);
+
+	return true;
+}
+
+/*
+ * binaryheap comparator for the runs being merged: the run whose current
+ * entry sorts first comes out on top.
+ */
+static int
+ginRunReaderCompare(Datum a, Datum b, void *arg)
+{
+	GinRunMerge *merge = (GinRunMerge *) arg;
+	GinRunReader *ra = &merge->readers[DatumGetInt32(a)];
+	GinRunReader *rb = &merge->readers[DatumGetInt32(b)];
+
+	return -ginCompareAttEntries(merge->ginstate,
+								 ra->attnum, ra->key, ra->category,
+								 rb->attnum, rb->key, rb->category);
+}
+
+/*
+ * Advance the run at the top of the heap past its current entry.
+ */
+static void
+ginAdvanceTopRun(binaryheap *heap, GinRunReader *readers)
+{
+	int			top = DatumGetInt32(binaryheap_first(heap));
+
+	if (ginReadRunEntry(&readers[top]))
+		binaryheap_replace_first(heap, Int32GetDatum(top));
+	else
+		(void) binaryheap_remove_first(heap);
+}
+
+/*
+ * Free a key returned by datumRestore().
+ */
+static void
+ginFreeRunKey(GinState *ginstate, OffsetNumber attnum,
+			  GinNullCategory category, Datum key)
+{
+	if (category == GIN_CAT_NORM_KEY &&
+		!TupleDescAttr(ginstate->origTupdesc, attnum - 1)->attbyval)
+		pfree(DatumGetPointer(key));
+}
+
+/*
+ * Within leader, wait for all participants to finish scanning the heap, then
+ * merge the runs they wrote and insert the result into the index.
+ *
+ * Equal keys coming from different runs are combined into a single posting
+ * list before insertion, so each key is normally inserted just once, with
+ * all its item pointers in order.  A posting list larger than
+ * maintenance_work_mem is inserted in several pieces instead.
+ *
+ * Returns the total number of heap tuples scanned.
+ */
+static double
+_gin_parallel_merge(GinBuildState *buildstate, GinLeader *ginleader,
+					bool *brokenhotchain)
+{
+	GinShared  *ginshared = ginleader->ginshared;
+	GinState   *ginstate = &buildstate->ginstate;
+	GinRunMerge merge;
+	binaryheap *heap;
+	MemoryContext oldCtx;
+	double		reltuples;
+	uint32		maxitems;
+	int			nreaders;
+	int			i;
+
+	for (;;)
+	{
+		SpinLockAcquire(&ginshared->mutex);
+		if (ginshared->nparticipantsdone == ginleader->nparticipants)
+		{
+			buildstate->indtuples = ginshared->indtuples;
+			*brokenhotchain = ginshared->brokenhotchain;
+			reltuples = ginshared->reltuples;
+			SpinLockRelease(&ginshared->mutex);
+			break;
+		}
+		SpinLockRelease(&ginshared->mutex);
+
+		ConditionVariableSleep(&ginshared->workersdonecv,
+							   WAIT_EVENT_PARALLEL_CREATE_INDEX_SCAN);
+	}
+
+	ConditionVariableCancelSleep();
+
+	oldCtx = MemoryContextSwitchTo(buildstate->tmpCtx);
+
+	/* Open every run, and load its first entry */
+	nreaders = 0;
+	for (i = 0; i <= ginleader->pcxt->nworkers; i++)
+		nreaders += ginleader->nruns[i];
+
+	merge.ginstate = ginstate;
+	merge.readers = palloc0(sizeof(GinRunReader) * Max(nreaders, 1));
+	heap = binaryheap_allocate(Max(nreaders, 1), ginRunReaderCompare, &merge);
+
+	nreaders = 0;
+	for (i = 0; i <= ginleader->pcxt->nworkers; i++)
+	{
+		int			run;
+
+		for (run = 0; run < ginleader->nruns[i]; run++)
+		{
+			GinRunReader *reader = &merge.readers[nreaders];
+			char		name[MAXPGPATH];
+
+			ginRunFileName(name, i, run);
+			reader->file = BufFileOpenShared(&ginshared->fileset, name,
+											 O_RDONLY);
+			if (ginReadRunEntry(reader))
+				binaryheap_add_unordered(heap, Int32GetDatum(nreaders));
+			nreaders++;
+		}
+	}
+	binaryheap_build(heap);
+
+	maxitems = Min((Size) maintenance_work_mem * 1024L, MaxAllocSize / 2) /
+		sizeof(ItemPointerData);
+
+	while (!binaryheap_empty(heap))
+	{
+		GinRunReader *reader = &merge.readers[DatumGetInt32(binaryheap_first(heap))];
+		OffsetNumber attnum = reader->attnum;
+		GinNullCategory category = reader->category;
+		Datum		key = reader->key;
+		ItemPointerData *items = reader->items;
+		uint32		nitems = reader->nitems;
+
+		/* there could be many entries, so be willing to abort here */
+		CHECK_FOR_INTERRUPTS();
+
+		ginAdvanceTopRun(heap, merge.readers);
+
+		/* Fold in the same key from all other runs */
+		while (!binaryheap_empty(heap))
+		{
+			GinRunReader *next = &merge.readers[DatumGetInt32(binaryheap_first(heap))];
+
+			if (ginCompareAttEntries(ginstate, attnum, key, category,
+									 next->attnum, next->key,
+									 next->category) != 0)
+				break;
+
+			if (nitems >= maxitems)
+			{
+				ginEntryInsert(ginstate, attnum, key, category,
+							   items, nitems, &buildstate->buildStats);
+				pfree(items);
+				items = next->items;
+				nitems = next->nitems;
+			}
+			else
+			{
+				ItemPointerData *merged;
+				int			nmerged;
+
+				merged = ginMergeItemPointers(items, nitems,
+											  next->items, next->nitems,
+											  &nmerged);
+				pfree(items);
+				pfree(next->items);
+				items = merged;
+				nitems = nmerged;
+			}
+
+			ginFreeRunKey(ginstate, next->attnum, next->category, next->key);
+			ginAdvanceTopRun(heap, merge.readers);
+		}
+
+		ginEntryInsert(ginstate, attnum, key, category,
+					   items, nitems, &buildstate->buildStats);
+		pfree(items);
+		ginFreeRunKey(ginstate, attnum, category, key);
+	}
+
+	binaryheap_free(heap);
+	pfree(merge.readers);
+
+	MemoryContextSwitchTo(oldCtx);
+
+	return reltuples;
+}
+
+/*
+ * Create parallel context, and launch workers for leader.
+ *
+ * request is the target number of parallel worker processes to launch.
+ *
+ * Returns the leader state, which caller must pass to _gin_parallel_merge()
+ * and then to _gin_end_parallel().  If not even a single worker process can
+ * be launched, returns NULL, and caller should proceed with a serial build.
+ */
+static GinLeader *
+_gin_begin_parallel(Relation heap, Relation index, bool isconcurrent,
+					int request)
+{
+	ParallelContext *pcxt;
+	int			scanparticipants;
+	Snapshot	snapshot;
+	Size		estginshared;
+	Size		estruns;
+	GinShared  *ginshared;
+	GinLeader  *ginleader = (GinLeader *) palloc0(sizeof(GinLeader));
+	int		   *nruns;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+	bool		leaderparticipates = true;
+	int			querylen;
+
+#ifdef DISABLE_LEADER_PARTICIPATION
+	leaderparticipates = false;
+#endif
+
+	/*
+	 * Enter parallel mode, and create context for parallel build of gin
+	 * index
+	 */
+	EnterParallelMode();
+	Assert(request > 0);
+	pcxt = CreateParallelContext("postgres", "_gin_parallel_build_main",
+								 request);
+
+	scanparticipants = leaderparticipates ? request + 1 : request;
+
+	/*
+	 * Prepare for scan of the base relation.  In a normal index build, we use
+	 * SnapshotAny because we must retrieve all tuples and do our own time
+	 * qual checks (because we have to index RECENTLY_DEAD tuples).  In a
+	 * concurrent build, we take a regular MVCC snapshot and index whatever's
+	 * live according to that.
+	 */
+	if (!isconcurrent)
+		snapshot = SnapshotAny;
+	else
+		snapshot = RegisterSnapshot(GetTransactionSnapshot());
+
+	/*
+	 * Estimate size for our own PARALLEL_KEY_GIN_SHARED workspace, and the
+	 * PARALLEL_KEY_GIN_RUNS counters.  The leader uses the last counter.
+	 */
+	estginshared = _gin_parallel_estimate_shared(heap, snapshot);
+	shm_toc_estimate_chunk(&pcxt->estimator, estginshared);
+	estruns = mul_size(sizeof(int), request + 1);
+	shm_toc_estimate_chunk(&pcxt->estimator, estruns);
+	shm_toc_estimate_keys(&pcxt->estimator, 2);
+
+	/*
+	 * Estimate space for WalUsage and BufferUsage -- PARALLEL_KEY_WAL_USAGE
+	 * and PARALLEL_KEY_BUFFER_USAGE.
+	 */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Finally, estimate PARALLEL_KEY_QUERY_TEXT space */
+	if (debug_query_string)
+	{
+		querylen = strlen(debug_query_string);
+		shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+	else
+		querylen = 0;			/* keep compiler quiet */
+
+	/* Everyone's had a chance to ask for space, so now create the DSM */
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out (do serial build) */
+	if (pcxt->seg == NULL)
+	{
+		if (IsMVCCSnapshot(snapshot))
+			UnregisterSnapshot(snapshot);
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		pfree(ginleader);
+		return NULL;
+	}
+
+	/* Store shared build state, for which we reserved space */
+	ginshared = (GinShared *) shm_toc_allocate(pcxt->toc, estginshared);
+	/* Initialize immutable state */
+	ginshared->heaprelid = RelationGetRelid(heap);
+	ginshared->indexrelid = RelationGetRelid(index);
+	ginshared->isconcurrent = isconcurrent;
+	ginshared->scanparticipants = scanparticipants;
+	SharedFileSetInit(&ginshared->fileset, pcxt->seg);
+	ConditionVariableInit(&ginshared->workersdonecv);
+	SpinLockInit(&ginshared->mutex);
+	/* Initialize mutable state */
+	ginshared->nparticipantsdone = 0;
+	ginshared->reltuples = 0.0;
+	ginshared->indtuples = 0.0;
+	ginshared->brokenhotchain = false;
+	table_parallelscan_initialize(heap,
+								  ParallelTableScanFromGinShared(ginshared),
+								  snapshot);
+
+	nruns = (int *) shm_toc_allocate(pcxt->toc, estruns);
+	memset(nruns, 0, estruns);
+
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_GIN_SHARED, ginshared);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_GIN_RUNS, nruns);
+
+	/* Store query string for workers */
+	if (debug_query_string)
+	{
+		char	   *sharedquery;
+
+		sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+		memcpy(sharedquery, debug_query_string, querylen + 1);
+		shm_toc_insert(pcxt->toc, PARALLEL_KEY_QUERY_TEXT, sharedquery);
+	}
+
+	/*
+	 * Allocate space for each worker's WalUsage and BufferUsage; no need to
+	 * initialize.
+	 */
+	walusage = shm_toc_allocate(pcxt->toc,
+								mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_WAL_USAGE, walusage);
+	bufferusage = shm_toc_allocate(pcxt->toc,
+								   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BUFFER_USAGE, bufferusage);
+
+	/* Launch workers, saving status for leader/caller */
+	LaunchParallelWorkers(pcxt);
+	ginleader->pcxt = pcxt;
+	ginleader->nparticipants = pcxt->nworkers_launched;
+	if (leaderparticipates)
+		ginleader->nparticipants++;
+	ginleader->ginshared = ginshared;
+	ginleader->nruns = nruns;
+	ginleader->snapshot = snapshot;
+	ginleader->walusage = walusage;
+	ginleader->bufferusage = bufferusage;
+
+	/* If no workers were successfully launched, back out (do serial build) */
+	if (pcxt->nworkers_launched == 0)
+	{
+		_gin_end_parallel(ginleader);
+		pfree(ginleader);
+		return NULL;
+	}
+
+	/*
+	 * Join heap scan ourselves.  Might as well use reliable figure when
+	 * doling out maintenance_work_mem (when requested number of workers were
+	 * not launched, this will be somewhat higher than it is for other
+	 * workers).
+	 */
+	if (leaderparticipates)
+		_gin_parallel_scan_and_spill(heap, index, ginshared, nruns,
+									 pcxt->nworkers,
+									 maintenance_work_mem / ginleader->nparticipants,
+									 true);
+
+	/*
+	 * Caller needs to wait for all launched workers when we return.  Make
+	 * sure that the failure-to-start case will not hang forever.
+	 */
+	WaitForParallelWorkersToAttach(pcxt);
+
+	return ginleader;
+}
+
+/*
+ * Shut down workers, destroy parallel context, and end parallel mode.
+ *
+ * This also removes the run files, so the leader must be done merging them.
+ */
+static void
+_gin_end_parallel(GinLeader *ginleader)
+{
+	int			i;
+
+	/* Shutdown worker processes */
+	WaitForParallelWorkersToFinish(ginleader->pcxt);
+
+	/*
+	 * Next, accumulate WAL usage.  (This must wait for the workers to finish,
+	 * or we might get incomplete data.)
+	 */
+	for (i = 0; i < ginleader->pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&ginleader->bufferusage[i], &ginleader->walusage[i]);
+
+	/* Free last reference to MVCC snapshot, if one was used */
+	if (IsMVCCSnapshot(ginleader->snapshot))
+		UnregisterSnapshot(ginleader->snapshot);
+	DestroyParallelContext(ginleader->pcxt);
+	ExitParallelMode();
+}
+
+/*
+ * Returns size of shared memory required to store state for a parallel
+ * gin index build based on the snapshot its parallel scan will use.
+ */
+static Size
+_gin_parallel_estimate_shared(Relation heap, Snapshot snapshot)
+{
+	/* c.f. shm_toc_allocate as to why BUFFERALIGN is used */
+	return add_size(BUFFERALIGN(sizeof(GinShared)),
+					table_parallelscan_estimate(heap, snapshot));
+}
+
+/*
+ * Perform work within a launched parallel process.
+ */
+void
+_gin_parallel_build_main(dsm_segment *seg, shm_toc *toc)
+{
+	char	   *sharedquery;
+	GinShared  *ginshared;
+	int		   *nruns;
+	Relation	heapRel;
+	Relation	indexRel;
+	LOCKMODE	heapLockmode;
+	LOCKMODE	indexLockmode;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+
+	/*
+	 * The only possible status flag that can be set to the parallel worker is
+	 * PROC_IN_SAFE_IC.
+	 */
+	Assert((MyProc->statusFlags == 0) ||
+		   (MyProc->statusFlags == PROC_IN_SAFE_IC));
+
+	/* Set debug_query_string for individual workers first */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_KEY_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+
+	/* Report the query string from leader */
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	/* Look up gin shared state */
+	ginshared = shm_toc_lookup(toc, PARALLEL_KEY_GIN_SHARED, false);
+	nruns = shm_toc_lookup(toc, PARALLEL_KEY_GIN_RUNS, false);
+
+	/* Open relations using lock modes known to be obtained by index.c */
+	if (!ginshared->isconcurrent)
+	{
+		heapLockmode = ShareLock;
+		indexLockmode = AccessExclusiveLock;
+	}
+	else
+	{
+		heapLockmode = ShareUpdateExclusiveLock;
+		indexLockmode = RowExclusiveLock;
+	}
+
+	/* Open relations within worker */
+	heapRel = table_open(ginshared->heaprelid, heapLockmode);
+	indexRel = index_open(ginshared->indexrelid, indexLockmode);
+
+	/* Run files must outlive us, until the leader has merged them */
+	SharedFileSetAttach(&ginshared->fileset, seg);
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	_gin_parallel_scan_and_spill(heapRel, indexRel, ginshared, nruns,
+								 ParallelWorkerNumber,
+								 maintenance_work_mem / ginshared->scanparticipants,
+								 false);
+
+	/* Report WAL/buffer usage during parallel execution */
+	bufferusage = shm_toc_lookup(toc, PARALLEL_KEY_BUFFER_USAGE, false);
+	walusage = shm_toc_lookup(toc, PARALLEL_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&bufferusage[ParallelWorkerNumber],
+						  &walusage[ParallelWorkerNumber]);
+
+	index_close(indexRel, indexLockmode);
+	table_close(heapRel, heapLockmode);
+}
+
+/*
+ * Perform a participant's portion of a parallel build: scan its share of the
+ * heap, and write the accumulated entries out as sorted runs.
+ *
+ * workmem is the amount of accumulator memory to use within each
+ * participant, expressed in KBs.
+ */
+static void
+_gin_parallel_scan_and_spill(Relation heap, Relation index,
+							 GinShared *ginshared, int *nruns,
+							 int participant, int workmem, bool progress)
+{
+	GinBuildState buildstate;
+	TableScanDesc scan;
+	double		reltuples;
+	IndexInfo  *indexInfo;
+	MemoryContext oldCtx;
+
+	initGinState(&buildstate.ginstate, index);
+	buildstate.indtuples = 0;
+	memset(&buildstate.buildStats, 0, sizeof(GinStatsData));
+	buildstate.tmpCtx = AllocSetContextCreate(CurrentMemoryContext,
+											  "Gin build temporary context",
+											  ALLOCSET_DEFAULT_SIZES);
+	buildstate.funcCtx = AllocSetContextCreate(CurrentMemoryContext,
+											   "Gin build temporary context for user-defined function",
+											   ALLOCSET_DEFAULT_SIZES);
+	buildstate.accum.ginstate = &buildstate.ginstate;
+	ginInitBA(&buildstate.accum);
+	buildstate.workMem = Max(workmem, 64);
+	buildstate.ginshared = ginshared;
+	buildstate.participant = participant;
+	buildstate.nruns = 0;
+
+	/* Join parallel scan */
+	indexInfo = BuildIndexInfo(index);
+	indexInfo->ii_Concurrent = ginshared->isconcurrent;
+	scan = table_beginscan_parallel(heap,
+									ParallelTableScanFromGinShared(ginshared));
+	reltuples = table_index_build_scan(heap, index, indexInfo, true, progress,
+									   ginBuildCallback, (void *) &buildstate,
+									   scan);
+
+	/* write out whatever is left as a last run */
+	if (buildstate.accum.allocatedMemory > 0)
+	{
+		oldCtx = MemoryContextSwitchTo(buildstate.tmpCtx);
+		ginWriteBuildRun(&buildstate);
+		MemoryContextSwitchTo(oldCtx);
+	}
+
+	/*
+	 * Done.  Record ambuild statistics, the number of runs we wrote, and
+	 * whether we encountered a broken HOT chain.
+	 */
+	SpinLockAcquire(&ginshared->mutex);
+	ginshared->nparticipantsdone++;
+	ginshared->reltuples += reltuples;
+	ginshared->indtuples += buildstate.indtuples;
+	if (indexInfo->ii_BrokenHotChain)
+		ginshared->brokenhotchain = true;
+	nruns[participant] = buildstate.nruns;
+	SpinLockRelease(&ginshared->mutex);
+
+	/* Notify leader */
+	ConditionVariableSignal(&ginshared->workersdonecv);
+
+	MemoryContextDelete(buildstate.funcCtx);
+	MemoryContextDelete(buildstate.tmpCtx);
+}
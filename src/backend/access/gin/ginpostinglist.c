@@ -313,10 +313,13 @@ ginPostingListDecodeAllSegments(GinPostingList *segment, int len, int *ndecoded_
 	ndecoded = 0;
 	while ((char *) segment < endseg)
 	{
-		/* enlarge output array if needed */
-		if (ndecoded >= nallocated)
+		/*
+		 * Enlarge output array if needed.  Every item but the first takes at
+		 * least one byte, so this is enough room for the whole segment.
+		 */
+		if (ndecoded + segment->nbytes + 1 > nallocated)
 		{
-			nallocated *= 2;
+			nallocated = Max(nallocated * 2, ndecoded + segment->nbytes + 1);
 			result = repalloc(result, nallocated * sizeof(ItemPointerData));
 		}
 
@@ -331,11 +334,27 @@ ginPostingListDecodeAllSegments(GinPostingList *segment, int len, int *ndecoded_
 		endptr = segment->bytes + segment->nbytes;
 		while (ptr < endptr)
 		{
-			/* enlarge output array if needed */
-			if (ndecoded >= nallocated)
+			/*
+			 * If none of the next 8 bytes has the continuation bit set, they
+			 * are 8 one-byte deltas, which we can decode without branching on
+			 * each byte.  Dense posting lists consist mostly of such runs.
+			 */
+			if (endptr - ptr >= sizeof(uint64))
 			{
-				nallocated *= 2;
-				result = repalloc(result, nallocated * sizeof(ItemPointerData));
+				uint64		chunk;
+
+				memcpy(&chunk, ptr, sizeof(uint64));
+				if ((chunk & UINT64CONST(0x8080808080808080)) == 0)
+				{
+					for (int i = 0; i < sizeof(uint64); i++)
+					{
+						val += ptr[i];
+						uint64_to_itemptr(val, &result[ndecoded]);
+						ndecoded++;
+					}
+					ptr += sizeof(uint64);
+					continue;
+				}
 			}
 
 			val += decode_varbyte(&ptr);
@@ -73,6 +73,7 @@ hashhandler(PG_FUNCTION_ARGS)
 	amroutine->amclusterable = false;
 	amroutine->ampredlocks = true;
 	amroutine->amcanparallel = false;
+	amroutine->amcanbuildparallel = false;
 	amroutine->amcaninclude = false;
 	amroutine->amusemaintenanceworkmem = false;
 	amroutine->amparallelvacuumoptions =
@@ -82,6 +83,7 @@ hashhandler(PG_FUNCTION_ARGS)
 	amroutine->ambuild = hashbuild;
 	amroutine->ambuildempty = hashbuildempty;
 	amroutine->aminsert = hashinsert;
+	amroutine->aminsertmulti = hashinsertmulti;
 	amroutine->ambulkdelete = hashbulkdelete;
 	amroutine->amvacuumcleanup = hashvacuumcleanup;
 	amroutine->amcanreturn = NULL;
@@ -272,6 +274,50 @@ hashinsert(Relation rel, Datum *values, bool *isnull,
 	return false;
 }
 
+/*
+ *	hashinsertmulti() -- insert a batch of index tuples into a hash table.
+ *
+ *	Like hashinsert, for each of ntuples heap tuples; the actual work is
+ *	done by _hash_doinsert_multi.
+ */
+void
+hashinsertmulti(Relation rel, Datum *values, bool *isnull,
+				ItemPointer ht_ctids, int ntuples, Relation heapRel,
+				IndexInfo *indexInfo)
+{
+	int			natts = IndexRelationGetNumberOfAttributes(rel);
+	IndexTuple *itups;
+	int			nitups = 0;
+	int			i;
+
+	itups = (IndexTuple *) palloc(sizeof(IndexTuple) * ntuples);
+
+	for (i = 0; i < ntuples; i++)
+	{
+		Datum		index_values[1];
+		bool		index_isnull[1];
+
+		/* convert data to a hash key; on failure, do not insert anything */
+		if (!_hash_convert_tuple(rel,
+								 values + i * natts, isnull + i * natts,
+								 index_values, index_isnull))
+			continue;
+
+		/* form an index tuple and point it at the heap tuple */
+		itups[nitups] = index_form_tuple(RelationGetDescr(rel),
+										 index_values, index_isnull);
+		itups[nitups]->t_tid = ht_ctids[i];
+		nitups++;
+	}
+
+	if (nitups > 0)
+		_hash_doinsert_multi(rel, itups, nitups, heapRel);
+
+	for (i = 0; i < nitups; i++)
+		pfree(itups[i]);
+	pfree(itups);
+}
+
 
 /*
  *	hashgettuple() -- Get the next tuple in the scan.
@@ -23,6 +23,17 @@
 #include "storage/predicate.h"
 #include "utils/rel.h"
 
+/* A tuple of a batch being inserted by _hash_doinsert_multi() */
+typedef struct HashInsertItem
+{
+	IndexTuple	itup;
+	uint32		hashkey;
+	Bucket		bucket;			/* as of when the batch was sorted */
+} HashInsertItem;
+
+static void _hash_insert_and_log(Relation rel, Buffer buf, Buffer metabuf,
+								 IndexTuple itup, Size itemsz);
+static int	_hash_insert_item_cmp(const void *a, const void *b);
 static void _hash_vacuum_one_page(Relation rel, Relation hrel,
 								  Buffer metabuf, Buffer buf);
 
@@ -45,9 +56,11 @@ _hash_doinsert(Relation rel, IndexTuple itup, Relation heapRel)
 	HashPageOpaque pageopaque;
 	Size		itemsz;
 	bool		do_expand;
+	double		ntuples;
+	uint16		ffactor;
+	uint32		maxbucket;
 	uint32		hashkey;
 	Bucket		bucket;
-	OffsetNumber itup_off;
 
 	/*
 	 * Get the hash key for the item (it's stored in the index tuple itself).
@@ -193,21 +206,282 @@ restart_insert:
 	 */
 	LockBuffer(metabuf, BUFFER_LOCK_EXCLUSIVE);
 
+	/* found page with enough space, so add the item here */
+	_hash_insert_and_log(rel, buf, metabuf, itup, itemsz);
+
+	/* Make sure this stays in sync with _hash_expandtable() */
+	metap = HashPageGetMeta(metapage);
+	ntuples = metap->hashm_ntuples;
+	ffactor = metap->hashm_ffactor;
+	maxbucket = metap->hashm_maxbucket;
+	do_expand = ntuples > (double) ffactor * (maxbucket + 1);
+
+	/* drop lock on metapage, but keep pin */
+	LockBuffer(metabuf, BUFFER_LOCK_UNLOCK);
+
+	/*
+	 * Release the modified page and ensure to release the pin on primary
+	 * page.
+	 */
+	_hash_relbuf(rel, buf);
+	if (buf != bucket_buf)
+		_hash_dropbuf(rel, bucket_buf);
+
+	/* Attempt to split if a split is needed, unless autovacuum will */
+	if (do_expand && !_hash_defer_expand(rel, ntuples, 1, ffactor, maxbucket))
+		_hash_expandtable(rel, metabuf);
+
+	/* Finally drop our pin on the metapage */
+	_hash_dropbuf(rel, metabuf);
+}
+
+/*
+ *	_hash_doinsert_multi() -- Handle insertion of a batch of index tuples.
+ *
+ *		This is _hash_doinsert() for many tuples at once, as used by COPY.
+ *		The tuples are sorted by bucket, and each bucket's share of the batch
+ *		is added under a single lock on the bucket, in one walk of its chain.
+ *		The metapage is locked once per page filled rather than once per
+ *		tuple, and the split decision is made once for the whole batch.
+ *		The WAL records are the same as for single insertions.
+ *
+ *		The itups array is not modified, but the caller must not assume
+ *		any particular order of insertion.
+ */
+void
+_hash_doinsert_multi(Relation rel, IndexTuple *itups, int nitups,
+					 Relation heapRel)
+{
+	HashInsertItem *items;
+	HashMetaPage cachedmetap;
+	HashMetaPage metap;
+	Buffer		metabuf;
+	Page		metapage;
+	bool		do_expand = false;
+	double		ntuples = 0;
+	uint16		ffactor = 0;
+	uint32		maxbucket = 0;
+	int			i;
+
+	metabuf = _hash_getbuf(rel, HASH_METAPAGE, HASH_NOLOCK, LH_META_PAGE);
+	metapage = BufferGetPage(metabuf);
+	metap = HashPageGetMeta(metapage);
+
+	/*
+	 * Compute the hash keys and the buckets they currently map to, and check
+	 * that every item fits on a page (see _hash_doinsert).
+	 */
+	cachedmetap = _hash_getcachedmetap(rel, &metabuf, false);
+	items = palloc(sizeof(HashInsertItem) * nitups);
+	for (i = 0; i < nitups; i++)
+	{
+		Size		itemsz = MAXALIGN(IndexTupleSize(itups[i]));
+
+		if (itemsz > HashMaxItemSize(metapage))
+			ereport(ERROR,
+					(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+					 errmsg("index row size %zu exceeds hash maximum %zu",
+							itemsz, HashMaxItemSize(metapage)),
+					 errhint("Values larger than a buffer page cannot be indexed.")));
+
+		items[i].itup = itups[i];
+		items[i].hashkey = _hash_get_indextuple_hashkey(itups[i]);
+		items[i].bucket = _hash_hashkey2bucket(items[i].hashkey,
+											   cachedmetap->hashm_maxbucket,
+											   cachedmetap->hashm_highmask,
+											   cachedmetap->hashm_lowmask);
+	}
+	qsort(items, nitups, sizeof(HashInsertItem), _hash_insert_item_cmp);
+
+	i = 0;
+	while (i < nitups)
+	{
+		HashMetaPage usedmetap = NULL;
+		Buffer		buf;
+		Buffer		bucket_buf;
+		Page		page;
+		HashPageOpaque pageopaque;
+		Bucket		bucket;
+		int			nbucket;
+		int			ndone;
+
+		CHECK_FOR_INTERRUPTS();
+
+		/* Lock the primary bucket page for the next item's bucket. */
+		buf = _hash_getbucketbuf_from_hashkey(rel, items[i].hashkey,
+											  HASH_WRITE, &usedmetap);
+		Assert(usedmetap != NULL);
+
+		CheckForSerializableConflictIn(rel, NULL, BufferGetBlockNumber(buf));
+
+		bucket_buf = buf;
+		page = BufferGetPage(buf);
+		pageopaque = (HashPageOpaque) PageGetSpecialPointer(page);
+		bucket = pageopaque->hasho_bucket;
+
+		/* Try to finish an interrupted split first, as _hash_doinsert does */
+		if (H_BUCKET_BEING_SPLIT(pageopaque) && IsBufferCleanupOK(buf))
+		{
+			LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+
+			_hash_finish_split(rel, metabuf, buf, bucket,
+							   usedmetap->hashm_maxbucket,
+							   usedmetap->hashm_highmask,
+							   usedmetap->hashm_lowmask);
+
+			_hash_dropbuf(rel, buf);
+			continue;
+		}
+
+		/*
+		 * Collect the following items that belong to this bucket too.  The
+		 * bucket can't be split while we hold its lock, and usedmetap is
+		 * known to be current as far as this bucket is concerned, so it
+		 * tells reliably which items belong here.  If other buckets were
+		 * split since we sorted the batch, the items might no longer be
+		 * grouped perfectly; stragglers just take another round.
+		 */
+		nbucket = 1;
+		while (i + nbucket < nitups &&
+			   _hash_hashkey2bucket(items[i + nbucket].hashkey,
+									usedmetap->hashm_maxbucket,
+									usedmetap->hashm_highmask,
+									usedmetap->hashm_lowmask) == bucket)
+			nbucket++;
+
+		/* Do the insertion */
+		ndone = 0;
+		while (ndone < nbucket)
+		{
+			Size		freespace = PageGetExactFreeSpace(page);
+			int			nfit = 0;
+
+			/* How many of the remaining items fit on this page? */
+			while (ndone + nfit < nbucket)
+			{
+				Size		itemsz;
+
+				itemsz = MAXALIGN(IndexTupleSize(items[i + ndone + nfit].itup));
+				if (freespace < itemsz + sizeof(ItemIdData))
+					break;
+				freespace -= itemsz + sizeof(ItemIdData);
+				nfit++;
+			}
+
+			if (nfit > 0)
+			{
+				int			j;
+
+				/*
+				 * Add them all while holding the metapage lock, so that we
+				 * take it once per page.
+				 */
+				LockBuffer(metabuf, BUFFER_LOCK_EXCLUSIVE);
+
+				for (j = 0; j < nfit; j++)
+				{
+					IndexTuple	itup = items[i + ndone + j].itup;
+
+					_hash_insert_and_log(rel, buf, metabuf, itup,
+										 MAXALIGN(IndexTupleSize(itup)));
+				}
+
+				/* Make sure this stays in sync with _hash_expandtable() */
+				ntuples = metap->hashm_ntuples;
+				ffactor = metap->hashm_ffactor;
+				maxbucket = metap->hashm_maxbucket;
+				do_expand = ntuples > (double) ffactor * (maxbucket + 1);
+
+				LockBuffer(metabuf, BUFFER_LOCK_UNLOCK);
+
+				ndone += nfit;
+				if (ndone == nbucket)
+					break;
+			}
+
+			/*
+			 * This page is full.  Try to make room by removing dead tuples,
+			 * otherwise move on to the next page of the bucket chain, as in
+			 * _hash_doinsert.
+			 */
+			if (nfit == 0 && H_HAS_DEAD_TUPLES(pageopaque) &&
+				IsBufferCleanupOK(buf))
+			{
+				_hash_vacuum_one_page(rel, heapRel, metabuf, buf);
+
+				if (PageGetFreeSpace(page) >=
+					MAXALIGN(IndexTupleSize(items[i + ndone].itup)))
+					continue;	/* OK, now we have enough space */
+			}
+
+			if (BlockNumberIsValid(pageopaque->hasho_nextblkno))
+			{
+				BlockNumber nextblkno = pageopaque->hasho_nextblkno;
+
+				if (buf != bucket_buf)
+					_hash_relbuf(rel, buf);
+				else
+					LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+				buf = _hash_getbuf(rel, nextblkno, HASH_WRITE, LH_OVERFLOW_PAGE);
+			}
+			else
+			{
+				/* chain to a new overflow page */
+				LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+				buf = _hash_addovflpage(rel, metabuf, buf, (buf == bucket_buf) ? true : false);
+			}
+			page = BufferGetPage(buf);
+			pageopaque = (HashPageOpaque) PageGetSpecialPointer(page);
+			Assert((pageopaque->hasho_flag & LH_PAGE_TYPE) == LH_OVERFLOW_PAGE);
+			Assert(pageopaque->hasho_bucket == bucket);
+		}
+
+		/*
+		 * Release the modified page and ensure to release the pin on primary
+		 * page.
+		 */
+		_hash_relbuf(rel, buf);
+		if (buf != bucket_buf)
+			_hash_dropbuf(rel, bucket_buf);
+
+		i += nbucket;
+	}
+
+	/*
+	 * Attempt to split if a split is needed, unless autovacuum will.  A
+	 * batch can call for several splits.
+	 */
+	if (do_expand && !_hash_defer_expand(rel, ntuples, nitups, ffactor, maxbucket))
+		_hash_expandtable_all(rel, metabuf);
+
+	/* Finally drop our pin on the metapage */
+	_hash_dropbuf(rel, metabuf);
+
+	pfree(items);
+}
+
+/*
+ * Add itup to the page in buf and count it in the metapage, WAL-logging the
+ * change.  The caller must hold exclusive locks on both buffers, and must
+ * have made sure that the tuple fits.
+ */
+static void
+_hash_insert_and_log(Relation rel, Buffer buf, Buffer metabuf,
+					 IndexTuple itup, Size itemsz)
+{
+	HashMetaPage metap;
+	OffsetNumber itup_off;
+
 	/* Do the update.  No ereport(ERROR) until changes are logged */
 	START_CRIT_SECTION();
 
-	/* found page with enough space, so add the item here */
 	itup_off = _hash_pgaddtup(rel, buf, itemsz, itup);
 	MarkBufferDirty(buf);
 
 	/* metapage operations */
-	metap = HashPageGetMeta(metapage);
+	metap = HashPageGetMeta(BufferGetPage(metabuf));
 	metap->hashm_ntuples += 1;
 
-	/* Make sure this stays in sync with _hash_expandtable() */
-	do_expand = metap->hashm_ntuples >
-		(double) metap->hashm_ffactor * (metap->hashm_maxbucket + 1);
-
 	MarkBufferDirty(metabuf);
 
 	/* XLOG stuff */
@@ -233,24 +507,22 @@ restart_insert:
 	}
 
 	END_CRIT_SECTION();
+}
 
-	/* drop lock on metapage, but keep pin */
-	LockBuffer(metabuf, BUFFER_LOCK_UNLOCK);
-
-	/*
-	 * Release the modified page and ensure to release the pin on primary
-	 * page.
-	 */
-	_hash_relbuf(rel, buf);
-	if (buf != bucket_buf)
-		_hash_dropbuf(rel, bucket_buf);
-
-	/* Attempt to split if a split is needed */
-	if (do_expand)
-		_hash_expandtable(rel, metabuf);
-
-	/* Finally drop our pin on the metapage */
-	_hash_dropbuf(rel, metabuf);
+/*
+ * qsort comparator for HashInsertItems: by bucket, then by hash key.
+ */
+static int
+_hash_insert_item_cmp(const void *a, const void *b)
+{
+	const HashInsertItem *ia = (const HashInsertItem *) a;
+	const HashInsertItem *ib = (const HashInsertItem *) b;
+
+	if (ia->bucket != ib->bucket)
+		return (ia->bucket < ib->bucket) ? -1 : 1;
+	if (ia->hashkey != ib->hashkey)
+		return (ia->hashkey < ib->hashkey) ? -1 : 1;
+	return 0;
 }
 
 /*
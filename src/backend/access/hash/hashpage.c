@@ -30,8 +30,12 @@
 
 #include "access/hash.h"
 #include "access/hash_xlog.h"
+#include "access/relation.h"
+#include "access/table.h"
+#include "catalog/index.h"
 #include "miscadmin.h"
 #include "port/pg_bitutils.h"
+#include "postmaster/autovacuum.h"
 #include "storage/lmgr.h"
 #include "storage/predicate.h"
 #include "storage/smgr.h"
@@ -962,6 +966,140 @@ fail:
 	LockBuffer(metabuf, BUFFER_LOCK_UNLOCK);
 }
 
+/*
+ * Split buckets until the index is within its fill factor again.
+ *
+ * Each round is an ordinary _hash_expandtable() call, so concurrent
+ * insertions only ever wait for the bucket being split at the moment.  We
+ * stop early if a split couldn't get its cleanup locks; someone will try
+ * again later.
+ *
+ * The caller must hold a pin, but no lock, on the metapage buffer.
+ */
+void
+_hash_expandtable_all(Relation rel, Buffer metabuf)
+{
+	HashMetaPage metap = HashPageGetMeta(BufferGetPage(metabuf));
+
+	for (;;)
+	{
+		uint32		maxbucket;
+		bool		need_expand;
+
+		CHECK_FOR_INTERRUPTS();
+
+		LockBuffer(metabuf, BUFFER_LOCK_SHARE);
+		maxbucket = metap->hashm_maxbucket;
+		need_expand = metap->hashm_ntuples >
+			(double) metap->hashm_ffactor * (maxbucket + 1);
+		LockBuffer(metabuf, BUFFER_LOCK_UNLOCK);
+
+		if (!need_expand)
+			break;
+
+		_hash_expandtable(rel, metabuf);
+
+		/* Give up if that didn't manage to split */
+		LockBuffer(metabuf, BUFFER_LOCK_SHARE);
+		need_expand = (metap->hashm_maxbucket != maxbucket);
+		LockBuffer(metabuf, BUFFER_LOCK_UNLOCK);
+
+		if (!need_expand)
+			break;
+	}
+}
+
+/*
+ * _hash_defer_expand() -- hand a due split over to autovacuum
+ *
+ * Inserters call this when they find the index needs to expand, passing the
+ * metapage figures they saw after adding their ninserted tuples.  If the
+ * index has autosplit set, we ask autovacuum to do the splitting and return
+ * true; the caller then skips _hash_expandtable().  To keep the request
+ * traffic down, only insertions crossing a multiple of the fill factor ask.
+ *
+ * Returns false, meaning the caller should split right away, if autosplit
+ * is off, if the index is temporary (autovacuum can't see it), if the
+ * request can't be queued, or if the index has fallen so far behind that
+ * autovacuum evidently isn't keeping up.
+ */
+bool
+_hash_defer_expand(Relation rel, double ntuples, uint32 ninserted,
+				   uint16 ffactor, uint32 maxbucket)
+{
+	if (!HashGetAutoSplit(rel) || RelationUsesLocalBuffers(rel))
+		return false;
+
+	if (ntuples > (double) ffactor * (maxbucket + 1) * HASH_AUTOSPLIT_FALLBACK)
+		return false;
+
+	/* A recent insertion has asked already */
+	if ((uint64) ntuples / ffactor == (uint64) (ntuples - ninserted) / ffactor)
+		return true;
+
+	if (AutoVacuumRequestWork(AVW_HashExpandTable, RelationGetRelid(rel),
+							  InvalidBlockNumber))
+		return true;
+
+	ereport(LOG,
+			(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+			 errmsg("request for hash index expansion for index \"%s\" was not recorded",
+					RelationGetRelationName(rel))));
+	return false;
+}
+
+/*
+ * _hash_expand_deferred() -- split buckets on behalf of inserters
+ *
+ * This is run by autovacuum for hash indexes with autosplit set, when
+ * inserters have found that the index needs to expand.  Like the rest of
+ * autovacuum, it honors the table's autovacuum_enabled option.
+ */
+void
+_hash_expand_deferred(Oid indexoid)
+{
+	Oid			heapoid;
+	Relation	heapRel;
+	Relation	rel;
+	Buffer		metabuf;
+
+	/* Lock the table first, like inserters do */
+	heapoid = IndexGetRelation(indexoid, true);
+	if (!OidIsValid(heapoid))
+		return;
+	heapRel = try_table_open(heapoid, RowExclusiveLock);
+	if (heapRel == NULL)
+		return;
+	rel = try_relation_open(indexoid, RowExclusiveLock);
+	if (rel == NULL)
+	{
+		table_close(heapRel, RowExclusiveLock);
+		return;
+	}
+
+	if (rel->rd_rel->relkind != RELKIND_INDEX ||
+		rel->rd_rel->relam != HASH_AM_OID)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("\"%s\" is not a hash index",
+						RelationGetRelationName(rel))));
+
+	/*
+	 * Leave tables that autovacuum is disabled for alone.  Their inserters
+	 * split buckets themselves once the index falls far enough behind.
+	 */
+	if (heapRel->rd_options == NULL ||
+		((StdRdOptions *) heapRel->rd_options)->autovacuum.enabled)
+	{
+		metabuf = _hash_getbuf(rel, HASH_METAPAGE, HASH_NOLOCK, LH_META_PAGE);
+		_hash_expandtable_all(rel, metabuf);
+		_hash_dropbuf(rel, metabuf);
+	}
+
+	relation_close(rel, RowExclusiveLock);
+	table_close(heapRel, RowExclusiveLock);
+}
+
 
 /*
  * _hash_alloc_buckets -- allocate a new splitpoint's worth of bucket pages
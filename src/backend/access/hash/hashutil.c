@@ -277,6 +277,7 @@ hashoptions(Datum reloptions, bool validate)
 {
 	static const relopt_parse_elt tab[] = {
 		{"fillfactor", RELOPT_TYPE_INT, offsetof(HashOptions, fillfactor)},
+		{"autosplit", RELOPT_TYPE_BOOL, offsetof(HashOptions, autosplit)},
 	};
 
 	return (bytea *) build_reloptions(reloptions, validate,
@@ -196,6 +196,36 @@ index_insert(Relation indexRelation,
 											 indexInfo);
 }
 
+/* ----------------
+ *		index_insert_multi - insert a batch of index tuples into a relation
+ *
+ * values and isnull hold the key values of all ntuples tuples, one tuple's
+ * columns after another.  No uniqueness checks are done; the caller must
+ * make sure the index AM provides aminsertmulti.
+ * ----------------
+ */
+void
+index_insert_multi(Relation indexRelation,
+				   Datum *values,
+				   bool *isnull,
+				   ItemPointer heap_tids,
+				   int ntuples,
+				   Relation heapRelation,
+				   IndexInfo *indexInfo)
+{
+	RELATION_CHECKS;
+	CHECK_REL_PROCEDURE(aminsertmulti);
+
+	if (!(indexRelation->rd_indam->ampredlocks))
+		CheckForSerializableConflictIn(indexRelation,
+									   (ItemPointer) NULL,
+									   InvalidBlockNumber);
+
+	indexRelation->rd_indam->aminsertmulti(indexRelation, values, isnull,
+										   heap_tids, ntuples, heapRelation,
+										   indexInfo);
+}
+
 /*
  * index_beginscan - start a scan of an index with amgettuple
  *
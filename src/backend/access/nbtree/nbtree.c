@@ -112,6 +112,7 @@ bthandler(PG_FUNCTION_ARGS)
 	amroutine->amclusterable = true;
 	amroutine->ampredlocks = true;
 	amroutine->amcanparallel = true;
+	amroutine->amcanbuildparallel = true;
 	amroutine->amcaninclude = true;
 	amroutine->amusemaintenanceworkmem = false;
 	amroutine->amparallelvacuumoptions =
@@ -121,6 +122,7 @@ bthandler(PG_FUNCTION_ARGS)
 	amroutine->ambuild = btbuild;
 	amroutine->ambuildempty = btbuildempty;
 	amroutine->aminsert = btinsert;
+	amroutine->aminsertmulti = NULL;
 	amroutine->ambulkdelete = btbulkdelete;
 	amroutine->amvacuumcleanup = btvacuumcleanup;
 	amroutine->amcanreturn = btcanreturn;
@@ -365,6 +367,10 @@ btbeginscan(Relation rel, int nkeys, int norderbys)
 	so->arrayKeys = NULL;
 	so->arrayContext = NULL;
 
+	so->skipEnabled = false;
+	so->skipPending = false;
+	so->skipTuple = NULL;		/* until needed */
+
 	so->killedItems = NULL;		/* until needed */
 	so->numKilled = 0;
 	so->prefetch_maximum = 0;   /* disable prefetch */
@@ -438,6 +444,17 @@ btrescan(IndexScanDesc scan, ScanKey scankey, int nscankeys,
 				scan->numberOfKeys * sizeof(ScanKeyData));
 	so->numberOfKeys = 0;		/* until _bt_preprocess_keys sets it */
 
+	/* Skip scan state is set up again by _bt_first */
+	so->skipEnabled = false;
+	so->skipPending = false;
+
+	/*
+	 * Allocate skip scan workspace if the new keys might allow skipping and
+	 * not already done in a previous rescan call.
+	 */
+	if (so->skipTuple == NULL && _bt_skip_possible(scan))
+		so->skipTuple = (IndexTuple) palloc(BLCKSZ);
+
 	/* If any keys are SK_SEARCHARRAY type, set up array-key info */
 	_bt_preprocess_array_keys(scan);
 }
@@ -475,6 +492,8 @@ btendscan(IndexScanDesc scan)
 	if (so->currTuples != NULL)
 		pfree(so->currTuples);
 	/* so->markTuples should not be pfree'd, see btrescan */
+	if (so->skipTuple != NULL)
+		pfree(so->skipTuple);
 	pfree(so);
 }
 
@@ -520,6 +539,9 @@ btrestrpos(IndexScanDesc scan)
 	if (so->numArrayKeys)
 		_bt_restore_array_keys(scan);
 
+	/* A pending skip was relative to the page we're leaving, so forget it */
+	so->skipPending = false;
+
 	if (so->markItemIndex >= 0)
 	{
 		/*
@@ -31,6 +31,9 @@ static void _bt_drop_lock_and_maybe_pin(IndexScanDesc scan, BTScanPos sp);
 static OffsetNumber _bt_binsrch(Relation rel, BTScanInsert key, Buffer buf);
 static int	_bt_binsrch_posting(BTScanInsert key, Page page,
 								OffsetNumber offnum);
+static inline int32 _bt_compare_prefix(Relation rel, BTScanInsert key,
+									   Page page, OffsetNumber offnum,
+									   int *cmpprefix);
 static bool _bt_readpage(IndexScanDesc scan, ScanDirection dir,
 						 OffsetNumber offnum);
 static void _bt_saveitem(BTScanOpaque so, int itemIndex,
@@ -43,6 +46,7 @@ static inline void _bt_savepostingitem(BTScanOpaque so, int itemIndex,
 									   ItemPointer heapTid, int tupleOffset);
 static bool _bt_steppage(IndexScanDesc scan, ScanDirection dir);
 static bool _bt_readnextpage(IndexScanDesc scan, BlockNumber blkno, ScanDirection dir);
+static OffsetNumber _bt_skip_search(IndexScanDesc scan, Buffer *bufP);
 static bool _bt_parallel_readpage(IndexScanDesc scan, BlockNumber blkno,
 								  ScanDirection dir);
 static Buffer _bt_walk_left(Relation rel, Buffer buf, Snapshot snapshot);
@@ -352,6 +356,8 @@ _bt_binsrch(Relation rel,
 	BTPageOpaque opaque;
 	OffsetNumber low,
 				high;
+	int			lowprefix,
+				highprefix;
 	int32		result,
 				cmpval;
 
@@ -387,23 +393,37 @@ _bt_binsrch(Relation rel,
 	 * 'low' are <= scan key, all slots at or after 'high' are > scan key.
 	 *
 	 * We can fall out when high == low.
+	 *
+	 * We also track how many leading key attributes the tuples just before
+	 * 'low' and at 'high' were found to share with the scan key.  Every tuple
+	 * between the two has at least the smaller of those prefixes in common
+	 * with the scan key too, so _bt_compare_prefix() needn't compare those
+	 * attributes again (dynamic prefix truncation).
 	 */
 	high++;						/* establish the loop invariant for high */
+	lowprefix = highprefix = 0;
 
 	cmpval = key->nextkey ? 0 : 1;	/* select comparison value */
 
 	while (high > low)
 	{
 		OffsetNumber mid = low + ((high - low) / 2);
+		int			prefix = Min(lowprefix, highprefix);
 
 		/* We have low <= mid < high, so mid points at a real slot */
 
-		result = _bt_compare(rel, key, page, mid);
+		result = _bt_compare_prefix(rel, key, page, mid, &prefix);
 
 		if (result >= cmpval)
+		{
 			low = mid + 1;
+			lowprefix = prefix;
+		}
 		else
+		{
 			high = mid;
+			highprefix = prefix;
+		}
 	}
 
 	/*
@@ -456,6 +476,8 @@ _bt_binsrch_insert(Relation rel, BTInsertState insertstate)
 	OffsetNumber low,
 				high,
 				stricthigh;
+	int			lowprefix,
+				highprefix;
 	int32		result,
 				cmpval;
 
@@ -498,26 +520,36 @@ _bt_binsrch_insert(Relation rel, BTInsertState insertstate)
 	 * maintained to save additional search effort for caller.
 	 *
 	 * We can fall out when high == low.
+	 *
+	 * Attribute prefixes shared with the scan key are tracked just as in
+	 * _bt_binsrch().  We don't know anything about the prefixes of cached
+	 * bounds, so always start from zero.
 	 */
 	if (!insertstate->bounds_valid)
 		high++;					/* establish the loop invariant for high */
 	stricthigh = high;			/* high initially strictly higher */
+	lowprefix = highprefix = 0;
 
 	cmpval = 1;					/* !nextkey comparison value */
 
 	while (high > low)
 	{
 		OffsetNumber mid = low + ((high - low) / 2);
+		int			prefix = Min(lowprefix, highprefix);
 
 		/* We have low <= mid < high, so mid points at a real slot */
 
-		result = _bt_compare(rel, key, page, mid);
+		result = _bt_compare_prefix(rel, key, page, mid, &prefix);
 
 		if (result >= cmpval)
+		{
 			low = mid + 1;
+			lowprefix = prefix;
+		}
 		else
 		{
 			high = mid;
+			highprefix = prefix;
 			if (result != 0)
 				stricthigh = high;
 		}
@@ -666,6 +698,26 @@ _bt_compare(Relation rel,
 			BTScanInsert key,
 			Page page,
 			OffsetNumber offnum)
+{
+	int			cmpprefix = 0;
+
+	return _bt_compare_prefix(rel, key, page, offnum, &cmpprefix);
+}
+
+/*
+ *	_bt_compare_prefix() -- _bt_compare() that can skip a known-equal prefix.
+ *
+ * On entry, *cmpprefix is the number of leading key attributes that the
+ * caller already knows the tuple at offnum shares with the scan key; those
+ * are not compared again.  On exit, it is set to the number of leading key
+ * attributes that were found equal, for use as a bound by later calls.
+ */
+static inline int32
+_bt_compare_prefix(Relation rel,
+				   BTScanInsert key,
+				   Page page,
+				   OffsetNumber offnum,
+				   int *cmpprefix)
 {
 	TupleDesc	itupdesc = RelationGetDescr(rel);
 	BTPageOpaque opaque = (BTPageOpaque) PageGetSpecialPointer(page);
@@ -685,7 +737,10 @@ _bt_compare(Relation rel,
 	 * --- see NOTE above.
 	 */
 	if (!P_ISLEAF(opaque) && offnum == P_FIRSTDATAKEY(opaque))
+	{
+		*cmpprefix = 0;
 		return 1;
+	}
 
 	itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, offnum));
 	ntupatts = BTreeTupleGetNAtts(itup, rel);
@@ -705,8 +760,9 @@ _bt_compare(Relation rel,
 	ncmpkey = Min(ntupatts, key->keysz);
 	Assert(key->heapkeyspace || ncmpkey == key->keysz);
 	Assert(!BTreeTupleIsPosting(itup) || key->allequalimage);
-	scankey = key->scankeys;
-	for (int i = 1; i <= ncmpkey; i++)
+	Assert(*cmpprefix >= 0 && *cmpprefix <= key->keysz);
+	scankey = key->scankeys + Min(*cmpprefix, ncmpkey);
+	for (int i = Min(*cmpprefix, ncmpkey) + 1; i <= ncmpkey; i++)
 	{
 		Datum		datum;
 		bool		isNull;
@@ -750,11 +806,16 @@ _bt_compare(Relation rel,
 
 		/* if the keys are unequal, return the difference */
 		if (result != 0)
+		{
+			*cmpprefix = i - 1;
 			return result;
+		}
 
 		scankey++;
 	}
 
+	*cmpprefix = ncmpkey;
+
 	/*
 	 * All non-truncated attributes (other than heap TID) were found to be
 	 * equal.  Treat truncated attributes as minus infinity when scankey has a
@@ -1199,6 +1260,9 @@ _bt_first(IndexScanDesc scan, ScanDirection dir)
 	/* If key bounds are not specified, then we will scan the whole relation and it make sense to start with the largest possible prefetch distance */
 	so->current_prefetch_distance = (keysCount == 0) ? so->prefetch_maximum : 0;
 
+	/* See whether we can skip over runs of leaf pages */
+	_bt_skip_preprocess(scan, dir);
+
 	/*
 	 * If we found no usable boundary keys, we have to start from one end of
 	 * the tree.  Walk down that edge to the first or last key, and scan from
@@ -1852,6 +1916,12 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 
 		if (!continuescan)
 			so->currPos.moreRight = false;
+		else if (so->skipEnabled)
+		{
+			/* See whether we can skip over pages to the right */
+			so->skipPending = false;
+			_bt_skip_check(scan, page);
+		}
 
 		Assert(itemIndex <= MaxTIDsPerBTreePage);
 		so->currPos.firstItem = 0;
@@ -2212,24 +2282,52 @@ _bt_readnextpage(IndexScanDesc scan, BlockNumber blkno, ScanDirection dir)
 			}
 			/* check for interrupts while we're not holding any buffer lock */
 			CHECK_FOR_INTERRUPTS();
-			/* step right one page */
-			so->currPos.buf = _bt_getbuf(rel, blkno, BT_READ);
-			page = BufferGetPage(so->currPos.buf);
-			TestForOldSnapshot(scan->xs_snapshot, rel, page);
-			opaque = (BTPageOpaque) PageGetSpecialPointer(page);
-			/* check for deleted page */
-			if (!P_IGNORE(opaque))
+			if (so->skipPending)
 			{
+				OffsetNumber offnum;
+
+				/*
+				 * The last page we read told us that the pages to its right
+				 * can't contain matches for a while, so descend the tree
+				 * again to the next position that might match, rather than
+				 * stepping right.  The descent lands on a live leaf page.
+				 */
+				Assert(scan->parallel_scan == NULL);
+				so->skipPending = false;
+				offnum = _bt_skip_search(scan, &so->currPos.buf);
+				if (!BufferIsValid(so->currPos.buf))
+				{
+					BTScanPosInvalidate(so->currPos);
+					return false;
+				}
+				blkno = BufferGetBlockNumber(so->currPos.buf);
+				page = BufferGetPage(so->currPos.buf);
+				opaque = (BTPageOpaque) PageGetSpecialPointer(page);
 				PredicateLockPage(rel, blkno, scan->xs_snapshot);
-				/* see if there are any matches on this page */
-				/* note that this will clear moreRight if we can stop */
-				if (_bt_readpage(scan, dir, P_FIRSTDATAKEY(opaque)))
+				if (_bt_readpage(scan, dir, offnum))
 					break;
 			}
-			else if (scan->parallel_scan != NULL)
+			else
 			{
-				/* allow next page be processed by parallel worker */
-				_bt_parallel_release(scan, opaque->btpo_next);
+				/* step right one page */
+				so->currPos.buf = _bt_getbuf(rel, blkno, BT_READ);
+				page = BufferGetPage(so->currPos.buf);
+				TestForOldSnapshot(scan->xs_snapshot, rel, page);
+				opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+				/* check for deleted page */
+				if (!P_IGNORE(opaque))
+				{
+					PredicateLockPage(rel, blkno, scan->xs_snapshot);
+					/* see if there are any matches on this page */
+					/* note that this will clear moreRight if we can stop */
+					if (_bt_readpage(scan, dir, P_FIRSTDATAKEY(opaque)))
+						break;
+				}
+				else if (scan->parallel_scan != NULL)
+				{
+					/* allow next page be processed by parallel worker */
+					_bt_parallel_release(scan, opaque->btpo_next);
+				}
 			}
 
 			/* nope, keep going */
@@ -2357,6 +2455,65 @@ _bt_readnextpage(IndexScanDesc scan, BlockNumber blkno, ScanDirection dir)
 	return true;
 }
 
+/*
+ *	_bt_skip_search() -- Descend to the target position of a pending skip
+ *
+ * Builds an insertion scan key from so->skipTuple's first column value, plus
+ * the second column's lower bound unless we're skipping to the next first
+ * column value, and uses it to find the first leaf tuple that could match.
+ * On return, *bufP is pinned and read-locked, and the offset to start
+ * reading from is returned.  *bufP is set to InvalidBuffer if the index
+ * turned out to be empty.
+ */
+static OffsetNumber
+_bt_skip_search(IndexScanDesc scan, Buffer *bufP)
+{
+	Relation	rel = scan->indexRelation;
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	BTScanInsertData inskey;
+	BTStack		stack;
+	Datum		datum;
+	bool		isNull;
+
+	datum = index_getattr(so->skipTuple, 1, RelationGetDescr(rel), &isNull);
+	ScanKeyEntryInitializeWithInfo(inskey.scankeys,
+								   (isNull ? SK_ISNULL : 0) |
+								   (rel->rd_indoption[0] << SK_BT_INDOPTION_SHIFT),
+								   1,
+								   InvalidStrategy,
+								   InvalidOid,
+								   rel->rd_indcollation[0],
+								   index_getprocinfo(rel, 1, BTORDER_PROC),
+								   datum);
+
+	if (so->skipNextPrefix)
+	{
+		/* Find the first tuple after all those with this first column value */
+		inskey.keysz = 1;
+		inskey.nextkey = true;
+	}
+	else
+	{
+		/* Find the first tuple with this first column value within bound */
+		memcpy(inskey.scankeys + 1, &so->skipLower, sizeof(ScanKeyData));
+		inskey.keysz = 2;
+		inskey.nextkey = so->skipLowerStrict;
+	}
+
+	_bt_metaversion(rel, &inskey.heapkeyspace, &inskey.allequalimage);
+	inskey.anynullkeys = false; /* unused */
+	inskey.pivotsearch = false;
+	inskey.scantid = NULL;
+
+	stack = _bt_search(rel, &inskey, bufP, BT_READ, scan->xs_snapshot);
+	_bt_freestack(stack);
+
+	if (!BufferIsValid(*bufP))
+		return InvalidOffsetNumber;
+
+	return _bt_binsrch(rel, &inskey, *bufP);
+}
+
 /*
  *	_bt_parallel_readpage() -- Read current page containing valid data for scan
  *
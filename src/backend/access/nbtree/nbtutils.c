@@ -1683,6 +1683,305 @@ _bt_check_rowcompare(ScanKey skey, IndexTuple tuple, int tupnatts,
 	return result;
 }
 
+/*
+ * _bt_skip_possible() -- might the scan keys allow a skip scan?
+ *
+ * Cheap test used by btrescan() to decide whether to allocate skip scan
+ * workspace: there must be a key on the second index column and none on the
+ * first.  _bt_skip_preprocess() makes the final decision.
+ */
+bool
+_bt_skip_possible(IndexScanDesc scan)
+{
+	bool		found = false;
+
+	if (IndexRelationGetNumberOfKeyAttributes(scan->indexRelation) < 2)
+		return false;
+
+	for (int i = 0; i < scan->numberOfKeys; i++)
+	{
+		ScanKey		cur = &scan->keyData[i];
+
+		if (cur->sk_attno == 1)
+			return false;
+		if (cur->sk_attno == 2)
+			found = true;
+	}
+
+	return found;
+}
+
+/*
+ * Set up an insertion-format copy of a search-type scan key, using the
+ * opfamily's comparison support function.  This is the same transformation
+ * that _bt_first() applies to its boundary keys.
+ */
+static void
+_bt_skip_init_bound(Relation rel, ScanKey cur, ScanKey dest)
+{
+	int			i = cur->sk_attno - 1;
+
+	if (cur->sk_subtype == rel->rd_opcintype[i] ||
+		cur->sk_subtype == InvalidOid)
+	{
+		FmgrInfo   *procinfo;
+
+		procinfo = index_getprocinfo(rel, cur->sk_attno, BTORDER_PROC);
+		ScanKeyEntryInitializeWithInfo(dest,
+									   cur->sk_flags,
+									   cur->sk_attno,
+									   cur->sk_strategy,
+									   cur->sk_subtype,
+									   cur->sk_collation,
+									   procinfo,
+									   cur->sk_argument);
+	}
+	else
+	{
+		RegProcedure cmp_proc;
+
+		cmp_proc = get_opfamily_proc(rel->rd_opfamily[i],
+									 rel->rd_opcintype[i],
+									 cur->sk_subtype,
+									 BTORDER_PROC);
+		if (!RegProcedureIsValid(cmp_proc))
+			elog(ERROR, "missing support function %d(%u,%u) for attribute %d of index \"%s\"",
+				 BTORDER_PROC, rel->rd_opcintype[i], cur->sk_subtype,
+				 cur->sk_attno, RelationGetRelationName(rel));
+		ScanKeyEntryInitialize(dest,
+							   cur->sk_flags,
+							   cur->sk_attno,
+							   cur->sk_strategy,
+							   cur->sk_subtype,
+							   cur->sk_collation,
+							   cmp_proc,
+							   cur->sk_argument);
+	}
+}
+
+/*
+ * _bt_skip_preprocess() -- decide whether a scan may skip leaf pages
+ *
+ * When the scan keys constrain the second index column but not the first,
+ * the matching tuples are spread across the index, one group for each value
+ * of the first column.  Reading every leaf page in between is wasteful when
+ * the first column has few distinct values.  Instead, whenever the last
+ * tuple on a leaf page shows that no more tuples with its first column value
+ * can match (or none can until some later second column value), and the
+ * page's high key shows that the same first column value continues on the
+ * next page, we descend the tree again to the first tuple that might match,
+ * rather than stepping right.  See _bt_skip_check().
+ *
+ * This is only done for non-parallel forward scans without array keys, and
+ * not when index-only scans are prefetching leaf pages, since that assumes
+ * we visit every leaf page in order.  Must be called after
+ * _bt_preprocess_keys().
+ */
+void
+_bt_skip_preprocess(IndexScanDesc scan, ScanDirection dir)
+{
+	Relation	rel = scan->indexRelation;
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+
+	so->skipEnabled = false;
+	so->skipPending = false;
+	so->skipHasLower = false;
+	so->skipHasUpper = false;
+
+	if (so->skipTuple == NULL || !ScanDirectionIsForward(dir) ||
+		scan->parallel_scan != NULL || so->numArrayKeys != 0 ||
+		(scan->xs_want_itup && so->prefetch_maximum > 0))
+		return;
+
+	for (int i = 0; i < so->numberOfKeys; i++)
+	{
+		ScanKey		cur = &so->keyData[i];
+		bool		lower,
+					upper;
+
+		if (cur->sk_attno == 1)
+			return;
+		if (cur->sk_attno != 2)
+			continue;
+
+		/* IS NULL, IS NOT NULL and row comparisons aren't supported */
+		if (cur->sk_flags & (SK_ISNULL | SK_ROW_HEADER))
+			return;
+
+		/* Work out which way the key bounds the column, in index order */
+		lower = upper = false;
+		switch (cur->sk_strategy)
+		{
+			case BTLessStrategyNumber:
+			case BTLessEqualStrategyNumber:
+				upper = true;
+				break;
+			case BTEqualStrategyNumber:
+				lower = upper = true;
+				break;
+			case BTGreaterEqualStrategyNumber:
+			case BTGreaterStrategyNumber:
+				lower = true;
+				break;
+			default:
+				return;
+		}
+		if (cur->sk_flags & SK_BT_DESC)
+		{
+			bool		tmp = lower;
+
+			lower = upper;
+			upper = tmp;
+		}
+
+		/*
+		 * Any one bound of each kind will do; if cross-type operators left
+		 * redundant keys behind, we might not pick the tightest one.
+		 */
+		if (lower && !so->skipHasLower)
+		{
+			_bt_skip_init_bound(rel, cur, &so->skipLower);
+			so->skipLowerStrict = (cur->sk_strategy == BTLessStrategyNumber ||
+								   cur->sk_strategy == BTGreaterStrategyNumber);
+			so->skipHasLower = true;
+		}
+		if (upper && !so->skipHasUpper)
+		{
+			_bt_skip_init_bound(rel, cur, &so->skipUpper);
+			so->skipUpperStrict = (cur->sk_strategy == BTLessStrategyNumber ||
+								   cur->sk_strategy == BTGreaterStrategyNumber);
+			so->skipHasUpper = true;
+		}
+	}
+
+	so->skipEnabled = so->skipHasLower || so->skipHasUpper;
+}
+
+/*
+ * Compare an index tuple's second column value to a skip bound, in index
+ * order.  Returns <0, 0 or >0 if the value sorts before, equal to, or after
+ * the bound.
+ */
+static int32
+_bt_skip_compare(ScanKey bound, Datum datum, bool isNull)
+{
+	int32		result;
+
+	if (isNull)
+		return (bound->sk_flags & SK_BT_NULLS_FIRST) ? -1 : 1;
+
+	result = DatumGetInt32(FunctionCall2Coll(&bound->sk_func,
+											 bound->sk_collation,
+											 datum,
+											 bound->sk_argument));
+	if (bound->sk_flags & SK_BT_DESC)
+		INVERT_COMPARE_RESULT(result);
+
+	return result;
+}
+
+/*
+ * _bt_skip_check() -- should the scan skip instead of stepping right?
+ *
+ * Called by _bt_readpage() once a forward scan has examined every tuple on
+ * a leaf page and still needs to continue.  Examines the last tuple on the
+ * page: if every later tuple with the same first column value must fail the
+ * second column's keys, or must fail them until some later second column
+ * value, and the high key shows that such tuples continue on the next page,
+ * then set so->skipPending so that _bt_readnextpage() re-descends the tree
+ * instead.  The last tuple is saved in so->skipTuple, since the target
+ * position is computed from it.
+ *
+ * Skipping is always safe: the tuples skipped over sort after the last tuple
+ * and before the target position, so they cannot satisfy the keys, whatever
+ * concurrent activity may have put them there.  The high key test only
+ * decides whether skipping is likely to save any page reads.
+ */
+void
+_bt_skip_check(IndexScanDesc scan, Page page)
+{
+	Relation	rel = scan->indexRelation;
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	TupleDesc	itupdesc = RelationGetDescr(rel);
+	BTPageOpaque opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+	OffsetNumber maxoff = PageGetMaxOffsetNumber(page);
+	IndexTuple	lasttup,
+				hikey;
+	Datum		lastdatum,
+				hidatum,
+				datum;
+	bool		lastnull,
+				hinull,
+				isNull;
+
+	Assert(so->skipEnabled);
+
+	if (P_RIGHTMOST(opaque) || maxoff < P_FIRSTDATAKEY(opaque))
+		return;
+
+	hikey = (IndexTuple) PageGetItem(page, PageGetItemId(page, P_HIKEY));
+	if (BTreeTupleGetNAtts(hikey, rel) < 1)
+		return;
+	lasttup = (IndexTuple) PageGetItem(page, PageGetItemId(page, maxoff));
+
+	/* Does the last tuple's first column value continue on the next page? */
+	lastdatum = index_getattr(lasttup, 1, itupdesc, &lastnull);
+	hidatum = index_getattr(hikey, 1, itupdesc, &hinull);
+	if (lastnull != hinull)
+		return;
+	if (!lastnull)
+	{
+		FmgrInfo   *procinfo = index_getprocinfo(rel, 1, BTORDER_PROC);
+
+		if (DatumGetInt32(FunctionCall2Coll(procinfo,
+											rel->rd_indcollation[0],
+											lastdatum, hidatum)) != 0)
+			return;
+	}
+
+	/* Where does the last tuple's second column value fall? */
+	datum = index_getattr(lasttup, 2, itupdesc, &isNull);
+	if (isNull)
+	{
+		ScanKey		bound = so->skipHasUpper ? &so->skipUpper : &so->skipLower;
+
+		/* With nulls last, only nulls (which can't match) can follow */
+		if (!(bound->sk_flags & SK_BT_NULLS_FIRST))
+		{
+			so->skipNextPrefix = true;
+			so->skipPending = true;
+		}
+	}
+	else if (so->skipHasUpper)
+	{
+		int32		cmp = _bt_skip_compare(&so->skipUpper, datum, isNull);
+
+		if (cmp > 0 || (cmp == 0 && so->skipUpperStrict))
+		{
+			/* No more matches until the next first column value */
+			so->skipNextPrefix = true;
+			so->skipPending = true;
+		}
+	}
+	if (!so->skipPending && so->skipHasLower)
+	{
+		int32		cmp = _bt_skip_compare(&so->skipLower, datum, isNull);
+
+		if (cmp < 0 || (cmp == 0 && so->skipLowerStrict))
+		{
+			/* No more matches until the lower bound */
+			so->skipNextPrefix = false;
+			so->skipPending = true;
+		}
+	}
+
+	if (so->skipPending)
+	{
+		Assert(IndexTupleSize(lasttup) <= BLCKSZ);
+		memcpy(so->skipTuple, lasttup, IndexTupleSize(lasttup));
+	}
+}
+
 /*
  * _bt_killitems - set LP_DEAD state for items an indexscan caller has
  * told us were killed
@@ -230,7 +230,9 @@ toast_tuple_try_compression(ToastTupleContext *ttc, int attribute)
 	Datum		new_value;
 	ToastAttrInfo *attr = &ttc->ttc_attr[attribute];
 
-	new_value = toast_compress_datum(*value, attr->tai_compression);
+	new_value = toast_compress_datum(*value, attr->tai_compression,
+									 RelationGetRelid(ttc->ttc_rel),
+									 attribute + 1);
 
 	if (DatumGetPointer(new_value) != NULL)
 	{
@@ -14,6 +14,9 @@
 
 #include "postgres.h"
 
+#include "access/brin.h"
+#include "access/gin_private.h"
+#include "access/gist_private.h"
 #include "access/heapam.h"
 #include "access/nbtree.h"
 #include "access/parallel.h"
@@ -143,6 +146,15 @@ static const struct
 	{
 		"_bt_parallel_build_main", _bt_parallel_build_main
 	},
+	{
+		"_brin_parallel_build_main", _brin_parallel_build_main
+	},
+	{
+		"_gin_parallel_build_main", _gin_parallel_build_main
+	},
+	{
+		"_gist_parallel_build_main", _gist_parallel_build_main
+	},
 	{
 		"parallel_vacuum_main", parallel_vacuum_main
 	}
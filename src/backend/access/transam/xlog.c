@@ -36,6 +36,7 @@
 #include "access/xlog_internal.h"
 #include "access/xlogarchive.h"
 #include "access/xloginsert.h"
+#include "access/xlogprefetch.h"
 #include "access/xlogreader.h"
 #include "access/xlogutils.h"
 #include "catalog/catversion.h"
@@ -7633,9 +7634,12 @@ StartupXLOG(void)
 			ErrorContextCallback errcallback;
 			TimestampTz xtime;
 			PGRUsage	ru0;
+			XLogPrefetcher *prefetcher;
 
 			pg_rusage_init(&ru0);
 
+			prefetcher = XLogPrefetcherAllocate();
+
 			InRedo = true;
 
 			ereport(LOG,
@@ -7786,6 +7790,12 @@ StartupXLOG(void)
 					TransactionIdIsValid(record->xl_xid))
 					RecordKnownAssignedTransactionIds(record->xl_xid);
 
+				/*
+				 * Read ahead in the WAL and start I/O for blocks that will
+				 * be needed by upcoming records.
+				 */
+				XLogPrefetcherReadAhead(prefetcher, xlogreader);
+
 				/* Now apply the WAL record itself */
 				RmgrTable[record->xl_rmid].rm_redo(xlogreader);
 
@@ -7862,6 +7872,8 @@ StartupXLOG(void)
 			 * end of main redo apply loop
 			 */
 
+			XLogPrefetcherFree(prefetcher);
+
 			if (reachedRecoveryTarget)
 			{
 				if (!reachedConsistency)
@@ -12669,6 +12681,17 @@ read_backup_label(XLogRecPtr *checkPointLoc, bool *backupEndRequired,
 								 tli_from_file, BACKUP_LABEL_FILE)));
 	}
 
+	/*
+	 * INCREMENTAL FROM LSN is only present in incremental backups, which hold
+	 * just the changed blocks of relation files. Such a backup must be
+	 * combined with its predecessors before it can be started.
+	 */
+	if (fscanf(lfp, "INCREMENTAL FROM LSN: %X/%X\n", &hi, &lo) > 0)
+		ereport(FATAL,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("this is an incremental backup, not a data directory"),
+				 errhint("Use pg_combinebackup to reconstruct a valid data directory.")));
+
 	if (ferror(lfp) || FreeFile(lfp))
 		ereport(FATAL,
 				(errcode_for_file_access(),
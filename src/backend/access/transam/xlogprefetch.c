@@ -0,0 +1,546 @@
+/*-------------------------------------------------------------------------
+ *
+ * xlogprefetch.c
+ *		Prefetching support for recovery.
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *		src/backend/access/transam/xlogprefetch.c
+ *
+ * The goal of this module is to read future WAL records and issue
+ * PrefetchSharedBuffer() calls for referenced blocks, so that we avoid I/O
+ * stalls in the main recovery loop.
+ *
+ * The prefetcher uses a WAL reader of its own, which runs up to
+ * recovery_prefetch_distance bytes ahead of the record being replayed.  It
+ * only reads WAL that is already present in pg_wal (and, while streaming,
+ * has already been flushed by the WAL receiver).  It never waits for WAL to
+ * arrive and never restores files from the archive; when it runs out of WAL
+ * it simply stops, and tries again a little later.  Whatever it decodes is
+ * used only as a hint: mistakes can cost some I/O, but can't affect the
+ * result of recovery, which is still performed by the main reader.
+ *
+ * To avoid flooding the system with I/O requests, no more than
+ * maintenance_io_concurrency prefetches are allowed to be in flight at once.
+ * A prefetch is considered to be complete when the record that referenced
+ * the block has been replayed, since by then the block must have been read.
+ *
+ * Blocks are not prefetched if the record carries a full page image for
+ * them, or if redo will initialize the page from scratch.  A relation that
+ * is created by a record in the look-ahead window doesn't exist on disk yet,
+ * so blocks of that relation (or of any relation in a database that is
+ * being created) are filtered out until the creating record has been
+ * replayed.  The same happens when a prefetch finds the relation file to be
+ * missing, to avoid retrying a failing open() for every later reference.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include <unistd.h>
+
+#include "access/xlog.h"
+#include "access/xlog_internal.h"
+#include "access/xlogprefetch.h"
+#include "access/xlogreader.h"
+#include "access/xlogutils.h"
+#include "catalog/pg_class.h"
+#include "catalog/storage_xlog.h"
+#include "commands/dbcommands_xlog.h"
+#include "replication/walreceiver.h"
+#include "storage/bufmgr.h"
+#include "storage/fd.h"
+#include "storage/smgr.h"
+#include "utils/hsearch.h"
+#include "utils/wait_event.h"
+
+/* GUCs */
+bool		recovery_prefetch = true;
+int			recovery_prefetch_distance = 256 * 1024;
+
+/*
+ * A relation (or, if relNode is InvalidOid, a whole database) whose blocks
+ * should not be prefetched until the record at filter_until_replayed has
+ * been replayed.
+ */
+typedef struct XLogPrefetcherFilter
+{
+	RelFileNode rnode;
+	XLogRecPtr	filter_until_replayed;
+} XLogPrefetcherFilter;
+
+struct XLogPrefetcher
+{
+	/* Reader and state for reading ahead. */
+	XLogReaderState *reader;
+	TimeLineID	tli;
+	int			file;
+	XLogSegNo	segno;
+	bool		active;			/* is the reader positioned? */
+	XLogRecPtr	next_lsn;		/* start of the next record to decode */
+	XLogRecPtr	retry_lsn;		/* after running out of WAL, wait for replay
+								 * to reach this point before retrying */
+
+	/* Current record, if its block references haven't all been examined. */
+	bool		have_record;
+	int			next_block_id;
+
+	/* Last block prefetched, to skip repeated and sequential references. */
+	RelFileNode last_rnode;
+	ForkNumber	last_forknum;
+	BlockNumber last_blkno;
+
+	/* Relations that are known not to exist yet. */
+	HTAB	   *filter_table;
+
+	/* Circular queue of LSNs of records with prefetches in flight. */
+	XLogRecPtr *prefetch_queue;
+	int			prefetch_queue_size;
+	int			prefetch_head;
+	int			prefetch_tail;
+
+	/* Statistics, reported at the end of recovery. */
+	int64		prefetch;
+	int64		skip_hit;
+	int64		skip_new;
+	int64		skip_fpw;
+	int64		skip_init;
+	int64		skip_seq;
+};
+
+static int	XLogPrefetcherPageRead(XLogReaderState *reader,
+								   XLogRecPtr targetPagePtr, int reqLen,
+								   XLogRecPtr targetRecPtr, char *readBuf);
+static void XLogPrefetcherCloseFile(XLogPrefetcher *prefetcher);
+static void XLogPrefetcherScanRecord(XLogPrefetcher *prefetcher);
+static bool XLogPrefetcherScanBlocks(XLogPrefetcher *prefetcher);
+static void XLogPrefetcherAddFilter(XLogPrefetcher *prefetcher,
+									RelFileNode rnode, XLogRecPtr lsn);
+static bool XLogPrefetcherIsFiltered(XLogPrefetcher *prefetcher,
+									 RelFileNode rnode);
+static void XLogPrefetcherCompleteFilters(XLogPrefetcher *prefetcher,
+										  XLogRecPtr replaying_lsn);
+static void XLogPrefetcherCompletedIO(XLogPrefetcher *prefetcher,
+									  XLogRecPtr replaying_lsn);
+static inline bool XLogPrefetcherSaturated(XLogPrefetcher *prefetcher);
+
+/*
+ * Create a prefetcher.  The WAL reader is allocated on first use, so this is
+ * cheap even if prefetching turns out to be disabled.
+ */
+XLogPrefetcher *
+XLogPrefetcherAllocate(void)
+{
+	XLogPrefetcher *prefetcher;
+	HASHCTL		hash_ctl;
+
+	prefetcher = palloc0(sizeof(XLogPrefetcher));
+	prefetcher->file = -1;
+
+	hash_ctl.keysize = sizeof(RelFileNode);
+	hash_ctl.entrysize = sizeof(XLogPrefetcherFilter);
+	prefetcher->filter_table = hash_create("XLogPrefetcherFilterTable", 64,
+										   &hash_ctl,
+										   HASH_ELEM | HASH_BLOBS);
+
+	/* One extra slot, so that a full queue can be told apart from empty. */
+	prefetcher->prefetch_queue_size = MAX_IO_CONCURRENCY + 1;
+	prefetcher->prefetch_queue = palloc(sizeof(XLogRecPtr) *
+										prefetcher->prefetch_queue_size);
+
+	return prefetcher;
+}
+
+/*
+ * Destroy a prefetcher and release all resources.
+ */
+void
+XLogPrefetcherFree(XLogPrefetcher *prefetcher)
+{
+	elog(DEBUG1,
+		 "recovery prefetch: " INT64_FORMAT " blocks prefetched, "
+		 INT64_FORMAT " already in buffers, "
+		 INT64_FORMAT " not yet created, "
+		 INT64_FORMAT " with full page images, "
+		 INT64_FORMAT " initialized by redo, "
+		 INT64_FORMAT " repeated or sequential",
+		 prefetcher->prefetch, prefetcher->skip_hit, prefetcher->skip_new,
+		 prefetcher->skip_fpw, prefetcher->skip_init, prefetcher->skip_seq);
+
+	XLogPrefetcherCloseFile(prefetcher);
+	if (prefetcher->reader)
+		XLogReaderFree(prefetcher->reader);
+	hash_destroy(prefetcher->filter_table);
+	pfree(prefetcher->prefetch_queue);
+	pfree(prefetcher);
+}
+
+/*
+ * Called before each record is replayed, to read ahead in the WAL and
+ * initiate I/O for blocks that will be needed soon.  replay_reader is the
+ * reader that has just decoded the record about to be replayed.
+ */
+void
+XLogPrefetcherReadAhead(XLogPrefetcher *prefetcher,
+						XLogReaderState *replay_reader)
+{
+	XLogRecPtr	replaying_lsn = replay_reader->ReadRecPtr;
+
+	/* Forget about prefetches and filters that replay has caught up with. */
+	XLogPrefetcherCompletedIO(prefetcher, replaying_lsn);
+	XLogPrefetcherCompleteFilters(prefetcher, replaying_lsn);
+
+	/*
+	 * If a redo filter is installed, only pages that are already in shared
+	 * buffers are replayed, so there is nothing to gain by prefetching.
+	 */
+	if (!recovery_prefetch || maintenance_io_concurrency == 0 ||
+		recovery_prefetch_distance == 0 || redo_read_buffer_filter != NULL)
+		return;
+
+	if (prefetcher->reader == NULL)
+	{
+		prefetcher->reader =
+			XLogReaderAllocate(wal_segment_size, NULL,
+							   XL_ROUTINE(.page_read = XLogPrefetcherPageRead,
+										  .segment_open = NULL,
+										  .segment_close = NULL),
+							   prefetcher);
+		if (prefetcher->reader == NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_OUT_OF_MEMORY),
+					 errmsg("out of memory"),
+					 errdetail("Failed while allocating a WAL reading processor.")));
+	}
+
+	/*
+	 * (Re)position the reader if it is idle, if replay has overtaken it, or
+	 * if replay has moved to a new timeline.
+	 */
+	if (!prefetcher->active ||
+		prefetcher->next_lsn < replay_reader->EndRecPtr ||
+		prefetcher->tli != ThisTimeLineID)
+	{
+		if (!prefetcher->active && replaying_lsn < prefetcher->retry_lsn)
+			return;
+
+		if (prefetcher->tli != ThisTimeLineID)
+		{
+			XLogPrefetcherCloseFile(prefetcher);
+			prefetcher->tli = ThisTimeLineID;
+			prefetcher->next_lsn = InvalidXLogRecPtr;
+		}
+		prefetcher->next_lsn = Max(prefetcher->next_lsn,
+								   replay_reader->EndRecPtr);
+		XLogBeginRead(prefetcher->reader, prefetcher->next_lsn);
+		prefetcher->active = true;
+		prefetcher->have_record = false;
+	}
+
+	for (;;)
+	{
+		char	   *errormsg;
+
+		/* Finish examining the current record first. */
+		if (prefetcher->have_record)
+		{
+			if (!XLogPrefetcherScanBlocks(prefetcher))
+				break;			/* too many prefetches in flight */
+			prefetcher->have_record = false;
+		}
+
+		/* Don't look further ahead than allowed. */
+		if (prefetcher->next_lsn - replaying_lsn >=
+			(XLogRecPtr) recovery_prefetch_distance)
+			break;
+
+		if (XLogReadRecord(prefetcher->reader, &errormsg) == NULL)
+		{
+			/*
+			 * We've run out of WAL that is available right now, or hit
+			 * something we can't decode yet.  Either way, the main reader
+			 * will deal with it; try again once replay has moved on a bit.
+			 */
+			prefetcher->active = false;
+			prefetcher->retry_lsn = replaying_lsn + XLOG_BLCKSZ;
+			break;
+		}
+
+		prefetcher->next_lsn = prefetcher->reader->EndRecPtr;
+		prefetcher->have_record = true;
+		prefetcher->next_block_id = 0;
+		XLogPrefetcherScanRecord(prefetcher);
+	}
+}
+
+/*
+ * Read a WAL page for the look-ahead reader.  Unlike the main reader, this
+ * never waits for WAL and never restores it from the archive: whatever isn't
+ * in pg_wal yet is treated as unavailable.
+ */
+static int
+XLogPrefetcherPageRead(XLogReaderState *reader, XLogRecPtr targetPagePtr,
+					   int reqLen, XLogRecPtr targetRecPtr, char *readBuf)
+{
+	XLogPrefetcher *prefetcher = (XLogPrefetcher *) reader->private_data;
+	int			readLen = XLOG_BLCKSZ;
+	XLogSegNo	segno;
+	uint32		offset;
+	int			r;
+
+	/* While streaming, don't read beyond what has been flushed. */
+	if (WalRcvStreaming())
+	{
+		XLogRecPtr	flushed = GetWalRcvFlushRecPtr(NULL, NULL);
+
+		if (targetPagePtr + reqLen > flushed)
+			return -1;
+		if (targetPagePtr + XLOG_BLCKSZ > flushed)
+			readLen = flushed - targetPagePtr;
+	}
+
+	XLByteToSeg(targetPagePtr, segno, wal_segment_size);
+	if (prefetcher->file >= 0 && prefetcher->segno != segno)
+		XLogPrefetcherCloseFile(prefetcher);
+	if (prefetcher->file < 0)
+	{
+		char		path[MAXPGPATH];
+
+		XLogFilePath(path, prefetcher->tli, segno, wal_segment_size);
+		prefetcher->file = BasicOpenFile(path, O_RDONLY | PG_BINARY);
+		if (prefetcher->file < 0)
+			return -1;
+		prefetcher->segno = segno;
+	}
+
+	offset = XLogSegmentOffset(targetPagePtr, wal_segment_size);
+	pgstat_report_wait_start(WAIT_EVENT_WAL_READ);
+	r = pg_pread(prefetcher->file, readBuf, XLOG_BLCKSZ, (off_t) offset);
+	pgstat_report_wait_end();
+	if (r < reqLen)
+		return -1;
+
+	return Min(r, readLen);
+}
+
+static void
+XLogPrefetcherCloseFile(XLogPrefetcher *prefetcher)
+{
+	if (prefetcher->file >= 0)
+	{
+		close(prefetcher->file);
+		prefetcher->file = -1;
+	}
+}
+
+/*
+ * Look for records that create relations or databases whose files don't
+ * exist yet, and filter them out until the record has been replayed.
+ */
+static void
+XLogPrefetcherScanRecord(XLogPrefetcher *prefetcher)
+{
+	XLogReaderState *reader = prefetcher->reader;
+	uint8		rmid = XLogRecGetRmid(reader);
+	uint8		info = XLogRecGetInfo(reader) & ~XLR_INFO_MASK;
+
+	if (rmid == RM_SMGR_ID && info == XLOG_SMGR_CREATE)
+	{
+		xl_smgr_create *xlrec = (xl_smgr_create *) XLogRecGetData(reader);
+
+		XLogPrefetcherAddFilter(prefetcher, xlrec->rnode, reader->ReadRecPtr);
+	}
+	else if (rmid == RM_DBASE_ID && info == XLOG_DBASE_CREATE)
+	{
+		xl_dbase_create_rec *xlrec =
+		(xl_dbase_create_rec *) XLogRecGetData(reader);
+		RelFileNode rnode;
+
+		rnode.spcNode = InvalidOid;
+		rnode.dbNode = xlrec->db_id;
+		rnode.relNode = InvalidOid;
+		XLogPrefetcherAddFilter(prefetcher, rnode, reader->ReadRecPtr);
+	}
+}
+
+/*
+ * Initiate prefetches for the blocks referenced by the current record,
+ * starting at next_block_id.  Returns false if we had to stop because too
+ * many prefetches are already in flight; next_block_id then says where to
+ * continue.
+ */
+static bool
+XLogPrefetcherScanBlocks(XLogPrefetcher *prefetcher)
+{
+	XLogReaderState *reader = prefetcher->reader;
+
+	for (int block_id = prefetcher->next_block_id;
+		 block_id <= reader->max_block_id;
+		 ++block_id)
+	{
+		DecodedBkpBlock *block = &reader->blocks[block_id];
+		SMgrRelation reln;
+		PrefetchBufferResult result;
+
+		if (!block->in_use)
+			continue;
+
+		/* Blocks that redo doesn't read don't need to be prefetched. */
+		if (block->apply_image)
+		{
+			prefetcher->skip_fpw++;
+			continue;
+		}
+		if (block->flags & BKPBLOCK_WILL_INIT)
+		{
+			prefetcher->skip_init++;
+			continue;
+		}
+
+		/*
+		 * Skip the block we just prefetched, and the one after it: the
+		 * kernel's read-ahead is better at dealing with sequential access.
+		 */
+		if (RelFileNodeEquals(block->rnode, prefetcher->last_rnode) &&
+			block->forknum == prefetcher->last_forknum &&
+			(block->blkno == prefetcher->last_blkno ||
+			 block->blkno == prefetcher->last_blkno + 1))
+		{
+			prefetcher->last_blkno = block->blkno;
+			prefetcher->skip_seq++;
+			continue;
+		}
+
+		if (XLogPrefetcherIsFiltered(prefetcher, block->rnode))
+		{
+			prefetcher->skip_new++;
+			continue;
+		}
+
+		if (XLogPrefetcherSaturated(prefetcher))
+		{
+			prefetcher->next_block_id = block_id;
+			return false;
+		}
+
+		reln = smgropen(block->rnode, InvalidBackendId,
+						RELPERSISTENCE_PERMANENT, UNKNOWN_REGION);
+		result = PrefetchSharedBuffer(reln, block->forknum, block->blkno);
+		if (BufferIsValid(result.recent_buffer))
+			prefetcher->skip_hit++;
+		else if (result.initiated_io)
+		{
+			prefetcher->prefetch++;
+			prefetcher->prefetch_queue[prefetcher->prefetch_head++] =
+				reader->ReadRecPtr;
+			prefetcher->prefetch_head %= prefetcher->prefetch_queue_size;
+		}
+		else
+		{
+			/*
+			 * The relation file doesn't exist.  It is presumably created or
+			 * dropped by a later record, so don't bother with it again
+			 * until this record has been replayed.
+			 */
+			XLogPrefetcherAddFilter(prefetcher, block->rnode,
+									reader->ReadRecPtr);
+			prefetcher->skip_new++;
+		}
+
+		prefetcher->last_rnode = block->rnode;
+		prefetcher->last_forknum = block->forknum;
+		prefetcher->last_blkno = block->blkno;
+	}
+
+	return true;
+}
+
+/*
+ * Don't prefetch any blocks of the given relation until the record at lsn
+ * has been replayed.  If relNode is InvalidOid, the whole database is
+ * filtered.
+ */
+static void
+XLogPrefetcherAddFilter(XLogPrefetcher *prefetcher, RelFileNode rnode,
+						XLogRecPtr lsn)
+{
+	XLogPrefetcherFilter *filter;
+	bool		found;
+
+	filter = hash_search(prefetcher->filter_table, &rnode, HASH_ENTER, &found);
+	if (!found || filter->filter_until_replayed < lsn)
+		filter->filter_until_replayed = lsn;
+}
+
+static bool
+XLogPrefetcherIsFiltered(XLogPrefetcher *prefetcher, RelFileNode rnode)
+{
+	RelFileNode dbnode;
+
+	if (hash_get_num_entries(prefetcher->filter_table) == 0)
+		return false;
+
+	if (hash_search(prefetcher->filter_table, &rnode, HASH_FIND, NULL))
+		return true;
+
+	dbnode.spcNode = InvalidOid;
+	dbnode.dbNode = rnode.dbNode;
+	dbnode.relNode = InvalidOid;
+	return hash_search(prefetcher->filter_table, &dbnode, HASH_FIND, NULL) != NULL;
+}
+
+/*
+ * Remove filters for records that have now been replayed.
+ */
+static void
+XLogPrefetcherCompleteFilters(XLogPrefetcher *prefetcher,
+							  XLogRecPtr replaying_lsn)
+{
+	HASH_SEQ_STATUS status;
+	XLogPrefetcherFilter *filter;
+
+	if (hash_get_num_entries(prefetcher->filter_table) == 0)
+		return;
+
+	hash_seq_init(&status, prefetcher->filter_table);
+	while ((filter = hash_seq_search(&status)) != NULL)
+	{
+		if (filter->filter_until_replayed < replaying_lsn)
+			hash_search(prefetcher->filter_table, &filter->rnode,
+						HASH_REMOVE, NULL);
+	}
+}
+
+/*
+ * Retire prefetches whose records have been replayed.
+ */
+static void
+XLogPrefetcherCompletedIO(XLogPrefetcher *prefetcher,
+						  XLogRecPtr replaying_lsn)
+{
+	while (prefetcher->prefetch_head != prefetcher->prefetch_tail &&
+		   prefetcher->prefetch_queue[prefetcher->prefetch_tail] < replaying_lsn)
+	{
+		prefetcher->prefetch_tail++;
+		prefetcher->prefetch_tail %= prefetcher->prefetch_queue_size;
+	}
+}
+
+/*
+ * Check if the maximum allowed number of I/Os is already in flight.
+ */
+static inline bool
+XLogPrefetcherSaturated(XLogPrefetcher *prefetcher)
+{
+	int			inflight;
+
+	inflight = prefetcher->prefetch_head - prefetcher->prefetch_tail;
+	if (inflight < 0)
+		inflight += prefetcher->prefetch_queue_size;
+
+	return inflight >= maintenance_io_concurrency;
+}
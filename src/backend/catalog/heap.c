@@ -60,6 +60,7 @@
 #include "catalog/pg_subscription_rel.h"
 #include "catalog/pg_tablespace.h"
 #include "catalog/pg_type.h"
+#include "catalog/pg_zstd_dictionary.h"
 #include "catalog/storage.h"
 #include "catalog/storage_xlog.h"
 #include "commands/tablecmds.h"
@@ -1762,7 +1763,10 @@ RemoveAttributeById(Oid relid, AttrNumber attnum)
 	table_close(attr_rel, RowExclusiveLock);
 
 	if (attnum > 0)
+	{
 		RemoveStatistics(relid, attnum);
+		ZstdDictionaryDetach(relid, attnum);
+	}
 
 	relation_close(rel, NoLock);
 }
@@ -2038,6 +2042,11 @@ heap_drop_with_catalog(Oid relid)
 	 */
 	RemoveStatistics(relid, 0);
 
+	/*
+	 * detach compression dictionaries
+	 */
+	ZstdDictionaryDetach(relid, 0);
+
 	/*
 	 * delete attribute tuples
 	 */
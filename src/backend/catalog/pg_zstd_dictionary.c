@@ -0,0 +1,247 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_zstd_dictionary.c
+ *	  routines to support manipulation of the pg_zstd_dictionary relation
+ *
+ * A dictionary is trained for one column (see pg_zstd_train_dictionary),
+ * but values compressed with it can end up anywhere: INSERT ... SELECT,
+ * for example, copies compressed datums verbatim.  Dictionaries are
+ * therefore never deleted; dropping the table or column they were trained
+ * for only detaches them, so they stop being used for new values.
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/catalog/pg_zstd_dictionary.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/genam.h"
+#include "access/htup_details.h"
+#include "access/table.h"
+#include "access/toast_compression.h"
+#include "catalog/catalog.h"
+#include "catalog/indexing.h"
+#include "catalog/pg_zstd_dictionary.h"
+#include "utils/fmgroids.h"
+#include "utils/inval.h"
+#include "utils/rel.h"
+
+static SysScanDesc ZstdDictionaryBeginColumnScan(Relation rel, Oid relid,
+												 AttrNumber attnum,
+												 ScanKey key);
+
+/*
+ * ZstdDictionaryCreate
+ *		Store a new dictionary for the given column and return its OID.
+ *
+ * The OID doubles as the dictionary ID that Zstandard records in each frame
+ * compressed with the dictionary, so it is stamped into 'data' (which is
+ * modified in place) before the row is inserted.
+ *
+ * The new dictionary gets the next version number for the column.  The
+ * caller must hold a self-conflicting lock on the table, so that no other
+ * dictionary for the column is being created concurrently.
+ */
+Oid
+ZstdDictionaryCreate(Oid relid, AttrNumber attnum, bytea *data)
+{
+	Relation	rel;
+	Oid			dictid;
+	int32		version = 0;
+	Datum		values[Natts_pg_zstd_dictionary];
+	bool		nulls[Natts_pg_zstd_dictionary];
+	SysScanDesc scan;
+	ScanKeyData key[2];
+	HeapTuple	tuple;
+
+	rel = table_open(ZstdDictionaryRelationId, RowExclusiveLock);
+
+	scan = ZstdDictionaryBeginColumnScan(rel, relid, attnum, key);
+	while (HeapTupleIsValid(tuple = systable_getnext(scan)))
+	{
+		Form_pg_zstd_dictionary form = (Form_pg_zstd_dictionary) GETSTRUCT(tuple);
+
+		version = Max(version, form->zdictversion);
+	}
+	systable_endscan(scan);
+
+	dictid = GetNewOidWithIndex(rel, ZstdDictionaryOidIndexId,
+								Anum_pg_zstd_dictionary_oid);
+	zstd_set_dictionary_id(data, dictid);
+
+	memset(nulls, false, sizeof(nulls));
+	values[Anum_pg_zstd_dictionary_oid - 1] = ObjectIdGetDatum(dictid);
+	values[Anum_pg_zstd_dictionary_zdictrelid - 1] = ObjectIdGetDatum(relid);
+	values[Anum_pg_zstd_dictionary_zdictattnum - 1] = Int16GetDatum(attnum);
+	values[Anum_pg_zstd_dictionary_zdictversion - 1] = Int32GetDatum(version + 1);
+	values[Anum_pg_zstd_dictionary_zdictdata - 1] = PointerGetDatum(data);
+
+	tuple = heap_form_tuple(RelationGetDescr(rel), values, nulls);
+	CatalogTupleInsert(rel, tuple);
+	heap_freetuple(tuple);
+
+	table_close(rel, RowExclusiveLock);
+
+	/* Make other backends pick up the new dictionary for the column */
+	CacheInvalidateRelcacheByRelid(relid);
+
+	return dictid;
+}
+
+/*
+ * ZstdDictionaryGetData
+ *		Return a palloc'd copy of a dictionary's contents, or NULL if there
+ *		is no dictionary with that OID.
+ */
+bytea *
+ZstdDictionaryGetData(Oid dictid)
+{
+	Relation	rel;
+	SysScanDesc scan;
+	ScanKeyData key;
+	HeapTuple	tuple;
+	bytea	   *result = NULL;
+
+	rel = table_open(ZstdDictionaryRelationId, AccessShareLock);
+
+	ScanKeyInit(&key,
+				Anum_pg_zstd_dictionary_oid,
+				BTEqualStrategyNumber, F_OIDEQ,
+				ObjectIdGetDatum(dictid));
+
+	scan = systable_beginscan(rel, ZstdDictionaryOidIndexId, true,
+							  NULL, 1, &key);
+
+	tuple = systable_getnext(scan);
+	if (HeapTupleIsValid(tuple))
+	{
+		Datum		datum;
+		bool		isnull;
+
+		datum = heap_getattr(tuple, Anum_pg_zstd_dictionary_zdictdata,
+							 RelationGetDescr(rel), &isnull);
+		Assert(!isnull);
+		result = DatumGetByteaPCopy(datum);
+	}
+
+	systable_endscan(scan);
+	table_close(rel, AccessShareLock);
+
+	return result;
+}
+
+/*
+ * ZstdDictionaryGetLatest
+ *		Return the OID of the most recently trained dictionary for a column,
+ *		or InvalidOid if it has none.
+ *
+ * OIDs wrap around, so the newest dictionary is the one with the highest
+ * version number, not the highest OID.
+ */
+Oid
+ZstdDictionaryGetLatest(Oid relid, AttrNumber attnum)
+{
+	Relation	rel;
+	SysScanDesc scan;
+	ScanKeyData key[2];
+	HeapTuple	tuple;
+	Oid			result = InvalidOid;
+	int32		version = 0;
+
+	rel = table_open(ZstdDictionaryRelationId, AccessShareLock);
+
+	scan = ZstdDictionaryBeginColumnScan(rel, relid, attnum, key);
+	while (HeapTupleIsValid(tuple = systable_getnext(scan)))
+	{
+		Form_pg_zstd_dictionary form = (Form_pg_zstd_dictionary) GETSTRUCT(tuple);
+
+		if (form->zdictversion > version)
+		{
+			result = form->oid;
+			version = form->zdictversion;
+		}
+	}
+
+	systable_endscan(scan);
+	table_close(rel, AccessShareLock);
+
+	return result;
+}
+
+/*
+ * ZstdDictionaryDetach
+ *		Stop using the dictionaries of a dropped table or column.
+ *
+ * If attnum is zero, detach the dictionaries of all columns of the table.
+ */
+void
+ZstdDictionaryDetach(Oid relid, AttrNumber attnum)
+{
+	Relation	rel;
+	SysScanDesc scan;
+	ScanKeyData key[2];
+	int			nkeys;
+	HeapTuple	tuple;
+
+	rel = table_open(ZstdDictionaryRelationId, RowExclusiveLock);
+
+	ScanKeyInit(&key[0],
+				Anum_pg_zstd_dictionary_zdictrelid,
+				BTEqualStrategyNumber, F_OIDEQ,
+				ObjectIdGetDatum(relid));
+
+	if (attnum == 0)
+		nkeys = 1;
+	else
+	{
+		ScanKeyInit(&key[1],
+					Anum_pg_zstd_dictionary_zdictattnum,
+					BTEqualStrategyNumber, F_INT2EQ,
+					Int16GetDatum(attnum));
+		nkeys = 2;
+	}
+
+	scan = systable_beginscan(rel, ZstdDictionaryRelidIndexId, true,
+							  NULL, nkeys, key);
+
+	while (HeapTupleIsValid(tuple = systable_getnext(scan)))
+	{
+		HeapTuple	newtuple = heap_copytuple(tuple);
+		Form_pg_zstd_dictionary form = (Form_pg_zstd_dictionary) GETSTRUCT(newtuple);
+
+		form->zdictrelid = InvalidOid;
+		form->zdictattnum = 0;
+		CatalogTupleUpdate(rel, &newtuple->t_self, newtuple);
+		heap_freetuple(newtuple);
+	}
+
+	systable_endscan(scan);
+
+	table_close(rel, RowExclusiveLock);
+}
+
+/*
+ * Start a scan of the dictionaries trained for a column.  key must point to
+ * an array of two scan keys, which must live as long as the scan.
+ */
+static SysScanDesc
+ZstdDictionaryBeginColumnScan(Relation rel, Oid relid, AttrNumber attnum,
+							  ScanKey key)
+{
+	ScanKeyInit(&key[0],
+				Anum_pg_zstd_dictionary_zdictrelid,
+				BTEqualStrategyNumber, F_OIDEQ,
+				ObjectIdGetDatum(relid));
+	ScanKeyInit(&key[1],
+				Anum_pg_zstd_dictionary_zdictattnum,
+				BTEqualStrategyNumber, F_INT2EQ,
+				Int16GetDatum(attnum));
+
+	return systable_beginscan(rel, ZstdDictionaryRelidIndexId, true,
+							  NULL, 2, key);
+}
@@ -397,6 +397,12 @@ CREATE OR REPLACE FUNCTION
   RETURNS boolean STRICT VOLATILE LANGUAGE INTERNAL AS 'pg_terminate_backend'
   PARALLEL SAFE;
 
+CREATE OR REPLACE FUNCTION
+  pg_zstd_train_dictionary(rel regclass, attname name,
+                           dict_size integer DEFAULT 65536)
+  RETURNS oid STRICT VOLATILE LANGUAGE INTERNAL AS 'pg_zstd_train_dictionary'
+  PARALLEL UNSAFE;
+
 -- legacy definition for compatibility with 9.3
 CREATE OR REPLACE FUNCTION
   json_populate_record(base anyelement, from_json json, use_json_as_text boolean DEFAULT false)
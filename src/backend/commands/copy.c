@@ -20,6 +20,7 @@
 
 #include "access/sysattr.h"
 #include "access/table.h"
+#include "access/toast_compression.h"
 #include "access/xact.h"
 #include "catalog/pg_authid.h"
 #include "commands/copy.h"
@@ -371,6 +372,12 @@ ProcessCopyOptions(ParseState *pstate,
 				opts_out->csv_mode = true;
 			else if (strcmp(fmt, "binary") == 0)
 				opts_out->binary = true;
+			else if (strcmp(fmt, "columnar") == 0)
+			{
+				/* a variant of binary format, see copyto.c */
+				opts_out->binary = true;
+				opts_out->columnar = true;
+			}
 			else
 				ereport(ERROR,
 						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
@@ -504,6 +511,38 @@ ProcessCopyOptions(ParseState *pstate,
 								defel->defname),
 						 parser_errposition(pstate, defel->location)));
 		}
+		else if (strcmp(defel->defname, "row_group_size") == 0)
+		{
+			if (opts_out->row_group_size != 0)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("conflicting or redundant options"),
+						 parser_errposition(pstate, defel->location)));
+			opts_out->row_group_size = defGetInt32(defel);
+			if (opts_out->row_group_size <= 0)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("COPY row group size must be greater than zero"),
+						 parser_errposition(pstate, defel->location)));
+		}
+		else if (strcmp(defel->defname, "compression") == 0)
+		{
+			char	   *method = defGetString(defel);
+
+			if (opts_out->compression != InvalidCompressionMethod)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("conflicting or redundant options"),
+						 parser_errposition(pstate, defel->location)));
+			opts_out->compression = CompressionNameToMethod(method);
+			if (opts_out->compression != TOAST_PGLZ_COMPRESSION &&
+				opts_out->compression != TOAST_LZ4_COMPRESSION)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("COPY compression method \"%s\" not supported",
+								method),
+						 parser_errposition(pstate, defel->location)));
+		}
 		else if (strcmp(defel->defname, "encoding") == 0)
 		{
 			if (opts_out->file_encoding >= 0)
@@ -541,7 +580,27 @@ ProcessCopyOptions(ParseState *pstate,
 				(errcode(ERRCODE_SYNTAX_ERROR),
 				 errmsg("cannot specify NULL in BINARY mode")));
 
+	/* Check columnar options */
+	if (opts_out->columnar && is_from)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("COPY FORMAT columnar is only available using COPY TO")));
+
+	if (!opts_out->columnar && opts_out->row_group_size != 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("COPY ROW_GROUP_SIZE available only in columnar mode")));
+
+	if (!opts_out->columnar &&
+		opts_out->compression != InvalidCompressionMethod)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("COPY COMPRESSION available only in columnar mode")));
+
 	/* Set defaults for omitted options */
+	if (opts_out->row_group_size == 0)
+		opts_out->row_group_size = COPY_COLUMNAR_DEFAULT_ROW_GROUP_SIZE;
+
 	if (!opts_out->delim)
 		opts_out->delim = opts_out->csv_mode ? "," : "\t";
 
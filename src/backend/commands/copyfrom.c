@@ -120,6 +120,18 @@ CopyFromErrorCallback(void *arg)
 	snprintf(curlineno_str, sizeof(curlineno_str), UINT64_FORMAT,
 			 cstate->cur_lineno);
 
+	if (cstate->cur_lineno_last > cstate->cur_lineno)
+	{
+		/* error is relevant to a batch of lines, as a whole */
+		char		lastlineno_str[32];
+
+		snprintf(lastlineno_str, sizeof(lastlineno_str), UINT64_FORMAT,
+				 cstate->cur_lineno_last);
+		errcontext("COPY %s, lines %s to %s",
+				   cstate->cur_relname, curlineno_str, lastlineno_str);
+		return;
+	}
+
 	if (cstate->opts.binary)
 	{
 		/* can't usefully display the data */
@@ -330,6 +342,19 @@ CopyMultiInsertBufferFlush(CopyMultiInsertInfo *miinfo,
 					   buffer->bistate);
 	MemoryContextSwitchTo(oldcontext);
 
+	/*
+	 * Indexes that can take the whole batch at once are updated first; the
+	 * loop below takes care of the rest.  An error here can't be pinned on
+	 * one row, so report the range of lines the batch came from.
+	 */
+	if (resultRelInfo->ri_NumIndices > 0)
+	{
+		cstate->cur_lineno = buffer->linenos[0];
+		cstate->cur_lineno_last = buffer->linenos[nused - 1];
+		ExecInsertIndexTuplesMulti(resultRelInfo, slots, nused, estate);
+		cstate->cur_lineno_last = 0;
+	}
+
 	for (i = 0; i < nused; i++)
 	{
 		/*
@@ -344,7 +369,7 @@ CopyMultiInsertBufferFlush(CopyMultiInsertInfo *miinfo,
 			recheckIndexes =
 				ExecInsertIndexTuples(resultRelInfo,
 									  buffer->slots[i], estate, false, false,
-									  NULL, NIL);
+									  NULL, NIL, true);
 			ExecARInsertTriggers(estate, resultRelInfo,
 								 slots[i], recheckIndexes,
 								 cstate->transition_capture);
@@ -1101,7 +1126,8 @@ CopyFrom(CopyFromState cstate)
 																   false,
 																   false,
 																   NULL,
-																   NIL);
+																   NIL,
+																   false);
 					}
 
 					/* AFTER ROW INSERT Triggers */
@@ -164,6 +164,10 @@ static inline bool CopyGetInt32(CopyFromState cstate, int32 *val);
 static inline bool CopyGetInt16(CopyFromState cstate, int16 *val);
 static void CopyLoadInputBuf(CopyFromState cstate);
 static int	CopyReadBinaryData(CopyFromState cstate, char *dest, int nbytes);
+static inline const char *CopySkipPlainBytes(const char *ptr,
+											 const char *end,
+											 char c1, char c2, char c3,
+											 char c4);
 
 void
 ReceiveCopyBegin(CopyFromState cstate)
@@ -1153,6 +1157,39 @@ CopyReadLineText(CopyFromState cstate)
 			need_data = false;
 		}
 
+		/*
+		 * Skip quickly over a run of bytes that can't affect the parse.  In
+		 * text mode those are all bytes other than newlines and backslashes.
+		 * In CSV mode, backslash matters only at the start of a line, so we
+		 * don't try to skip there, and the quote and escape characters
+		 * matter everywhere else.
+		 */
+		if (!cstate->opts.csv_mode || !first_char_in_line)
+		{
+			int			plain_end;
+
+			if (cstate->opts.csv_mode)
+				plain_end = CopySkipPlainBytes(copy_input_buf + input_buf_ptr,
+											   copy_input_buf + copy_buf_len,
+											   '\n', '\r', quotec,
+											   escapec ? escapec : quotec) -
+					copy_input_buf;
+			else
+				plain_end = CopySkipPlainBytes(copy_input_buf + input_buf_ptr,
+											   copy_input_buf + copy_buf_len,
+											   '\n', '\r', '\\', '\\') -
+					copy_input_buf;
+
+			if (plain_end > input_buf_ptr)
+			{
+				input_buf_ptr = plain_end;
+				last_was_esc = false;
+				first_char_in_line = false;
+				if (input_buf_ptr >= copy_buf_len)
+					continue;
+			}
+		}
+
 		/* OK to fetch a character */
 		prev_raw_ptr = input_buf_ptr;
 		c = copy_input_buf[input_buf_ptr++];
@@ -1394,6 +1431,49 @@ not_end_of_copy:
 	return result;
 }
 
+/*
+ * CopySkipPlainBytes - find the end of a run of uninteresting bytes
+ *
+ * Returns a pointer to the first byte in [ptr, end) that might equal one of
+ * c1 .. c4, or end if there is none.  The result is conservative: the byte it
+ * points to is not necessarily special, so callers must still examine it
+ * one byte at a time, but every byte before it is known not to be.  Callers
+ * that have fewer than four interesting bytes can pass duplicates.
+ *
+ * The input is examined eight bytes at a time, using the usual trick of
+ * XORing each word with a broadcast copy of the target byte and testing the
+ * result for a zero byte.  Since all supported server encodings keep ASCII
+ * bytes out of multibyte sequences, this is safe regardless of encoding.
+ */
+static inline const char *
+CopySkipPlainBytes(const char *ptr, const char *end,
+				   char c1, char c2, char c3, char c4)
+{
+#define BROADCAST_BYTE(c) (UINT64CONST(0x0101010101010101) * (unsigned char) (c))
+#define HAS_ZERO_BYTE(w) \
+	(((w) - UINT64CONST(0x0101010101010101)) & ~(w) & \
+	 UINT64CONST(0x8080808080808080))
+	const uint64 b1 = BROADCAST_BYTE(c1);
+	const uint64 b2 = BROADCAST_BYTE(c2);
+	const uint64 b3 = BROADCAST_BYTE(c3);
+	const uint64 b4 = BROADCAST_BYTE(c4);
+
+	while (end - ptr >= sizeof(uint64))
+	{
+		uint64		w;
+
+		memcpy(&w, ptr, sizeof(uint64));
+		if (HAS_ZERO_BYTE(w ^ b1) | HAS_ZERO_BYTE(w ^ b2) |
+			HAS_ZERO_BYTE(w ^ b3) | HAS_ZERO_BYTE(w ^ b4))
+			break;
+		ptr += sizeof(uint64);
+	}
+
+	return ptr;
+#undef BROADCAST_BYTE
+#undef HAS_ZERO_BYTE
+}
+
 /*
  *	Return decimal value for a hexadecimal digit
  */
@@ -1500,6 +1580,19 @@ CopyReadAttributesText(CopyFromState cstate)
 		for (;;)
 		{
 			char		c;
+			const char *plain_end;
+
+			/* Copy any run of bytes that need no de-escaping in one go */
+			plain_end = CopySkipPlainBytes(cur_ptr, line_end_ptr,
+										   delimc, '\\', delimc, '\\');
+			if (plain_end > cur_ptr)
+			{
+				int			plain_len = plain_end - cur_ptr;
+
+				memcpy(output_ptr, cur_ptr, plain_len);
+				output_ptr += plain_len;
+				cur_ptr += plain_len;
+			}
 
 			end_ptr = cur_ptr;
 			if (cur_ptr >= line_end_ptr)
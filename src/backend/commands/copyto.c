@@ -18,13 +18,19 @@
 #include <unistd.h>
 #include <sys/stat.h>
 
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+
 #include "access/heapam.h"
 #include "access/htup_details.h"
 #include "access/tableam.h"
+#include "access/toast_compression.h"
 #include "access/xact.h"
 #include "access/xlog.h"
 #include "commands/copy.h"
 #include "commands/progress.h"
+#include "common/pg_lzcompress.h"
 #include "executor/execdesc.h"
 #include "executor/executor.h"
 #include "executor/tuptable.h"
@@ -39,6 +45,7 @@
 #include "tcop/tcopprot.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
+#include "utils/fmgroids.h"
 #include "utils/partcache.h"
 #include "utils/rel.h"
 #include "utils/snapmgr.h"
@@ -53,6 +60,38 @@ typedef enum CopyDest
 	COPY_FRONTEND,				/* to frontend */
 } CopyDest;
 
+/*
+ * Buffer for the values of one column in the current row group of a
+ * columnar COPY TO.  Non-null values are appended to data in their binary
+ * output form; ends[i] is the end offset in data of row i's value, and
+ * validity has a bit set for each row whose value is not null.
+ */
+typedef struct CopyToColumn
+{
+	FmgrInfo   *out_function;	/* binary output function */
+	Oid			send_func;		/* its OID, if sent without calling it */
+	StringInfoData data;		/* non-null values, concatenated */
+	uint32	   *ends;			/* end offset of each row's value */
+	bits8	   *validity;		/* bitmap of non-null values */
+	bool		hasnulls;		/* any nulls in this row group? */
+	int			width;			/* length shared by all non-null values */
+} CopyToColumn;
+
+/* Special values of CopyToColumn.width */
+#define COLUMN_WIDTH_UNKNOWN	(-2)	/* no non-null value seen yet */
+#define COLUMN_WIDTH_VARIABLE	(-1)	/* values differ in length */
+
+/*
+ * Row groups are flushed early once their values take this much space, to
+ * bound memory use with wide rows.
+ */
+#define COLUMNAR_MAX_GROUP_BYTES	(64 * 1024 * 1024)
+
+/* Compression method IDs in the columnar format */
+#define COLUMNAR_COMPRESSION_NONE	0
+#define COLUMNAR_COMPRESSION_PGLZ	1
+#define COLUMNAR_COMPRESSION_LZ4	2
+
 /*
  * This struct contains all the state variables used throughout a COPY TO
  * operation.
@@ -98,6 +137,13 @@ typedef struct CopyToStateData
 	MemoryContext rowcontext;	/* per-row evaluation context */
 	uint64		bytes_processed;	/* number of bytes processed so far */
 
+	/* state of the current row group, columnar format only */
+	CopyToColumn *columns;		/* one per attnumlist entry */
+	int			group_rows;		/* number of rows buffered */
+	int			group_capacity; /* number of rows there is room for */
+	Size		group_bytes;	/* size of the values buffered */
+	StringInfoData chunkbuf;	/* workspace for building column chunks */
+
 } CopyToStateData;
 
 /* DestReceiver for COPY (query) TO */
@@ -111,11 +157,17 @@ typedef struct
 /* NOTE: there's a copy of this in copyfromparse.c */
 static const char BinarySignature[11] = "PGCOPY\n\377\r\n\0";
 
+static const char ColumnarSignature[11] = "PGCOLS\n\377\r\n\0";
+
 
 /* non-export function prototypes */
 static void EndCopy(CopyToState cstate);
 static void ClosePipeToProgram(CopyToState cstate);
 static void CopyOneRowTo(CopyToState cstate, TupleTableSlot *slot);
+static void CopyOneRowToColumnar(CopyToState cstate, TupleTableSlot *slot);
+static void CopyColumnarStart(CopyToState cstate, TupleDesc tupDesc);
+static void CopyColumnarFlushGroup(CopyToState cstate);
+static void CopyColumnarSendChunk(CopyToState cstate, StringInfo chunk);
 static void CopyAttributeOutText(CopyToState cstate, char *string);
 static void CopyAttributeOutCSV(CopyToState cstate, char *string,
 								bool use_quote, bool single_attr);
@@ -820,7 +872,12 @@ DoCopyTo(CopyToState cstate)
 											   "COPY TO",
 											   ALLOCSET_DEFAULT_SIZES);
 
-	if (cstate->opts.binary)
+	if (cstate->opts.columnar)
+	{
+		/* Generate header for a columnar copy */
+		CopyColumnarStart(cstate, tupDesc);
+	}
+	else if (cstate->opts.binary)
 	{
 		/* Generate header for a binary copy */
 		int32		tmp;
@@ -906,7 +963,14 @@ DoCopyTo(CopyToState cstate)
 		processed = ((DR_copy *) cstate->queryDesc->dest)->processed;
 	}
 
-	if (cstate->opts.binary)
+	if (cstate->opts.columnar)
+	{
+		/* Send the last row group and the trailer */
+		CopyColumnarFlushGroup(cstate);
+		CopySendInt32(cstate, -1);
+		CopySendEndOfRow(cstate);
+	}
+	else if (cstate->opts.binary)
 	{
 		/* Generate trailer for a binary copy */
 		CopySendInt16(cstate, -1);
@@ -934,6 +998,12 @@ CopyOneRowTo(CopyToState cstate, TupleTableSlot *slot)
 	ListCell   *cur;
 	char	   *string;
 
+	if (cstate->opts.columnar)
+	{
+		CopyOneRowToColumnar(cstate, slot);
+		return;
+	}
+
 	MemoryContextReset(cstate->rowcontext);
 	oldcontext = MemoryContextSwitchTo(cstate->rowcontext);
 
@@ -997,6 +1067,375 @@ CopyOneRowTo(CopyToState cstate, TupleTableSlot *slot)
 	MemoryContextSwitchTo(oldcontext);
 }
 
+/*
+ * Columnar format support for DoCopyTo().
+ *
+ * The output starts with an 11-byte signature, a 32-bit flags field and a
+ * 32-bit header extension length (both zero), followed by a 16-bit column
+ * count and the 32-bit type OID of each column.  Then come row groups, each
+ * consisting of a 32-bit row count and one chunk per column, and finally a
+ * 32-bit -1 in place of a row count.
+ *
+ * A column chunk starts with a compression method byte and the 32-bit sizes
+ * of the chunk before and after compression, followed by the (possibly
+ * compressed) chunk contents: a 32-bit value width, a byte saying whether
+ * there is a null bitmap, the bitmap if so, and the values.  The bitmap has
+ * a bit set for each non-null value, least significant bit first.  Values
+ * are in the binary output format of their type, as in COPY BINARY.  If all
+ * non-null values of the chunk have the same length, the width is that
+ * length and the values are stored back to back, with zeroes in place of
+ * nulls.  Otherwise the width is -1, and the values are preceded by row
+ * count + 1 32-bit offsets delimiting each row's value; nulls are empty.
+ * All integers are in network byte order.
+ */
+
+/*
+ * Set up the column buffers and send the header.
+ */
+static void
+CopyColumnarStart(CopyToState cstate, TupleDesc tupDesc)
+{
+	int			ncolumns = list_length(cstate->attnumlist);
+	MemoryContext oldcontext;
+	ListCell   *cur;
+	int			i;
+
+	oldcontext = MemoryContextSwitchTo(cstate->copycontext);
+
+	cstate->columns = (CopyToColumn *) palloc0(ncolumns * sizeof(CopyToColumn));
+	cstate->group_rows = 0;
+	cstate->group_capacity = Min(cstate->opts.row_group_size, 1024);
+	cstate->group_bytes = 0;
+	initStringInfo(&cstate->chunkbuf);
+
+	CopySendData(cstate, ColumnarSignature, 11);
+	/* Flags field */
+	CopySendInt32(cstate, 0);
+	/* No header extension */
+	CopySendInt32(cstate, 0);
+	CopySendInt16(cstate, ncolumns);
+
+	i = 0;
+	foreach(cur, cstate->attnumlist)
+	{
+		int			attnum = lfirst_int(cur);
+		CopyToColumn *column = &cstate->columns[i++];
+		Oid			send_func = cstate->out_functions[attnum - 1].fn_oid;
+
+		CopySendInt32(cstate, TupleDescAttr(tupDesc, attnum - 1)->atttypid);
+
+		column->out_function = &cstate->out_functions[attnum - 1];
+
+		/*
+		 * The send functions of these types just send the Datum in network
+		 * byte order, so we can skip calling them.
+		 */
+		switch (send_func)
+		{
+			case F_BOOLSEND:
+			case F_CHARSEND:
+			case F_INT2SEND:
+			case F_INT4SEND:
+			case F_INT8SEND:
+			case F_OIDSEND:
+			case F_FLOAT4SEND:
+			case F_FLOAT8SEND:
+			case F_DATE_SEND:
+			case F_TIME_SEND:
+			case F_TIMESTAMP_SEND:
+			case F_TIMESTAMPTZ_SEND:
+				column->send_func = send_func;
+				break;
+			default:
+				column->send_func = InvalidOid;
+				break;
+		}
+
+		initStringInfo(&column->data);
+		column->ends = (uint32 *) palloc(cstate->group_capacity * sizeof(uint32));
+		column->validity = (bits8 *) palloc0(BITMAPLEN(cstate->group_capacity));
+		column->hasnulls = false;
+		column->width = COLUMN_WIDTH_UNKNOWN;
+	}
+
+	CopySendEndOfRow(cstate);
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Add one row to the current row group, sending the group if it's full.
+ */
+static void
+CopyOneRowToColumnar(CopyToState cstate, TupleTableSlot *slot)
+{
+	int			row = cstate->group_rows;
+	MemoryContext oldcontext;
+	ListCell   *cur;
+	int			i;
+
+	MemoryContextReset(cstate->rowcontext);
+	oldcontext = MemoryContextSwitchTo(cstate->rowcontext);
+
+	/* Make room for the row, if needed */
+	if (row == cstate->group_capacity)
+	{
+		int			newcapacity = Min(cstate->group_capacity * 2,
+									  cstate->opts.row_group_size);
+
+		for (i = 0; i < list_length(cstate->attnumlist); i++)
+		{
+			CopyToColumn *column = &cstate->columns[i];
+
+			column->ends = (uint32 *)
+				repalloc(column->ends, newcapacity * sizeof(uint32));
+			column->validity = (bits8 *)
+				repalloc(column->validity, BITMAPLEN(newcapacity));
+			memset(column->validity + BITMAPLEN(cstate->group_capacity), 0,
+				   BITMAPLEN(newcapacity) - BITMAPLEN(cstate->group_capacity));
+		}
+		cstate->group_capacity = newcapacity;
+	}
+
+	/* Make sure the tuple is fully deconstructed */
+	slot_getallattrs(slot);
+
+	i = 0;
+	foreach(cur, cstate->attnumlist)
+	{
+		int			attnum = lfirst_int(cur);
+		Datum		value = slot->tts_values[attnum - 1];
+		bool		isnull = slot->tts_isnull[attnum - 1];
+		CopyToColumn *column = &cstate->columns[i++];
+		int			start = column->data.len;
+		int			len;
+
+		if (isnull)
+		{
+			column->hasnulls = true;
+			column->ends[row] = start;
+			continue;
+		}
+
+		column->validity[row / BITS_PER_BYTE] |= 1 << (row % BITS_PER_BYTE);
+
+		switch (column->send_func)
+		{
+			case F_BOOLSEND:
+				appendStringInfoCharMacro(&column->data,
+										  DatumGetBool(value) ? 1 : 0);
+				break;
+			case F_CHARSEND:
+				appendStringInfoCharMacro(&column->data, DatumGetChar(value));
+				break;
+			case F_INT2SEND:
+				{
+					uint16		buf = pg_hton16((uint16) DatumGetInt16(value));
+
+					appendBinaryStringInfo(&column->data, (char *) &buf, sizeof(buf));
+				}
+				break;
+			case F_INT4SEND:
+			case F_OIDSEND:
+			case F_DATE_SEND:
+				{
+					uint32		buf = pg_hton32((uint32) DatumGetInt32(value));
+
+					appendBinaryStringInfo(&column->data, (char *) &buf, sizeof(buf));
+				}
+				break;
+			case F_INT8SEND:
+			case F_TIME_SEND:
+			case F_TIMESTAMP_SEND:
+			case F_TIMESTAMPTZ_SEND:
+				{
+					uint64		buf = pg_hton64((uint64) DatumGetInt64(value));
+
+					appendBinaryStringInfo(&column->data, (char *) &buf, sizeof(buf));
+				}
+				break;
+			case F_FLOAT4SEND:
+				{
+					float4		f = DatumGetFloat4(value);
+					uint32		buf;
+
+					memcpy(&buf, &f, sizeof(buf));
+					buf = pg_hton32(buf);
+					appendBinaryStringInfo(&column->data, (char *) &buf, sizeof(buf));
+				}
+				break;
+			case F_FLOAT8SEND:
+				{
+					float8		f = DatumGetFloat8(value);
+					uint64		buf;
+
+					memcpy(&buf, &f, sizeof(buf));
+					buf = pg_hton64(buf);
+					appendBinaryStringInfo(&column->data, (char *) &buf, sizeof(buf));
+				}
+				break;
+			default:
+				{
+					bytea	   *outputbytes;
+
+					outputbytes = SendFunctionCall(column->out_function, value);
+					appendBinaryStringInfo(&column->data, VARDATA(outputbytes),
+										   VARSIZE(outputbytes) - VARHDRSZ);
+				}
+				break;
+		}
+
+		len = column->data.len - start;
+		if (column->width == COLUMN_WIDTH_UNKNOWN)
+			column->width = len;
+		else if (column->width != len)
+			column->width = COLUMN_WIDTH_VARIABLE;
+
+		column->ends[row] = column->data.len;
+		cstate->group_bytes += len;
+	}
+
+	cstate->group_rows++;
+	if (cstate->group_rows >= cstate->opts.row_group_size ||
+		cstate->group_bytes >= COLUMNAR_MAX_GROUP_BYTES)
+		CopyColumnarFlushGroup(cstate);
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Send the buffered row group, if any, and empty the column buffers.
+ */
+static void
+CopyColumnarFlushGroup(CopyToState cstate)
+{
+	int			nrows = cstate->group_rows;
+	StringInfo	chunk = &cstate->chunkbuf;
+	int			i;
+
+	if (nrows == 0)
+		return;
+
+	CopySendInt32(cstate, nrows);
+
+	for (i = 0; i < list_length(cstate->attnumlist); i++)
+	{
+		CopyToColumn *column = &cstate->columns[i];
+		int			row;
+		uint32		buf;
+
+		resetStringInfo(chunk);
+
+		/* a column of nulls only has width zero */
+		if (column->width == COLUMN_WIDTH_UNKNOWN)
+			column->width = 0;
+
+		buf = pg_hton32((uint32) column->width);
+		appendBinaryStringInfo(chunk, (char *) &buf, sizeof(buf));
+		appendStringInfoCharMacro(chunk, column->hasnulls ? 1 : 0);
+		if (column->hasnulls)
+			appendBinaryStringInfo(chunk, (char *) column->validity,
+								   BITMAPLEN(nrows));
+
+		if (column->width == COLUMN_WIDTH_VARIABLE)
+		{
+			buf = 0;
+			appendBinaryStringInfo(chunk, (char *) &buf, sizeof(buf));
+			for (row = 0; row < nrows; row++)
+			{
+				buf = pg_hton32(column->ends[row]);
+				appendBinaryStringInfo(chunk, (char *) &buf, sizeof(buf));
+			}
+			appendBinaryStringInfo(chunk, column->data.data, column->data.len);
+		}
+		else if (!column->hasnulls)
+			appendBinaryStringInfo(chunk, column->data.data, column->data.len);
+		else
+		{
+			/* leave zeroes in the slots of null values */
+			enlargeStringInfo(chunk, nrows * column->width);
+			memset(chunk->data + chunk->len, 0, nrows * column->width);
+			for (row = 0; row < nrows; row++)
+			{
+				if (column->validity[row / BITS_PER_BYTE] &
+					(1 << (row % BITS_PER_BYTE)))
+					memcpy(chunk->data + chunk->len + row * column->width,
+						   column->data.data + column->ends[row] - column->width,
+						   column->width);
+			}
+			chunk->len += nrows * column->width;
+			chunk->data[chunk->len] = '\0';
+		}
+
+		CopyColumnarSendChunk(cstate, chunk);
+
+		/* Reset the column for the next row group */
+		resetStringInfo(&column->data);
+		memset(column->validity, 0, BITMAPLEN(cstate->group_capacity));
+		column->hasnulls = false;
+		column->width = COLUMN_WIDTH_UNKNOWN;
+	}
+
+	cstate->group_rows = 0;
+	cstate->group_bytes = 0;
+}
+
+/*
+ * Compress a column chunk if requested, and send it.
+ */
+static void
+CopyColumnarSendChunk(CopyToState cstate, StringInfo chunk)
+{
+	char		method = COLUMNAR_COMPRESSION_NONE;
+	char	   *compressed = NULL;
+	int32		len = -1;
+
+	if (cstate->opts.compression == TOAST_PGLZ_COMPRESSION)
+	{
+		compressed = palloc(PGLZ_MAX_OUTPUT(chunk->len));
+		len = pglz_compress(chunk->data, chunk->len, compressed,
+							PGLZ_strategy_default);
+		method = COLUMNAR_COMPRESSION_PGLZ;
+	}
+	else if (cstate->opts.compression == TOAST_LZ4_COMPRESSION)
+	{
+#ifdef USE_LZ4
+		int			max_size = LZ4_compressBound(chunk->len);
+
+		compressed = palloc(max_size);
+		len = LZ4_compress_default(chunk->data, compressed, chunk->len,
+								   max_size);
+		if (len <= 0)
+			elog(ERROR, "lz4 compression failed");
+		method = COLUMNAR_COMPRESSION_LZ4;
+#else
+		/* ProcessCopyOptions() should have refused the option */
+		elog(ERROR, "lz4 compression not supported");
+#endif
+	}
+
+	/* Send the chunk uncompressed if compression didn't help */
+	if (len < 0 || len >= chunk->len)
+	{
+		CopySendChar(cstate, COLUMNAR_COMPRESSION_NONE);
+		CopySendInt32(cstate, chunk->len);
+		CopySendInt32(cstate, chunk->len);
+		CopySendData(cstate, chunk->data, chunk->len);
+	}
+	else
+	{
+		CopySendChar(cstate, method);
+		CopySendInt32(cstate, chunk->len);
+		CopySendInt32(cstate, len);
+		CopySendData(cstate, compressed, len);
+	}
+
+	if (compressed)
+		pfree(compressed);
+
+	CopySendEndOfRow(cstate);
+}
+
 /*
  * Send text representation of one attribute, with conversion and escaping
  */
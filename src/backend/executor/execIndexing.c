@@ -106,6 +106,7 @@
  */
 #include "postgres.h"
 
+#include "access/amapi.h"
 #include "access/genam.h"
 #include "access/relscan.h"
 #include "access/tableam.h"
@@ -136,6 +137,7 @@ static bool check_exclusion_or_unique_constraint(Relation heap, Relation index,
 static bool index_recheck_constraint(Relation index, Oid *constr_procs,
 									 Datum *existing_values, bool *existing_isnull,
 									 Datum *new_values);
+static bool index_can_insert_multi(Relation index, IndexInfo *indexInfo);
 
 /* ----------------------------------------------------------------
  *		ExecOpenIndices
@@ -273,6 +275,10 @@ ExecCloseIndices(ResultRelInfo *resultRelInfo)
  *
  *		If 'arbiterIndexes' is nonempty, noDupErr applies only to
  *		those indexes.  NIL means noDupErr applies to all indexes.
+ *
+ *		If 'multiInserted' is true, the caller has already passed
+ *		the tuple to ExecInsertIndexTuplesMulti, so indexes that
+ *		routine handles are skipped here.
  * ----------------------------------------------------------------
  */
 List *
@@ -282,7 +288,8 @@ ExecInsertIndexTuples(ResultRelInfo *resultRelInfo,
 					  bool update,
 					  bool noDupErr,
 					  bool *specConflict,
-					  List *arbiterIndexes)
+					  List *arbiterIndexes,
+					  bool multiInserted)
 {
 	ItemPointer tupleid = &slot->tts_tid;
 	List	   *result = NIL;
@@ -338,6 +345,10 @@ ExecInsertIndexTuples(ResultRelInfo *resultRelInfo,
 		if (!indexInfo->ii_ReadyForInserts)
 			continue;
 
+		/* Skip indexes already updated by ExecInsertIndexTuplesMulti */
+		if (multiInserted && index_can_insert_multi(indexRelation, indexInfo))
+			continue;
+
 		/* Check for partial index */
 		if (indexInfo->ii_Predicate != NIL)
 		{
@@ -480,6 +491,130 @@ ExecInsertIndexTuples(ResultRelInfo *resultRelInfo,
 	return result;
 }
 
+/* ----------------------------------------------------------------
+ *		ExecInsertIndexTuplesMulti
+ *
+ *		Insert index entries for a batch of heap tuples that were
+ *		just inserted into the result relation, for those indexes
+ *		whose AM accepts a whole batch in one call (see
+ *		index_can_insert_multi).  The remaining indexes must still
+ *		be updated one tuple at a time, by calling
+ *		ExecInsertIndexTuples with 'multiInserted' set to true.
+ * ----------------------------------------------------------------
+ */
+void
+ExecInsertIndexTuplesMulti(ResultRelInfo *resultRelInfo,
+						   TupleTableSlot **slots, int nslots,
+						   EState *estate)
+{
+	int			i;
+	int			numIndices;
+	RelationPtr relationDescs;
+	Relation	heapRelation;
+	IndexInfo **indexInfoArray;
+	ExprContext *econtext;
+	Datum	   *values = NULL;
+	bool	   *isnull = NULL;
+	ItemPointer tids = NULL;
+
+	numIndices = resultRelInfo->ri_NumIndices;
+	relationDescs = resultRelInfo->ri_IndexRelationDescs;
+	indexInfoArray = resultRelInfo->ri_IndexRelationInfo;
+	heapRelation = resultRelInfo->ri_RelationDesc;
+
+	econtext = GetPerTupleExprContext(estate);
+
+	for (i = 0; i < numIndices; i++)
+	{
+		Relation	indexRelation = relationDescs[i];
+		IndexInfo  *indexInfo;
+		ExprState  *predicate = NULL;
+		int			natts;
+		int			ntuples;
+		int			j;
+
+		if (indexRelation == NULL)
+			continue;
+
+		indexInfo = indexInfoArray[i];
+
+		if (!indexInfo->ii_ReadyForInserts ||
+			!index_can_insert_multi(indexRelation, indexInfo))
+			continue;
+
+		if (indexInfo->ii_Predicate != NIL)
+		{
+			predicate = indexInfo->ii_PredicateState;
+			if (predicate == NULL)
+			{
+				predicate = ExecPrepareQual(indexInfo->ii_Predicate, estate);
+				indexInfo->ii_PredicateState = predicate;
+			}
+		}
+
+		/* Allocate the key arrays once, sized for the widest index */
+		if (values == NULL)
+		{
+			values = palloc(sizeof(Datum) * INDEX_MAX_KEYS * nslots);
+			isnull = palloc(sizeof(bool) * INDEX_MAX_KEYS * nslots);
+			tids = palloc(sizeof(ItemPointerData) * nslots);
+		}
+
+		natts = indexInfo->ii_NumIndexAttrs;
+		ntuples = 0;
+		for (j = 0; j < nslots; j++)
+		{
+			TupleTableSlot *slot = slots[j];
+
+			Assert(ItemPointerIsValid(&slot->tts_tid));
+			Assert(slot->tts_tableOid == RelationGetRelid(heapRelation));
+
+			econtext->ecxt_scantuple = slot;
+
+			if (predicate != NULL && !ExecQual(predicate, econtext))
+				continue;
+
+			FormIndexDatum(indexInfo,
+						   slot,
+						   estate,
+						   values + ntuples * natts,
+						   isnull + ntuples * natts);
+			ItemPointerCopy(&slot->tts_tid, &tids[ntuples]);
+			ntuples++;
+		}
+
+		if (ntuples > 0)
+			index_insert_multi(indexRelation,
+							   values,
+							   isnull,
+							   tids,
+							   ntuples,
+							   heapRelation,
+							   indexInfo);
+	}
+
+	if (values != NULL)
+	{
+		pfree(values);
+		pfree(isnull);
+		pfree(tids);
+	}
+}
+
+/*
+ * Can the index take a batch of insertions through ExecInsertIndexTuplesMulti?
+ *
+ * Batched insertion skips uniqueness and exclusion checking, so only plain
+ * indexes qualify.
+ */
+static bool
+index_can_insert_multi(Relation index, IndexInfo *indexInfo)
+{
+	return index->rd_indam->aminsertmulti != NULL &&
+		!indexInfo->ii_Unique &&
+		indexInfo->ii_ExclusionOps == NULL;
+}
+
 /* ----------------------------------------------------------------
  *		ExecCheckIndexConstraints
  *
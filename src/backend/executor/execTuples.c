@@ -69,6 +69,34 @@
 #include "utils/lsyscache.h"
 #include "utils/typcache.h"
 
+/*
+ * A deform program is a compact summary of the slot's tuple descriptor that
+ * slot_deform_heap_tuple() walks instead of the descriptor's
+ * FormData_pg_attribute array, which is much larger and so much less cache
+ * friendly.  fixedoff is the offset of the attribute's data in a tuple
+ * without nulls, or -1 if that isn't fixed (ie, a preceding attribute is
+ * variable-length).  Attributes 0 .. nfixed - 1 all have fixed offsets.
+ *
+ * The program is built on first use and kept in the slot's memory context
+ * until the slot's descriptor changes.
+ */
+typedef struct TupleDeformStep
+{
+	int32		fixedoff;		/* data offset if fixed, else -1 */
+	int16		attlen;			/* copies of pg_attribute fields */
+	bool		attbyval;
+	char		attalign;
+} TupleDeformStep;
+
+typedef struct TupleDeformProgram
+{
+	int			natts;			/* number of steps */
+	int			nfixed;			/* length of fixed-offset prefix */
+	TupleDeformStep steps[FLEXIBLE_ARRAY_MEMBER];
+} TupleDeformProgram;
+
+static TupleDeformProgram *slot_build_deform_program(TupleTableSlot *slot);
+static void slot_free_deform_program(TupleTableSlot *slot);
 static TupleDesc ExecTypeFromTLInternal(List *targetList,
 										bool skipjunk);
 static pg_attribute_always_inline void slot_deform_heap_tuple(TupleTableSlot *slot, HeapTuple tuple, uint32 *offp,
@@ -925,7 +953,8 @@ static pg_attribute_always_inline void
 slot_deform_heap_tuple(TupleTableSlot *slot, HeapTuple tuple, uint32 *offp,
 					   int natts)
 {
-	TupleDesc	tupleDesc = slot->tts_tupleDescriptor;
+	TupleDeformProgram *program = slot->tts_deform;
+	const TupleDeformStep *steps;
 	Datum	   *values = slot->tts_values;
 	bool	   *isnull = slot->tts_isnull;
 	HeapTupleHeader tup = tuple->t_data;
@@ -959,55 +988,69 @@ slot_deform_heap_tuple(TupleTableSlot *slot, HeapTuple tuple, uint32 *offp,
 
 	tp = (char *) tup + tup->t_hoff;
 
+	if (unlikely(program == NULL))
+		program = slot_build_deform_program(slot);
+	steps = program->steps;
+
+	/*
+	 * Fast path: if the tuple has no nulls, every attribute in the
+	 * fixed-offset prefix can be fetched directly, with no alignment or
+	 * length computations.
+	 */
+	if (!hasnulls && attnum < program->nfixed)
+	{
+		int			nfast = Min(natts, program->nfixed);
+
+		Assert(!slow);
+		for (; attnum < nfast; attnum++)
+		{
+			const TupleDeformStep *step = &steps[attnum];
+
+			isnull[attnum] = false;
+			values[attnum] = fetch_att(tp + step->fixedoff, step->attbyval,
+									   step->attlen);
+		}
+
+		/* Compute the end of the last attribute fetched */
+		off = steps[attnum - 1].fixedoff;
+		off = att_addlength_pointer(off, steps[attnum - 1].attlen, tp + off);
+		if (steps[attnum - 1].attlen <= 0)
+			slow = true;
+	}
+
 	for (; attnum < natts; attnum++)
 	{
-		Form_pg_attribute thisatt = TupleDescAttr(tupleDesc, attnum);
+		const TupleDeformStep *step = &steps[attnum];
 
 		if (hasnulls && att_isnull(attnum, bp))
 		{
 			values[attnum] = (Datum) 0;
 			isnull[attnum] = true;
-			slow = true;		/* can't use attcacheoff anymore */
+			slow = true;		/* can't use fixedoff anymore */
 			continue;
 		}
 
 		isnull[attnum] = false;
 
-		if (!slow && thisatt->attcacheoff >= 0)
-			off = thisatt->attcacheoff;
-		else if (thisatt->attlen == -1)
+		if (!slow && step->fixedoff >= 0)
+			off = step->fixedoff;
+		else if (step->attlen == -1)
 		{
-			/*
-			 * We can only cache the offset for a varlena attribute if the
-			 * offset is already suitably aligned, so that there would be no
-			 * pad bytes in any case: then the offset will be valid for either
-			 * an aligned or unaligned value.
-			 */
-			if (!slow &&
-				off == att_align_nominal(off, thisatt->attalign))
-				thisatt->attcacheoff = off;
-			else
-			{
-				off = att_align_pointer(off, thisatt->attalign, -1,
-										tp + off);
-				slow = true;
-			}
+			off = att_align_pointer(off, step->attalign, -1, tp + off);
+			slow = true;
 		}
 		else
 		{
 			/* not varlena, so safe to use att_align_nominal */
-			off = att_align_nominal(off, thisatt->attalign);
-
-			if (!slow)
-				thisatt->attcacheoff = off;
+			off = att_align_nominal(off, step->attalign);
 		}
 
-		values[attnum] = fetchatt(thisatt, tp + off);
+		values[attnum] = fetch_att(tp + off, step->attbyval, step->attlen);
 
-		off = att_addlength_pointer(off, thisatt->attlen, tp + off);
+		off = att_addlength_pointer(off, step->attlen, tp + off);
 
-		if (thisatt->attlen <= 0)
-			slow = true;		/* can't use attcacheoff anymore */
+		if (step->attlen <= 0)
+			slow = true;		/* can't use fixedoff anymore */
 	}
 
 	/*
@@ -1021,6 +1064,82 @@ slot_deform_heap_tuple(TupleTableSlot *slot, HeapTuple tuple, uint32 *offp,
 		slot->tts_flags &= ~TTS_FLAG_SLOW;
 }
 
+/*
+ * slot_build_deform_program
+ *		Build and install the deform program for the slot's descriptor.
+ */
+static TupleDeformProgram *
+slot_build_deform_program(TupleTableSlot *slot)
+{
+	TupleDesc	tupleDesc = slot->tts_tupleDescriptor;
+	TupleDeformProgram *program;
+	int32		off = 0;
+	bool		fixed = true;
+	int			i;
+
+	program = (TupleDeformProgram *)
+		MemoryContextAlloc(slot->tts_mcxt,
+						   offsetof(TupleDeformProgram, steps) +
+						   tupleDesc->natts * sizeof(TupleDeformStep));
+	program->natts = tupleDesc->natts;
+	program->nfixed = 0;
+
+	for (i = 0; i < tupleDesc->natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupleDesc, i);
+		TupleDeformStep *step = &program->steps[i];
+
+		step->attlen = att->attlen;
+		step->attbyval = att->attbyval;
+		step->attalign = att->attalign;
+		step->fixedoff = -1;
+
+		if (!fixed)
+			continue;
+
+		if (att->attlen > 0)
+		{
+			off = att_align_nominal(off, att->attalign);
+			step->fixedoff = off;
+			off += att->attlen;
+		}
+		else
+		{
+			/*
+			 * The offset of a variable-length attribute is only fixed if it
+			 * is already suitably aligned, so that there would be no pad
+			 * bytes in any case: then the offset will be valid for either an
+			 * aligned or unaligned value.  Nothing after it has a fixed
+			 * offset.
+			 */
+			if (off == att_align_nominal(off, att->attalign))
+				step->fixedoff = off;
+			fixed = false;
+		}
+
+		if (step->fixedoff >= 0)
+			program->nfixed = i + 1;
+	}
+
+	slot->tts_deform = program;
+
+	return program;
+}
+
+/*
+ * slot_free_deform_program
+ *		Forget the slot's deform program, if any.
+ */
+static void
+slot_free_deform_program(TupleTableSlot *slot)
+{
+	if (slot->tts_deform)
+	{
+		pfree(slot->tts_deform);
+		slot->tts_deform = NULL;
+	}
+}
+
 
 const TupleTableSlotOps TTSOpsVirtual = {
 	.base_slot_size = sizeof(VirtualTupleTableSlot),
@@ -1205,6 +1324,7 @@ ExecResetTupleTable(List *tupleTable,	/* tuple table */
 			ReleaseTupleDesc(slot->tts_tupleDescriptor);
 			slot->tts_tupleDescriptor = NULL;
 		}
+		slot_free_deform_program(slot);
 
 		/* If shouldFree, release memory occupied by the slot itself */
 		if (shouldFree)
@@ -1259,6 +1379,7 @@ ExecDropSingleTupleTableSlot(TupleTableSlot *slot)
 	slot->tts_ops->release(slot);
 	if (slot->tts_tupleDescriptor)
 		ReleaseTupleDesc(slot->tts_tupleDescriptor);
+	slot_free_deform_program(slot);
 	if (!TTS_FIXED(slot))
 	{
 		if (slot->tts_values)
@@ -1305,6 +1426,7 @@ ExecSetSlotDescriptor(TupleTableSlot *slot, /* slot to change */
 		pfree(slot->tts_values);
 	if (slot->tts_isnull)
 		pfree(slot->tts_isnull);
+	slot_free_deform_program(slot);
 
 	/*
 	 * Install the new descriptor; if it's refcounted, bump its refcount.
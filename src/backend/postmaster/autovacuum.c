@@ -65,6 +65,7 @@
 #include <sys/time.h>
 #include <unistd.h>
 
+#include "access/hash.h"
 #include "access/heapam.h"
 #include "access/htup_details.h"
 #include "access/multixact.h"
@@ -2699,6 +2700,13 @@ perform_work_item(AutoVacuumWorkItem *workitem)
 									ObjectIdGetDatum(workitem->avw_relation),
 									Int64GetDatum((int64) workitem->avw_blockNumber));
 				break;
+			case AVW_GINCleanupPendingList:
+				DirectFunctionCall1(gin_clean_pending_list,
+									ObjectIdGetDatum(workitem->avw_relation));
+				break;
+			case AVW_HashExpandTable:
+				_hash_expand_deferred(workitem->avw_relation);
+				break;
 			default:
 				elog(WARNING, "unrecognized work item found: type %d",
 					 workitem->avw_type);
@@ -3321,6 +3329,14 @@ autovac_report_workitem(AutoVacuumWorkItem *workitem,
 			snprintf(activity, MAX_AUTOVAC_ACTIV_LEN,
 					 "autovacuum: BRIN summarize");
 			break;
+		case AVW_GINCleanupPendingList:
+			snprintf(activity, MAX_AUTOVAC_ACTIV_LEN,
+					 "autovacuum: GIN pending list cleanup");
+			break;
+		case AVW_HashExpandTable:
+			snprintf(activity, MAX_AUTOVAC_ACTIV_LEN,
+					 "autovacuum: hash index expansion");
+			break;
 	}
 
 	/*
@@ -3358,6 +3374,10 @@ AutoVacuumingActive(void)
 /*
  * Request one work item to the next autovacuum run processing our database.
  * Return false if the request can't be recorded.
+ *
+ * A GIN pending list cleanup request is satisfied by an identical one that is
+ * still waiting to be processed, since inserters re-request it every time the
+ * list overflows.  Other requests are always recorded.
  */
 bool
 AutoVacuumRequestWork(AutoVacuumWorkItemType type, Oid relationId,
@@ -3368,6 +3388,28 @@ AutoVacuumRequestWork(AutoVacuumWorkItemType type, Oid relationId,
 
 	LWLockAcquire(AutovacuumLock, LW_EXCLUSIVE);
 
+	/*
+	 * Nothing to do if the same pending list cleanup is already queued and
+	 * not yet started.
+	 */
+	if (type == AVW_GINCleanupPendingList)
+	{
+		for (i = 0; i < NUM_WORKITEMS; i++)
+		{
+			AutoVacuumWorkItem *workitem = &AutoVacuumShmem->av_workItems[i];
+
+			if (workitem->avw_used && !workitem->avw_active &&
+				workitem->avw_type == type &&
+				workitem->avw_database == MyDatabaseId &&
+				workitem->avw_relation == relationId &&
+				workitem->avw_blockNumber == blkno)
+			{
+				LWLockRelease(AutovacuumLock);
+				return true;
+			}
+		}
+	}
+
 	/*
 	 * Locate an unused work item and fill it with the given data.
 	 */
@@ -306,6 +306,21 @@ AddWALInfoToBackupManifest(backup_manifest_info *manifest, XLogRecPtr startptr,
 	AppendStringToManifest(manifest, "\n],\n");
 }
 
+/*
+ * Record that this is an incremental backup, taken relative to the backup
+ * that started at reference_lsn.
+ */
+void
+AddIncrementalInfoToBackupManifest(backup_manifest_info *manifest,
+								   XLogRecPtr reference_lsn)
+{
+	if (!IsManifestEnabled(manifest))
+		return;
+
+	AppendToManifest(manifest, "\"Incremental-From-LSN\": \"%X/%X\",\n",
+					 LSN_FORMAT_ARGS(reference_lsn));
+}
+
 /*
  * Finalize the backup manifest, and send it to the client.
  */
@@ -17,6 +17,7 @@
 #include <time.h>
 
 #include "access/xlog_internal.h"	/* for pg_start/stop_backup */
+#include "catalog/pg_tablespace.h"
 #include "catalog/pg_type.h"
 #include "common/file_perm.h"
 #include "commands/progress.h"
@@ -30,6 +31,7 @@
 #include "port.h"
 #include "postmaster/syslogger.h"
 #include "replication/basebackup.h"
+#include "replication/basebackup_incremental.h"
 #include "replication/backup_manifest.h"
 #include "replication/walsender.h"
 #include "replication/walsender_private.h"
@@ -40,6 +42,7 @@
 #include "storage/ipc.h"
 #include "storage/reinit.h"
 #include "utils/builtins.h"
+#include "utils/pg_lsn.h"
 #include "utils/ps_status.h"
 #include "utils/relcache.h"
 #include "utils/resowner.h"
@@ -56,6 +59,7 @@ typedef struct
 	bool		sendtblspcmapfile;
 	backup_manifest_option manifest;
 	pg_checksum_type manifest_checksum_type;
+	XLogRecPtr	incremental_lsn;
 } basebackup_options;
 
 static int64 sendTablespace(char *path, char *oid, bool sizeonly,
@@ -66,8 +70,21 @@ static int64 sendDir(const char *path, int basepathlen, bool sizeonly,
 static bool sendFile(const char *readfilename, const char *tarfilename,
 					 struct stat *statbuf, bool missing_ok, Oid dboid,
 					 backup_manifest_info *manifest, const char *spcoid);
+static bool sendIncrementalFile(const char *readfilename,
+								const char *tarfilename,
+								struct stat *statbuf, unsigned segno,
+								unsigned num_blocks_required,
+								unsigned truncation_block_length, Oid dboid,
+								backup_manifest_info *manifest,
+								const char *spcoid);
 static void sendFileWithContent(const char *filename, const char *content,
 								backup_manifest_info *manifest);
+static FileBackupMethod get_file_backup_method(const char *filename,
+											   struct stat *statbuf,
+											   Oid dboid, const char *spcoid,
+											   unsigned *segno,
+											   unsigned *num_blocks_required,
+											   unsigned *truncation_block_length);
 static int64 _tarWriteHeader(const char *filename, const char *linktarget,
 							 struct stat *statbuf, bool sizeonly);
 static int64 _tarWriteDir(const char *pathbuf, int basepathlen, struct stat *statbuf,
@@ -121,6 +138,15 @@ static long long int total_checksum_failures;
 /* Do not verify checksums. */
 static bool noverify_checksums = false;
 
+/*
+ * Changed-block information for an incremental backup, or NULL if we're
+ * taking a full backup.
+ */
+static IncrementalBackupInfo *incremental_info = NULL;
+
+/* Blocks to send for the relation segment currently being sent. */
+static BlockNumber *relative_block_numbers = NULL;
+
 /*
  * Total amount of backup data that will be streamed.
  * -1 means that the size is not estimated.
@@ -294,6 +320,8 @@ perform_base_backup(basebackup_options *opt)
 							 opt->manifest_checksum_type);
 
 	total_checksum_failures = 0;
+	incremental_info = NULL;
+	relative_block_numbers = NULL;
 
 	pgstat_progress_update_param(PROGRESS_BASEBACKUP_PHASE,
 								 PROGRESS_BASEBACKUP_PHASE_WAIT_CHECKPOINT);
@@ -314,6 +342,21 @@ perform_base_backup(basebackup_options *opt)
 		tablespaceinfo *ti;
 		int			tblspc_streamed = 0;
 
+		/*
+		 * For an incremental backup, find out which blocks changed since the
+		 * reference backup started. Also note the reference in backup_label,
+		 * so that the server refuses to start from this backup until it has
+		 * been combined with its predecessors.
+		 */
+		if (!XLogRecPtrIsInvalid(opt->incremental_lsn))
+		{
+			incremental_info = CreateIncrementalBackupInfo(opt->incremental_lsn);
+			PrepareForIncrementalBackup(incremental_info, startptr);
+			relative_block_numbers = palloc(sizeof(BlockNumber) * RELSEG_SIZE);
+			appendStringInfo(labelfile, "INCREMENTAL FROM LSN: %X/%X\n",
+							 LSN_FORMAT_ARGS(opt->incremental_lsn));
+		}
+
 		/*
 		 * Calculate the relative path of temporary statistics directory in
 		 * order to skip the files which are located in that directory later.
@@ -711,6 +754,9 @@ perform_base_backup(basebackup_options *opt)
 
 	AddWALInfoToBackupManifest(&manifest, startptr, starttli, endptr, endtli);
 
+	if (incremental_info != NULL)
+		AddIncrementalInfoToBackupManifest(&manifest, opt->incremental_lsn);
+
 	SendBackupManifest(&manifest);
 
 	SendXlogRecPtrResult(endptr, endtli);
@@ -736,6 +782,14 @@ perform_base_backup(basebackup_options *opt)
 	 */
 	FreeBackupManifest(&manifest);
 
+	if (incremental_info != NULL)
+	{
+		FreeIncrementalBackupInfo(incremental_info);
+		incremental_info = NULL;
+		pfree(relative_block_numbers);
+		relative_block_numbers = NULL;
+	}
+
 	/* clean up the resource owner we created */
 	WalSndResourceCleanup(true);
 
@@ -772,6 +826,7 @@ parse_basebackup_options(List *options, basebackup_options *opt)
 	bool		o_noverify_checksums = false;
 	bool		o_manifest = false;
 	bool		o_manifest_checksums = false;
+	bool		o_incremental = false;
 
 	MemSet(opt, 0, sizeof(*opt));
 	opt->manifest = MANIFEST_OPTION_NO;
@@ -904,6 +959,23 @@ parse_basebackup_options(List *options, basebackup_options *opt)
 								optval)));
 			o_manifest_checksums = true;
 		}
+		else if (strcmp(defel->defname, "incremental") == 0)
+		{
+			char	   *optval = strVal(defel->arg);
+			bool		have_error = false;
+
+			if (o_incremental)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+			opt->incremental_lsn = pg_lsn_in_internal(optval, &have_error);
+			if (have_error || XLogRecPtrIsInvalid(opt->incremental_lsn))
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("invalid incremental backup reference LSN: \"%s\"",
+								optval)));
+			o_incremental = true;
+		}
 		else
 			elog(ERROR, "option \"%s\" not recognized",
 				 defel->defname);
@@ -1225,6 +1297,7 @@ sendDir(const char *path, int basepathlen, bool sizeonly, List *tablespaces,
 	int64		size = 0;
 	const char *lastDir;		/* Split last dir from parent path. */
 	bool		isDbDir = false;	/* Does this directory contain relations? */
+	bool		isGlobalDir;	/* Is this the shared catalog directory? */
 
 	/*
 	 * Determine if the current path is a database directory that can contain
@@ -1253,6 +1326,7 @@ sendDir(const char *path, int basepathlen, bool sizeonly, List *tablespaces,
 					 sizeof(TABLESPACE_VERSION_DIRECTORY) - 1) == 0))
 			isDbDir = true;
 	}
+	isGlobalDir = (strcmp(path, "./global") == 0);
 
 	dir = AllocateDir(path);
 	while ((de = ReadDir(dir, path)) != NULL)
@@ -1502,19 +1576,48 @@ sendDir(const char *path, int basepathlen, bool sizeonly, List *tablespaces,
 		else if (S_ISREG(statbuf.st_mode))
 		{
 			bool		sent = false;
+			Oid			dboid = isDbDir ? atooid(lastDir + 1) : InvalidOid;
+			FileBackupMethod method = BACK_UP_FILE_FULLY;
+			unsigned	segno = 0;
+			unsigned	num_blocks_required = 0;
+			unsigned	truncation_block_length = 0;
+			size_t		filesize = statbuf.st_size;
+
+			/*
+			 * In an incremental backup, relation files may be sent as
+			 * INCREMENTAL.<name> files holding only the changed blocks.
+			 */
+			if (incremental_info != NULL && (isDbDir || isGlobalDir))
+				method = get_file_backup_method(de->d_name, &statbuf, dboid,
+												spcoid, &segno,
+												&num_blocks_required,
+												&truncation_block_length);
+			if (method == BACK_UP_FILE_INCREMENTALLY)
+				filesize = IncrementalFileSize(num_blocks_required);
+
+			if (!sizeonly && method == BACK_UP_FILE_INCREMENTALLY)
+			{
+				char		tarfilename[MAXPGPATH * 2];
 
-			if (!sizeonly)
+				snprintf(tarfilename, sizeof(tarfilename), "%s/%s%s",
+						 path + basepathlen + 1, INCREMENTAL_PREFIX,
+						 de->d_name);
+				sent = sendIncrementalFile(pathbuf, tarfilename, &statbuf,
+										   segno, num_blocks_required,
+										   truncation_block_length, dboid,
+										   manifest, spcoid);
+			}
+			else if (!sizeonly)
 				sent = sendFile(pathbuf, pathbuf + basepathlen + 1, &statbuf,
-								true, isDbDir ? atooid(lastDir + 1) : InvalidOid,
-								manifest, spcoid);
+								true, dboid, manifest, spcoid);
 
 			if (sent || sizeonly)
 			{
 				/* Add size. */
-				size += statbuf.st_size;
+				size += filesize;
 
 				/* Pad to a multiple of the tar block size. */
-				size += tarPaddingBytesRequired(statbuf.st_size);
+				size += tarPaddingBytesRequired(filesize);
 
 				/* Size of the header for the file. */
 				size += TAR_BLOCK_SIZE;
@@ -1835,6 +1938,215 @@ sendFile(const char *readfilename, const char *tarfilename,
 	return true;
 }
 
+/*
+ * Decide whether a file in a database directory, or in global, should be
+ * sent in full or incrementally, based on the changed-block information
+ * gathered for this backup.
+ *
+ * If it is to be sent incrementally, the segment number of the file and the
+ * number of blocks to send are returned, and relative_block_numbers holds
+ * the blocks themselves.
+ */
+static FileBackupMethod
+get_file_backup_method(const char *filename, struct stat *statbuf,
+					   Oid dboid, const char *spcoid, unsigned *segno,
+					   unsigned *num_blocks_required,
+					   unsigned *truncation_block_length)
+{
+	int			relOidChars;
+	ForkNumber	relForkNum;
+	Oid			relfilenode;
+	Oid			tsoid;
+	const char *segpath;
+
+	if (!parse_filename_for_nontemp_relation(filename, &relOidChars,
+											 &relForkNum))
+		return BACK_UP_FILE_FULLY;
+
+	relfilenode = atooid(filename);
+	segpath = strchr(filename, '.');
+	*segno = segpath != NULL ? atoi(segpath + 1) : 0;
+
+	if (spcoid != NULL)
+		tsoid = atooid(spcoid);
+	else if (OidIsValid(dboid))
+		tsoid = DEFAULTTABLESPACE_OID;
+	else
+		tsoid = GLOBALTABLESPACE_OID;
+
+	return GetFileBackupMethod(incremental_info, tsoid, dboid, relfilenode,
+							   relForkNum, *segno, statbuf->st_size,
+							   num_blocks_required, relative_block_numbers,
+							   truncation_block_length);
+}
+
+/*
+ * Send the changed blocks of a relation segment as an incremental file.
+ *
+ * relative_block_numbers holds the num_blocks_required blocks to send. The
+ * file starts with a header describing them, see basebackup_incremental.h,
+ * followed by the block images. As in sendFile(), blocks that disappeared
+ * due to a concurrent truncation are sent as zeroes, and WAL replay will fix
+ * them up.
+ *
+ * Returns true if the file was sent, false if it no longer exists.
+ */
+static bool
+sendIncrementalFile(const char *readfilename, const char *tarfilename,
+					struct stat *statbuf, unsigned segno,
+					unsigned num_blocks_required,
+					unsigned truncation_block_length, Oid dboid,
+					backup_manifest_info *manifest, const char *spcoid)
+{
+	int			fd;
+	struct stat incstatbuf;
+	StringInfoData header;
+	uint32		magic = INCREMENTAL_MAGIC;
+	char		buf[BLCKSZ];
+	int			checksum_failures = 0;
+	bool		verify_checksum;
+	pgoff_t		len;
+	size_t		pad;
+	unsigned	i;
+	pg_checksum_context checksum_ctx;
+
+	if (pg_checksum_init(&checksum_ctx, manifest->checksum_type) < 0)
+		elog(ERROR, "could not initialize checksum of file \"%s\"",
+			 readfilename);
+
+	fd = OpenTransientFile(readfilename, O_RDONLY | PG_BINARY);
+	if (fd < 0)
+	{
+		if (errno == ENOENT)
+			return false;
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m", readfilename)));
+	}
+
+	incstatbuf = *statbuf;
+	incstatbuf.st_size = IncrementalFileSize(num_blocks_required);
+	_tarWriteHeader(tarfilename, NULL, &incstatbuf, false);
+
+	verify_checksum = !noverify_checksums && DataChecksumsEnabled();
+
+	/* Send the header. */
+	initStringInfo(&header);
+	appendBinaryStringInfo(&header, (char *) &magic, sizeof(uint32));
+	appendBinaryStringInfo(&header, (char *) &num_blocks_required,
+						   sizeof(uint32));
+	appendBinaryStringInfo(&header, (char *) &truncation_block_length,
+						   sizeof(uint32));
+	appendBinaryStringInfo(&header, (char *) relative_block_numbers,
+						   sizeof(BlockNumber) * num_blocks_required);
+	Assert(header.len == IncrementalFileHeaderSize(num_blocks_required));
+
+	if (pq_putmessage('d', header.data, header.len))
+		ereport(ERROR,
+				(errmsg("base backup could not send data, aborting backup")));
+	update_basebackup_progress(header.len);
+	if (pg_checksum_update(&checksum_ctx, (uint8 *) header.data,
+						   header.len) < 0)
+		elog(ERROR, "could not update checksum of base backup");
+	len = header.len;
+	throttle(header.len);
+	pfree(header.data);
+
+	/* Then the blocks. */
+	for (i = 0; i < num_blocks_required; i++)
+	{
+		BlockNumber blkno = relative_block_numbers[i];
+		off_t		offset = (off_t) blkno * BLCKSZ;
+		int			cnt;
+
+		cnt = basebackup_read_file(fd, buf, BLCKSZ, offset, readfilename,
+								   true);
+		if (cnt < BLCKSZ)
+			MemSet(buf + cnt, 0, BLCKSZ - cnt);
+
+		/*
+		 * Verify the checksum the same way sendFile() does, rereading the
+		 * block once in case we saw a torn page.
+		 */
+		if (verify_checksum && cnt == BLCKSZ && !PageIsNew(buf) &&
+			PageGetLSN(buf) < startptr)
+		{
+			uint16		checksum;
+
+			checksum = pg_checksum_page(buf, blkno + segno * RELSEG_SIZE);
+			if (((PageHeader) buf)->pd_checksum != checksum)
+			{
+				cnt = basebackup_read_file(fd, buf, BLCKSZ, offset,
+										   readfilename, true);
+				if (cnt < BLCKSZ)
+					MemSet(buf + cnt, 0, BLCKSZ - cnt);
+				else if (!PageIsNew(buf) && PageGetLSN(buf) < startptr)
+				{
+					checksum = pg_checksum_page(buf, blkno + segno * RELSEG_SIZE);
+					if (((PageHeader) buf)->pd_checksum != checksum)
+					{
+						checksum_failures++;
+
+						if (checksum_failures <= 5)
+							ereport(WARNING,
+									(errmsg("checksum verification failed in "
+											"file \"%s\", block %u: calculated "
+											"%X but expected %X",
+											readfilename, blkno, checksum,
+											((PageHeader) buf)->pd_checksum)));
+						if (checksum_failures == 5)
+							ereport(WARNING,
+									(errmsg("further checksum verification "
+											"failures in file \"%s\" will not "
+											"be reported", readfilename)));
+					}
+				}
+			}
+		}
+
+		if (pq_putmessage('d', buf, BLCKSZ))
+			ereport(ERROR,
+					(errmsg("base backup could not send data, aborting backup")));
+		update_basebackup_progress(BLCKSZ);
+		if (pg_checksum_update(&checksum_ctx, (uint8 *) buf, BLCKSZ) < 0)
+			elog(ERROR, "could not update checksum of base backup");
+		len += BLCKSZ;
+		throttle(BLCKSZ);
+	}
+
+	Assert(len == incstatbuf.st_size);
+
+	/* Pad to a block boundary, per tar format requirements. */
+	pad = tarPaddingBytesRequired(len);
+	if (pad > 0)
+	{
+		MemSet(buf, 0, pad);
+		pq_putmessage('d', buf, pad);
+		update_basebackup_progress(pad);
+	}
+
+	CloseTransientFile(fd);
+
+	if (checksum_failures > 1)
+	{
+		ereport(WARNING,
+				(errmsg_plural("file \"%s\" has a total of %d checksum verification failure",
+							   "file \"%s\" has a total of %d checksum verification failures",
+							   checksum_failures,
+							   readfilename, checksum_failures)));
+
+		pgstat_report_checksum_failures_in_db(dboid, checksum_failures);
+	}
+
+	total_checksum_failures += checksum_failures;
+
+	AddFileToBackupManifest(manifest, spcoid, tarfilename,
+							incstatbuf.st_size,
+							(pg_time_t) incstatbuf.st_mtime, &checksum_ctx);
+
+	return true;
+}
+
 
 static int64
 _tarWriteHeader(const char *filename, const char *linktarget,
@@ -0,0 +1,471 @@
+/*-------------------------------------------------------------------------
+ *
+ * basebackup_incremental.c
+ *	  code for deciding which blocks an incremental base backup must send
+ *
+ * An incremental backup is taken relative to an earlier backup, identified
+ * by the LSN at which that backup started. Every block modified since then
+ * is referenced by some WAL record between that LSN and the start LSN of
+ * the new backup, so by reading that stretch of WAL we can build the set of
+ * changed blocks, and send only those for each relation segment. Blocks
+ * changed after the new backup starts will be fixed up by WAL replay, as
+ * usual.
+ *
+ * A few operations change relation files without leaving block references
+ * behind: relation forks created by smgrcreate() can be populated without
+ * WAL when wal_level is minimal, truncations shorten files, and CREATE
+ * DATABASE copies a whole directory. We track those separately and fall
+ * back to sending the affected files in full.
+ *
+ * Copyright (c) 2021, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/replication/basebackup_incremental.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/rmgr.h"
+#include "access/xlog.h"
+#include "access/xlog_internal.h"
+#include "access/xlogreader.h"
+#include "access/xlogutils.h"
+#include "catalog/pg_control.h"
+#include "catalog/storage_xlog.h"
+#include "commands/dbcommands_xlog.h"
+#include "miscadmin.h"
+#include "replication/basebackup_incremental.h"
+#include "storage/relfilenode.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+
+/*
+ * Modified blocks are remembered in bitmaps covering BLOCKS_PER_CHUNK
+ * consecutive blocks of one relation fork, which keeps the table compact
+ * for the common case of changes clustered in a few parts of a relation.
+ */
+#define BLOCKS_PER_CHUNK		256
+#define BLOCK_BITMAP_WORDS		(BLOCKS_PER_CHUNK / 64)
+
+/*
+ * If at least this fraction of a segment's blocks have changed, send the
+ * whole segment; the incremental file would not be much smaller.
+ */
+#define INCREMENTAL_SEND_FRACTION	0.9
+
+typedef struct RelForkKey
+{
+	RelFileNode rnode;
+	ForkNumber	forknum;
+} RelForkKey;
+
+typedef struct RelForkEntry
+{
+	RelForkKey	key;
+	BlockNumber limit_block;	/* lowest truncation point seen, or
+								 * InvalidBlockNumber if never truncated */
+	bool		whole_file;		/* changed in ways not visible block-wise */
+} RelForkEntry;
+
+typedef struct BlockChunkKey
+{
+	RelFileNode rnode;
+	ForkNumber	forknum;
+	BlockNumber chunkno;
+} BlockChunkKey;
+
+typedef struct BlockChunkEntry
+{
+	BlockChunkKey key;
+	uint64		bits[BLOCK_BITMAP_WORDS];
+} BlockChunkEntry;
+
+typedef struct DatabaseKey
+{
+	Oid			spcoid;
+	Oid			dboid;
+} DatabaseKey;
+
+struct IncrementalBackupInfo
+{
+	MemoryContext mcxt;
+
+	/* Start LSN of the backup this one is relative to. */
+	XLogRecPtr	reference_lsn;
+
+	HTAB	   *relforks;		/* RelForkEntry, by RelForkKey */
+	HTAB	   *chunks;			/* BlockChunkEntry, by BlockChunkKey */
+	HTAB	   *databases;		/* DatabaseKey of databases created */
+};
+
+static void ScanRecordForChangedBlocks(IncrementalBackupInfo *ib,
+									   XLogReaderState *record);
+static RelForkEntry *GetRelForkEntry(IncrementalBackupInfo *ib,
+									 RelFileNode *rnode, ForkNumber forknum,
+									 bool create);
+static void MarkBlockModified(IncrementalBackupInfo *ib, RelFileNode *rnode,
+							  ForkNumber forknum, BlockNumber blkno);
+
+/*
+ * Create the state needed to take an incremental backup relative to the
+ * backup that started at reference_lsn.
+ *
+ * Everything is allocated in a child of the current memory context, so
+ * that it goes away with the replication command on error.
+ */
+IncrementalBackupInfo *
+CreateIncrementalBackupInfo(XLogRecPtr reference_lsn)
+{
+	MemoryContext mcxt;
+	IncrementalBackupInfo *ib;
+	HASHCTL		ctl;
+
+	mcxt = AllocSetContextCreate(CurrentMemoryContext,
+								 "incremental backup information",
+								 ALLOCSET_DEFAULT_SIZES);
+	ib = MemoryContextAllocZero(mcxt, sizeof(IncrementalBackupInfo));
+	ib->mcxt = mcxt;
+	ib->reference_lsn = reference_lsn;
+
+	ctl.hcxt = mcxt;
+
+	ctl.keysize = sizeof(RelForkKey);
+	ctl.entrysize = sizeof(RelForkEntry);
+	ib->relforks = hash_create("incremental backup relation forks", 1024,
+							   &ctl, HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	ctl.keysize = sizeof(BlockChunkKey);
+	ctl.entrysize = sizeof(BlockChunkEntry);
+	ib->chunks = hash_create("incremental backup modified blocks", 4096,
+							 &ctl, HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	ctl.keysize = sizeof(DatabaseKey);
+	ctl.entrysize = sizeof(DatabaseKey);
+	ib->databases = hash_create("incremental backup created databases", 16,
+								&ctl, HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	return ib;
+}
+
+/*
+ * Read the WAL between the reference LSN and the start of the current
+ * backup, and remember every block it touches.
+ *
+ * All of that WAL must still be available in pg_wal; if any of it has been
+ * recycled, the WAL reader raises an error and the incremental backup can't
+ * be taken.
+ */
+void
+PrepareForIncrementalBackup(IncrementalBackupInfo *ib,
+							XLogRecPtr backup_start_lsn)
+{
+	XLogReaderState *xlogreader;
+
+	if (ib->reference_lsn > backup_start_lsn)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("incremental backup reference LSN %X/%X is newer than backup start LSN %X/%X",
+						LSN_FORMAT_ARGS(ib->reference_lsn),
+						LSN_FORMAT_ARGS(backup_start_lsn))));
+
+	xlogreader =
+		XLogReaderAllocate(wal_segment_size, NULL,
+						   XL_ROUTINE(.page_read = &read_local_xlog_page,
+									  .segment_open = &wal_segment_open,
+									  .segment_close = &wal_segment_close),
+						   NULL);
+	if (xlogreader == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory"),
+				 errdetail("Failed while allocating a WAL reading processor.")));
+
+	/* Make sure the WAL segment isn't leaked if we error out midway. */
+	PG_TRY();
+	{
+		/*
+		 * The reference LSN is the redo pointer of the checkpoint the earlier
+		 * backup started from, so a record begins there.
+		 */
+		XLogBeginRead(xlogreader, ib->reference_lsn);
+
+		while (xlogreader->EndRecPtr < backup_start_lsn)
+		{
+			XLogRecord *record;
+			char	   *errormsg;
+
+			CHECK_FOR_INTERRUPTS();
+
+			record = XLogReadRecord(xlogreader, &errormsg);
+			if (record == NULL)
+			{
+				if (errormsg)
+					ereport(ERROR,
+							(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+							 errmsg("could not read WAL record at %X/%X for incremental backup: %s",
+									LSN_FORMAT_ARGS(xlogreader->EndRecPtr),
+									errormsg)));
+				else
+					ereport(ERROR,
+							(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+							 errmsg("could not read WAL record at %X/%X for incremental backup",
+									LSN_FORMAT_ARGS(xlogreader->EndRecPtr))));
+			}
+
+			ScanRecordForChangedBlocks(ib, xlogreader);
+		}
+	}
+	PG_FINALLY();
+	{
+		XLogReaderFree(xlogreader);
+	}
+	PG_END_TRY();
+
+	elog(DEBUG1, "incremental backup from %X/%X to %X/%X: %ld relation forks, %ld block chunks modified",
+		 LSN_FORMAT_ARGS(ib->reference_lsn),
+		 LSN_FORMAT_ARGS(backup_start_lsn),
+		 hash_get_num_entries(ib->relforks),
+		 hash_get_num_entries(ib->chunks));
+}
+
+/*
+ * Return the start LSN of the backup this one is relative to.
+ */
+XLogRecPtr
+GetIncrementalBackupReferenceLSN(IncrementalBackupInfo *ib)
+{
+	return ib->reference_lsn;
+}
+
+/*
+ * Decide how to back up one relation segment file of the given size.
+ *
+ * If it should be sent incrementally, fill relative_block_numbers (which
+ * must have room for RELSEG_SIZE entries) with the segment-relative numbers
+ * of the blocks to send, in ascending order, and set *num_blocks_required
+ * and *truncation_block_length, the segment's length in blocks.
+ */
+FileBackupMethod
+GetFileBackupMethod(IncrementalBackupInfo *ib, Oid spcoid, Oid dboid,
+					Oid relfilenode, ForkNumber forknum, unsigned segno,
+					size_t size, unsigned *num_blocks_required,
+					BlockNumber *relative_block_numbers,
+					unsigned *truncation_block_length)
+{
+	RelFileNode rnode;
+	RelForkEntry *relfork;
+	DatabaseKey dbkey;
+	BlockNumber start_blkno;
+	BlockNumber nblocks;
+	BlockNumber limit_blkno;
+	BlockNumber chunkno;
+	unsigned	nrequired = 0;
+
+	/*
+	 * Only the main fork is done incrementally. The free space map is not
+	 * WAL-logged reliably, and visibility map bits are cleared during redo
+	 * of heap records that don't reference the map page. Both are small
+	 * compared to the main fork anyway.
+	 */
+	if (forknum != MAIN_FORKNUM)
+		return BACK_UP_FILE_FULLY;
+
+	/* Files that aren't a whole number of blocks are sent as they are. */
+	if (size == 0 || size % BLCKSZ != 0 || size / BLCKSZ > RELSEG_SIZE)
+		return BACK_UP_FILE_FULLY;
+
+	/* Databases created since the reference backup are sent in full. */
+	memset(&dbkey, 0, sizeof(dbkey));
+	dbkey.spcoid = spcoid;
+	dbkey.dboid = dboid;
+	if (hash_search(ib->databases, &dbkey, HASH_FIND, NULL) != NULL)
+		return BACK_UP_FILE_FULLY;
+
+	rnode.spcNode = spcoid;
+	rnode.dbNode = dboid;
+	rnode.relNode = relfilenode;
+	relfork = GetRelForkEntry(ib, &rnode, forknum, false);
+	if (relfork != NULL && relfork->whole_file)
+		return BACK_UP_FILE_FULLY;
+
+	nblocks = size / BLCKSZ;
+	start_blkno = segno * RELSEG_SIZE;
+
+	/*
+	 * Every block at or beyond the truncation point may differ from what the
+	 * reference backup has, even if we saw no record touching it, so all of
+	 * them must be sent. Compute where that starts within this segment.
+	 */
+	limit_blkno = nblocks;
+	if (relfork != NULL && relfork->limit_block != InvalidBlockNumber)
+	{
+		if (relfork->limit_block <= start_blkno)
+			limit_blkno = 0;
+		else if (relfork->limit_block - start_blkno < nblocks)
+			limit_blkno = relfork->limit_block - start_blkno;
+	}
+
+	/* Collect the modified blocks below the truncation point. */
+	for (chunkno = start_blkno / BLOCKS_PER_CHUNK;
+		 limit_blkno > 0 &&
+		 chunkno <= (start_blkno + limit_blkno - 1) / BLOCKS_PER_CHUNK;
+		 chunkno++)
+	{
+		BlockChunkKey key;
+		BlockChunkEntry *chunk;
+		int			i;
+
+		memset(&key, 0, sizeof(key));
+		key.rnode = rnode;
+		key.forknum = forknum;
+		key.chunkno = chunkno;
+		chunk = hash_search(ib->chunks, &key, HASH_FIND, NULL);
+		if (chunk == NULL)
+			continue;
+
+		for (i = 0; i < BLOCKS_PER_CHUNK; i++)
+		{
+			BlockNumber blkno = chunkno * BLOCKS_PER_CHUNK + i;
+
+			if ((chunk->bits[i / 64] & (UINT64CONST(1) << (i % 64))) == 0)
+				continue;
+			if (blkno < start_blkno || blkno - start_blkno >= limit_blkno)
+				continue;
+			relative_block_numbers[nrequired++] = blkno - start_blkno;
+		}
+	}
+
+	/* Add everything from the truncation point to the end of the segment. */
+	while (limit_blkno < nblocks)
+		relative_block_numbers[nrequired++] = limit_blkno++;
+
+	if (nrequired >= nblocks * INCREMENTAL_SEND_FRACTION)
+		return BACK_UP_FILE_FULLY;
+
+	*num_blocks_required = nrequired;
+	*truncation_block_length = nblocks;
+	return BACK_UP_FILE_INCREMENTALLY;
+}
+
+/*
+ * Release the memory used by the changed-block tracking state.
+ */
+void
+FreeIncrementalBackupInfo(IncrementalBackupInfo *ib)
+{
+	MemoryContextDelete(ib->mcxt);
+}
+
+/*
+ * Remember what one WAL record changed.
+ */
+static void
+ScanRecordForChangedBlocks(IncrementalBackupInfo *ib, XLogReaderState *record)
+{
+	RmgrId		rmid = XLogRecGetRmid(record);
+	uint8		info = XLogRecGetInfo(record) & ~XLR_INFO_MASK;
+	int			block_id;
+
+	if (rmid == RM_SMGR_ID && info == XLOG_SMGR_CREATE)
+	{
+		xl_smgr_create *xlrec = (xl_smgr_create *) XLogRecGetData(record);
+
+		GetRelForkEntry(ib, &xlrec->rnode, xlrec->forkNum, true)->whole_file = true;
+	}
+	else if (rmid == RM_SMGR_ID && info == XLOG_SMGR_TRUNCATE)
+	{
+		xl_smgr_truncate *xlrec = (xl_smgr_truncate *) XLogRecGetData(record);
+
+		if ((xlrec->flags & SMGR_TRUNCATE_HEAP) != 0)
+		{
+			RelForkEntry *relfork;
+
+			relfork = GetRelForkEntry(ib, &xlrec->rnode, MAIN_FORKNUM, true);
+			if (relfork->limit_block == InvalidBlockNumber ||
+				xlrec->blkno < relfork->limit_block)
+				relfork->limit_block = xlrec->blkno;
+		}
+	}
+	else if (rmid == RM_DBASE_ID && info == XLOG_DBASE_CREATE)
+	{
+		xl_dbase_create_rec *xlrec =
+		(xl_dbase_create_rec *) XLogRecGetData(record);
+		DatabaseKey key;
+
+		memset(&key, 0, sizeof(key));
+		key.spcoid = xlrec->tablespace_id;
+		key.dboid = xlrec->db_id;
+		hash_search(ib->databases, &key, HASH_ENTER, NULL);
+	}
+	else if (rmid == RM_XLOG_ID && info == XLOG_PARAMETER_CHANGE)
+	{
+		xl_parameter_change xlrec;
+
+		memcpy(&xlrec, XLogRecGetData(record), sizeof(xl_parameter_change));
+		if (xlrec.wal_level < WAL_LEVEL_REPLICA)
+			ereport(ERROR,
+					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+					 errmsg("WAL since the reference backup was generated with wal_level=minimal"),
+					 errhint("Take a full backup instead.")));
+	}
+
+	for (block_id = 0; block_id <= record->max_block_id; block_id++)
+	{
+		RelFileNode rnode;
+		ForkNumber	forknum;
+		BlockNumber blkno;
+
+		if (!XLogRecGetBlockTag(record, block_id, &rnode, &forknum, &blkno))
+			continue;
+		MarkBlockModified(ib, &rnode, forknum, blkno);
+	}
+}
+
+/*
+ * Look up the tracking entry for a relation fork, optionally creating it.
+ */
+static RelForkEntry *
+GetRelForkEntry(IncrementalBackupInfo *ib, RelFileNode *rnode,
+				ForkNumber forknum, bool create)
+{
+	RelForkKey	key;
+	RelForkEntry *relfork;
+	bool		found;
+
+	memset(&key, 0, sizeof(key));
+	key.rnode = *rnode;
+	key.forknum = forknum;
+	relfork = hash_search(ib->relforks, &key,
+						  create ? HASH_ENTER : HASH_FIND, &found);
+	if (create && !found)
+	{
+		relfork->limit_block = InvalidBlockNumber;
+		relfork->whole_file = false;
+	}
+
+	return relfork;
+}
+
+/*
+ * Remember that a block was modified.
+ */
+static void
+MarkBlockModified(IncrementalBackupInfo *ib, RelFileNode *rnode,
+				  ForkNumber forknum, BlockNumber blkno)
+{
+	BlockChunkKey key;
+	BlockChunkEntry *chunk;
+	bool		found;
+	int			i = blkno % BLOCKS_PER_CHUNK;
+
+	memset(&key, 0, sizeof(key));
+	key.rnode = *rnode;
+	key.forknum = forknum;
+	key.chunkno = blkno / BLOCKS_PER_CHUNK;
+	chunk = hash_search(ib->chunks, &key, HASH_ENTER, &found);
+	if (!found)
+		memset(chunk->bits, 0, sizeof(chunk->bits));
+
+	chunk->bits[i / 64] |= UINT64CONST(1) << (i % 64);
+}
@@ -465,9 +465,28 @@ libpqrcv_startstreaming(WalReceiverConn *conn,
 		appendStringInfoChar(&cmd, ')');
 	}
 	else
+	{
 		appendStringInfo(&cmd, " TIMELINE %u",
 						 options->proto.physical.startpointTLI);
 
+		if (options->proto.physical.compression)
+		{
+			char	   *compression_literal;
+
+			compression_literal =
+				PQescapeLiteral(conn->streamConn,
+								options->proto.physical.compression,
+								strlen(options->proto.physical.compression));
+			if (!compression_literal)
+				ereport(ERROR,
+						(errcode(ERRCODE_OUT_OF_MEMORY),	/* likely guess */
+						 errmsg("could not start WAL streaming: %s",
+								pchomp(PQerrorMessage(conn->streamConn)))));
+			appendStringInfo(&cmd, " (compression %s)", compression_literal);
+			PQfreemem(compression_literal);
+		}
+	}
+
 	/* Start streaming. */
 	res = libpqrcv_PQexec(conn->streamConn, cmd.data);
 	pfree(cmd.data);
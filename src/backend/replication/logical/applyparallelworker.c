@@ -0,0 +1,1715 @@
+/*-------------------------------------------------------------------------
+ * applyparallelworker.c
+ *	   Support routines for applying logical replication transactions in
+ *	   parallel apply workers
+ *
+ * Copyright (c) 2021, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/replication/logical/applyparallelworker.c
+ *
+ * NOTES
+ *	  When max_parallel_apply_workers_per_subscription is greater than zero,
+ *	  the apply worker of a subscription (the leader) hands the transactions
+ *	  it receives to parallel apply workers instead of applying them itself.
+ *	  The leader keeps receiving from the publisher while the workers apply,
+ *	  so that a stream of independent transactions is applied by several
+ *	  backends at once.
+ *
+ *	  The leader and its workers share one dynamic shared memory segment.
+ *	  It holds a message queue from the leader to each worker, over which the
+ *	  leader forwards the protocol messages of a transaction, and a queue from
+ *	  each worker back to the leader, over which errors are reported the same
+ *	  way parallel query workers report them.  The leader rethrows any error
+ *	  of a worker, which makes all of them exit.
+ *
+ *	  COMMIT ORDER
+ *	  ------------
+ *	  Transactions are committed in the order in which the publisher
+ *	  committed them.  Each transaction gets a commit order number once the
+ *	  leader knows its commit position: at BEGIN for an ordinary transaction
+ *	  and at STREAM COMMIT for a streamed one.  A worker about to commit waits
+ *	  until the transaction with the preceding order number has committed.
+ *	  The workers publish the last committed order number in shared memory,
+ *	  from which the leader derives the flush position it reports to the
+ *	  publisher.
+ *
+ *	  DEPENDENCIES
+ *	  ------------
+ *	  The leader reads the replica identity key of every row a transaction
+ *	  changes and remembers which transaction changed that key last.  When a
+ *	  transaction changes a row that an earlier, not yet committed transaction
+ *	  changed too, the worker is told to wait for that transaction before
+ *	  applying the change.  The same happens for the whole queue of earlier
+ *	  transactions when the key cannot be determined, and every transaction
+ *	  after a TRUNCATE waits for it.  Conflicts the leader cannot see, such as
+ *	  two transactions inserting the same value into a unique index that is
+ *	  not the replica identity, end in a unique violation or a deadlock; the
+ *	  leader then remembers where it was and applies everything up to that
+ *	  point itself after the restart.
+ *
+ *	  Every worker holds a session lock on the remote XID of the transaction
+ *	  it is applying, and waiting for another transaction means waiting for
+ *	  that lock.  That way a worker blocked on a row lock held by a worker
+ *	  that waits for it in turn shows up as a deadlock.
+ *
+ *	  STREAMED TRANSACTIONS
+ *	  ---------------------
+ *	  The changes of a large transaction streamed by the publisher are
+ *	  applied by a worker as they arrive, instead of being spooled to a file
+ *	  until the commit.  Subtransactions become savepoints of the worker's
+ *	  transaction, so that an aborted subtransaction can be rolled back.
+ *
+ *	  Parallel apply is only used once all tables of the subscription are
+ *	  READY; until then, and for transactions the publisher does not send as
+ *	  a whole, the leader applies transactions itself after waiting for the
+ *	  workers to finish.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/xact.h"
+#include "catalog/pg_subscription.h"
+#include "common/hashfn.h"
+#include "libpq/pqformat.h"
+#include "libpq/pqmq.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/interrupt.h"
+#include "replication/logicallauncher.h"
+#include "replication/logicalproto.h"
+#include "replication/logicalworker.h"
+#include "replication/origin.h"
+#include "replication/worker_internal.h"
+#include "storage/condition_variable.h"
+#include "storage/dsm.h"
+#include "storage/ipc.h"
+#include "storage/lmgr.h"
+#include "storage/proc.h"
+#include "storage/shm_mq.h"
+#include "storage/shm_toc.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"
+#include "utils/guc.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+
+#define PARALLEL_APPLY_MAGIC			0x61707061
+
+/* Keys of the shared memory table of contents */
+#define PARALLEL_APPLY_KEY_SHARED		UINT64CONST(0xFFFFFFFFFFFF0001)
+#define PARALLEL_APPLY_KEY_QUEUE(i)		((uint64) (i) * 2)
+#define PARALLEL_APPLY_KEY_ERROR_QUEUE(i)	((uint64) (i) * 2 + 1)
+
+/* Size of the queue to each worker, and of the one the errors come back on */
+#define PARALLEL_APPLY_QUEUE_SIZE		(4 * 1024 * 1024)
+#define PARALLEL_APPLY_ERROR_QUEUE_SIZE	16384
+
+/*
+ * Messages sent by the leader to a worker.  The first byte is the message
+ * type, followed by the fields given.
+ */
+#define PA_MSG_BEGIN		'b' /* start a transaction: xid */
+#define PA_MSG_ORDER		'o' /* commit order: order, xid of the previous */
+#define PA_MSG_WAIT			'd' /* wait for a transaction: xid, order */
+#define PA_MSG_SUBXACT		's' /* changes of a subtransaction follow: xid */
+#define PA_MSG_ABORT		'a' /* streamed (sub)transaction aborted: xid,
+								 * subxid */
+#define PA_MSG_CHANGE		'w' /* logical replication protocol message */
+
+/* Number of remembered row keys above which unneeded ones are discarded */
+#define PA_MIN_KEYS_LIMIT	65536
+
+/*
+ * Shared state of the leader and its workers.
+ */
+typedef struct ParallelApplyShared
+{
+	slock_t		mutex;
+
+	/* Process to wake up when a transaction finishes. */
+	int			leader_pgprocno;
+
+	/* Commit order of the last committed transaction. */
+	uint64		committed_order;
+
+	/* Local end of the latest commit of any worker. */
+	XLogRecPtr	commit_end;
+
+	/* Broadcast whenever a transaction finishes. */
+	ConditionVariable finished_cv;
+
+	/* Number of transactions each worker has finished. */
+	int			nworkers;
+	uint64		ntxns_done[FLEXIBLE_ARRAY_MEMBER];
+} ParallelApplyShared;
+
+/*
+ * Leader's view of a worker.
+ */
+typedef struct ParallelApplyWorkerInfo
+{
+	shm_mq_handle *mq_handle;	/* queue to the worker */
+	shm_mq_handle *error_mq_handle; /* queue from the worker */
+	uint64		ntxns_assigned; /* transactions handed to the worker */
+	bool		streaming;		/* applying a streamed transaction? */
+} ParallelApplyWorkerInfo;
+
+/*
+ * A transaction handed to a worker, until the leader has seen it commit.
+ */
+typedef struct ParallelApplyTxn
+{
+	TransactionId xid;			/* remote XID, hash key */
+	ParallelApplyWorkerInfo *winfo;
+	bool		streamed;
+	uint64		order;			/* commit order, 0 while unknown */
+	TransactionId prev_xid;		/* transaction with the preceding order */
+	uint64		waited_order;	/* highest order the worker waits for */
+	TransactionId last_subxid;	/* subtransaction of the last change */
+	XLogRecPtr	end_lsn;		/* remote end of the commit */
+	dlist_node	node;			/* in pa_inflight once the order is known */
+} ParallelApplyTxn;
+
+/*
+ * Last transaction that changed a row, by hash of relation and key.
+ */
+typedef struct ParallelApplyKey
+{
+	uint64		key;
+	TransactionId xid;
+} ParallelApplyKey;
+
+/*
+ * RELATION and TYPE messages, which every new worker has to see first.
+ */
+typedef struct ParallelApplySchema
+{
+	uint64		key;			/* relation OID, or type OID with high bit */
+	Bitmapset  *attkeys;		/* replica identity columns of a relation */
+	char	   *msg;			/* message without the streaming XID */
+	int			len;
+} ParallelApplySchema;
+
+/* Leader state */
+static dsm_segment *pa_seg = NULL;
+static ParallelApplyShared *pa_shared = NULL;
+static ParallelApplyWorkerInfo *pa_workers = NULL;
+static int	pa_pool_size = 0;
+static int	pa_nworkers = 0;
+static bool pa_launch_failed = false;
+
+static HTAB *pa_txns = NULL;
+static HTAB *pa_keys = NULL;
+static HTAB *pa_schema = NULL;
+static long pa_keys_limit = PA_MIN_KEYS_LIMIT;
+
+/* Transactions with a known commit order, in that order */
+static dlist_head pa_inflight = DLIST_STATIC_INIT(pa_inflight);
+
+/* Transaction whose messages are being received, if handed to a worker */
+static ParallelApplyTxn *pa_current = NULL;
+
+/* Receiving a streamed transaction the leader applies itself? */
+static bool pa_in_serial_stream = false;
+
+/* Last commit order handed out, and the transaction it went to */
+static uint64 pa_last_order = 0;
+static TransactionId pa_last_order_xid = InvalidTransactionId;
+
+/* Transaction all later ones wait for, after a TRUNCATE */
+static TransactionId pa_barrier_xid = InvalidTransactionId;
+
+/* Remote LSN up to which the leader applies everything itself */
+static XLogRecPtr pa_serial_lsn = InvalidXLogRecPtr;
+static bool pa_serial_lsn_valid = false;
+
+/* Worker state */
+static ParallelApplyShared *MyParallelShared = NULL;
+static shm_mq_handle *MyMqHandle = NULL;
+static TransactionId pa_xid = InvalidTransactionId;
+static uint64 pa_order = 0;
+static TransactionId pa_prev_xid = InvalidTransactionId;
+static TransactionId *pa_subxacts = NULL;
+static int	pa_nsubxacts = 0;
+static int	pa_nsubxacts_max = 0;
+
+static void pa_setup_segment(int nworkers);
+static ParallelApplyWorkerInfo *pa_launch_worker(void);
+static ParallelApplyWorkerInfo *pa_get_free_worker(bool wait);
+static bool pa_can_start(XLogRecPtr lsn);
+static void pa_wait_for_all(void);
+static void pa_check_workers(void);
+static void pa_worker_failed(void);
+static uint64 pa_get_committed_order(void);
+
+static bool pa_begin(StringInfo s);
+static bool pa_stream_start(StringInfo s);
+static bool pa_stream_abort(StringInfo s);
+static bool pa_stream_commit(StringInfo s);
+static void pa_current_message(StringInfo s);
+static void pa_change(ParallelApplyTxn *txn, StringInfo s);
+static void pa_remember_schema(StringInfo s, bool streamed);
+
+static ParallelApplyTxn *pa_start_txn(ParallelApplyWorkerInfo *winfo,
+									  TransactionId xid, bool streamed);
+static void pa_assign_order(ParallelApplyTxn *txn);
+static void pa_depend_on_xid(ParallelApplyTxn *txn, TransactionId xid);
+static void pa_depend_on_all(ParallelApplyTxn *txn);
+static bool pa_depend_on_tuple(ParallelApplyTxn *txn, LogicalRepRelId relid,
+							   LogicalRepTupleData *tuple);
+static void pa_prune_keys(void);
+
+static void pa_send(ParallelApplyWorkerInfo *winfo, shm_mq_iovec *iov,
+					int iovcnt);
+static void pa_send_control(ParallelApplyWorkerInfo *winfo, StringInfo msg);
+static void pa_send_change(ParallelApplyWorkerInfo *winfo, char action,
+						   const char *data, int len);
+
+static void pa_worker_loop(void);
+static void pa_worker_message(StringInfo s);
+static void pa_wait_for_transaction(TransactionId xid, uint64 order);
+static void pa_start_subxact(TransactionId subxid);
+static void pa_abort(TransactionId xid, TransactionId subxid);
+static void pa_finish(void);
+
+
+/*
+ * Leader: look at a protocol message before it is applied.
+ *
+ * Returns true if the message was taken care of, which includes handing it
+ * to a parallel apply worker, and false if the leader has to apply it.
+ */
+bool
+pa_dispatch(StringInfo s)
+{
+	LogicalRepMsgType action;
+
+	if (am_tablesync_worker())
+		return false;
+
+	/* Rethrow the errors of the workers as early as possible. */
+	if (pa_seg != NULL)
+		pa_check_workers();
+
+	action = s->data[s->cursor];
+
+	if (pa_current != NULL)
+	{
+		pa_current_message(s);
+		return true;
+	}
+
+	switch (action)
+	{
+		case LOGICAL_REP_MSG_BEGIN:
+			return pa_begin(s);
+
+		case LOGICAL_REP_MSG_STREAM_START:
+			return pa_stream_start(s);
+
+		case LOGICAL_REP_MSG_STREAM_END:
+			pa_in_serial_stream = false;
+			return false;
+
+		case LOGICAL_REP_MSG_STREAM_ABORT:
+			return pa_stream_abort(s);
+
+		case LOGICAL_REP_MSG_STREAM_COMMIT:
+			return pa_stream_commit(s);
+
+		case LOGICAL_REP_MSG_RELATION:
+		case LOGICAL_REP_MSG_TYPE:
+			pa_remember_schema(s, pa_in_serial_stream);
+			return false;
+
+		default:
+			return false;
+	}
+}
+
+/*
+ * Leader: handle BEGIN.
+ */
+static bool
+pa_begin(StringInfo s)
+{
+	StringInfoData msg = *s;
+	LogicalRepBeginData begin_data;
+	ParallelApplyWorkerInfo *winfo;
+	ParallelApplyTxn *txn;
+
+	(void) pq_getmsgbyte(&msg);
+	logicalrep_read_begin(&msg, &begin_data);
+
+	pa_process_commits();
+
+	if (pa_can_start(begin_data.final_lsn) &&
+		(winfo = pa_get_free_worker(true)) != NULL)
+	{
+		txn = pa_start_txn(winfo, begin_data.xid, false);
+		pa_assign_order(txn);
+		pa_send_change(winfo, LOGICAL_REP_MSG_BEGIN,
+					   &s->data[s->cursor + 1], s->len - s->cursor - 1);
+
+		pa_current = txn;
+		in_remote_transaction = true;
+		pgstat_report_activity(STATE_RUNNING, NULL);
+		return true;
+	}
+
+	/*
+	 * Apply the transaction here, after everything handed out before it has
+	 * committed.
+	 */
+	pa_wait_for_all();
+	return false;
+}
+
+/*
+ * Leader: handle STREAM START.
+ */
+static bool
+pa_stream_start(StringInfo s)
+{
+	StringInfoData msg = *s;
+	TransactionId xid;
+	bool		first_segment;
+	ParallelApplyWorkerInfo *winfo;
+
+	(void) pq_getmsgbyte(&msg);
+	xid = logicalrep_read_stream_start(&msg, &first_segment);
+
+	if (pa_txns != NULL)
+	{
+		pa_current = hash_search(pa_txns, &xid, HASH_FIND, NULL);
+		if (pa_current != NULL)
+			return true;
+	}
+
+	/*
+	 * Only start applying a streamed transaction in a worker if one is free
+	 * right away; its changes can take a long time to arrive.
+	 */
+	if (first_segment &&
+		pa_can_start(MyLogicalRepWorker->last_lsn) &&
+		(winfo = pa_get_free_worker(false)) != NULL)
+	{
+		pa_current = pa_start_txn(winfo, xid, true);
+		winfo->streaming = true;
+		return true;
+	}
+
+	pa_in_serial_stream = true;
+	return false;
+}
+
+/*
+ * Leader: handle STREAM ABORT.
+ */
+static bool
+pa_stream_abort(StringInfo s)
+{
+	StringInfoData msg = *s;
+	TransactionId xid;
+	TransactionId subxid;
+	ParallelApplyTxn *txn;
+	StringInfoData buf;
+
+	(void) pq_getmsgbyte(&msg);
+	logicalrep_read_stream_abort(&msg, &xid, &subxid);
+
+	if (pa_txns == NULL ||
+		(txn = hash_search(pa_txns, &xid, HASH_FIND, NULL)) == NULL)
+		return false;
+
+	initStringInfo(&buf);
+	pq_sendbyte(&buf, PA_MSG_ABORT);
+	pq_sendint32(&buf, xid);
+	pq_sendint32(&buf, subxid);
+	pa_send_control(txn->winfo, &buf);
+	pfree(buf.data);
+
+	if (xid == subxid)
+	{
+		txn->winfo->streaming = false;
+		if (pa_barrier_xid == xid)
+			pa_barrier_xid = InvalidTransactionId;
+		hash_search(pa_txns, &xid, HASH_REMOVE, NULL);
+	}
+	else if (txn->last_subxid == subxid)
+		txn->last_subxid = InvalidTransactionId;
+
+	return true;
+}
+
+/*
+ * Leader: handle STREAM COMMIT.
+ */
+static bool
+pa_stream_commit(StringInfo s)
+{
+	StringInfoData msg = *s;
+	TransactionId xid;
+	LogicalRepCommitData commit_data;
+	ParallelApplyTxn *txn;
+
+	(void) pq_getmsgbyte(&msg);
+	xid = logicalrep_read_stream_commit(&msg, &commit_data);
+
+	if (pa_txns == NULL ||
+		(txn = hash_search(pa_txns, &xid, HASH_FIND, NULL)) == NULL)
+	{
+		/* Spooled by us; replay it once the workers are done. */
+		pa_wait_for_all();
+		return false;
+	}
+
+	pa_assign_order(txn);
+	txn->end_lsn = commit_data.end_lsn;
+	pa_send_change(txn->winfo, LOGICAL_REP_MSG_STREAM_COMMIT,
+				   &s->data[s->cursor + 1], s->len - s->cursor - 1);
+
+	txn->winfo->streaming = false;
+	dlist_push_tail(&pa_inflight, &txn->node);
+
+	return true;
+}
+
+/*
+ * Leader: handle a message of the transaction handed to a worker.
+ */
+static void
+pa_current_message(StringInfo s)
+{
+	ParallelApplyTxn *txn = pa_current;
+	LogicalRepMsgType action = s->data[s->cursor];
+
+	switch (action)
+	{
+		case LOGICAL_REP_MSG_INSERT:
+		case LOGICAL_REP_MSG_UPDATE:
+		case LOGICAL_REP_MSG_DELETE:
+		case LOGICAL_REP_MSG_TRUNCATE:
+			pa_change(txn, s);
+			break;
+
+		case LOGICAL_REP_MSG_RELATION:
+		case LOGICAL_REP_MSG_TYPE:
+			pa_remember_schema(s, txn->streamed);
+			break;
+
+		case LOGICAL_REP_MSG_ORIGIN:
+		case LOGICAL_REP_MSG_MESSAGE:
+			/* Nothing to apply. */
+			break;
+
+		case LOGICAL_REP_MSG_COMMIT:
+			{
+				StringInfoData msg = *s;
+				LogicalRepCommitData commit_data;
+
+				if (txn->streamed)
+					goto out_of_order;
+
+				(void) pq_getmsgbyte(&msg);
+				logicalrep_read_commit(&msg, &commit_data);
+
+				txn->end_lsn = commit_data.end_lsn;
+				pa_send_change(txn->winfo, action,
+							   &s->data[s->cursor + 1],
+							   s->len - s->cursor - 1);
+				dlist_push_tail(&pa_inflight, &txn->node);
+
+				pa_current = NULL;
+				in_remote_transaction = false;
+				pgstat_report_activity(STATE_IDLE, NULL);
+				break;
+			}
+
+		case LOGICAL_REP_MSG_STREAM_END:
+			if (!txn->streamed)
+				goto out_of_order;
+			pa_current = NULL;
+			break;
+
+		default:
+	out_of_order:
+			ereport(ERROR,
+					(errcode(ERRCODE_PROTOCOL_VIOLATION),
+					 errmsg_internal("unexpected logical replication message type \"%c\" in remote transaction %u",
+									 action, txn->xid)));
+	}
+}
+
+/*
+ * Leader: pass a data change to the worker applying the transaction, after
+ * telling it what to wait for first.
+ */
+static void
+pa_change(ParallelApplyTxn *txn, StringInfo s)
+{
+	StringInfoData msg = *s;
+	LogicalRepMsgType action;
+	LogicalRepRelId relid;
+	int			payload;
+
+	action = pq_getmsgbyte(&msg);
+
+	if (txn->streamed)
+	{
+		TransactionId subxid = pq_getmsgint(&msg, 4);
+
+		if (!TransactionIdIsValid(subxid))
+			ereport(ERROR,
+					(errcode(ERRCODE_PROTOCOL_VIOLATION),
+					 errmsg_internal("invalid transaction ID in streamed replication transaction")));
+
+		if (subxid != txn->xid && subxid != txn->last_subxid)
+		{
+			StringInfoData buf;
+
+			initStringInfo(&buf);
+			pq_sendbyte(&buf, PA_MSG_SUBXACT);
+			pq_sendint32(&buf, subxid);
+			pa_send_control(txn->winfo, &buf);
+			pfree(buf.data);
+		}
+		txn->last_subxid = subxid;
+	}
+	payload = msg.cursor;
+
+	if (TransactionIdIsValid(pa_barrier_xid))
+		pa_depend_on_xid(txn, pa_barrier_xid);
+
+	switch (action)
+	{
+		case LOGICAL_REP_MSG_INSERT:
+			{
+				LogicalRepTupleData newtup;
+
+				relid = logicalrep_read_insert(&msg, &newtup);
+				if (!pa_depend_on_tuple(txn, relid, &newtup))
+					pa_depend_on_all(txn);
+				break;
+			}
+
+		case LOGICAL_REP_MSG_UPDATE:
+			{
+				LogicalRepTupleData oldtup;
+				LogicalRepTupleData newtup;
+				bool		has_oldtup;
+				bool		known = true;
+
+				relid = logicalrep_read_update(&msg, &has_oldtup,
+											   &oldtup, &newtup);
+				if (has_oldtup)
+					known = pa_depend_on_tuple(txn, relid, &oldtup);
+
+				/*
+				 * Without an old tuple, an unchanged key is sent as such and
+				 * the row it belongs to is not known.
+				 */
+				if (!pa_depend_on_tuple(txn, relid, &newtup) && !has_oldtup)
+					known = false;
+
+				if (!known)
+					pa_depend_on_all(txn);
+				break;
+			}
+
+		case LOGICAL_REP_MSG_DELETE:
+			{
+				LogicalRepTupleData oldtup;
+
+				relid = logicalrep_read_delete(&msg, &oldtup);
+				if (!pa_depend_on_tuple(txn, relid, &oldtup))
+					pa_depend_on_all(txn);
+				break;
+			}
+
+		case LOGICAL_REP_MSG_TRUNCATE:
+			pa_depend_on_all(txn);
+			pa_barrier_xid = txn->xid;
+			break;
+
+		default:
+			Assert(false);
+	}
+
+	pa_send_change(txn->winfo, action, &s->data[payload], s->len - payload);
+
+	if (hash_get_num_entries(pa_keys) > pa_keys_limit)
+		pa_prune_keys();
+}
+
+/*
+ * Leader: remember a RELATION or TYPE message and pass it on to all workers.
+ *
+ * A worker applying a transaction may need the relation map entry sent
+ * during any earlier transaction, so all workers get to see all of them.
+ * When the message belongs to a transaction handed to a worker, the leader
+ * updates its own map too.
+ */
+static void
+pa_remember_schema(StringInfo s, bool streamed)
+{
+	StringInfoData msg = *s;
+	MemoryContext oldctx;
+	LogicalRepMsgType action;
+	ParallelApplySchema *entry;
+	Bitmapset  *attkeys = NULL;
+	uint64		key;
+	int			payload;
+	bool		found;
+	int			i;
+
+	action = pq_getmsgbyte(&msg);
+	if (streamed)
+		(void) pq_getmsgint(&msg, 4);
+	payload = msg.cursor;
+
+	if (action == LOGICAL_REP_MSG_RELATION)
+	{
+		LogicalRepRelation *rel = logicalrep_read_rel(&msg);
+
+		key = rel->remoteid;
+		attkeys = rel->attkeys;
+	}
+	else
+	{
+		LogicalRepTyp typ;
+
+		logicalrep_read_typ(&msg, &typ);
+		key = UINT64CONST(0x100000000) | typ.remoteid;
+	}
+
+	if (pa_schema == NULL)
+	{
+		HASHCTL		ctl;
+
+		ctl.keysize = sizeof(uint64);
+		ctl.entrysize = sizeof(ParallelApplySchema);
+		ctl.hcxt = ApplyContext;
+		pa_schema = hash_create("logical replication parallel apply schema",
+								256, &ctl,
+								HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	entry = hash_search(pa_schema, &key, HASH_ENTER, &found);
+	if (found)
+	{
+		bms_free(entry->attkeys);
+		pfree(entry->msg);
+	}
+
+	oldctx = MemoryContextSwitchTo(ApplyContext);
+	entry->attkeys = bms_copy(attkeys);
+	entry->len = s->len - payload + 1;
+	entry->msg = palloc(entry->len);
+	entry->msg[0] = action;
+	memcpy(&entry->msg[1], &s->data[payload], s->len - payload);
+	MemoryContextSwitchTo(oldctx);
+
+	for (i = 0; i < pa_nworkers; i++)
+		pa_send_change(&pa_workers[i], action,
+					   &s->data[payload], s->len - payload);
+
+	if (pa_current != NULL)
+	{
+		StringInfoData local;
+
+		local.data = entry->msg;
+		local.len = local.maxlen = entry->len;
+		local.cursor = 0;
+		apply_dispatch(&local);
+	}
+}
+
+/*
+ * Leader: start handing a transaction to a worker.
+ */
+static ParallelApplyTxn *
+pa_start_txn(ParallelApplyWorkerInfo *winfo, TransactionId xid, bool streamed)
+{
+	ParallelApplyTxn *txn;
+	StringInfoData buf;
+	bool		found;
+
+	txn = hash_search(pa_txns, &xid, HASH_ENTER, &found);
+	if (found)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg_internal("remote transaction %u is already being applied",
+								 xid)));
+
+	txn->winfo = winfo;
+	txn->streamed = streamed;
+	txn->order = 0;
+	txn->prev_xid = InvalidTransactionId;
+	txn->waited_order = 0;
+	txn->last_subxid = InvalidTransactionId;
+	txn->end_lsn = InvalidXLogRecPtr;
+
+	winfo->ntxns_assigned++;
+
+	initStringInfo(&buf);
+	pq_sendbyte(&buf, PA_MSG_BEGIN);
+	pq_sendint32(&buf, xid);
+	pa_send_control(winfo, &buf);
+	pfree(buf.data);
+
+	return txn;
+}
+
+/*
+ * Leader: give the transaction the next commit order and tell its worker.
+ */
+static void
+pa_assign_order(ParallelApplyTxn *txn)
+{
+	StringInfoData buf;
+
+	txn->order = ++pa_last_order;
+	txn->prev_xid = pa_last_order_xid;
+	pa_last_order_xid = txn->xid;
+
+	initStringInfo(&buf);
+	pq_sendbyte(&buf, PA_MSG_ORDER);
+	pq_sendint64(&buf, txn->order);
+	pq_sendint32(&buf, txn->prev_xid);
+	pa_send_control(txn->winfo, &buf);
+	pfree(buf.data);
+}
+
+/*
+ * Leader: make the transaction wait for another one before its next change.
+ *
+ * Only transactions with a known commit order are waited for.  A streamed
+ * transaction that has not committed yet cannot hold a row this one
+ * changes: on the publisher, this one would have had to wait for it, and
+ * the change would only arrive after its commit.
+ */
+static void
+pa_depend_on_xid(ParallelApplyTxn *txn, TransactionId xid)
+{
+	ParallelApplyTxn *other;
+	StringInfoData buf;
+
+	other = hash_search(pa_txns, &xid, HASH_FIND, NULL);
+	if (other == NULL || other == txn || other->order == 0)
+		return;
+
+	if (other->order <= txn->waited_order ||
+		other->order <= pa_get_committed_order())
+		return;
+
+	initStringInfo(&buf);
+	pq_sendbyte(&buf, PA_MSG_WAIT);
+	pq_sendint32(&buf, other->xid);
+	pq_sendint64(&buf, other->order);
+	pa_send_control(txn->winfo, &buf);
+	pfree(buf.data);
+
+	txn->waited_order = other->order;
+}
+
+/*
+ * Leader: make the transaction wait for all transactions ordered before it.
+ */
+static void
+pa_depend_on_all(ParallelApplyTxn *txn)
+{
+	pa_depend_on_xid(txn, txn->order != 0 ? txn->prev_xid : pa_last_order_xid);
+}
+
+/*
+ * Leader: make the transaction wait for the last one that changed the row
+ * with the key of the tuple, and remember it as the last one.
+ *
+ * Returns false if the key of the tuple is not known.
+ */
+static bool
+pa_depend_on_tuple(ParallelApplyTxn *txn, LogicalRepRelId relid,
+				   LogicalRepTupleData *tuple)
+{
+	ParallelApplySchema *rel;
+	ParallelApplyKey *entry;
+	uint64		relkey = relid;
+	uint64		key;
+	bool		found;
+	int			i;
+
+	rel = pa_schema ? hash_search(pa_schema, &relkey, HASH_FIND, NULL) : NULL;
+	if (rel == NULL)
+		return false;
+
+	key = hash_bytes_uint32_extended(relid, 0);
+	for (i = 0; i < tuple->ncols; i++)
+	{
+		StringInfo	value = &tuple->colvalues[i];
+
+		if (!bms_is_member(i, rel->attkeys))
+			continue;
+
+		switch (tuple->colstatus[i])
+		{
+			case LOGICALREP_COLUMN_NULL:
+				key = hash_combine64(key, 0);
+				break;
+			case LOGICALREP_COLUMN_TEXT:
+			case LOGICALREP_COLUMN_BINARY:
+				key = hash_combine64(key,
+									 hash_bytes_extended((unsigned char *) value->data,
+														 value->len, i + 1));
+				break;
+			default:
+				return false;
+		}
+	}
+
+	entry = hash_search(pa_keys, &key, HASH_ENTER, &found);
+	if (found && entry->xid != txn->xid)
+		pa_depend_on_xid(txn, entry->xid);
+	entry->xid = txn->xid;
+
+	return true;
+}
+
+/*
+ * Leader: forget the keys of transactions that have finished.
+ */
+static void
+pa_prune_keys(void)
+{
+	HASH_SEQ_STATUS status;
+	ParallelApplyKey *entry;
+
+	hash_seq_init(&status, pa_keys);
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		if (hash_search(pa_txns, &entry->xid, HASH_FIND, NULL) == NULL)
+			hash_search(pa_keys, &entry->key, HASH_REMOVE, NULL);
+	}
+
+	pa_keys_limit = Max(PA_MIN_KEYS_LIMIT, 2 * hash_get_num_entries(pa_keys));
+}
+
+/*
+ * Leader: may the transaction at the given remote LSN go to a worker?
+ */
+static bool
+pa_can_start(XLogRecPtr lsn)
+{
+	MemoryContext oldctx;
+	bool		ready;
+
+	if (max_parallel_apply_workers_per_subscription == 0)
+		return false;
+
+	/*
+	 * After a worker failed, apply everything up to where the leader was at
+	 * that point itself.
+	 */
+	if (!pa_serial_lsn_valid)
+	{
+		pa_serial_lsn = logicalrep_get_serial_apply_lsn(MySubscription->oid);
+		pa_serial_lsn_valid = true;
+	}
+	if (!XLogRecPtrIsInvalid(pa_serial_lsn))
+	{
+		if (lsn <= pa_serial_lsn)
+			return false;
+
+		logicalrep_set_serial_apply_lsn(MySubscription->oid,
+										InvalidXLogRecPtr);
+		pa_serial_lsn = InvalidXLogRecPtr;
+	}
+
+	oldctx = CurrentMemoryContext;
+	ready = AllTablesyncsReady();
+	MemoryContextSwitchTo(oldctx);
+
+	return ready;
+}
+
+/*
+ * Leader: find a worker that is not applying a transaction, starting a new
+ * one if the pool is not full yet.
+ *
+ * If wait is true and all workers are busy, wait for one, unless all of them
+ * have a streamed transaction open.  Returns NULL if no worker is found.
+ */
+static ParallelApplyWorkerInfo *
+pa_get_free_worker(bool wait)
+{
+	ParallelApplyWorkerInfo *winfo;
+
+	for (;;)
+	{
+		bool		can_wait = false;
+		int			i;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (pa_seg != NULL)
+			pa_check_workers();
+
+		for (i = 0; i < pa_nworkers; i++)
+		{
+			winfo = &pa_workers[i];
+
+			if (winfo->streaming)
+				continue;
+
+			SpinLockAcquire(&pa_shared->mutex);
+			if (pa_shared->ntxns_done[i] == winfo->ntxns_assigned)
+			{
+				SpinLockRelease(&pa_shared->mutex);
+				return winfo;
+			}
+			SpinLockRelease(&pa_shared->mutex);
+
+			can_wait = true;
+		}
+
+		if (!pa_launch_failed &&
+			pa_nworkers < max_parallel_apply_workers_per_subscription &&
+			(pa_seg == NULL || pa_nworkers < pa_pool_size))
+		{
+			winfo = pa_launch_worker();
+			if (winfo != NULL)
+				return winfo;
+		}
+
+		if (!wait || !can_wait)
+			return NULL;
+
+		(void) WaitLatch(MyLatch,
+						 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+						 1000L, WAIT_EVENT_LOGICAL_PARALLEL_APPLY_STATE_CHANGE);
+		ResetLatch(MyLatch);
+
+		if (ConfigReloadPending)
+		{
+			ConfigReloadPending = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+	}
+}
+
+/*
+ * Leader: start a new worker.
+ *
+ * Returns NULL if it could not be started, in which case no more are tried.
+ */
+static ParallelApplyWorkerInfo *
+pa_launch_worker(void)
+{
+	ParallelApplyWorkerInfo *winfo;
+	HASH_SEQ_STATUS status;
+	ParallelApplySchema *entry;
+
+	if (pa_seg == NULL)
+		pa_setup_segment(max_parallel_apply_workers_per_subscription);
+
+	if (!logicalrep_worker_launch(MyLogicalRepWorker->dbid,
+								  MySubscription->oid,
+								  MySubscription->name,
+								  MyLogicalRepWorker->userid,
+								  InvalidOid,
+								  dsm_segment_handle(pa_seg),
+								  pa_nworkers))
+	{
+		pa_launch_failed = true;
+		return NULL;
+	}
+
+	winfo = &pa_workers[pa_nworkers++];
+
+	/* Tell the new worker about everything sent so far. */
+	if (pa_schema != NULL)
+	{
+		hash_seq_init(&status, pa_schema);
+		while ((entry = hash_seq_search(&status)) != NULL)
+			pa_send_change(winfo, entry->msg[0], &entry->msg[1],
+						   entry->len - 1);
+	}
+
+	return winfo;
+}
+
+/*
+ * Leader: create the shared memory segment for up to nworkers workers.
+ */
+static void
+pa_setup_segment(int nworkers)
+{
+	MemoryContext oldctx;
+	shm_toc_estimator e;
+	shm_toc    *toc;
+	Size		shared_size;
+	Size		segsize;
+	HASHCTL		ctl;
+	int			i;
+
+	shared_size = add_size(offsetof(ParallelApplyShared, ntxns_done),
+						   mul_size(nworkers, sizeof(uint64)));
+
+	shm_toc_initialize_estimator(&e);
+	shm_toc_estimate_chunk(&e, shared_size);
+	for (i = 0; i < nworkers; i++)
+	{
+		shm_toc_estimate_chunk(&e, PARALLEL_APPLY_QUEUE_SIZE);
+		shm_toc_estimate_chunk(&e, PARALLEL_APPLY_ERROR_QUEUE_SIZE);
+	}
+	shm_toc_estimate_keys(&e, 1 + 2 * nworkers);
+	segsize = shm_toc_estimate(&e);
+
+	oldctx = MemoryContextSwitchTo(ApplyContext);
+
+	pa_seg = dsm_create(segsize, 0);
+	dsm_pin_mapping(pa_seg);
+	toc = shm_toc_create(PARALLEL_APPLY_MAGIC, dsm_segment_address(pa_seg),
+						 segsize);
+
+	pa_shared = shm_toc_allocate(toc, shared_size);
+	SpinLockInit(&pa_shared->mutex);
+	pa_shared->leader_pgprocno = MyProc->pgprocno;
+	pa_shared->committed_order = 0;
+	pa_shared->commit_end = InvalidXLogRecPtr;
+	ConditionVariableInit(&pa_shared->finished_cv);
+	pa_shared->nworkers = nworkers;
+	memset(pa_shared->ntxns_done, 0, nworkers * sizeof(uint64));
+	shm_toc_insert(toc, PARALLEL_APPLY_KEY_SHARED, pa_shared);
+
+	pa_workers = palloc0(nworkers * sizeof(ParallelApplyWorkerInfo));
+	for (i = 0; i < nworkers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = shm_mq_create(shm_toc_allocate(toc, PARALLEL_APPLY_QUEUE_SIZE),
+						   PARALLEL_APPLY_QUEUE_SIZE);
+		shm_toc_insert(toc, PARALLEL_APPLY_KEY_QUEUE(i), mq);
+		shm_mq_set_sender(mq, MyProc);
+		pa_workers[i].mq_handle = shm_mq_attach(mq, pa_seg, NULL);
+
+		mq = shm_mq_create(shm_toc_allocate(toc, PARALLEL_APPLY_ERROR_QUEUE_SIZE),
+						   PARALLEL_APPLY_ERROR_QUEUE_SIZE);
+		shm_toc_insert(toc, PARALLEL_APPLY_KEY_ERROR_QUEUE(i), mq);
+		shm_mq_set_receiver(mq, MyProc);
+		pa_workers[i].error_mq_handle = shm_mq_attach(mq, pa_seg, NULL);
+	}
+	pa_pool_size = nworkers;
+
+	MemoryContextSwitchTo(oldctx);
+
+	ctl.keysize = sizeof(TransactionId);
+	ctl.entrysize = sizeof(ParallelApplyTxn);
+	ctl.hcxt = ApplyContext;
+	pa_txns = hash_create("logical replication parallel apply transactions",
+						  64, &ctl, HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	ctl.keysize = sizeof(uint64);
+	ctl.entrysize = sizeof(ParallelApplyKey);
+	ctl.hcxt = ApplyContext;
+	pa_keys = hash_create("logical replication parallel apply keys",
+						  1024, &ctl, HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+}
+
+/*
+ * Leader: wait until all transactions handed out have committed.
+ */
+static void
+pa_wait_for_all(void)
+{
+	if (pa_seg == NULL)
+		return;
+
+	for (;;)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		pa_check_workers();
+
+		if (pa_get_committed_order() >= pa_last_order)
+			break;
+
+		(void) WaitLatch(MyLatch,
+						 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+						 1000L, WAIT_EVENT_LOGICAL_PARALLEL_APPLY_STATE_CHANGE);
+		ResetLatch(MyLatch);
+	}
+
+	pa_process_commits();
+}
+
+/*
+ * Leader: record the flush positions of the transactions the workers have
+ * committed since the last call.
+ */
+void
+pa_process_commits(void)
+{
+	MemoryContext oldctx = CurrentMemoryContext;
+	uint64		committed_order;
+	XLogRecPtr	commit_end;
+
+	if (pa_seg == NULL)
+		return;
+
+	pa_check_workers();
+
+	SpinLockAcquire(&pa_shared->mutex);
+	committed_order = pa_shared->committed_order;
+	commit_end = pa_shared->commit_end;
+	SpinLockRelease(&pa_shared->mutex);
+
+	while (!dlist_is_empty(&pa_inflight))
+	{
+		ParallelApplyTxn *txn = dlist_head_element(ParallelApplyTxn, node,
+												   &pa_inflight);
+
+		if (txn->order > committed_order)
+			break;
+
+		dlist_pop_head_node(&pa_inflight);
+
+		/*
+		 * The latest commit of any worker is at least as far as this one's,
+		 * and everything before it has committed too.
+		 */
+		store_flush_position(txn->end_lsn, commit_end);
+
+		if (pa_barrier_xid == txn->xid)
+			pa_barrier_xid = InvalidTransactionId;
+		hash_search(pa_txns, &txn->xid, HASH_REMOVE, NULL);
+	}
+
+	MemoryContextSwitchTo(oldctx);
+}
+
+/*
+ * Leader: do the workers have transactions in progress?
+ */
+bool
+pa_has_pending_work(void)
+{
+	int			i;
+
+	if (pa_seg == NULL)
+		return false;
+
+	if (pa_get_committed_order() < pa_last_order)
+		return true;
+
+	for (i = 0; i < pa_nworkers; i++)
+	{
+		if (pa_workers[i].streaming)
+			return true;
+	}
+
+	return false;
+}
+
+static uint64
+pa_get_committed_order(void)
+{
+	uint64		committed_order;
+
+	SpinLockAcquire(&pa_shared->mutex);
+	committed_order = pa_shared->committed_order;
+	SpinLockRelease(&pa_shared->mutex);
+
+	return committed_order;
+}
+
+/*
+ * Leader: rethrow any error reported by a worker, and complain if one has
+ * exited.
+ */
+static void
+pa_check_workers(void)
+{
+	int			i;
+
+	for (i = 0; i < pa_nworkers; i++)
+	{
+		for (;;)
+		{
+			shm_mq_result res;
+			Size		nbytes;
+			void	   *data;
+			StringInfoData msg;
+			char		msgtype;
+
+			res = shm_mq_receive(pa_workers[i].error_mq_handle, &nbytes,
+								 &data, true);
+			if (res == SHM_MQ_WOULD_BLOCK)
+				break;
+
+			if (res != SHM_MQ_SUCCESS)
+			{
+				pa_worker_failed();
+				ereport(ERROR,
+						(errcode(ERRCODE_CONNECTION_FAILURE),
+						 errmsg("logical replication parallel apply worker exited unexpectedly")));
+			}
+
+			initStringInfo(&msg);
+			appendBinaryStringInfo(&msg, data, nbytes);
+			msgtype = pq_getmsgbyte(&msg);
+
+			switch (msgtype)
+			{
+				case 'E':		/* ErrorResponse */
+				case 'N':		/* NoticeResponse */
+					{
+						ErrorData	edata;
+						ErrorContextCallback *save_error_context_stack;
+
+						pq_parse_errornotice(&msg, &edata);
+
+						/* A worker's FATAL is only an ERROR for the leader. */
+						edata.elevel = Min(edata.elevel, ERROR);
+
+						if (edata.context)
+							edata.context = psprintf("%s\n%s", edata.context,
+													 _("logical replication parallel apply worker"));
+						else
+							edata.context = pstrdup(_("logical replication parallel apply worker"));
+
+						if (edata.elevel >= ERROR)
+							pa_worker_failed();
+
+						/* The context of the leader does not apply. */
+						save_error_context_stack = error_context_stack;
+						error_context_stack = NULL;
+						ThrowErrorData(&edata);
+						error_context_stack = save_error_context_stack;
+						break;
+					}
+
+				default:
+					elog(ERROR, "unrecognized message type received from logical replication parallel apply worker: %c (message length %d bytes)",
+						 msgtype, msg.len);
+			}
+
+			pfree(msg.data);
+		}
+	}
+}
+
+/*
+ * Leader: a worker failed; apply what has been received so far serially
+ * after the restart.
+ */
+static void
+pa_worker_failed(void)
+{
+	if (!XLogRecPtrIsInvalid(MyLogicalRepWorker->last_lsn))
+		logicalrep_set_serial_apply_lsn(MySubscription->oid,
+										MyLogicalRepWorker->last_lsn);
+}
+
+/*
+ * Leader: send a message to a worker, waiting for space in the queue.
+ */
+static void
+pa_send(ParallelApplyWorkerInfo *winfo, shm_mq_iovec *iov, int iovcnt)
+{
+	if (shm_mq_sendv(winfo->mq_handle, iov, iovcnt, false) != SHM_MQ_SUCCESS)
+	{
+		/* Report the error of the worker if it sent one. */
+		pa_check_workers();
+		pa_worker_failed();
+		ereport(ERROR,
+				(errcode(ERRCODE_CONNECTION_FAILURE),
+				 errmsg("lost connection to the logical replication parallel apply worker")));
+	}
+}
+
+static void
+pa_send_control(ParallelApplyWorkerInfo *winfo, StringInfo msg)
+{
+	shm_mq_iovec iov;
+
+	iov.data = msg->data;
+	iov.len = msg->len;
+	pa_send(winfo, &iov, 1);
+}
+
+/*
+ * Send a protocol message, given as action and contents without the XID of
+ * streamed transactions.
+ */
+static void
+pa_send_change(ParallelApplyWorkerInfo *winfo, char action,
+			   const char *data, int len)
+{
+	char		msgtype = PA_MSG_CHANGE;
+	shm_mq_iovec iov[3];
+
+	iov[0].data = &msgtype;
+	iov[0].len = 1;
+	iov[1].data = &action;
+	iov[1].len = 1;
+	iov[2].data = data;
+	iov[2].len = len;
+	pa_send(winfo, iov, 3);
+}
+
+/*
+ * Worker: wait for the transactions ordered before ours to commit.
+ */
+void
+pa_wait_for_commit_turn(void)
+{
+	if (pa_order == 0)
+		elog(ERROR, "commit order of remote transaction %u is not known",
+			 pa_xid);
+
+	if (pa_order > 1)
+		pa_wait_for_transaction(pa_prev_xid, pa_order - 1);
+}
+
+/*
+ * Worker: the transaction has committed.
+ */
+void
+pa_transaction_finished(XLogRecPtr commit_end)
+{
+	SpinLockAcquire(&MyParallelShared->mutex);
+	Assert(MyParallelShared->committed_order == pa_order - 1);
+	MyParallelShared->committed_order = pa_order;
+	if (MyParallelShared->commit_end < commit_end)
+		MyParallelShared->commit_end = commit_end;
+	MyParallelShared->ntxns_done[MyLogicalRepWorker->subworker_index]++;
+	SpinLockRelease(&MyParallelShared->mutex);
+
+	pa_finish();
+}
+
+/*
+ * Worker: let the others know the transaction is done, and forget it.
+ */
+static void
+pa_finish(void)
+{
+	UnlockApplyTransactionForSession(MySubscription->oid, pa_xid, 0,
+									 AccessExclusiveLock);
+
+	ConditionVariableBroadcast(&MyParallelShared->finished_cv);
+	SetLatch(&GetPGProcByNumber(MyParallelShared->leader_pgprocno)->procLatch);
+
+	pa_xid = InvalidTransactionId;
+	pa_order = 0;
+	pa_prev_xid = InvalidTransactionId;
+	pa_nsubxacts = 0;
+}
+
+/*
+ * Worker: wait until the transaction with the given commit order has
+ * committed.
+ *
+ * Waiting for the lock the worker applying it holds makes the wait visible
+ * to the deadlock detector.  That worker may not have taken the lock yet,
+ * though, so check the commit order again after getting it.
+ */
+static void
+pa_wait_for_transaction(TransactionId xid, uint64 order)
+{
+	for (;;)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		SpinLockAcquire(&MyParallelShared->mutex);
+		if (MyParallelShared->committed_order >= order)
+		{
+			SpinLockRelease(&MyParallelShared->mutex);
+			break;
+		}
+		SpinLockRelease(&MyParallelShared->mutex);
+
+		LockApplyTransactionForSession(MySubscription->oid, xid, 0,
+									   AccessShareLock);
+		UnlockApplyTransactionForSession(MySubscription->oid, xid, 0,
+										 AccessShareLock);
+
+		SpinLockAcquire(&MyParallelShared->mutex);
+		if (MyParallelShared->committed_order >= order)
+		{
+			SpinLockRelease(&MyParallelShared->mutex);
+			break;
+		}
+		SpinLockRelease(&MyParallelShared->mutex);
+
+		(void) ConditionVariableTimedSleep(&MyParallelShared->finished_cv, 10L,
+										   WAIT_EVENT_LOGICAL_PARALLEL_APPLY_STATE_CHANGE);
+	}
+
+	ConditionVariableCancelSleep();
+}
+
+/*
+ * Worker: the following changes belong to the given subtransaction of a
+ * streamed transaction; start a savepoint for it unless there is one.
+ */
+static void
+pa_start_subxact(TransactionId subxid)
+{
+	char		spname[NAMEDATALEN];
+	int			i;
+
+	for (i = pa_nsubxacts - 1; i >= 0; i--)
+	{
+		if (pa_subxacts[i] == subxid)
+			return;
+	}
+
+	if (!IsTransactionBlock())
+	{
+		if (!IsTransactionState())
+			StartTransactionCommand();
+
+		BeginTransactionBlock();
+		CommitTransactionCommand();
+	}
+
+	snprintf(spname, sizeof(spname), "pg_sp_%u_%u", MySubscription->oid,
+			 subxid);
+	DefineSavepoint(spname);
+	CommitTransactionCommand();
+
+	if (pa_nsubxacts >= pa_nsubxacts_max)
+	{
+		pa_nsubxacts_max = Max(16, 2 * pa_nsubxacts_max);
+		if (pa_subxacts == NULL)
+			pa_subxacts = MemoryContextAlloc(ApplyContext,
+											 pa_nsubxacts_max * sizeof(TransactionId));
+		else
+			pa_subxacts = repalloc(pa_subxacts,
+								   pa_nsubxacts_max * sizeof(TransactionId));
+	}
+	pa_subxacts[pa_nsubxacts++] = subxid;
+}
+
+/*
+ * Worker: abort a streamed transaction, or one of its subtransactions.
+ */
+static void
+pa_abort(TransactionId xid, TransactionId subxid)
+{
+	char		spname[NAMEDATALEN];
+	int			i;
+
+	if (xid == subxid)
+	{
+		AbortOutOfAnyTransaction();
+
+		SpinLockAcquire(&MyParallelShared->mutex);
+		MyParallelShared->ntxns_done[MyLogicalRepWorker->subworker_index]++;
+		SpinLockRelease(&MyParallelShared->mutex);
+
+		pa_finish();
+		pgstat_report_activity(STATE_IDLE, NULL);
+		return;
+	}
+
+	for (i = pa_nsubxacts - 1; i >= 0; i--)
+	{
+		if (pa_subxacts[i] == subxid)
+			break;
+	}
+
+	/* Nothing of the subtransaction has been applied. */
+	if (i < 0)
+		return;
+
+	snprintf(spname, sizeof(spname), "pg_sp_%u_%u", MySubscription->oid,
+			 subxid);
+	RollbackToSavepoint(spname);
+	CommitTransactionCommand();
+
+	pa_nsubxacts = i;
+}
+
+/*
+ * Worker: process a message from the leader.
+ */
+static void
+pa_worker_message(StringInfo s)
+{
+	char		msgtype = pq_getmsgbyte(s);
+
+	switch (msgtype)
+	{
+		case PA_MSG_BEGIN:
+			pa_xid = pq_getmsgint(s, 4);
+			LockApplyTransactionForSession(MySubscription->oid, pa_xid, 0,
+										   AccessExclusiveLock);
+			break;
+
+		case PA_MSG_ORDER:
+			pa_order = pq_getmsgint64(s);
+			pa_prev_xid = pq_getmsgint(s, 4);
+			break;
+
+		case PA_MSG_WAIT:
+			{
+				TransactionId xid = pq_getmsgint(s, 4);
+				uint64		order = pq_getmsgint64(s);
+
+				pa_wait_for_transaction(xid, order);
+				break;
+			}
+
+		case PA_MSG_SUBXACT:
+			pa_start_subxact(pq_getmsgint(s, 4));
+			break;
+
+		case PA_MSG_ABORT:
+			{
+				TransactionId xid = pq_getmsgint(s, 4);
+				TransactionId subxid = pq_getmsgint(s, 4);
+
+				pa_abort(xid, subxid);
+				break;
+			}
+
+		case PA_MSG_CHANGE:
+			apply_dispatch(s);
+			break;
+
+		default:
+			elog(ERROR, "unrecognized message type received from logical replication apply worker: %c (message length %d bytes)",
+				 msgtype, s->len);
+	}
+}
+
+/*
+ * Worker: apply what the leader sends until told to exit.
+ */
+static void
+pa_worker_loop(void)
+{
+	for (;;)
+	{
+		shm_mq_result res;
+		Size		len;
+		void	   *data;
+
+		CHECK_FOR_INTERRUPTS();
+
+		MemoryContextSwitchTo(ApplyMessageContext);
+
+		res = shm_mq_receive(MyMqHandle, &len, &data, true);
+
+		if (res == SHM_MQ_SUCCESS)
+		{
+			StringInfoData s;
+
+			s.data = data;
+			s.len = len;
+			s.cursor = 0;
+			s.maxlen = -1;
+
+			pa_worker_message(&s);
+		}
+		else if (res == SHM_MQ_WOULD_BLOCK)
+		{
+			int			rc;
+
+			rc = WaitLatch(MyLatch,
+						   WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+						   1000L, WAIT_EVENT_LOGICAL_PARALLEL_APPLY_MAIN);
+			if (rc & WL_LATCH_SET)
+				ResetLatch(MyLatch);
+		}
+		else
+			ereport(ERROR,
+					(errcode(ERRCODE_CONNECTION_FAILURE),
+					 errmsg("lost connection to the logical replication apply worker")));
+
+		if (ConfigReloadPending)
+		{
+			ConfigReloadPending = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+
+		MemoryContextReset(ApplyMessageContext);
+	}
+}
+
+/* Logical replication parallel apply worker entry point */
+void
+ParallelApplyWorkerMain(Datum main_arg)
+{
+	int			worker_slot = DatumGetInt32(main_arg);
+	dsm_segment *seg;
+	shm_toc    *toc;
+	shm_mq	   *mq;
+	RepOriginId originid;
+	char		originname[NAMEDATALEN];
+
+	/* Attach to slot */
+	logicalrep_worker_attach(worker_slot);
+
+	/* Setup signal handling */
+	pqsignal(SIGHUP, SignalHandlerForConfigReload);
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	/*
+	 * Attach to the queues first, so that the leader hears about any error
+	 * from here on.
+	 */
+	seg = dsm_attach(MyLogicalRepWorker->subworker_dsm);
+	if (seg == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not map dynamic shared memory segment")));
+	toc = shm_toc_attach(PARALLEL_APPLY_MAGIC, dsm_segment_address(seg));
+	if (toc == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("invalid magic number in dynamic shared memory segment")));
+
+	MyParallelShared = shm_toc_lookup(toc, PARALLEL_APPLY_KEY_SHARED, false);
+
+	mq = shm_toc_lookup(toc,
+						PARALLEL_APPLY_KEY_ERROR_QUEUE(MyLogicalRepWorker->subworker_index),
+						false);
+	shm_mq_set_sender(mq, MyProc);
+	pq_redirect_to_shm_mq(seg, shm_mq_attach(mq, seg, NULL));
+
+	mq = shm_toc_lookup(toc,
+						PARALLEL_APPLY_KEY_QUEUE(MyLogicalRepWorker->subworker_index),
+						false);
+	shm_mq_set_receiver(mq, MyProc);
+	MyMqHandle = shm_mq_attach(mq, seg, NULL);
+
+	InitializeApplyWorker();
+
+	/*
+	 * Use the replication origin of the leader, so that the commits of all
+	 * workers advance it.
+	 */
+	snprintf(originname, sizeof(originname), "pg_%u", MySubscription->oid);
+	StartTransactionCommand();
+	originid = replorigin_by_name(originname, false);
+	replorigin_session_setup(originid, MyLogicalRepWorker->leader_pid);
+	replorigin_session_origin = originid;
+	CommitTransactionCommand();
+
+	ApplyMessageContext = AllocSetContextCreate(ApplyContext,
+												"ApplyMessageContext",
+												ALLOCSET_DEFAULT_SIZES);
+
+	pa_worker_loop();
+
+	proc_exit(0);
+}
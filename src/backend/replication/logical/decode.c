@@ -34,6 +34,8 @@
 #include "access/xlogreader.h"
 #include "access/xlogrecord.h"
 #include "access/xlogutils.h"
+#include "catalog/dependency.h"
+#include "catalog/pg_class.h"
 #include "catalog/pg_control.h"
 #include "replication/decode.h"
 #include "replication/logical.h"
@@ -42,6 +44,9 @@
 #include "replication/reorderbuffer.h"
 #include "replication/snapbuild.h"
 #include "storage/standby.h"
+#include "utils/rel.h"
+#include "utils/relfilenodemap.h"
+#include "utils/snapmgr.h"
 
 typedef struct XLogRecordBuffer
 {
@@ -50,6 +55,13 @@ typedef struct XLogRecordBuffer
 	XLogReaderState *record;
 } XLogRecordBuffer;
 
+/* entry in LogicalDecodingContext->relation_filter_cache */
+typedef struct RelationFilterEntry
+{
+	RelFileNode rnode;			/* hash key */
+	bool		filtered;		/* result of filter_by_relation_cb */
+} RelationFilterEntry;
+
 /* RMGR Handlers */
 static void DecodeXLogOp(LogicalDecodingContext *ctx, XLogRecordBuffer *buf);
 static void DecodeHeapOp(LogicalDecodingContext *ctx, XLogRecordBuffer *buf);
@@ -85,6 +97,10 @@ static inline bool FilterPrepare(LogicalDecodingContext *ctx,
 static bool DecodeTXNNeedSkip(LogicalDecodingContext *ctx,
 							  XLogRecordBuffer *buf, Oid dbId,
 							  RepOriginId origin_id);
+static bool FilterByRelation(LogicalDecodingContext *ctx, TransactionId xid,
+							 RelFileNode *rnode);
+static bool LookupRelationFilter(LogicalDecodingContext *ctx,
+								 TransactionId xid, RelFileNode *rnode);
 
 /*
  * Take every XLogReadRecord()ed record and perform the actions required to
@@ -617,6 +633,142 @@ FilterByOrigin(LogicalDecodingContext *ctx, RepOriginId origin_id)
 	return filter_by_origin_cb_wrapper(ctx, origin_id);
 }
 
+/*
+ * Ask the output plugin whether changes to the relation stored in 'rnode'
+ * are of interest, so that uninteresting changes are never queued in (and
+ * possibly spilled to disk by) the reorderbuffer.
+ *
+ * The relation is looked up with the snapshot builder's current snapshot,
+ * which is the catalog state the change would be replayed with - unless the
+ * transaction changed the catalog itself, so we never filter changes made
+ * by such transactions. The answers are cached until the next commit that
+ * carries invalidations, cf. DecodeCommit().
+ */
+static bool
+FilterByRelation(LogicalDecodingContext *ctx, TransactionId xid,
+				 RelFileNode *rnode)
+{
+	RelationFilterEntry *entry;
+	bool		found;
+
+	if (ctx->callbacks.filter_by_relation_cb == NULL)
+		return false;
+
+	if (SnapBuildCurrentState(ctx->snapshot_builder) != SNAPBUILD_CONSISTENT ||
+		ReorderBufferXactHasCatalogChanges(ctx->reorder, xid))
+		return false;
+
+	/*
+	 * Nor while the transaction has an incomplete change queued, such as
+	 * TOAST chunks waiting for their main table tuple: that change would
+	 * never be completed, and the transaction could no longer be streamed.
+	 * TOAST chunks are filtered along with their owning relation, so this
+	 * only happens if the filter's answer changed in between.
+	 */
+	if (ReorderBufferXactHasPartialChange(ctx->reorder, xid))
+		return false;
+
+	if (ctx->relation_filter_cache == NULL)
+	{
+		HASHCTL		hash_ctl;
+
+		hash_ctl.keysize = sizeof(RelFileNode);
+		hash_ctl.entrysize = sizeof(RelationFilterEntry);
+		hash_ctl.hcxt = ctx->context;
+		ctx->relation_filter_cache =
+			hash_create("logical decoding relation filter cache", 128,
+						&hash_ctl, HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	entry = (RelationFilterEntry *) hash_search(ctx->relation_filter_cache,
+												rnode, HASH_ENTER, &found);
+	if (!found)
+	{
+		entry->filtered = false;
+		entry->filtered = LookupRelationFilter(ctx, xid, rnode);
+	}
+
+	return entry->filtered;
+}
+
+/*
+ * Map 'rnode' to a relation and call the output plugin's filter for it.
+ *
+ * This needs catalog access, so like ReorderBufferProcessTXN() we do it in a
+ * (sub-)transaction that is aborted afterwards.
+ */
+static bool
+LookupRelationFilter(LogicalDecodingContext *ctx, TransactionId xid,
+					 RelFileNode *rnode)
+{
+	MemoryContext oldcontext = CurrentMemoryContext;
+	bool		using_subtxn = IsTransactionOrTransactionBlock();
+	bool		filtered = false;
+	Snapshot	snapshot;
+
+	if (using_subtxn)
+		BeginInternalSubTransaction("filter");
+	else
+		StartTransactionCommand();
+
+	snapshot = SnapBuildGetOrBuildSnapshot(ctx->snapshot_builder, xid);
+	SetupHistoricSnapshot(snapshot, NULL);
+
+	PG_TRY();
+	{
+		Oid			reloid;
+		Relation	relation;
+
+		reloid = RelidByRelfilenode(rnode->spcNode, rnode->relNode);
+		if (OidIsValid(reloid))
+			relation = RelationIdGetRelation(reloid);
+		else
+			relation = NULL;
+
+		/*
+		 * TOAST chunks are only needed to reassemble the changes of their
+		 * owning relation, so filter them the same way.  A TOAST table has
+		 * an internal dependency on its owner, which sequenceIsOwned() finds
+		 * just as well as a sequence's.  If we can't tell, keep the chunks.
+		 */
+		if (RelationIsValid(relation) &&
+			relation->rd_rel->relkind == RELKIND_TOASTVALUE)
+		{
+			Oid			ownerid;
+			int32		ownercol;
+
+			RelationClose(relation);
+			if (sequenceIsOwned(reloid, DEPENDENCY_INTERNAL,
+								&ownerid, &ownercol))
+				relation = RelationIdGetRelation(ownerid);
+			else
+				relation = NULL;
+		}
+
+		if (RelationIsValid(relation))
+		{
+			filtered = filter_by_relation_cb_wrapper(ctx, relation);
+			RelationClose(relation);
+		}
+
+		TeardownHistoricSnapshot(false);
+	}
+	PG_CATCH();
+	{
+		TeardownHistoricSnapshot(true);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	AbortCurrentTransaction();
+	if (using_subtxn)
+		RollbackAndReleaseCurrentSubTransaction();
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return filtered;
+}
+
 /*
  * Handle rmgr LOGICALMSG_ID records for DecodeRecordIntoReorderBuffer().
  */
@@ -701,6 +853,16 @@ DecodeCommit(LogicalDecodingContext *ctx, XLogRecordBuffer *buf,
 		commit_time = parsed->origin_timestamp;
 	}
 
+	/*
+	 * The relation filter results may depend on the catalog state this
+	 * commit changes, so forget them.
+	 */
+	if (parsed->nmsgs > 0 && ctx->relation_filter_cache != NULL)
+	{
+		hash_destroy(ctx->relation_filter_cache);
+		ctx->relation_filter_cache = NULL;
+	}
+
 	/*
 	 * If the COMMIT record has invalidation messages, it could have catalog
 	 * changes. It is possible that we didn't mark this transaction as
@@ -954,6 +1116,14 @@ DecodeInsert(LogicalDecodingContext *ctx, XLogRecordBuffer *buf)
 	if (FilterByOrigin(ctx, XLogRecGetOrigin(r)))
 		return;
 
+	/*
+	 * Nor for this relation. Speculative insertions are always queued, their
+	 * confirmation or abort must find them.
+	 */
+	if (!(xlrec->flags & XLH_INSERT_IS_SPECULATIVE) &&
+		FilterByRelation(ctx, XLogRecGetXid(r), &target_node))
+		return;
+
 	change = ReorderBufferGetChange(ctx->reorder);
 	if (!(xlrec->flags & XLH_INSERT_IS_SPECULATIVE))
 		change->action = REORDER_BUFFER_CHANGE_INSERT;
@@ -1004,6 +1174,10 @@ DecodeUpdate(LogicalDecodingContext *ctx, XLogRecordBuffer *buf)
 	if (FilterByOrigin(ctx, XLogRecGetOrigin(r)))
 		return;
 
+	/* nor for this relation */
+	if (FilterByRelation(ctx, XLogRecGetXid(r), &target_node))
+		return;
+
 	change = ReorderBufferGetChange(ctx->reorder);
 	change->action = REORDER_BUFFER_CHANGE_UPDATE;
 	change->origin_id = XLogRecGetOrigin(r);
@@ -1070,6 +1244,11 @@ DecodeDelete(LogicalDecodingContext *ctx, XLogRecordBuffer *buf)
 	if (FilterByOrigin(ctx, XLogRecGetOrigin(r)))
 		return;
 
+	/* nor for this relation, unless this aborts a speculative insertion */
+	if (!(xlrec->flags & XLH_DELETE_IS_SUPER) &&
+		FilterByRelation(ctx, XLogRecGetXid(r), &target_node))
+		return;
+
 	change = ReorderBufferGetChange(ctx->reorder);
 
 	if (xlrec->flags & XLH_DELETE_IS_SUPER)
@@ -1172,6 +1351,10 @@ DecodeMultiInsert(LogicalDecodingContext *ctx, XLogRecordBuffer *buf)
 	if (FilterByOrigin(ctx, XLogRecGetOrigin(r)))
 		return;
 
+	/* nor for this relation */
+	if (FilterByRelation(ctx, XLogRecGetXid(r), &rnode))
+		return;
+
 	/*
 	 * We know that this multi_insert isn't for a catalog, so the block should
 	 * always have data even if a full-page write of it is taken.
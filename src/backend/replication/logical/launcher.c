@@ -53,6 +53,7 @@
 
 int			max_logical_replication_workers = 4;
 int			max_sync_workers_per_subscription = 2;
+int			max_parallel_apply_workers_per_subscription = 0;
 
 LogicalRepWorker *MyLogicalRepWorker = NULL;
 
@@ -67,11 +68,26 @@ typedef struct LogicalRepCtxStruct
 
 LogicalRepCtxStruct *LogicalRepCtx;
 
+/*
+ * When a parallel apply worker fails, the apply worker records how far it had
+ * received changes before it exits.  Its successor applies the transactions
+ * up to that point by itself, see applyparallelworker.c.  There is at most
+ * one entry per subscription, protected by LogicalRepWorkerLock.
+ */
+typedef struct SerialApplyEntry
+{
+	Oid			subid;
+	XLogRecPtr	lsn;
+} SerialApplyEntry;
+
+static SerialApplyEntry *SerialApplyEntries;
+
 static void ApplyLauncherWakeup(void);
 static void logicalrep_launcher_onexit(int code, Datum arg);
 static void logicalrep_worker_onexit(int code, Datum arg);
 static void logicalrep_worker_detach(void);
 static void logicalrep_worker_cleanup(LogicalRepWorker *worker);
+static void logicalrep_worker_stop_internal(LogicalRepWorker *worker);
 
 static bool on_commit_launcher_wakeup = false;
 
@@ -152,14 +168,17 @@ get_subscription_list(void)
  *
  * This is only needed for cleaning up the shared memory in case the worker
  * fails to attach.
+ *
+ * Returns whether the attach was successful.
  */
-static void
+static bool
 WaitForReplicationWorkerAttach(LogicalRepWorker *worker,
 							   uint16 generation,
 							   BackgroundWorkerHandle *handle)
 {
 	BgwHandleStatus status;
 	int			rc;
+	bool		result;
 
 	for (;;)
 	{
@@ -172,8 +191,9 @@ WaitForReplicationWorkerAttach(LogicalRepWorker *worker,
 		/* Worker either died or has started; no need to do anything. */
 		if (!worker->in_use || worker->proc)
 		{
+			result = worker->in_use;
 			LWLockRelease(LogicalRepWorkerLock);
-			return;
+			return result;
 		}
 
 		LWLockRelease(LogicalRepWorkerLock);
@@ -188,7 +208,7 @@ WaitForReplicationWorkerAttach(LogicalRepWorker *worker,
 			if (generation == worker->generation)
 				logicalrep_worker_cleanup(worker);
 			LWLockRelease(LogicalRepWorkerLock);
-			return;
+			return false;
 		}
 
 		/*
@@ -210,6 +230,9 @@ WaitForReplicationWorkerAttach(LogicalRepWorker *worker,
 /*
  * Walks the workers array and searches for one that matches given
  * subscription id and relid.
+ *
+ * Parallel apply workers are never returned; with an invalid relid this finds
+ * the apply worker of the subscription.
  */
 LogicalRepWorker *
 logicalrep_worker_find(Oid subid, Oid relid, bool only_running)
@@ -224,6 +247,9 @@ logicalrep_worker_find(Oid subid, Oid relid, bool only_running)
 	{
 		LogicalRepWorker *w = &LogicalRepCtx->workers[i];
 
+		if (isParallelApplyWorker(w))
+			continue;
+
 		if (w->in_use && w->subid == subid && w->relid == relid &&
 			(!only_running || w->proc))
 		{
@@ -261,10 +287,16 @@ logicalrep_workers_find(Oid subid, bool only_running)
 
 /*
  * Start new apply background worker, if possible.
+ *
+ * A valid subworker_dsm starts a parallel apply worker for the calling apply
+ * worker, using slot subworker_index of that shared memory segment.
+ *
+ * Returns true if the worker was started and attached to its slot.
  */
-void
+bool
 logicalrep_worker_launch(Oid dbid, Oid subid, const char *subname, Oid userid,
-						 Oid relid)
+						 Oid relid, dsm_handle subworker_dsm,
+						 int subworker_index)
 {
 	BackgroundWorker bgw;
 	BackgroundWorkerHandle *bgw_handle;
@@ -274,6 +306,10 @@ logicalrep_worker_launch(Oid dbid, Oid subid, const char *subname, Oid userid,
 	LogicalRepWorker *worker = NULL;
 	int			nsyncworkers;
 	TimestampTz now;
+	bool		is_parallel_apply_worker = (subworker_dsm != DSM_HANDLE_INVALID);
+
+	/* Sanity check - tablesync worker cannot be a subworker */
+	Assert(!(is_parallel_apply_worker && OidIsValid(relid)));
 
 	ereport(DEBUG1,
 			(errmsg_internal("starting logical replication worker for subscription \"%s\"",
@@ -351,7 +387,7 @@ retry:
 	if (OidIsValid(relid) && nsyncworkers >= max_sync_workers_per_subscription)
 	{
 		LWLockRelease(LogicalRepWorkerLock);
-		return;
+		return false;
 	}
 
 	/*
@@ -365,7 +401,7 @@ retry:
 				(errcode(ERRCODE_CONFIGURATION_LIMIT_EXCEEDED),
 				 errmsg("out of logical replication worker slots"),
 				 errhint("You might need to increase max_logical_replication_workers.")));
-		return;
+		return false;
 	}
 
 	/* Prepare the worker slot. */
@@ -379,6 +415,9 @@ retry:
 	worker->relid = relid;
 	worker->relstate = SUBREL_STATE_UNKNOWN;
 	worker->relstate_lsn = InvalidXLogRecPtr;
+	worker->leader_pid = is_parallel_apply_worker ? MyProcPid : 0;
+	worker->subworker_dsm = subworker_dsm;
+	worker->subworker_index = subworker_index;
 	worker->last_lsn = InvalidXLogRecPtr;
 	TIMESTAMP_NOBEGIN(worker->last_send_time);
 	TIMESTAMP_NOBEGIN(worker->last_recv_time);
@@ -396,14 +435,25 @@ retry:
 		BGWORKER_BACKEND_DATABASE_CONNECTION;
 	bgw.bgw_start_time = BgWorkerStart_RecoveryFinished;
 	snprintf(bgw.bgw_library_name, BGW_MAXLEN, "postgres");
-	snprintf(bgw.bgw_function_name, BGW_MAXLEN, "ApplyWorkerMain");
+	if (is_parallel_apply_worker)
+		snprintf(bgw.bgw_function_name, BGW_MAXLEN, "ParallelApplyWorkerMain");
+	else
+		snprintf(bgw.bgw_function_name, BGW_MAXLEN, "ApplyWorkerMain");
+
 	if (OidIsValid(relid))
 		snprintf(bgw.bgw_name, BGW_MAXLEN,
 				 "logical replication worker for subscription %u sync %u", subid, relid);
+	else if (is_parallel_apply_worker)
+		snprintf(bgw.bgw_name, BGW_MAXLEN,
+				 "logical replication parallel apply worker for subscription %u", subid);
 	else
 		snprintf(bgw.bgw_name, BGW_MAXLEN,
 				 "logical replication worker for subscription %u", subid);
-	snprintf(bgw.bgw_type, BGW_MAXLEN, "logical replication worker");
+
+	if (is_parallel_apply_worker)
+		snprintf(bgw.bgw_type, BGW_MAXLEN, "logical replication parallel worker");
+	else
+		snprintf(bgw.bgw_type, BGW_MAXLEN, "logical replication worker");
 
 	bgw.bgw_restart_time = BGW_NEVER_RESTART;
 	bgw.bgw_notify_pid = MyProcPid;
@@ -421,33 +471,26 @@ retry:
 				(errcode(ERRCODE_CONFIGURATION_LIMIT_EXCEEDED),
 				 errmsg("out of background worker slots"),
 				 errhint("You might need to increase max_worker_processes.")));
-		return;
+		return false;
 	}
 
 	/* Now wait until it attaches. */
-	WaitForReplicationWorkerAttach(worker, generation, bgw_handle);
+	return WaitForReplicationWorkerAttach(worker, generation, bgw_handle);
 }
 
 /*
- * Stop the logical replication worker for subid/relid, if any, and wait until
- * it detaches from the slot.
+ * Stop the given logical replication worker and wait until it detaches from
+ * the slot.
+ *
+ * The caller must hold LogicalRepWorkerLock in shared mode; it is still held
+ * on return, although it is released while waiting.
  */
-void
-logicalrep_worker_stop(Oid subid, Oid relid)
+static void
+logicalrep_worker_stop_internal(LogicalRepWorker *worker)
 {
-	LogicalRepWorker *worker;
 	uint16		generation;
 
-	LWLockAcquire(LogicalRepWorkerLock, LW_SHARED);
-
-	worker = logicalrep_worker_find(subid, relid, false);
-
-	/* No worker, nothing to do. */
-	if (!worker)
-	{
-		LWLockRelease(LogicalRepWorkerLock);
-		return;
-	}
+	Assert(LWLockHeldByMeInMode(LogicalRepWorkerLock, LW_SHARED));
 
 	/*
 	 * Remember which generation was our worker so we can check if what we see
@@ -485,10 +528,7 @@ logicalrep_worker_stop(Oid subid, Oid relid)
 		 * different, meaning that a different worker has taken the slot.
 		 */
 		if (!worker->in_use || worker->generation != generation)
-		{
-			LWLockRelease(LogicalRepWorkerLock);
 			return;
-		}
 
 		/* Worker has assigned proc, so it has started. */
 		if (worker->proc)
@@ -522,6 +562,23 @@ logicalrep_worker_stop(Oid subid, Oid relid)
 
 		LWLockAcquire(LogicalRepWorkerLock, LW_SHARED);
 	}
+}
+
+/*
+ * Stop the logical replication worker for subid/relid, if any, and wait until
+ * it detaches from the slot.
+ */
+void
+logicalrep_worker_stop(Oid subid, Oid relid)
+{
+	LogicalRepWorker *worker;
+
+	LWLockAcquire(LogicalRepWorkerLock, LW_SHARED);
+
+	worker = logicalrep_worker_find(subid, relid, false);
+
+	if (worker)
+		logicalrep_worker_stop_internal(worker);
 
 	LWLockRelease(LogicalRepWorkerLock);
 }
@@ -599,6 +656,29 @@ logicalrep_worker_attach(int slot)
 static void
 logicalrep_worker_detach(void)
 {
+	/*
+	 * Stop the parallel apply workers of an apply worker.  They must not go
+	 * on committing transactions once our successor has determined where to
+	 * restart streaming from.
+	 */
+	if (!am_tablesync_worker() && !am_parallel_apply_worker())
+	{
+		int			i;
+
+		LWLockAcquire(LogicalRepWorkerLock, LW_SHARED);
+
+		for (i = 0; i < max_logical_replication_workers; i++)
+		{
+			LogicalRepWorker *w = &LogicalRepCtx->workers[i];
+
+			if (w->in_use && isParallelApplyWorker(w) &&
+				w->leader_pid == MyProcPid)
+				logicalrep_worker_stop_internal(w);
+		}
+
+		LWLockRelease(LogicalRepWorkerLock);
+	}
+
 	/* Block concurrent access. */
 	LWLockAcquire(LogicalRepWorkerLock, LW_EXCLUSIVE);
 
@@ -621,6 +701,9 @@ logicalrep_worker_cleanup(LogicalRepWorker *worker)
 	worker->userid = InvalidOid;
 	worker->subid = InvalidOid;
 	worker->relid = InvalidOid;
+	worker->leader_pid = 0;
+	worker->subworker_dsm = DSM_HANDLE_INVALID;
+	worker->subworker_index = -1;
 }
 
 /*
@@ -675,6 +758,80 @@ logicalrep_sync_worker_count(Oid subid)
 	return res;
 }
 
+/*
+ * Return the LSN up to which the apply worker of the subscription must apply
+ * transactions by itself, or InvalidXLogRecPtr if there is no such limit.
+ */
+XLogRecPtr
+logicalrep_get_serial_apply_lsn(Oid subid)
+{
+	XLogRecPtr	lsn = InvalidXLogRecPtr;
+	int			i;
+
+	LWLockAcquire(LogicalRepWorkerLock, LW_SHARED);
+
+	for (i = 0; i < max_logical_replication_workers; i++)
+	{
+		if (SerialApplyEntries[i].subid == subid)
+		{
+			lsn = SerialApplyEntries[i].lsn;
+			break;
+		}
+	}
+
+	LWLockRelease(LogicalRepWorkerLock);
+
+	return lsn;
+}
+
+/*
+ * Set the LSN up to which the apply worker of the subscription must apply
+ * transactions by itself.  InvalidXLogRecPtr removes the limit.
+ */
+void
+logicalrep_set_serial_apply_lsn(Oid subid, XLogRecPtr lsn)
+{
+	int			i;
+	int			slot = -1;
+
+	LWLockAcquire(LogicalRepWorkerLock, LW_EXCLUSIVE);
+
+	for (i = 0; i < max_logical_replication_workers; i++)
+	{
+		if (SerialApplyEntries[i].subid == subid)
+		{
+			slot = i;
+			break;
+		}
+		if (slot < 0 && !OidIsValid(SerialApplyEntries[i].subid))
+			slot = i;
+	}
+
+	/*
+	 * Entries of dropped subscriptions are not removed eagerly, so we may
+	 * have to reuse one of those.  Any entry will do: losing it only means
+	 * that another subscription retries parallel apply sooner.
+	 */
+	if (slot < 0 && max_logical_replication_workers > 0)
+		slot = subid % max_logical_replication_workers;
+
+	if (slot >= 0)
+	{
+		if (XLogRecPtrIsInvalid(lsn))
+		{
+			if (SerialApplyEntries[slot].subid == subid)
+				SerialApplyEntries[slot].subid = InvalidOid;
+		}
+		else
+		{
+			SerialApplyEntries[slot].subid = subid;
+			SerialApplyEntries[slot].lsn = lsn;
+		}
+	}
+
+	LWLockRelease(LogicalRepWorkerLock);
+}
+
 /*
  * ApplyLauncherShmemSize
  *		Compute space needed for replication launcher shared memory
@@ -691,6 +848,8 @@ ApplyLauncherShmemSize(void)
 	size = MAXALIGN(size);
 	size = add_size(size, mul_size(max_logical_replication_workers,
 								   sizeof(LogicalRepWorker)));
+	size = add_size(size, mul_size(max_logical_replication_workers,
+								   sizeof(SerialApplyEntry)));
 	return size;
 }
 
@@ -736,6 +895,9 @@ ApplyLauncherShmemInit(void)
 		ShmemInitStruct("Logical Replication Launcher Data",
 						ApplyLauncherShmemSize(),
 						&found);
+	SerialApplyEntries = (SerialApplyEntry *)
+		((char *) LogicalRepCtx + MAXALIGN(sizeof(LogicalRepCtxStruct)) +
+		 mul_size(max_logical_replication_workers, sizeof(LogicalRepWorker)));
 
 	if (!found)
 	{
@@ -864,7 +1026,8 @@ ApplyLauncherMain(Datum main_arg)
 					wait_time = wal_retrieve_retry_interval;
 
 					logicalrep_worker_launch(sub->dbid, sub->oid, sub->name,
-											 sub->owner, InvalidOid);
+											 sub->owner, InvalidOid,
+											 DSM_HANDLE_INVALID, -1);
 				}
 			}
 
@@ -970,6 +1133,10 @@ pg_stat_get_subscription(PG_FUNCTION_ARGS)
 		if (!worker.proc || !IsBackendPid(worker.proc->pid))
 			continue;
 
+		/* Parallel apply workers report progress through their leader. */
+		if (isParallelApplyWorker(&worker))
+			continue;
+
 		if (OidIsValid(subid) && worker.subid != subid)
 			continue;
 
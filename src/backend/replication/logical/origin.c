@@ -1063,9 +1063,14 @@ ReplicationOriginExitCleanup(int code, Datum arg)
  * Obviously only one such cached origin can exist per process and the current
  * cached value can only be set again after the previous value is torn down
  * with replorigin_session_reset().
+ *
+ * Normally only one process can use an origin at a time.  A logical
+ * replication parallel apply worker passes the PID of its leader apply worker
+ * as acquired_by to share the origin the leader has already acquired; the
+ * leader keeps ownership and remains responsible for releasing it.
  */
 void
-replorigin_session_setup(RepOriginId node)
+replorigin_session_setup(RepOriginId node, int acquired_by)
 {
 	static bool registered_cleanup;
 	int			i;
@@ -1107,12 +1112,18 @@ replorigin_session_setup(RepOriginId node)
 		if (curstate->roident != node)
 			continue;
 
-		else if (curstate->acquired_by != 0)
+		else if (curstate->acquired_by != acquired_by)
 		{
-			ereport(ERROR,
-					(errcode(ERRCODE_OBJECT_IN_USE),
-					 errmsg("replication origin with OID %d is already active for PID %d",
-							curstate->roident, curstate->acquired_by)));
+			if (acquired_by == 0)
+				ereport(ERROR,
+						(errcode(ERRCODE_OBJECT_IN_USE),
+						 errmsg("replication origin with OID %d is already active for PID %d",
+								curstate->roident, curstate->acquired_by)));
+			else
+				ereport(ERROR,
+						(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+						 errmsg("could not find replication state slot for replication origin with OID %u which was acquired by %d",
+								node, acquired_by)));
 		}
 
 		/* ok, found slot */
@@ -1120,7 +1131,12 @@ replorigin_session_setup(RepOriginId node)
 	}
 
 
-	if (session_replication_state == NULL && free_slot == -1)
+	if (session_replication_state == NULL && acquired_by != 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not find replication state slot for replication origin with OID %u which was acquired by %d",
+						node, acquired_by)));
+	else if (session_replication_state == NULL && free_slot == -1)
 		ereport(ERROR,
 				(errcode(ERRCODE_CONFIGURATION_LIMIT_EXCEEDED),
 				 errmsg("could not find free replication state slot for replication origin with OID %u",
@@ -1138,7 +1154,8 @@ replorigin_session_setup(RepOriginId node)
 
 	Assert(session_replication_state->roident != InvalidRepOriginId);
 
-	session_replication_state->acquired_by = MyProcPid;
+	if (acquired_by == 0)
+		session_replication_state->acquired_by = MyProcPid;
 
 	LWLockRelease(ReplicationOriginLock);
 
@@ -1318,7 +1335,7 @@ pg_replication_origin_session_setup(PG_FUNCTION_ARGS)
 
 	name = text_to_cstring((text *) DatumGetPointer(PG_GETARG_DATUM(0)));
 	origin = replorigin_by_name(name, false);
-	replorigin_session_setup(origin);
+	replorigin_session_setup(origin, 0);
 
 	replorigin_session_origin = origin;
 
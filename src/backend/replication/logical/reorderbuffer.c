@@ -67,6 +67,12 @@
  *	  allocator, evicting the oldest changes would make it more likely the
  *	  memory gets actually freed.
  *
+ *	  Changes are spilled in blocks of up to REORDER_BUFFER_SPILL_BLOCK_SIZE
+ *	  bytes, each written and read back with a single system call, and
+ *	  optionally compressed as a whole (logical_decoding_spill_compression).
+ *	  Within a block, changes start at MAXALIGN'd offsets, so they can be
+ *	  restored straight from the block once it is in memory.
+ *
  *	  We still rely on max_changes_in_memory when loading serialized changes
  *	  back into memory. At that point we can't use the memory limit directly
  *	  as we load the subxacts independently. One option to deal with this
@@ -83,6 +89,12 @@
 
 #include <unistd.h>
 #include <sys/stat.h>
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
 
 #include "access/detoast.h"
 #include "access/heapam.h"
@@ -91,6 +103,7 @@
 #include "access/xact.h"
 #include "access/xlog_internal.h"
 #include "catalog/catalog.h"
+#include "common/pg_lzcompress.h"
 #include "lib/binaryheap.h"
 #include "miscadmin.h"
 #include "pgstat.h"
@@ -178,6 +191,23 @@ typedef struct ReorderBufferDiskChange
 	/* data follows */
 } ReorderBufferDiskChange;
 
+/*
+ * Spill files are a sequence of blocks, each holding the MAXALIGN'd
+ * ReorderBufferDiskChanges of a number of changes.
+ */
+typedef struct ReorderBufferDiskBlock
+{
+	uint32		size;			/* bytes stored after this header */
+	uint32		rawsize;		/* bytes of changes in the block */
+	uint32		compression;	/* ReorderBufferSpillCompression */
+} ReorderBufferDiskBlock;
+
+/*
+ * Size at which a block of spilled changes is written out.  A change larger
+ * than that gets a block of its own.
+ */
+#define REORDER_BUFFER_SPILL_BLOCK_SIZE (256 * 1024)
+
 #define IsSpecInsert(action) \
 ( \
 	((action) == REORDER_BUFFER_CHANGE_INTERNAL_SPEC_INSERT) \
@@ -209,6 +239,8 @@ typedef struct ReorderBufferDiskChange
 int			logical_decoding_work_mem;
 static const Size max_changes_in_memory = 4096; /* XXX for restore only */
 
+int			logical_decoding_spill_compression = REORDER_BUFFER_SPILL_COMPRESSION_OFF;
+
 /* ---------------------------------------
  * primary reorderbuffer support routines
  * ---------------------------------------
@@ -245,10 +277,14 @@ static void ReorderBufferExecuteInvalidations(uint32 nmsgs, SharedInvalidationMe
  */
 static void ReorderBufferCheckMemoryLimit(ReorderBuffer *rb);
 static void ReorderBufferSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn);
+static void ReorderBufferSpillFlush(ReorderBuffer *rb, ReorderBufferTXN *txn,
+								   int fd);
 static void ReorderBufferSerializeChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
 										 int fd, ReorderBufferChange *change);
 static Size ReorderBufferRestoreChanges(ReorderBuffer *rb, ReorderBufferTXN *txn,
 										TXNEntryFile *file, XLogSegNo *segno);
+static void ReorderBufferDecompressBlock(ReorderBuffer *rb,
+										 ReorderBufferDiskBlock *block);
 static void ReorderBufferRestoreChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
 									   char *change);
 static void ReorderBufferRestoreCleanup(ReorderBuffer *rb, ReorderBufferTXN *txn);
@@ -344,6 +380,11 @@ ReorderBufferAllocate(void)
 
 	buffer->outbuf = NULL;
 	buffer->outbufsize = 0;
+	buffer->spillbuf = NULL;
+	buffer->spillbufsize = 0;
+	buffer->spillbuflen = 0;
+	buffer->compressbuf = NULL;
+	buffer->compressbufsize = 0;
 	buffer->size = 0;
 
 	buffer->spillTxns = 0;
@@ -3332,6 +3373,47 @@ ReorderBufferXidHasCatalogChanges(ReorderBuffer *rb, TransactionId xid)
 	return rbtxn_has_catalog_changes(txn);
 }
 
+/*
+ * Like ReorderBufferXidHasCatalogChanges, but also consider catalog changes
+ * made by other subtransactions of the same toplevel transaction.
+ */
+bool
+ReorderBufferXactHasCatalogChanges(ReorderBuffer *rb, TransactionId xid)
+{
+	ReorderBufferTXN *txn;
+
+	txn = ReorderBufferTXNByXid(rb, xid, false, NULL, InvalidXLogRecPtr,
+								false);
+	if (txn == NULL)
+		return false;
+
+	if (txn->toptxn != NULL)
+		txn = txn->toptxn;
+
+	return rbtxn_has_catalog_changes(txn);
+}
+
+/*
+ * Does the toplevel transaction of xid have an incomplete change queued, like
+ * TOAST chunks whose main table change hasn't been decoded yet?  This is only
+ * tracked when the transaction can be streamed.
+ */
+bool
+ReorderBufferXactHasPartialChange(ReorderBuffer *rb, TransactionId xid)
+{
+	ReorderBufferTXN *txn;
+
+	txn = ReorderBufferTXNByXid(rb, xid, false, NULL, InvalidXLogRecPtr,
+								false);
+	if (txn == NULL)
+		return false;
+
+	if (txn->toptxn != NULL)
+		txn = txn->toptxn;
+
+	return rbtxn_has_partial_change(txn);
+}
+
 /*
  * ReorderBufferXidHasBaseSnapshot
  *		Have we already set the base snapshot for the given txn/subtxn?
@@ -3557,6 +3639,9 @@ ReorderBufferSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 	elog(DEBUG2, "spill %u changes in XID %u to disk",
 		 (uint32) txn->nentries_mem, txn->xid);
 
+	/* forget any block left behind by an earlier error */
+	rb->spillbuflen = sizeof(ReorderBufferDiskBlock);
+
 	/* do the same to all child TXs */
 	dlist_foreach(subtxn_i, &txn->subtxns)
 	{
@@ -3583,7 +3668,10 @@ ReorderBufferSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 			char		path[MAXPGPATH];
 
 			if (fd != -1)
+			{
+				ReorderBufferSpillFlush(rb, txn, fd);
 				CloseTransientFile(fd);
+			}
 
 			XLByteToSeg(change->lsn, curOpenSegNo, wal_segment_size);
 
@@ -3630,11 +3718,114 @@ ReorderBufferSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 	txn->txn_flags |= RBTXN_IS_SERIALIZED;
 
 	if (fd != -1)
+	{
+		ReorderBufferSpillFlush(rb, txn, fd);
 		CloseTransientFile(fd);
+	}
+}
+
+/*
+ * Write out the block of changes collected in rb->spillbuf, compressing it
+ * if enabled and worthwhile.
+ */
+static void
+ReorderBufferSpillFlush(ReorderBuffer *rb, ReorderBufferTXN *txn, int fd)
+{
+	ReorderBufferDiskBlock *block;
+	Size		rawsize;
+	char	   *buf = rb->spillbuf;
+	int32		len = -1;
+
+	if (rb->spillbuflen <= sizeof(ReorderBufferDiskBlock))
+		return;
+	rawsize = rb->spillbuflen - sizeof(ReorderBufferDiskBlock);
+
+	if (logical_decoding_spill_compression != REORDER_BUFFER_SPILL_COMPRESSION_OFF)
+	{
+		const char *src = rb->spillbuf + sizeof(ReorderBufferDiskBlock);
+		Size		bufsize = sizeof(ReorderBufferDiskBlock) +
+		PGLZ_MAX_OUTPUT(rawsize);
+		char	   *dst;
+
+		if (rb->compressbufsize < bufsize)
+		{
+			if (rb->compressbuf)
+				pfree(rb->compressbuf);
+			rb->compressbuf = MemoryContextAlloc(rb->context, bufsize);
+			rb->compressbufsize = bufsize;
+		}
+		dst = rb->compressbuf + sizeof(ReorderBufferDiskBlock);
+
+		/* only keep the result if it is smaller */
+		switch (logical_decoding_spill_compression)
+		{
+			case REORDER_BUFFER_SPILL_COMPRESSION_PGLZ:
+				len = pglz_compress(src, rawsize, dst, PGLZ_strategy_default);
+				break;
+			case REORDER_BUFFER_SPILL_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+				len = LZ4_compress_default(src, dst, rawsize, rawsize - 1);
+				if (len == 0)
+					len = -1;
+#endif
+				break;
+			case REORDER_BUFFER_SPILL_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+				{
+					size_t		zlen = ZSTD_compress(dst, rawsize - 1, src,
+													 rawsize, 1);
+
+					len = ZSTD_isError(zlen) ? -1 : (int32) zlen;
+				}
+#endif
+				break;
+		}
+
+		if (len >= 0 && len < rawsize)
+			buf = rb->compressbuf;
+		else
+			len = -1;
+	}
+
+	block = (ReorderBufferDiskBlock *) buf;
+	block->rawsize = rawsize;
+	if (len >= 0)
+	{
+		block->size = len;
+		block->compression = logical_decoding_spill_compression;
+	}
+	else
+	{
+		block->size = rawsize;
+		block->compression = REORDER_BUFFER_SPILL_COMPRESSION_OFF;
+	}
+	len = sizeof(ReorderBufferDiskBlock) + block->size;
+
+	errno = 0;
+	pgstat_report_wait_start(WAIT_EVENT_REORDER_BUFFER_WRITE);
+	if (write(fd, buf, len) != len)
+	{
+		int			save_errno = errno;
+
+		CloseTransientFile(fd);
+
+		/* if write didn't set errno, assume problem is no disk space */
+		errno = save_errno ? save_errno : ENOSPC;
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to data file for XID %u: %m",
+						txn->xid)));
+	}
+	pgstat_report_wait_end();
+
+	rb->spillbuflen = sizeof(ReorderBufferDiskBlock);
 }
 
 /*
  * Serialize individual change to disk.
+ *
+ * The change is added to the block in rb->spillbuf, which is written out
+ * once full.
  */
 static void
 ReorderBufferSerializeChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
@@ -3819,22 +4010,29 @@ ReorderBufferSerializeChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
 
 	ondisk->size = sz;
 
-	errno = 0;
-	pgstat_report_wait_start(WAIT_EVENT_REORDER_BUFFER_WRITE);
-	if (write(fd, rb->outbuf, ondisk->size) != ondisk->size)
-	{
-		int			save_errno = errno;
+	/* make room in the block, writing it out first if it is full */
+	if (rb->spillbuflen > sizeof(ReorderBufferDiskBlock) &&
+		rb->spillbuflen + MAXALIGN(sz) > REORDER_BUFFER_SPILL_BLOCK_SIZE)
+		ReorderBufferSpillFlush(rb, txn, fd);
 
-		CloseTransientFile(fd);
+	if (rb->spillbufsize < rb->spillbuflen + MAXALIGN(sz))
+	{
+		Size		newsize = Max(REORDER_BUFFER_SPILL_BLOCK_SIZE,
+								  sizeof(ReorderBufferDiskBlock) + MAXALIGN(sz));
 
-		/* if write didn't set errno, assume problem is no disk space */
-		errno = save_errno ? save_errno : ENOSPC;
-		ereport(ERROR,
-				(errcode_for_file_access(),
-				 errmsg("could not write to data file for XID %u: %m",
-						txn->xid)));
+		if (rb->spillbuf == NULL)
+		{
+			rb->spillbuf = MemoryContextAlloc(rb->context, newsize);
+			rb->spillbuflen = sizeof(ReorderBufferDiskBlock);
+		}
+		else
+			rb->spillbuf = repalloc(rb->spillbuf, newsize);
+		rb->spillbufsize = newsize;
 	}
-	pgstat_report_wait_end();
+
+	memcpy(rb->spillbuf + rb->spillbuflen, rb->outbuf, sz);
+	memset(rb->spillbuf + rb->spillbuflen + sz, 0, MAXALIGN(sz) - sz);
+	rb->spillbuflen += MAXALIGN(sz);
 
 	/*
 	 * Keep the transaction's final_lsn up to date with each change we send to
@@ -4117,7 +4315,10 @@ ReorderBufferRestoreChanges(ReorderBuffer *rb, ReorderBufferTXN *txn,
 	while (restored < max_changes_in_memory && *segno <= last_segno)
 	{
 		int			readBytes;
-		ReorderBufferDiskChange *ondisk;
+		ReorderBufferDiskBlock block;
+		char	   *buf;
+		char	   *data;
+		char	   *end;
 
 		CHECK_FOR_INTERRUPTS();
 
@@ -4157,13 +4358,11 @@ ReorderBufferRestoreChanges(ReorderBuffer *rb, ReorderBufferTXN *txn,
 		}
 
 		/*
-		 * Read the statically sized part of a change which has information
-		 * about the total size. If we couldn't read a record, we're at the
-		 * end of this file.
+		 * Read the header of the next block, which has information about its
+		 * size. If we couldn't read one, we're at the end of this file.
 		 */
-		ReorderBufferSerializeReserve(rb, sizeof(ReorderBufferDiskChange));
-		readBytes = FileRead(file->vfd, rb->outbuf,
-							 sizeof(ReorderBufferDiskChange),
+		readBytes = FileRead(file->vfd, (char *) &block,
+							 sizeof(ReorderBufferDiskBlock),
 							 file->curOffset, WAIT_EVENT_REORDER_BUFFER_READ);
 
 		/* eof */
@@ -4178,51 +4377,109 @@ ReorderBufferRestoreChanges(ReorderBuffer *rb, ReorderBufferTXN *txn,
 			ereport(ERROR,
 					(errcode_for_file_access(),
 					 errmsg("could not read from reorderbuffer spill file: %m")));
-		else if (readBytes != sizeof(ReorderBufferDiskChange))
+		else if (readBytes != sizeof(ReorderBufferDiskBlock))
 			ereport(ERROR,
 					(errcode_for_file_access(),
 					 errmsg("could not read from reorderbuffer spill file: read %d instead of %u bytes",
 							readBytes,
-							(uint32) sizeof(ReorderBufferDiskChange))));
+							(uint32) sizeof(ReorderBufferDiskBlock))));
 
 		file->curOffset += readBytes;
 
-		ondisk = (ReorderBufferDiskChange *) rb->outbuf;
-
-		ReorderBufferSerializeReserve(rb,
-									  sizeof(ReorderBufferDiskChange) + ondisk->size);
-		ondisk = (ReorderBufferDiskChange *) rb->outbuf;
+		/* read the block, into the compression buffer if compressed */
+		ReorderBufferSerializeReserve(rb, block.rawsize);
+		if (block.compression == REORDER_BUFFER_SPILL_COMPRESSION_OFF)
+			buf = rb->outbuf;
+		else
+		{
+			if (rb->compressbufsize < block.size)
+			{
+				if (rb->compressbuf)
+					pfree(rb->compressbuf);
+				rb->compressbuf = MemoryContextAlloc(rb->context, block.size);
+				rb->compressbufsize = block.size;
+			}
+			buf = rb->compressbuf;
+		}
 
-		readBytes = FileRead(file->vfd,
-							 rb->outbuf + sizeof(ReorderBufferDiskChange),
-							 ondisk->size - sizeof(ReorderBufferDiskChange),
-							 file->curOffset,
+		readBytes = FileRead(file->vfd, buf, block.size, file->curOffset,
 							 WAIT_EVENT_REORDER_BUFFER_READ);
 
 		if (readBytes < 0)
 			ereport(ERROR,
 					(errcode_for_file_access(),
 					 errmsg("could not read from reorderbuffer spill file: %m")));
-		else if (readBytes != ondisk->size - sizeof(ReorderBufferDiskChange))
+		else if (readBytes != block.size)
 			ereport(ERROR,
 					(errcode_for_file_access(),
 					 errmsg("could not read from reorderbuffer spill file: read %d instead of %u bytes",
-							readBytes,
-							(uint32) (ondisk->size - sizeof(ReorderBufferDiskChange)))));
+							readBytes, block.size)));
 
 		file->curOffset += readBytes;
 
+		if (block.compression != REORDER_BUFFER_SPILL_COMPRESSION_OFF)
+			ReorderBufferDecompressBlock(rb, &block);
+
 		/*
-		 * ok, read a full change from disk, now restore it into proper
-		 * in-memory format
+		 * ok, read a full block from disk, now restore its changes into
+		 * proper in-memory format.  We always restore a whole block, so we
+		 * may go somewhat over max_changes_in_memory.
 		 */
-		ReorderBufferRestoreChange(rb, txn, rb->outbuf);
-		restored++;
+		data = rb->outbuf;
+		end = rb->outbuf + block.rawsize;
+		while (data < end)
+		{
+			Size		size = ((ReorderBufferDiskChange *) data)->size;
+
+			ReorderBufferRestoreChange(rb, txn, data);
+			data += MAXALIGN(size);
+			restored++;
+		}
 	}
 
 	return restored;
 }
 
+/*
+ * Decompress a block read into rb->compressbuf into rb->outbuf.
+ */
+static void
+ReorderBufferDecompressBlock(ReorderBuffer *rb, ReorderBufferDiskBlock *block)
+{
+	int32		rawsize = -1;
+
+	switch (block->compression)
+	{
+		case REORDER_BUFFER_SPILL_COMPRESSION_PGLZ:
+			rawsize = pglz_decompress(rb->compressbuf, block->size,
+									  rb->outbuf, block->rawsize, true);
+			break;
+		case REORDER_BUFFER_SPILL_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			rawsize = LZ4_decompress_safe(rb->compressbuf, rb->outbuf,
+										  block->size, block->rawsize);
+#endif
+			break;
+		case REORDER_BUFFER_SPILL_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			{
+				size_t		zlen = ZSTD_decompress(rb->outbuf, block->rawsize,
+												   rb->compressbuf,
+												   block->size);
+
+				if (!ZSTD_isError(zlen))
+					rawsize = zlen;
+			}
+#endif
+			break;
+	}
+
+	if (rawsize < 0 || rawsize != block->rawsize)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("compressed reorderbuffer spill data is corrupt")));
+}
+
 /*
  * Convert change from its on-disk format to in-memory format and queue it onto
  * the TXN's ->changes list.
@@ -49,6 +49,13 @@
  * a new way to pass filenames to BufFile APIs so that we are allowed to open
  * the file we desired across multiple stream-open calls for the same
  * transaction.
+ *
+ * PARALLEL APPLY
+ * --------------
+ * With max_parallel_apply_workers_per_subscription set, the apply worker
+ * hands transactions, including streamed ones, to parallel apply workers,
+ * which run the same apply functions on the messages it forwards.  See
+ * applyparallelworker.c.
  *-------------------------------------------------------------------------
  */
 
@@ -161,7 +168,7 @@ typedef struct StreamXidHash
 	SharedFileSet *subxact_fileset; /* shared file set for subxact info */
 } StreamXidHash;
 
-static MemoryContext ApplyMessageContext = NULL;
+MemoryContext ApplyMessageContext = NULL;
 MemoryContext ApplyContext = NULL;
 
 /* per stream context for streaming transactions */
@@ -228,13 +235,8 @@ static void stream_close_file(void);
 
 static void send_feedback(XLogRecPtr recvpos, bool force, bool requestReply);
 
-static void store_flush_position(XLogRecPtr remote_lsn);
-
 static void maybe_reread_subscription(void);
 
-/* prototype needed because of stream_commit */
-static void apply_dispatch(StringInfo s);
-
 static void apply_handle_commit_internal(LogicalRepCommitData *commit_data);
 static void apply_handle_insert_internal(ApplyExecutionData *edata,
 										 ResultRelInfo *relinfo,
@@ -273,6 +275,22 @@ should_apply_changes_for_rel(LogicalRepRelMapEntry *rel)
 {
 	if (am_tablesync_worker())
 		return MyLogicalRepWorker->relid == rel->localreloid;
+	else if (am_parallel_apply_worker())
+	{
+		/*
+		 * The leader only hands out transactions once all tables are READY,
+		 * but a table may have been added since.  Leave it to the leader,
+		 * which will apply the transaction itself after the restart.
+		 */
+		if (rel->state != SUBREL_STATE_READY)
+			ereport(ERROR,
+					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+					 errmsg("logical replication parallel apply worker for subscription \"%s\" will stop",
+							MySubscription->name),
+					 errdetail("Cannot apply changes to tables that are being synchronized in a parallel apply worker.")));
+
+		return true;
+	}
 	else
 		return (rel->state == SUBREL_STATE_READY ||
 				(rel->state == SUBREL_STATE_SYNCDONE &&
@@ -1022,6 +1040,18 @@ apply_handle_stream_commit(StringInfo s)
 
 	elog(DEBUG1, "received commit for streamed transaction %u", xid);
 
+	/*
+	 * A parallel apply worker has applied the changes as they arrived, so
+	 * all that is left to do is to commit them.
+	 */
+	if (am_parallel_apply_worker())
+	{
+		remote_final_lsn = commit_data.commit_lsn;
+		apply_handle_commit_internal(&commit_data);
+		pgstat_report_activity(STATE_IDLE, NULL);
+		return;
+	}
+
 	/* Make sure we have an open transaction */
 	begin_replication_step();
 
@@ -1146,10 +1176,19 @@ apply_handle_stream_commit(StringInfo s)
 
 /*
  * Helper function for apply_handle_commit and apply_handle_stream_commit.
+ *
+ * In a parallel apply worker, the commit waits until the transactions the
+ * leader handed out before this one have committed, and the leader is told
+ * about the commit instead of tracking the flush position here.
  */
 static void
 apply_handle_commit_internal(LogicalRepCommitData *commit_data)
 {
+	XLogRecPtr	commit_end = InvalidXLogRecPtr;
+
+	if (am_parallel_apply_worker())
+		pa_wait_for_commit_turn();
+
 	if (IsTransactionState())
 	{
 		/*
@@ -1159,10 +1198,19 @@ apply_handle_commit_internal(LogicalRepCommitData *commit_data)
 		replorigin_session_origin_lsn = commit_data->end_lsn;
 		replorigin_session_origin_timestamp = commit_data->committime;
 
+		/*
+		 * Streamed transactions applied by a parallel apply worker run in a
+		 * transaction block, for the savepoints of their subtransactions.
+		 */
+		if (IsTransactionBlock())
+			EndTransactionBlock(false);
+
 		CommitTransactionCommand();
 		pgstat_report_stat(false);
 
-		store_flush_position(commit_data->end_lsn);
+		commit_end = XactLastCommitEnd;
+		if (!am_parallel_apply_worker())
+			store_flush_position(commit_data->end_lsn, commit_end);
 	}
 	else
 	{
@@ -1171,6 +1219,9 @@ apply_handle_commit_internal(LogicalRepCommitData *commit_data)
 		maybe_reread_subscription();
 	}
 
+	if (am_parallel_apply_worker())
+		pa_transaction_finished(commit_end);
+
 	in_remote_transaction = false;
 }
 
@@ -2025,7 +2076,7 @@ apply_handle_truncate(StringInfo s)
 /*
  * Logical replication protocol message dispatcher.
  */
-static void
+void
 apply_dispatch(StringInfo s)
 {
 	LogicalRepMsgType action = pq_getmsgbyte(s);
@@ -2157,8 +2208,8 @@ get_flush_position(XLogRecPtr *write, XLogRecPtr *flush,
 /*
  * Store current remote/local lsn pair in the tracking list.
  */
-static void
-store_flush_position(XLogRecPtr remote_lsn)
+void
+store_flush_position(XLogRecPtr remote_lsn, XLogRecPtr local_lsn)
 {
 	FlushPosition *flushpos;
 
@@ -2167,7 +2218,7 @@ store_flush_position(XLogRecPtr remote_lsn)
 
 	/* Track commit lsn  */
 	flushpos = (FlushPosition *) palloc(sizeof(FlushPosition));
-	flushpos->local_end = XactLastCommitEnd;
+	flushpos->local_end = local_lsn;
 	flushpos->remote_end = remote_lsn;
 
 	dlist_push_tail(&lsn_mapping, &flushpos->node);
@@ -2289,7 +2340,8 @@ LogicalRepApplyLoop(XLogRecPtr last_received)
 
 						UpdateWorkerStats(last_received, send_time, false);
 
-						apply_dispatch(&s);
+						if (!pa_dispatch(&s))
+							apply_dispatch(&s);
 					}
 					else if (c == 'k')
 					{
@@ -2329,8 +2381,13 @@ LogicalRepApplyLoop(XLogRecPtr last_received)
 			AcceptInvalidationMessages();
 			maybe_reread_subscription();
 
-			/* Process any table synchronization changes. */
-			process_syncing_tables(last_received);
+			/*
+			 * Process any table synchronization changes.  Not while parallel
+			 * apply workers still have transactions in progress, as tablesync
+			 * workers are told to catch up to last_received.
+			 */
+			if (!pa_has_pending_work())
+				process_syncing_tables(last_received);
 		}
 
 		/* Cleanup the memory. */
@@ -2348,7 +2405,7 @@ LogicalRepApplyLoop(XLogRecPtr last_received)
 		 * no particular urgency about waking up unless we get data or a
 		 * signal.
 		 */
-		if (!dlist_is_empty(&lsn_mapping))
+		if (!dlist_is_empty(&lsn_mapping) || pa_has_pending_work())
 			wait_time = WalWriterDelay;
 		else
 			wait_time = NAPTIME_PER_CYCLE;
@@ -2454,13 +2511,17 @@ send_feedback(XLogRecPtr recvpos, bool force, bool requestReply)
 	if (recvpos < last_recvpos)
 		recvpos = last_recvpos;
 
+	/* Collect the commits of parallel apply workers. */
+	pa_process_commits();
+
 	get_flush_position(&writepos, &flushpos, &have_pending_txes);
 
 	/*
 	 * No outstanding transactions to flush, we can report the latest received
-	 * position. This is important for synchronous replication.
+	 * position. This is important for synchronous replication.  Transactions
+	 * still being applied by parallel apply workers are outstanding too.
 	 */
-	if (!have_pending_txes)
+	if (!have_pending_txes && !pa_has_pending_work())
 		flushpos = writepos = recvpos;
 
 	if (writepos < last_writepos)
@@ -3076,36 +3137,16 @@ cleanup_subxact_info()
 	subxact_data.nsubxacts_max = 0;
 }
 
-/* Logical Replication Apply worker entry point */
+/*
+ * Common initialization for the apply, table synchronization and parallel
+ * apply workers: connect to the database and load the subscription.
+ *
+ * The caller must have attached to its worker slot.
+ */
 void
-ApplyWorkerMain(Datum main_arg)
+InitializeApplyWorker(void)
 {
-	int			worker_slot = DatumGetInt32(main_arg);
 	MemoryContext oldctx;
-	char		originname[NAMEDATALEN];
-	XLogRecPtr	origin_startpos;
-	char	   *myslotname;
-	WalRcvStreamOptions options;
-
-	/* Attach to slot */
-	logicalrep_worker_attach(worker_slot);
-
-	/* Setup signal handling */
-	pqsignal(SIGHUP, SignalHandlerForConfigReload);
-	pqsignal(SIGTERM, die);
-	BackgroundWorkerUnblockSignals();
-
-	/*
-	 * We don't currently need any ResourceOwner in a walreceiver process, but
-	 * if we did, we could call CreateAuxProcessResourceOwner here.
-	 */
-
-	/* Initialise stats to a sanish value */
-	MyLogicalRepWorker->last_send_time = MyLogicalRepWorker->last_recv_time =
-		MyLogicalRepWorker->reply_time = GetCurrentTimestamp();
-
-	/* Load the libpq-specific functions */
-	load_file("libpqwalreceiver", false);
 
 	/* Run as replica session replication role. */
 	SetConfigOption("session_replication_role", "replica",
@@ -3165,12 +3206,49 @@ ApplyWorkerMain(Datum main_arg)
 		ereport(LOG,
 				(errmsg("logical replication table synchronization worker for subscription \"%s\", table \"%s\" has started",
 						MySubscription->name, get_rel_name(MyLogicalRepWorker->relid))));
+	else if (am_parallel_apply_worker())
+		ereport(LOG,
+				(errmsg("logical replication parallel apply worker for subscription \"%s\" has started",
+						MySubscription->name)));
 	else
 		ereport(LOG,
 				(errmsg("logical replication apply worker for subscription \"%s\" has started",
 						MySubscription->name)));
 
 	CommitTransactionCommand();
+}
+
+/* Logical Replication Apply worker entry point */
+void
+ApplyWorkerMain(Datum main_arg)
+{
+	int			worker_slot = DatumGetInt32(main_arg);
+	char		originname[NAMEDATALEN];
+	XLogRecPtr	origin_startpos;
+	char	   *myslotname;
+	WalRcvStreamOptions options;
+
+	/* Attach to slot */
+	logicalrep_worker_attach(worker_slot);
+
+	/* Setup signal handling */
+	pqsignal(SIGHUP, SignalHandlerForConfigReload);
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	/*
+	 * We don't currently need any ResourceOwner in a walreceiver process, but
+	 * if we did, we could call CreateAuxProcessResourceOwner here.
+	 */
+
+	/* Initialise stats to a sanish value */
+	MyLogicalRepWorker->last_send_time = MyLogicalRepWorker->last_recv_time =
+		MyLogicalRepWorker->reply_time = GetCurrentTimestamp();
+
+	/* Load the libpq-specific functions */
+	load_file("libpqwalreceiver", false);
+
+	InitializeApplyWorker();
 
 	/* Connect to the origin and start the replication. */
 	elog(DEBUG1, "connecting to publisher using connection string \"%s\"",
@@ -3213,7 +3291,7 @@ ApplyWorkerMain(Datum main_arg)
 		originid = replorigin_by_name(originname, true);
 		if (!OidIsValid(originid))
 			originid = replorigin_create(originname);
-		replorigin_session_setup(originid);
+		replorigin_session_setup(originid, 0);
 		replorigin_session_origin = originid;
 		origin_startpos = replorigin_session_get_progress(false);
 		CommitTransactionCommand();
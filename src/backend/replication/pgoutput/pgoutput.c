@@ -51,6 +51,8 @@ static void pgoutput_message(LogicalDecodingContext *ctx,
 							 Size sz, const char *message);
 static bool pgoutput_origin_filter(LogicalDecodingContext *ctx,
 								   RepOriginId origin_id);
+static bool pgoutput_relation_filter(LogicalDecodingContext *ctx,
+									 Relation relation);
 static void pgoutput_stream_start(struct LogicalDecodingContext *ctx,
 								  ReorderBufferTXN *txn);
 static void pgoutput_stream_stop(struct LogicalDecodingContext *ctx,
@@ -147,6 +149,7 @@ _PG_output_plugin_init(OutputPluginCallbacks *cb)
 	cb->message_cb = pgoutput_message;
 	cb->commit_cb = pgoutput_commit_txn;
 	cb->filter_by_origin_cb = pgoutput_origin_filter;
+	cb->filter_by_relation_cb = pgoutput_relation_filter;
 	cb->shutdown_cb = pgoutput_shutdown;
 
 	/* transaction streaming */
@@ -783,6 +786,31 @@ pgoutput_origin_filter(LogicalDecodingContext *ctx,
 	return false;
 }
 
+/*
+ * Filter out relations that are not published for insert, update or delete
+ * by any of our publications, so their changes are not even queued.
+ * TRUNCATE isn't affected, it's not decoded per relfilenode.
+ */
+static bool
+pgoutput_relation_filter(LogicalDecodingContext *ctx, Relation relation)
+{
+	PGOutputData *data = (PGOutputData *) ctx->output_plugin_private;
+	RelationSyncEntry *relentry;
+
+	/* not set up when we're only creating the slot */
+	if (RelationSyncCache == NULL)
+		return false;
+
+	if (!is_publishable_relation(relation))
+		return true;
+
+	relentry = get_rel_sync_entry(data, RelationGetRelid(relation));
+
+	return !(relentry->pubactions.pubinsert ||
+			 relentry->pubactions.pubupdate ||
+			 relentry->pubactions.pubdelete);
+}
+
 /*
  * Shutdown the output plugin.
  *
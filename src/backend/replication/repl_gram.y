@@ -86,6 +86,7 @@ Node *replication_parse_result;
 %token K_USE_SNAPSHOT
 %token K_MANIFEST
 %token K_MANIFEST_CHECKSUMS
+%token K_INCREMENTAL
 
 %type <node>	command
 %type <node>	base_backup start_replication start_logical_replication
@@ -223,6 +224,11 @@ base_backup_opt:
 				  $$ = makeDefElem("manifest_checksums",
 								   (Node *)makeString($2), -1);
 				}
+			| K_INCREMENTAL SCONST
+				{
+				  $$ = makeDefElem("incremental",
+								   (Node *)makeString($2), -1);
+				}
 			;
 
 create_replication_slot:
@@ -302,10 +308,10 @@ drop_replication_slot:
 			;
 
 /*
- * START_REPLICATION [SLOT slot] [PHYSICAL] %X/%X [TIMELINE %d]
+ * START_REPLICATION [SLOT slot] [PHYSICAL] %X/%X [TIMELINE %d] [options]
  */
 start_replication:
-			K_START_REPLICATION opt_slot opt_physical RECPTR opt_timeline
+			K_START_REPLICATION opt_slot opt_physical RECPTR opt_timeline plugin_options
 				{
 					StartReplicationCmd *cmd;
 
@@ -314,6 +320,7 @@ start_replication:
 					cmd->slotname = $2;
 					cmd->startpoint = $4;
 					cmd->timeline = $5;
+					cmd->options = $6;
 					$$ = (Node *) cmd;
 				}
 			;
@@ -59,6 +59,7 @@
 #include "catalog/pg_authid.h"
 #include "catalog/pg_type.h"
 #include "common/ip.h"
+#include "common/walstream_compression.h"
 #include "funcapi.h"
 #include "libpq/pqformat.h"
 #include "libpq/pqsignal.h"
@@ -89,6 +90,7 @@
 int			wal_receiver_status_interval;
 int			wal_receiver_timeout;
 bool		hot_standby_feedback;
+char	   *wal_receiver_compression;
 
 /* libpqwalreceiver connection */
 static WalReceiverConn *wrconn = NULL;
@@ -117,6 +119,7 @@ static struct
 
 static StringInfoData reply_message;
 static StringInfoData incoming_message;
+static StringInfoData decompressed_message;
 
 /* Prototypes for private functions */
 static void WalRcvFetchTimeLineHistoryFiles(TimeLineID first, TimeLineID last);
@@ -394,6 +397,8 @@ WalReceiverMain(void)
 		options.startpoint = startpoint;
 		options.slotname = slotname[0] != '\0' ? slotname : NULL;
 		options.proto.physical.startpointTLI = startpointTLI;
+		options.proto.physical.compression =
+			wal_receiver_compression[0] != '\0' ? wal_receiver_compression : NULL;
 		ThisTimeLineID = startpointTLI;
 		if (walrcv_startstreaming(wrconn, &options))
 		{
@@ -411,6 +416,7 @@ WalReceiverMain(void)
 			LogstreamResult.Write = LogstreamResult.Flush = GetXLogReplayRecPtr(NULL);
 			initStringInfo(&reply_message);
 			initStringInfo(&incoming_message);
+			initStringInfo(&decompressed_message);
 
 			/* Initialize the last recv timestamp */
 			last_recv_timestamp = GetCurrentTimestamp();
@@ -848,6 +854,48 @@ XLogWalRcvProcessMsg(unsigned char type, char *buf, Size len)
 				XLogWalRcvWrite(buf, len, dataStart);
 				break;
 			}
+		case 'z':				/* compressed WAL records */
+			{
+				pg_walstream_compression method;
+				int			rawlen;
+
+				/* copy message to StringInfo */
+				hdrlen = sizeof(int64) + sizeof(int64) + sizeof(int64) +
+					sizeof(char) + sizeof(int32);
+				if (len < hdrlen)
+					ereport(ERROR,
+							(errcode(ERRCODE_PROTOCOL_VIOLATION),
+							 errmsg_internal("invalid WAL message received from primary")));
+				appendBinaryStringInfo(&incoming_message, buf, hdrlen);
+
+				/* read the fields */
+				dataStart = pq_getmsgint64(&incoming_message);
+				walEnd = pq_getmsgint64(&incoming_message);
+				sendTime = pq_getmsgint64(&incoming_message);
+				method = (pg_walstream_compression) pq_getmsgbyte(&incoming_message);
+				rawlen = pq_getmsgint(&incoming_message, 4);
+				ProcessWalSndrMessage(walEnd, sendTime);
+
+				if (rawlen <= 0 || rawlen >= MaxAllocSize)
+					ereport(ERROR,
+							(errcode(ERRCODE_PROTOCOL_VIOLATION),
+							 errmsg_internal("invalid WAL message received from primary")));
+
+				buf += hdrlen;
+				len -= hdrlen;
+
+				resetStringInfo(&decompressed_message);
+				enlargeStringInfo(&decompressed_message, rawlen);
+				if (pg_walstream_decompress(method, buf, len,
+											decompressed_message.data,
+											rawlen) != rawlen)
+					ereport(ERROR,
+							(errcode(ERRCODE_PROTOCOL_VIOLATION),
+							 errmsg("could not decompress WAL received from primary with method %d",
+									(int) method)));
+				XLogWalRcvWrite(decompressed_message.data, rawlen, dataStart);
+				break;
+			}
 		case 'k':				/* Keepalive */
 			{
 				/* copy message to StringInfo */
@@ -60,6 +60,7 @@
 #include "catalog/pg_type.h"
 #include "commands/dbcommands.h"
 #include "commands/defrem.h"
+#include "common/walstream_compression.h"
 #include "funcapi.h"
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
@@ -93,6 +94,7 @@
 #include "utils/ps_status.h"
 #include "utils/timeout.h"
 #include "utils/timestamp.h"
+#include "utils/varlena.h"
 
 /*
  * Maximum data payload in a WAL data message.  Must be >= XLOG_BLCKSZ.
@@ -105,6 +107,12 @@
  */
 #define MAX_SEND_SIZE (XLOG_BLCKSZ * 16)
 
+/*
+ * WAL data messages smaller than this are never compressed, the saving would
+ * not be worth the extra work on both sides.
+ */
+#define MIN_COMPRESS_SIZE 1024
+
 /* Array of WalSnds in shared memory */
 WalSndCtlData *WalSndCtl = NULL;
 
@@ -164,6 +172,13 @@ static StringInfoData output_message;
 static StringInfoData reply_message;
 static StringInfoData tmpbuf;
 
+/*
+ * Compression method for WAL data messages negotiated in START_REPLICATION,
+ * and the buffer compressed messages are built in.
+ */
+static pg_walstream_compression sendCompression = WALSTREAM_COMPRESSION_NONE;
+static StringInfoData compressed_message;
+
 /* Timestamp of last ProcessRepliesIfAny(). */
 static TimestampTz last_processing = 0;
 
@@ -234,6 +249,7 @@ static void InitWalSenderSlot(void);
 static void WalSndKill(int code, Datum arg);
 static void WalSndShutdown(void) pg_attribute_noreturn();
 static void XLogSendPhysical(void);
+static bool XLogCompressPhysical(void);
 static void XLogSendLogical(void);
 static void WalSndDone(WalSndSendDataCallback send_data);
 static XLogRecPtr GetStandbyFlushRecPtr(void);
@@ -566,6 +582,71 @@ SendTimeLineHistory(TimeLineHistoryCmd *cmd)
 	pq_endmessage(&buf);
 }
 
+/*
+ * Process options given to physical START_REPLICATION.
+ *
+ * The client lists the methods it can decompress WAL data messages with, in
+ * order of preference, and we use the first one we support ourselves.  Names
+ * we don't know are skipped, so that newer clients can offer methods older
+ * servers don't have.
+ */
+static void
+parseStartReplicationOptions(StartReplicationCmd *cmd)
+{
+	ListCell   *lc;
+	bool		compression_given = false;
+
+	sendCompression = WALSTREAM_COMPRESSION_NONE;
+
+	foreach(lc, cmd->options)
+	{
+		DefElem    *defel = (DefElem *) lfirst(lc);
+
+		if (strcmp(defel->defname, "compression") == 0)
+		{
+			char	   *rawstring;
+			List	   *elemlist;
+			ListCell   *l;
+
+			if (compression_given)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("conflicting or redundant options")));
+			compression_given = true;
+
+			rawstring = pstrdup(defGetString(defel));
+			if (!SplitIdentifierString(rawstring, ',', &elemlist))
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("invalid list syntax in parameter \"%s\"",
+								"compression")));
+
+			foreach(l, elemlist)
+			{
+				pg_walstream_compression method;
+
+				if (pg_walstream_parse_compression((char *) lfirst(l), &method) &&
+					pg_walstream_compression_supported(method))
+				{
+					sendCompression = method;
+					break;
+				}
+			}
+
+			list_free(elemlist);
+			pfree(rawstring);
+		}
+		else
+			ereport(ERROR,
+					(errcode(ERRCODE_SYNTAX_ERROR),
+					 errmsg("unrecognized option \"%s\"", defel->defname)));
+	}
+
+	if (sendCompression != WALSTREAM_COMPRESSION_NONE)
+		elog(DEBUG1, "compressing WAL data messages with %s",
+			 pg_walstream_compression_name(sendCompression));
+}
+
 /*
  * Handle START_REPLICATION command.
  *
@@ -583,6 +664,8 @@ StartReplication(StartReplicationCmd *cmd)
 				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
 				 errmsg("IDENTIFY_SYSTEM has not been run before START_REPLICATION")));
 
+	parseStartReplicationOptions(cmd);
+
 	/* create xlogreader for physical replication */
 	xlogreader =
 		XLogReaderAllocate(wal_segment_size, NULL,
@@ -2616,6 +2699,7 @@ XLogSendPhysical(void)
 	Size		nbytes;
 	XLogSegNo	segno;
 	WALReadError errinfo;
+	StringInfo	msg;
 
 	/* If requested switch the WAL sender to the stopping state. */
 	if (got_STOPPING)
@@ -2876,15 +2960,28 @@ retry:
 	output_message.len += nbytes;
 	output_message.data[output_message.len] = '\0';
 
+	/*
+	 * Compress the slice if the client asked for that.  A slice that brings a
+	 * synchronous standby up to date may carry a commit record a backend is
+	 * waiting for, so it goes out as is; compression is meant for the bulk of
+	 * the data sent while catching up.
+	 */
+	msg = &output_message;
+	if (sendCompression != WALSTREAM_COMPRESSION_NONE &&
+		nbytes >= MIN_COMPRESS_SIZE &&
+		!(WalSndCaughtUp && MyWalSnd->sync_standby_priority > 0) &&
+		XLogCompressPhysical())
+		msg = &compressed_message;
+
 	/*
 	 * Fill the send timestamp last, so that it is taken as late as possible.
 	 */
 	resetStringInfo(&tmpbuf);
 	pq_sendint64(&tmpbuf, GetCurrentTimestamp());
-	memcpy(&output_message.data[1 + sizeof(int64) + sizeof(int64)],
+	memcpy(&msg->data[1 + sizeof(int64) + sizeof(int64)],
 		   tmpbuf.data, sizeof(int64));
 
-	pq_putmessage_noblock('d', output_message.data, output_message.len);
+	pq_putmessage_noblock('d', msg->data, msg->len);
 
 	sentPtr = endptr;
 
@@ -2908,6 +3005,47 @@ retry:
 	}
 }
 
+/*
+ * Build a compressed WAL data message from the one in output_message.
+ *
+ * The compressed message has the same header as the plain one, followed by
+ * the compression method and the uncompressed size of the WAL.  Returns false
+ * if the WAL didn't compress, in which case the plain message should be sent.
+ */
+static bool
+XLogCompressPhysical(void)
+{
+	int			hdrlen = 1 + sizeof(int64) + sizeof(int64) + sizeof(int64);
+	int			rawlen = output_message.len - hdrlen;
+	int			complen;
+
+	if (compressed_message.data)
+		resetStringInfo(&compressed_message);
+	else
+		initStringInfo(&compressed_message);
+
+	enlargeStringInfo(&compressed_message,
+					  hdrlen + sizeof(uint8) + sizeof(int32) +
+					  PG_WALSTREAM_COMPRESS_BOUND(rawlen));
+
+	/* same header, except for the message type */
+	appendBinaryStringInfo(&compressed_message, output_message.data, hdrlen);
+	compressed_message.data[0] = 'z';
+	pq_sendbyte(&compressed_message, (uint8) sendCompression);
+	pq_sendint32(&compressed_message, rawlen);
+
+	complen = pg_walstream_compress(sendCompression,
+									&output_message.data[hdrlen], rawlen,
+									&compressed_message.data[compressed_message.len]);
+	if (complen < 0)
+		return false;
+
+	compressed_message.len += complen;
+	compressed_message.data[compressed_message.len] = '\0';
+
+	return true;
+}
+
 /*
  * Stream out logically decoded data.
  */
@@ -9,6 +9,11 @@
  * in most cases the caller needs to adjust the buffer header contents
  * before the lock is released (see notes in README).
  *
+ * The one exception is BufTableLookupOptimistic, which probes a lossy,
+ * set-associative lookup cache without taking any lock at all.  Its result
+ * is only a hint: the caller must pin the buffer and then re-check the
+ * buffer's tag before trusting it.
+ *
  *
  * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -21,6 +26,8 @@
  */
 #include "postgres.h"
 
+#include "port/atomics.h"
+#include "port/pg_bitutils.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
 
@@ -33,6 +40,56 @@ typedef struct
 
 static HTAB *SharedBufHash;
 
+/*
+ * Lock-free lookup cache.
+ *
+ * This is a set-associative array of (tag, buffer ID) pairs, maintained
+ * alongside the hash table by BufTableInsert and BufTableDelete.  The number
+ * of buckets is a power of 2 no smaller than NUM_BUFFER_PARTITIONS, so all
+ * the tags that can land in a given bucket belong to the same buffer mapping
+ * partition, and writers are serialized by the exclusive partition lock they
+ * already hold.  Readers take no lock and do no atomic writes.
+ *
+ * A writer first sets the entry's id to -1, then stores the tag, then the new
+ * id, with write barriers in between; a reader reads id, tag and id again.
+ * That keeps most torn reads out, but not all of them (the same id can be
+ * stored again for a different tag), so a hit is never more than a hint.
+ * Entries that don't fit are simply dropped: the hash table remains
+ * authoritative, and a miss here just means taking the locked path.
+ */
+#define BUFMAP_CACHE_WAYS	4
+
+typedef struct
+{
+	BufferTag	key;			/* Tag of a disk page */
+	int			id;				/* Associated buffer ID, or -1 if unused */
+} BufMapCacheEnt;
+
+typedef struct
+{
+	BufMapCacheEnt ents[BUFMAP_CACHE_WAYS];
+} BufMapCacheBucket;
+
+static BufMapCacheBucket *BufMapCache;
+static uint32 BufMapCacheMask;
+
+static uint32 BufMapCacheBuckets(int size);
+static void BufMapCacheInsert(BufferTag *tagPtr, uint32 hashcode, int buf_id);
+static void BufMapCacheDelete(BufferTag *tagPtr, uint32 hashcode);
+
+
+/*
+ * Number of lookup cache buckets for a mapping table of the given size.
+ * We aim for a load factor of about one half.
+ */
+static uint32
+BufMapCacheBuckets(int size)
+{
+	uint32		nbuckets = (uint32) size * 2 / BUFMAP_CACHE_WAYS;
+
+	return pg_nextpower2_32(Max(nbuckets, NUM_BUFFER_PARTITIONS));
+}
+
 
 /*
  * Estimate space needed for mapping hashtable
@@ -41,7 +98,13 @@ static HTAB *SharedBufHash;
 Size
 BufTableShmemSize(int size)
 {
-	return hash_estimate_size(size, sizeof(BufferLookupEnt));
+	Size		sz;
+
+	sz = hash_estimate_size(size, sizeof(BufferLookupEnt));
+	sz = add_size(sz, mul_size(BufMapCacheBuckets(size),
+							   sizeof(BufMapCacheBucket)));
+
+	return sz;
 }
 
 /*
@@ -52,6 +115,8 @@ void
 InitBufTable(int size)
 {
 	HASHCTL		info;
+	uint32		nbuckets;
+	bool		found;
 
 	/* assume no locking is needed yet */
 
@@ -64,6 +129,32 @@ InitBufTable(int size)
 								  size, size,
 								  &info,
 								  HASH_ELEM | HASH_BLOBS | HASH_PARTITION);
+
+	/* the bucket-to-partition mapping relies on this */
+	StaticAssertStmt((NUM_BUFFER_PARTITIONS & (NUM_BUFFER_PARTITIONS - 1)) == 0,
+					 "NUM_BUFFER_PARTITIONS must be a power of 2");
+
+	nbuckets = BufMapCacheBuckets(size);
+	BufMapCacheMask = nbuckets - 1;
+	BufMapCache = (BufMapCacheBucket *)
+		ShmemInitStruct("Shared Buffer Lookup Cache",
+						mul_size(nbuckets, sizeof(BufMapCacheBucket)),
+						&found);
+
+	if (!found)
+	{
+		uint32		i;
+		int			j;
+
+		for (i = 0; i < nbuckets; i++)
+		{
+			for (j = 0; j < BUFMAP_CACHE_WAYS; j++)
+			{
+				CLEAR_BUFFERTAG(BufMapCache[i].ents[j].key);
+				BufMapCache[i].ents[j].id = -1;
+			}
+		}
+	}
 }
 
 /*
@@ -105,6 +196,40 @@ BufTableLookup(BufferTag *tagPtr, uint32 hashcode)
 	return result->id;
 }
 
+/*
+ * BufTableLookupOptimistic
+ *		Lookup the given BufferTag without locking; return a buffer ID that
+ *		probably holds the tag, or -1 if no candidate was found
+ *
+ * No lock is required.  The returned buffer may hold some other page by the
+ * time the caller looks at it, so the caller must pin the buffer and verify
+ * its tag, and fall back to BufTableLookup when that fails.
+ */
+int
+BufTableLookupOptimistic(BufferTag *tagPtr, uint32 hashcode)
+{
+	BufMapCacheBucket *bucket = &BufMapCache[hashcode & BufMapCacheMask];
+	int			i;
+
+	for (i = 0; i < BUFMAP_CACHE_WAYS; i++)
+	{
+		volatile BufMapCacheEnt *ent = &bucket->ents[i];
+		int			id = ent->id;
+
+		if (id < 0)
+			continue;
+		pg_read_barrier();
+		if (!BUFFERTAGS_EQUAL(ent->key, *tagPtr))
+			continue;
+		pg_read_barrier();
+		if (ent->id != id)
+			continue;
+		return id;
+	}
+
+	return -1;
+}
+
 /*
  * BufTableInsert
  *		Insert a hashtable entry for given tag and buffer ID,
@@ -136,6 +261,8 @@ BufTableInsert(BufferTag *tagPtr, uint32 hashcode, int buf_id)
 
 	result->id = buf_id;
 
+	BufMapCacheInsert(tagPtr, hashcode, buf_id);
+
 	return -1;
 }
 
@@ -159,4 +286,61 @@ BufTableDelete(BufferTag *tagPtr, uint32 hashcode)
 
 	if (!result)				/* shouldn't happen */
 		elog(ERROR, "shared buffer hash table corrupted");
+
+	BufMapCacheDelete(tagPtr, hashcode);
+}
+
+/*
+ * BufMapCacheInsert
+ *		Remember a tag-to-buffer mapping in the lock-free lookup cache
+ *
+ * If the bucket is full, some other entry is overwritten; that mapping then
+ * can only be found through the hash table.
+ *
+ * Caller must hold exclusive lock on BufMappingLock for tag's partition
+ */
+static void
+BufMapCacheInsert(BufferTag *tagPtr, uint32 hashcode, int buf_id)
+{
+	BufMapCacheBucket *bucket = &BufMapCache[hashcode & BufMapCacheMask];
+	volatile BufMapCacheEnt *ent = NULL;
+	int			i;
+
+	for (i = 0; i < BUFMAP_CACHE_WAYS; i++)
+	{
+		if (bucket->ents[i].id < 0)
+		{
+			ent = &bucket->ents[i];
+			break;
+		}
+	}
+	if (ent == NULL)
+		ent = &bucket->ents[buf_id % BUFMAP_CACHE_WAYS];
+
+	ent->id = -1;
+	pg_write_barrier();
+	ent->key = *tagPtr;
+	pg_write_barrier();
+	ent->id = buf_id;
+}
+
+/*
+ * BufMapCacheDelete
+ *		Forget any lookup cache entry for the given tag
+ *
+ * Caller must hold exclusive lock on BufMappingLock for tag's partition
+ */
+static void
+BufMapCacheDelete(BufferTag *tagPtr, uint32 hashcode)
+{
+	BufMapCacheBucket *bucket = &BufMapCache[hashcode & BufMapCacheMask];
+	int			i;
+
+	for (i = 0; i < BUFMAP_CACHE_WAYS; i++)
+	{
+		volatile BufMapCacheEnt *ent = &bucket->ents[i];
+
+		if (ent->id >= 0 && BUFFERTAGS_EQUAL(ent->key, *tagPtr))
+			ent->id = -1;
+	}
 }
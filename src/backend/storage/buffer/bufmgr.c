@@ -51,6 +51,7 @@
 #include "storage/smgr.h"
 #include "storage/standby.h"
 #include "utils/memdebug.h"
+#include "utils/memutils.h"
 #include "utils/ps_status.h"
 #include "utils/rel.h"
 #include "utils/resowner_private.h"
@@ -1139,6 +1140,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	BufferDesc *buf;
 	bool		valid;
 	uint32		buf_state;
+	int			usage_count;	/* initial usage_count for new buffer */
 
 	/* create a tag so we can lookup the buffer */
 	INIT_BUFFERTAG(newTag, smgr->smgr_rnode.node, forkNum, blockNum);
@@ -1147,6 +1149,34 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	newHash = BufTableHashCode(&newTag);
 	newPartitionLock = BufMappingPartitionLock(newHash);
 
+	/*
+	 * First try the lock-free lookup cache.  Its answer may be stale, but
+	 * once we hold a pin nobody can change the buffer's tag (they'd have to
+	 * see a zero refcount, or only their own pin, under the buffer header
+	 * lock), so re-checking the tag after pinning validates the hit.
+	 */
+	buf_id = BufTableLookupOptimistic(&newTag, newHash);
+	if (buf_id >= 0)
+	{
+		buf = GetBufferDescriptor(buf_id);
+
+		valid = PinBuffer(buf, strategy);
+
+		if (BUFFERTAGS_EQUAL(buf->tag, newTag))
+		{
+			*foundPtr = true;
+
+			/* See comments about the !valid case below */
+			if (!valid && StartBufferIO(buf, true))
+				*foundPtr = false;
+
+			return buf;
+		}
+
+		/* Wrong buffer; drop the pin and do it the hard way */
+		UnpinBuffer(buf, true);
+	}
+
 	/* see if the block is in the buffer pool already */
 	LWLockAcquire(newPartitionLock, LW_SHARED);
 	buf_id = BufTableLookup(&newTag, newHash);
@@ -1194,6 +1224,9 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	 */
 	LWLockRelease(newPartitionLock);
 
+	/* Ask the replacement policy how much protection the new page gets */
+	usage_count = StrategyAdmitBuffer(newHash);
+
 	/* Loop here in case we have to try another victim buffer */
 	for (;;)
 	{
@@ -1429,8 +1462,9 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	 *
 	 * Clearing BM_VALID here is necessary, clearing the dirtybits is just
 	 * paranoia.  We also reset the usage_count since any recency of use of
-	 * the old content is no longer relevant.  (The usage_count starts out at
-	 * 1 so that the buffer can survive one clock-sweep pass.)
+	 * the old content is no longer relevant.  (With the default replacement
+	 * policy, the usage_count starts out at 1 so that the buffer can survive
+	 * one clock-sweep pass; see StrategyAdmitBuffer.)
 	 *
 	 * Make sure BM_PERMANENT is set for buffers that must be written at every
 	 * checkpoint.  Unlogged buffers only need to be written at shutdown
@@ -1442,14 +1476,16 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 				   BM_CHECKPOINT_NEEDED | BM_IO_ERROR | BM_PERMANENT |
 				   BUF_USAGECOUNT_MASK);
 	if (relpersistence == RELPERSISTENCE_PERMANENT || forkNum == INIT_FORKNUM)
-		buf_state |= BM_TAG_VALID | BM_PERMANENT | BUF_USAGECOUNT_ONE;
+		buf_state |= BM_TAG_VALID | BM_PERMANENT;
 	else
-		buf_state |= BM_TAG_VALID | BUF_USAGECOUNT_ONE;
+		buf_state |= BM_TAG_VALID;
+	buf_state += usage_count * BUF_USAGECOUNT_ONE;
 
 	UnlockBufHdr(buf, buf_state);
 
 	if (oldPartitionLock != NULL)
 	{
+		StrategyRecordEviction(oldHash);
 		BufTableDelete(&oldTag, oldHash);
 		if (oldPartitionLock != newPartitionLock)
 			LWLockRelease(oldPartitionLock);
@@ -2245,6 +2281,33 @@ BufferSync(int flags)
 	TRACE_POSTGRESQL_BUFFER_SYNC_DONE(NBuffers, num_written, num_to_scan);
 }
 
+/*
+ * State of the background writer's LRU scan for one clock sweep partition,
+ * see BgBufferSync.  Buffer ids are absolute, but lie within the range
+ * [first_buffer, first_buffer + nbuffers) covered by the partition's hand.
+ */
+typedef struct BgSweepPartition
+{
+	int			first_buffer;	/* first buffer covered by the hand */
+	int			nbuffers;		/* number of buffers covered */
+
+	/* info obtained from freelist.c */
+	int			strategy_buf_id;
+	uint32		strategy_passes;
+
+	/*
+	 * Information saved between calls so we can determine the strategy
+	 * point's advance rate and avoid scanning already-cleaned buffers.
+	 */
+	int			prev_strategy_buf_id;
+	uint32		prev_strategy_passes;
+	int			next_to_clean;
+	uint32		next_passes;
+
+	/* buffers we can scan before lapping the hand, computed on each call */
+	int			bufs_to_lap;
+} BgSweepPartition;
+
 /*
  * BgBufferSync -- Write out some dirty buffers in the pool.
  *
@@ -2255,24 +2318,27 @@ BufferSync(int flags)
  * has been "lapped" and no buffer allocations have occurred recently,
  * or if the bgwriter has been effectively disabled by setting
  * bgwriter_lru_maxpages to 0.)
+ *
+ * If the buffer pool is divided into several clock sweep partitions (see
+ * buffer_sweep_partitions), each partition's hand moves independently, so
+ * we keep a separate cleaning point for each and clean each partition just
+ * ahead of its own hand.  The allocation rate and the density of reusable
+ * buffers are estimated for the pool as a whole, and the expected
+ * allocations are divided between the partitions in proportion to their
+ * size, which is how the backends spread their victim searches over them.
  */
 bool
 BgBufferSync(WritebackContext *wb_context)
 {
 	/* info obtained from freelist.c */
-	int			strategy_buf_id;
-	uint32		strategy_passes;
 	uint32		recent_alloc;
 
-	/*
-	 * Information saved between calls so we can determine the strategy
-	 * point's advance rate and avoid scanning already-cleaned buffers.
-	 */
+	/* The clock sweep partitions, set up on first call */
+	static BgSweepPartition *partitions = NULL;
+	static int	npartitions;
+	static int	first_partition = 0;
+
 	static bool saved_info_valid = false;
-	static int	prev_strategy_buf_id;
-	static uint32 prev_strategy_passes;
-	static int	next_to_clean;
-	static uint32 next_passes;
 
 	/* Moving averages of allocation rate and clean-buffer density */
 	static float smoothed_alloc = 0;
@@ -2294,17 +2360,46 @@ BgBufferSync(WritebackContext *wb_context)
 	/* Variables for the scanning loop proper */
 	int			num_to_scan;
 	int			num_written;
+	int			num_scanned;
 	int			reusable_buffers;
+	int			reusable_found;
+	bool		hit_maxpages;
 
 	/* Variables for final smoothed_density update */
 	long		new_strategy_delta;
 	uint32		new_recent_alloc;
 
+	int			i;
+
+	if (partitions == NULL)
+	{
+		int		   *first_buffers;
+		int		   *nbuffers;
+
+		npartitions = StrategySyncPartitions(&first_buffers, &nbuffers);
+		partitions = (BgSweepPartition *)
+			MemoryContextAllocZero(TopMemoryContext,
+								   npartitions * sizeof(BgSweepPartition));
+		for (i = 0; i < npartitions; i++)
+		{
+			partitions[i].first_buffer = first_buffers[i];
+			partitions[i].nbuffers = nbuffers[i];
+		}
+		pfree(first_buffers);
+		pfree(nbuffers);
+	}
+
 	/*
-	 * Find out where the freelist clock sweep currently is, and how many
+	 * Find out where the freelist clock sweeps currently are, and how many
 	 * buffer allocations have happened since our last call.
 	 */
-	strategy_buf_id = StrategySyncStart(&strategy_passes, &recent_alloc);
+	for (i = 0; i < npartitions; i++)
+	{
+		BgSweepPartition *part = &partitions[i];
+
+		part->strategy_buf_id = StrategySyncStart(i, &part->strategy_passes,
+												  i == 0 ? &recent_alloc : NULL);
+	}
 
 	/* Report buffer alloc counts to pgstat */
 	BgWriterStats.m_buf_alloc += recent_alloc;
@@ -2322,80 +2417,93 @@ BgBufferSync(WritebackContext *wb_context)
 
 	/*
 	 * Compute strategy_delta = how many buffers have been scanned by the
-	 * clock sweep since last time.  If first time through, assume none. Then
-	 * see if we are still ahead of the clock sweep, and if so, how many
+	 * clock sweeps since last time.  If first time through, assume none.
+	 * Then see if we are still ahead of each clock sweep, and if so, how many
 	 * buffers we could scan before we'd catch up with it and "lap" it. Note:
 	 * weird-looking coding of xxx_passes comparisons are to avoid bogus
 	 * behavior when the passes counts wrap around.
 	 */
-	if (saved_info_valid)
+	strategy_delta = 0;
+	bufs_to_lap = 0;
+	for (i = 0; i < npartitions; i++)
 	{
-		int32		passes_delta = strategy_passes - prev_strategy_passes;
+		BgSweepPartition *part = &partitions[i];
+		int			strategy_buf_id = part->strategy_buf_id;
+		uint32		strategy_passes = part->strategy_passes;
 
-		strategy_delta = strategy_buf_id - prev_strategy_buf_id;
-		strategy_delta += (long) passes_delta * NBuffers;
+		if (saved_info_valid)
+		{
+			int32		passes_delta = strategy_passes - part->prev_strategy_passes;
+			long		delta;
 
-		Assert(strategy_delta >= 0);
+			delta = strategy_buf_id - part->prev_strategy_buf_id;
+			delta += (long) passes_delta * part->nbuffers;
 
-		if ((int32) (next_passes - strategy_passes) > 0)
-		{
-			/* we're one pass ahead of the strategy point */
-			bufs_to_lap = strategy_buf_id - next_to_clean;
+			Assert(delta >= 0);
+			strategy_delta += delta;
+
+			if ((int32) (part->next_passes - strategy_passes) > 0)
+			{
+				/* we're one pass ahead of the strategy point */
+				part->bufs_to_lap = strategy_buf_id - part->next_to_clean;
 #ifdef BGW_DEBUG
-			elog(DEBUG2, "bgwriter ahead: bgw %u-%u strategy %u-%u delta=%ld lap=%d",
-				 next_passes, next_to_clean,
-				 strategy_passes, strategy_buf_id,
-				 strategy_delta, bufs_to_lap);
+				elog(DEBUG2, "bgwriter ahead: partition %d bgw %u-%u strategy %u-%u delta=%ld lap=%d",
+					 i, part->next_passes, part->next_to_clean,
+					 strategy_passes, strategy_buf_id,
+					 delta, part->bufs_to_lap);
 #endif
-		}
-		else if (next_passes == strategy_passes &&
-				 next_to_clean >= strategy_buf_id)
-		{
-			/* on same pass, but ahead or at least not behind */
-			bufs_to_lap = NBuffers - (next_to_clean - strategy_buf_id);
+			}
+			else if (part->next_passes == strategy_passes &&
+					 part->next_to_clean >= strategy_buf_id)
+			{
+				/* on same pass, but ahead or at least not behind */
+				part->bufs_to_lap = part->nbuffers -
+					(part->next_to_clean - strategy_buf_id);
+#ifdef BGW_DEBUG
+				elog(DEBUG2, "bgwriter ahead: partition %d bgw %u-%u strategy %u-%u delta=%ld lap=%d",
+					 i, part->next_passes, part->next_to_clean,
+					 strategy_passes, strategy_buf_id,
+					 delta, part->bufs_to_lap);
+#endif
+			}
+			else
+			{
+				/*
+				 * We're behind, so skip forward to the strategy point and
+				 * start cleaning from there.
+				 */
 #ifdef BGW_DEBUG
-			elog(DEBUG2, "bgwriter ahead: bgw %u-%u strategy %u-%u delta=%ld lap=%d",
-				 next_passes, next_to_clean,
-				 strategy_passes, strategy_buf_id,
-				 strategy_delta, bufs_to_lap);
+				elog(DEBUG2, "bgwriter behind: partition %d bgw %u-%u strategy %u-%u delta=%ld",
+					 i, part->next_passes, part->next_to_clean,
+					 strategy_passes, strategy_buf_id,
+					 delta);
 #endif
+				part->next_to_clean = strategy_buf_id;
+				part->next_passes = strategy_passes;
+				part->bufs_to_lap = part->nbuffers;
+			}
 		}
 		else
 		{
 			/*
-			 * We're behind, so skip forward to the strategy point and start
-			 * cleaning from there.
+			 * Initializing at startup or after LRU scanning had been off.
+			 * Always start at the strategy point.
 			 */
 #ifdef BGW_DEBUG
-			elog(DEBUG2, "bgwriter behind: bgw %u-%u strategy %u-%u delta=%ld",
-				 next_passes, next_to_clean,
-				 strategy_passes, strategy_buf_id,
-				 strategy_delta);
+			elog(DEBUG2, "bgwriter initializing: partition %d strategy %u-%u",
+				 i, strategy_passes, strategy_buf_id);
 #endif
-			next_to_clean = strategy_buf_id;
-			next_passes = strategy_passes;
-			bufs_to_lap = NBuffers;
+			part->next_to_clean = strategy_buf_id;
+			part->next_passes = strategy_passes;
+			part->bufs_to_lap = part->nbuffers;
 		}
-	}
-	else
-	{
-		/*
-		 * Initializing at startup or after LRU scanning had been off. Always
-		 * start at the strategy point.
-		 */
-#ifdef BGW_DEBUG
-		elog(DEBUG2, "bgwriter initializing: strategy %u-%u",
-			 strategy_passes, strategy_buf_id);
-#endif
-		strategy_delta = 0;
-		next_to_clean = strategy_buf_id;
-		next_passes = strategy_passes;
-		bufs_to_lap = NBuffers;
-	}
 
-	/* Update saved info for next time */
-	prev_strategy_buf_id = strategy_buf_id;
-	prev_strategy_passes = strategy_passes;
+		bufs_to_lap += part->bufs_to_lap;
+
+		/* Update saved info for next time */
+		part->prev_strategy_buf_id = strategy_buf_id;
+		part->prev_strategy_passes = strategy_passes;
+	}
 	saved_info_valid = true;
 
 	/*
@@ -2413,7 +2521,7 @@ BgBufferSync(WritebackContext *wb_context)
 
 	/*
 	 * Estimate how many reusable buffers there are between the current
-	 * strategy point and where we've scanned ahead to, based on the smoothed
+	 * strategy points and where we've scanned ahead to, based on the smoothed
 	 * density estimate.
 	 */
 	bufs_ahead = NBuffers - bufs_to_lap;
@@ -2466,54 +2574,82 @@ BgBufferSync(WritebackContext *wb_context)
 	}
 
 	/*
-	 * Now write out dirty reusable buffers, working forward from the
-	 * next_to_clean point, until we have lapped the strategy scan, or cleaned
-	 * enough buffers to match our estimate of the next cycle's allocation
-	 * requirements, or hit the bgwriter_lru_maxpages limit.
+	 * Now write out dirty reusable buffers in each partition, working forward
+	 * from its next_to_clean point, until we have lapped its strategy scan,
+	 * or cleaned enough buffers to match our estimate of the next cycle's
+	 * allocation requirements in the partition, or hit the
+	 * bgwriter_lru_maxpages limit.  We start with a different partition each
+	 * time, so that hitting the limit doesn't always starve the same ones.
 	 */
 
 	/* Make sure we can handle the pin inside SyncOneBuffer */
 	ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
 
-	num_to_scan = bufs_to_lap;
 	num_written = 0;
-	reusable_buffers = reusable_buffers_est;
+	num_scanned = 0;
+	reusable_found = 0;
+	hit_maxpages = false;
 
-	/* Execute the LRU scan */
-	while (num_to_scan > 0 && reusable_buffers < upcoming_alloc_est)
+	for (i = 0; i < npartitions && !hit_maxpages; i++)
 	{
-		int			sync_state = SyncOneBuffer(next_to_clean, true,
-											   wb_context);
+		BgSweepPartition *part;
+		int			part_alloc_est;
+		int			part_reusable_est;
 
-		if (++next_to_clean >= NBuffers)
-		{
-			next_to_clean = 0;
-			next_passes++;
-		}
-		num_to_scan--;
+		part = &partitions[(first_partition + i) % npartitions];
+
+		/* the partition's share of the work, by size */
+		part_alloc_est = (int) ((int64) upcoming_alloc_est *
+								part->nbuffers / NBuffers);
+		part_reusable_est = (float) (part->nbuffers - part->bufs_to_lap) /
+			smoothed_density;
 
-		if (sync_state & BUF_WRITTEN)
+		num_to_scan = part->bufs_to_lap;
+		reusable_buffers = part_reusable_est;
+
+		/* Execute the LRU scan */
+		while (num_to_scan > 0 && reusable_buffers < part_alloc_est)
 		{
-			reusable_buffers++;
-			if (++num_written >= bgwriter_lru_maxpages)
+			int			sync_state = SyncOneBuffer(part->next_to_clean, true,
+												   wb_context);
+
+			if (++part->next_to_clean >= part->first_buffer + part->nbuffers)
 			{
-				BgWriterStats.m_maxwritten_clean++;
-				break;
+				part->next_to_clean = part->first_buffer;
+				part->next_passes++;
 			}
+			num_to_scan--;
+
+			if (sync_state & BUF_WRITTEN)
+			{
+				reusable_buffers++;
+				if (++num_written >= bgwriter_lru_maxpages)
+				{
+					BgWriterStats.m_maxwritten_clean++;
+					hit_maxpages = true;
+					break;
+				}
+			}
+			else if (sync_state & BUF_REUSABLE)
+				reusable_buffers++;
 		}
-		else if (sync_state & BUF_REUSABLE)
-			reusable_buffers++;
+
+		num_scanned += part->bufs_to_lap - num_to_scan;
+		reusable_found += reusable_buffers - part_reusable_est;
 	}
 
+	if (++first_partition >= npartitions)
+		first_partition = 0;
+
 	BgWriterStats.m_buf_written_clean += num_written;
 
 #ifdef BGW_DEBUG
 	elog(DEBUG1, "bgwriter: recent_alloc=%u smoothed=%.2f delta=%ld ahead=%d density=%.2f reusable_est=%d upcoming_est=%d scanned=%d wrote=%d reusable=%d",
 		 recent_alloc, smoothed_alloc, strategy_delta, bufs_ahead,
 		 smoothed_density, reusable_buffers_est, upcoming_alloc_est,
-		 bufs_to_lap - num_to_scan,
+		 num_scanned,
 		 num_written,
-		 reusable_buffers - reusable_buffers_est);
+		 reusable_found);
 #endif
 
 	/*
@@ -2524,8 +2660,8 @@ BgBufferSync(WritebackContext *wb_context)
 	 * which is helpful because a long memory isn't as desirable on the
 	 * density estimates.
 	 */
-	new_strategy_delta = bufs_to_lap - num_to_scan;
-	new_recent_alloc = reusable_buffers - reusable_buffers_est;
+	new_strategy_delta = num_scanned;
+	new_recent_alloc = reusable_found;
 	if (new_strategy_delta > 0 && new_recent_alloc > 0)
 	{
 		scans_per_alloc = (float) new_strategy_delta / (float) new_recent_alloc;
@@ -15,6 +15,7 @@
  */
 #include "postgres.h"
 
+#include "miscadmin.h"
 #include "port/atomics.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
@@ -22,22 +23,57 @@
 
 #define INT_ACCESS_ONCE(var)	((int)(*((volatile int *)&(var))))
 
+/* GUC variables */
+int			buffer_replacement_policy = BUFFER_REPLACEMENT_CLOCK;
+int			buffer_sweep_partitions = 1;
 
 /*
- * The shared freelist control information.
+ * Under the clock_2q policy, a page that is read back in while it is still
+ * remembered in the ghost table starts out with this usage_count, instead of
+ * zero for a page we haven't seen recently.
+ */
+#define GHOST_HIT_USAGE_COUNT	2
+
+/* Don't split the buffer pool into sweep partitions smaller than this */
+#define MIN_BUFFERS_PER_SWEEP_PARTITION	128
+
+/*
+ * Each sweep partition has its own clock hand, covering a contiguous range of
+ * buffers.  Keep them on separate cache lines so that backends sweeping
+ * different partitions don't contend.
  */
 typedef struct
 {
-	/* Spinlock: protects the values below */
-	slock_t		buffer_strategy_lock;
-
 	/*
-	 * Clock sweep hand: index of next buffer to consider grabbing. Note that
-	 * this isn't a concrete buffer - we only ever increase the value. So, to
-	 * get an actual buffer, it needs to be used modulo NBuffers.
+	 * Index, relative to firstBuffer, of the next buffer to consider
+	 * grabbing.  Like the single clock hand of old, this isn't a concrete
+	 * buffer - we only ever increase the value.  So, to get an actual buffer,
+	 * it needs to be used modulo nbuffers.
 	 */
 	pg_atomic_uint32 nextVictimBuffer;
 
+	int			firstBuffer;	/* first buffer covered by this hand */
+	int			nbuffers;		/* number of buffers covered */
+
+	/* Complete cycles of this hand; protected by buffer_strategy_lock */
+	uint32		completePasses;
+} BufferSweepHand;
+
+typedef union BufferSweepHandPadded
+{
+	BufferSweepHand hand;
+	char		pad[PG_CACHE_LINE_SIZE];
+} BufferSweepHandPadded;
+
+
+/*
+ * The shared freelist control information.
+ */
+typedef struct
+{
+	/* Spinlock: protects the values below */
+	slock_t		buffer_strategy_lock;
+
 	int			firstFreeBuffer;	/* Head of list of unused buffers */
 	int			lastFreeBuffer; /* Tail of list of unused buffers */
 
@@ -50,7 +86,6 @@ typedef struct
 	 * Statistics.  These counters should be wide enough that they can't
 	 * overflow during a single bgwriter cycle.
 	 */
-	uint32		completePasses; /* Complete cycles of the clock sweep */
 	pg_atomic_uint32 numBufferAllocs;	/* Buffers allocated since last reset */
 
 	/*
@@ -58,11 +93,26 @@ typedef struct
 	 * StrategyNotifyBgWriter.
 	 */
 	int			bgwprocno;
+
+	/* Clock sweep hands, see buffer_sweep_partitions */
+	int			numSweepHands;
+	BufferSweepHandPadded sweepHands[FLEXIBLE_ARRAY_MEMBER];
 } BufferStrategyControl;
 
 /* Pointers to shared state */
 static BufferStrategyControl *StrategyControl = NULL;
 
+/*
+ * Ghost table for the clock_2q policy: hash codes of the tags of recently
+ * evicted pages, indexed by hash code.  Entries are simply overwritten by
+ * later evictions that map to the same slot, and zero means empty.
+ */
+static pg_atomic_uint32 *StrategyGhosts = NULL;
+static uint32 NumStrategyGhosts = 0;
+
+/* Sweep partition this backend will use next, or -1 if not chosen yet */
+static int	nextSweepHand = -1;
+
 /*
  * Private (non-shared) state for managing a ring of shared buffers to re-use.
  * This is currently the only kind of BufferAccessStrategy object, but someday
@@ -106,11 +156,11 @@ static void AddBufferToRing(BufferAccessStrategy strategy,
 /*
  * ClockSweepTick - Helper routine for StrategyGetBuffer()
  *
- * Move the clock hand one buffer ahead of its current position and return the
- * id of the buffer now under the hand.
+ * Move the given clock hand one buffer ahead of its current position and
+ * return the id of the buffer now under the hand.
  */
 static inline uint32
-ClockSweepTick(void)
+ClockSweepTick(BufferSweepHand *hand)
 {
 	uint32		victim;
 
@@ -120,14 +170,14 @@ ClockSweepTick(void)
 	 * apparent order.
 	 */
 	victim =
-		pg_atomic_fetch_add_u32(&StrategyControl->nextVictimBuffer, 1);
+		pg_atomic_fetch_add_u32(&hand->nextVictimBuffer, 1);
 
-	if (victim >= NBuffers)
+	if (victim >= hand->nbuffers)
 	{
 		uint32		originalVictim = victim;
 
 		/* always wrap what we look up in BufferDescriptors */
-		victim = victim % NBuffers;
+		victim = victim % hand->nbuffers;
 
 		/*
 		 * If we're the one that just caused a wraparound, force
@@ -155,17 +205,44 @@ ClockSweepTick(void)
 				 */
 				SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
 
-				wrapped = expected % NBuffers;
+				wrapped = expected % hand->nbuffers;
 
-				success = pg_atomic_compare_exchange_u32(&StrategyControl->nextVictimBuffer,
+				success = pg_atomic_compare_exchange_u32(&hand->nextVictimBuffer,
 														 &expected, wrapped);
 				if (success)
-					StrategyControl->completePasses++;
+					hand->completePasses++;
 				SpinLockRelease(&StrategyControl->buffer_strategy_lock);
 			}
 		}
 	}
-	return victim;
+	return hand->firstBuffer + victim;
+}
+
+/*
+ * NextSweepHand - Helper routine for StrategyGetBuffer()
+ *
+ * Returns the index of the clock hand to start the next sweep with.  Each
+ * backend starts at a different partition and then moves round-robin through
+ * all of them, so that concurrent backends mostly use different hands while
+ * every partition still ages at about the same rate.
+ */
+static inline int
+NextSweepHand(void)
+{
+	int			numHands = StrategyControl->numSweepHands;
+	int			result;
+
+	if (numHands == 1)
+		return 0;
+
+	if (nextSweepHand < 0)
+		nextSweepHand = MyProcPid % numHands;
+
+	result = nextSweepHand;
+	if (++nextSweepHand >= numHands)
+		nextSweepHand = 0;
+
+	return result;
 }
 
 /*
@@ -201,7 +278,10 @@ BufferDesc *
 StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 {
 	BufferDesc *buf;
+	BufferSweepHand *hand;
 	int			bgwprocno;
+	int			handno;
+	int			handsTried;
 	int			trycounter;
 	uint32		local_buf_state;	/* to avoid repeated (de-)referencing */
 
@@ -313,10 +393,13 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 	}
 
 	/* Nothing on the freelist, so run the "clock sweep" algorithm */
-	trycounter = NBuffers;
+	handno = NextSweepHand();
+	hand = &StrategyControl->sweepHands[handno].hand;
+	handsTried = 1;
+	trycounter = hand->nbuffers;
 	for (;;)
 	{
-		buf = GetBufferDescriptor(ClockSweepTick());
+		buf = GetBufferDescriptor(ClockSweepTick(hand));
 
 		/*
 		 * If the buffer is pinned or has a nonzero usage_count, we cannot use
@@ -330,7 +413,7 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 			{
 				local_buf_state -= BUF_USAGECOUNT_ONE;
 
-				trycounter = NBuffers;
+				trycounter = hand->nbuffers;
 			}
 			else
 			{
@@ -341,7 +424,20 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 				return buf;
 			}
 		}
-		else if (--trycounter == 0)
+		else if (--trycounter == 0 &&
+				 handsTried < StrategyControl->numSweepHands)
+		{
+			/*
+			 * Every buffer in this partition is pinned; move on to the next
+			 * one.
+			 */
+			if (++handno >= StrategyControl->numSweepHands)
+				handno = 0;
+			hand = &StrategyControl->sweepHands[handno].hand;
+			handsTried++;
+			trycounter = hand->nbuffers;
+		}
+		else if (trycounter == 0)
 		{
 			/*
 			 * We've scanned all the buffers without making any state changes,
@@ -380,36 +476,68 @@ StrategyFreeBuffer(BufferDesc *buf)
 	SpinLockRelease(&StrategyControl->buffer_strategy_lock);
 }
 
+/*
+ * StrategySyncPartitions -- report the clock sweep partitions
+ *
+ * Returns the number of sweep partitions.  If first_buffers and nbuffers are
+ * not NULL, they are set to palloc'd arrays holding the range of buffers
+ * covered by each partition's clock hand.
+ */
+int
+StrategySyncPartitions(int **first_buffers, int **nbuffers)
+{
+	int			numHands = StrategyControl->numSweepHands;
+	int			i;
+
+	if (first_buffers && nbuffers)
+	{
+		*first_buffers = (int *) palloc(numHands * sizeof(int));
+		*nbuffers = (int *) palloc(numHands * sizeof(int));
+
+		/* the ranges never change after StrategyInitialize, so no locking */
+		for (i = 0; i < numHands; i++)
+		{
+			(*first_buffers)[i] = StrategyControl->sweepHands[i].hand.firstBuffer;
+			(*nbuffers)[i] = StrategyControl->sweepHands[i].hand.nbuffers;
+		}
+	}
+
+	return numHands;
+}
+
 /*
  * StrategySyncStart -- tell BufferSync where to start syncing
  *
- * The result is the buffer index of the best buffer to sync first.
- * BufferSync() will proceed circularly around the buffer array from there.
+ * The result is the buffer index of the best buffer to sync first within the
+ * given sweep partition.  BgBufferSync() will proceed circularly around the
+ * partition's range of buffers from there.
  *
- * In addition, we return the completed-pass count (which is effectively
- * the higher-order bits of nextVictimBuffer) and the count of recent buffer
- * allocs if non-NULL pointers are passed.  The alloc count is reset after
- * being read.
+ * In addition, we return the partition's completed-pass count (which is
+ * effectively the higher-order bits of its nextVictimBuffer) and the count of
+ * recent buffer allocs in all partitions if non-NULL pointers are passed.
+ * The alloc count is reset after being read.
  */
 int
-StrategySyncStart(uint32 *complete_passes, uint32 *num_buf_alloc)
+StrategySyncStart(int partition, uint32 *complete_passes,
+				  uint32 *num_buf_alloc)
 {
+	BufferSweepHand *hand = &StrategyControl->sweepHands[partition].hand;
 	uint32		nextVictimBuffer;
 	int			result;
 
 	SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
-	nextVictimBuffer = pg_atomic_read_u32(&StrategyControl->nextVictimBuffer);
-	result = nextVictimBuffer % NBuffers;
+	nextVictimBuffer = pg_atomic_read_u32(&hand->nextVictimBuffer);
+	result = hand->firstBuffer + nextVictimBuffer % hand->nbuffers;
 
 	if (complete_passes)
 	{
-		*complete_passes = StrategyControl->completePasses;
+		*complete_passes = hand->completePasses;
 
 		/*
 		 * Additionally add the number of wraparounds that happened before
 		 * completePasses could be incremented. C.f. ClockSweepTick().
 		 */
-		*complete_passes += nextVictimBuffer / NBuffers;
+		*complete_passes += nextVictimBuffer / hand->nbuffers;
 	}
 
 	if (num_buf_alloc)
@@ -441,6 +569,66 @@ StrategyNotifyBgWriter(int bgwprocno)
 	SpinLockRelease(&StrategyControl->buffer_strategy_lock);
 }
 
+/*
+ * StrategyAdmitBuffer -- choose the initial usage_count of a page being
+ *		read into a shared buffer
+ *
+ * hashcode is the buffer mapping hash code of the page's tag.  The plain
+ * clock policy always starts pages at 1, so that they survive one pass of
+ * the clock sweep.  clock_2q starts pages at 0, so that a page touched only
+ * once (typically by a large scan) is the first thing to go, unless the page
+ * was evicted recently enough to still be in the ghost table: that means we
+ * guessed wrong last time, and it starts out hot instead.
+ *
+ * The answer is only advisory, so we look at the ghost table without any
+ * locking.
+ */
+int
+StrategyAdmitBuffer(uint32 hashcode)
+{
+	uint32		slot;
+
+	if (buffer_replacement_policy == BUFFER_REPLACEMENT_CLOCK)
+		return 1;
+
+	slot = hashcode % NumStrategyGhosts;
+	if (hashcode != 0 &&
+		pg_atomic_read_u32(&StrategyGhosts[slot]) == hashcode)
+		return GHOST_HIT_USAGE_COUNT;
+
+	return 0;
+}
+
+/*
+ * StrategyRecordEviction -- remember that a page was evicted
+ *
+ * hashcode is the buffer mapping hash code of the tag the buffer held
+ * before being recycled.
+ */
+void
+StrategyRecordEviction(uint32 hashcode)
+{
+	if (buffer_replacement_policy == BUFFER_REPLACEMENT_CLOCK)
+		return;
+
+	pg_atomic_write_u32(&StrategyGhosts[hashcode % NumStrategyGhosts],
+						hashcode);
+}
+
+/*
+ * Number of clock sweep partitions to use.  Each partition must be large
+ * enough for the clock sweep within it to be meaningful, so with very small
+ * shared_buffers we use fewer partitions than requested.
+ */
+static int
+StrategyNumSweepHands(void)
+{
+	int			result = Min(buffer_sweep_partitions,
+							 NBuffers / MIN_BUFFERS_PER_SWEEP_PARTITION);
+
+	return Max(result, 1);
+}
+
 
 /*
  * StrategyShmemSize
@@ -459,7 +647,14 @@ StrategyShmemSize(void)
 	size = add_size(size, BufTableShmemSize(NBuffers + NUM_BUFFER_PARTITIONS));
 
 	/* size of the shared replacement strategy control block */
-	size = add_size(size, MAXALIGN(sizeof(BufferStrategyControl)));
+	size = add_size(size,
+					MAXALIGN(add_size(offsetof(BufferStrategyControl, sweepHands),
+									  mul_size(StrategyNumSweepHands(),
+											   sizeof(BufferSweepHandPadded)))));
+
+	/* size of the ghost table, if the policy needs one */
+	if (buffer_replacement_policy == BUFFER_REPLACEMENT_CLOCK_2Q)
+		size = add_size(size, mul_size(NBuffers, sizeof(pg_atomic_uint32)));
 
 	return size;
 }
@@ -475,6 +670,7 @@ void
 StrategyInitialize(bool init)
 {
 	bool		found;
+	int			numHands = StrategyNumSweepHands();
 
 	/*
 	 * Initialize the shared buffer lookup hashtable.
@@ -493,11 +689,14 @@ StrategyInitialize(bool init)
 	 */
 	StrategyControl = (BufferStrategyControl *)
 		ShmemInitStruct("Buffer Strategy Status",
-						sizeof(BufferStrategyControl),
+						offsetof(BufferStrategyControl, sweepHands) +
+						numHands * sizeof(BufferSweepHandPadded),
 						&found);
 
 	if (!found)
 	{
+		int			i;
+
 		/*
 		 * Only done once, usually in postmaster
 		 */
@@ -512,18 +711,51 @@ StrategyInitialize(bool init)
 		StrategyControl->firstFreeBuffer = 0;
 		StrategyControl->lastFreeBuffer = NBuffers - 1;
 
-		/* Initialize the clock sweep pointer */
-		pg_atomic_init_u32(&StrategyControl->nextVictimBuffer, 0);
-
 		/* Clear statistics */
-		StrategyControl->completePasses = 0;
 		pg_atomic_init_u32(&StrategyControl->numBufferAllocs, 0);
 
 		/* No pending notification */
 		StrategyControl->bgwprocno = -1;
+
+		/*
+		 * Initialize the clock sweep hands, dividing the buffers between them
+		 * as evenly as possible.
+		 */
+		StrategyControl->numSweepHands = numHands;
+		for (i = 0; i < numHands; i++)
+		{
+			BufferSweepHand *hand = &StrategyControl->sweepHands[i].hand;
+			int			first = (int) ((int64) NBuffers * i / numHands);
+			int			next = (int) ((int64) NBuffers * (i + 1) / numHands);
+
+			pg_atomic_init_u32(&hand->nextVictimBuffer, 0);
+			hand->firstBuffer = first;
+			hand->nbuffers = next - first;
+			hand->completePasses = 0;
+		}
 	}
 	else
 		Assert(!init);
+
+	/*
+	 * Get or create the ghost table.
+	 */
+	if (buffer_replacement_policy == BUFFER_REPLACEMENT_CLOCK_2Q)
+	{
+		NumStrategyGhosts = NBuffers;
+		StrategyGhosts = (pg_atomic_uint32 *)
+			ShmemInitStruct("Buffer Strategy Ghosts",
+							NumStrategyGhosts * sizeof(pg_atomic_uint32),
+							&found);
+
+		if (!found)
+		{
+			uint32		i;
+
+			for (i = 0; i < NumStrategyGhosts; i++)
+				pg_atomic_init_u32(&StrategyGhosts[i], 0);
+		}
+	}
 }
 
 
@@ -766,6 +766,40 @@ BufFileSeekBlock(BufFile *file, long blknum)
 					   SEEK_SET);
 }
 
+/*
+ * BufFilePrefetchBlock --- initiate asynchronous read of a range of blocks
+ *
+ * Asks the kernel to start reading nblocks BLCKSZ-sized blocks, starting at
+ * the n'th block of the file, so that a later BufFileRead() doesn't have to
+ * wait for them.  This is only a hint; blocks beyond the end of the file, or
+ * not yet written out of our buffer, are silently ignored, and the logical
+ * position is not moved.
+ */
+void
+BufFilePrefetchBlock(BufFile *file, long blknum, int nblocks)
+{
+#ifdef USE_PREFETCH
+	while (nblocks > 0)
+	{
+		int			fileno = (int) (blknum / BUFFILE_SEG_SIZE);
+		long		segblock = blknum % BUFFILE_SEG_SIZE;
+		int			segblocks;
+
+		if (fileno >= file->numFiles)
+			break;
+
+		segblocks = (int) Min((long) nblocks, BUFFILE_SEG_SIZE - segblock);
+		(void) FilePrefetch(file->files[fileno],
+							(off_t) segblock * BLCKSZ,
+							segblocks * BLCKSZ,
+							WAIT_EVENT_BUFFILE_READ);
+
+		blknum += segblocks;
+		nblocks -= segblocks;
+	}
+#endif							/* USE_PREFETCH */
+}
+
 #ifdef NOT_USED
 /*
  * BufFileTellBlock --- block-oriented tell
@@ -13,6 +13,7 @@
  */
 #include "postgres.h"
 
+#include "access/detoast.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_type.h"
 #include "common/hashfn.h"
@@ -545,6 +546,317 @@ fillJsonbValue(JsonbContainer *container, int index,
 	}
 }
 
+/*
+ * Piecewise lookups in TOASTed jsonb values.
+ *
+ * Fetching one key of a large out-of-line jsonb needs only the JEntries and
+ * keys of the containers along the path, plus the value itself.  When the
+ * TOAST storage allows fetching slices at any offset (see
+ * detoast_attr_is_seekable), getJsonbValueFromToasted() reads just those
+ * pieces with detoast_attr_slice(), instead of detoasting the whole value.
+ *
+ * Reads go through a few cached windows of JSONB_SLICE_WINDOW bytes, since a
+ * binary search touches many nearby JEntries and keys, and each slice fetch
+ * costs a TOAST index lookup.
+ */
+#define JSONB_SLICE_WINDOW		8192
+#define JSONB_SLICE_NWINDOWS	4
+
+/* Smaller values are cheaper to detoast whole than to read piecewise */
+#define JSONB_SLICE_MIN_SIZE	(4 * JSONB_SLICE_WINDOW)
+
+typedef struct JsonbSliceWindow
+{
+	uint32		offset;			/* offset of data within the jsonb */
+	uint32		len;			/* length of data, 0 if unused */
+	struct varlena *data;		/* fetched slice */
+} JsonbSliceWindow;
+
+typedef struct JsonbSliceReader
+{
+	struct varlena *attr;		/* the TOASTed jsonb */
+	uint32		size;			/* size of the jsonb, excluding varlena header */
+	int			nextwindow;		/* window to replace on the next miss */
+	JsonbSliceWindow windows[JSONB_SLICE_NWINDOWS];
+} JsonbSliceReader;
+
+/*
+ * Return a pointer to 'len' bytes at 'offset' of the jsonb.  The pointer
+ * stays valid at least until the next call.
+ */
+static const char *
+jsonbSliceRead(JsonbSliceReader *reader, uint32 offset, uint32 len)
+{
+	JsonbSliceWindow *window;
+	uint32		start;
+	uint32		end;
+	int			i;
+
+	if (offset > reader->size || len > reader->size - offset)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("jsonb data is corrupt")));
+
+	for (i = 0; i < JSONB_SLICE_NWINDOWS; i++)
+	{
+		window = &reader->windows[i];
+		if (window->len > 0 && offset >= window->offset &&
+			offset + len <= window->offset + window->len)
+			return VARDATA(window->data) + (offset - window->offset);
+	}
+
+	/* Not cached; fetch an aligned window around the requested range */
+	start = offset - offset % JSONB_SLICE_WINDOW;
+	end = Max(offset + len, start + JSONB_SLICE_WINDOW);
+	end = Min(end, reader->size);
+
+	window = &reader->windows[reader->nextwindow];
+	reader->nextwindow = (reader->nextwindow + 1) % JSONB_SLICE_NWINDOWS;
+	if (window->data != NULL)
+		pfree(window->data);
+	window->data = detoast_attr_slice(reader->attr, start, end - start);
+	window->offset = start;
+	window->len = VARSIZE(window->data) - VARHDRSZ;
+	if (window->len != end - start)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("jsonb data is corrupt")));
+
+	return VARDATA(window->data) + (offset - start);
+}
+
+static uint32
+jsonbSliceReadUint32(JsonbSliceReader *reader, uint32 offset)
+{
+	uint32		result;
+
+	memcpy(&result, jsonbSliceRead(reader, offset, sizeof(uint32)),
+		   sizeof(uint32));
+	return result;
+}
+
+/*
+ * Get the JEntry, offset and length of a child of the container at
+ * 'containerOffset', like getJsonbOffset and getJsonbLength do for
+ * containers in memory.
+ */
+static JEntry
+jsonbSliceChild(JsonbSliceReader *reader, uint32 containerOffset, int index,
+				uint32 *offset, uint32 *length)
+{
+	uint32		childrenOffset = containerOffset + offsetof(JsonbContainer, children);
+	int			first = Max(index - JB_OFFSET_STRIDE, 0);
+	JEntry		entries[JB_OFFSET_STRIDE + 1];
+	JEntry		entry;
+	uint32		off = 0;
+	int			i;
+
+	/*
+	 * The start offset of an entry can be computed from the entries before
+	 * it, up to the closest one that stores an end offset; there is one at
+	 * least every JB_OFFSET_STRIDE entries.
+	 */
+	memcpy(entries,
+		   jsonbSliceRead(reader, childrenOffset + first * sizeof(JEntry),
+						  (index - first + 1) * sizeof(JEntry)),
+		   (index - first + 1) * sizeof(JEntry));
+	entry = entries[index - first];
+
+	for (i = index - 1; i >= first; i--)
+	{
+		off += JBE_OFFLENFLD(entries[i - first]);
+		if (JBE_HAS_OFF(entries[i - first]))
+			break;
+	}
+
+	*offset = off;
+	if (JBE_HAS_OFF(entry))
+		*length = JBE_OFFLENFLD(entry) - off;
+	else
+		*length = JBE_OFFLENFLD(entry);
+
+	return entry;
+}
+
+/*
+ * Look up a path of object keys and array subscripts in a jsonb, reading
+ * only the parts of it that are needed if it is TOASTed in a way that allows
+ * that.
+ *
+ * Returns false if the value isn't suitable, in which case the caller should
+ * detoast it and use the regular lookup functions.  Otherwise returns true,
+ * and sets *result to a palloc'd copy of the value at the end of the path,
+ * or NULL if there's no such value.  Scalar jsonb values are never handled
+ * here.
+ */
+bool
+getJsonbValueFromToasted(struct varlena *attr, JsonbPathStep *path, int npath,
+						 JsonbValue **result)
+{
+	JsonbSliceReader reader;
+	JsonbValue *res = NULL;
+	uint32		containerOffset = 0;
+	uint32		header;
+	int			i;
+
+	Assert(npath > 0);
+
+	if (!detoast_attr_is_seekable(attr) ||
+		toast_raw_datum_size(PointerGetDatum(attr)) <
+		VARHDRSZ + JSONB_SLICE_MIN_SIZE)
+		return false;
+
+	memset(&reader, 0, sizeof(reader));
+	reader.attr = attr;
+	reader.size = toast_raw_datum_size(PointerGetDatum(attr)) - VARHDRSZ;
+
+	header = jsonbSliceReadUint32(&reader, 0);
+	if (header & JB_FSCALAR)
+		return false;
+
+	for (i = 0; i < npath; i++)
+	{
+		uint32		count = header & JB_CMASK;
+		uint32		base;
+		int			index = -1;
+		JEntry		entry;
+		uint32		offset;
+		uint32		length;
+		uint32		pad;
+
+		if (header & JB_FOBJECT)
+		{
+			uint32		stopLow = 0,
+						stopHigh = count;
+
+			if (path[i].key == NULL)
+				break;
+
+			/* Binary search the keys, as getKeyJsonValueFromContainer does */
+			base = containerOffset + offsetof(JsonbContainer, children) +
+				count * 2 * sizeof(JEntry);
+			while (stopLow < stopHigh)
+			{
+				uint32		stopMiddle = stopLow + (stopHigh - stopLow) / 2;
+				int			difference;
+
+				(void) jsonbSliceChild(&reader, containerOffset, stopMiddle,
+									   &offset, &length);
+				difference = lengthCompareJsonbString(jsonbSliceRead(&reader,
+																	 base + offset,
+																	 length),
+													  length,
+													  path[i].key,
+													  path[i].keyLen);
+				if (difference == 0)
+				{
+					index = stopMiddle + count;
+					break;
+				}
+				else if (difference < 0)
+					stopLow = stopMiddle + 1;
+				else
+					stopHigh = stopMiddle;
+			}
+		}
+		else if (header & JB_FARRAY)
+		{
+			if (!path[i].hasIndex)
+				break;
+
+			base = containerOffset + offsetof(JsonbContainer, children) +
+				count * sizeof(JEntry);
+			if (path[i].index >= 0)
+			{
+				if ((uint32) path[i].index < count)
+					index = path[i].index;
+			}
+			else if (path[i].index != PG_INT32_MIN &&
+					 (uint32) -path[i].index <= count)
+				index = count + path[i].index;
+		}
+		else
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg_internal("jsonb data is corrupt")));
+
+		if (index < 0)
+			break;
+
+		entry = jsonbSliceChild(&reader, containerOffset, index,
+								&offset, &length);
+
+		/* Descend into a nested container without fetching it */
+		if (i < npath - 1)
+		{
+			if (!JBE_ISCONTAINER(entry))
+				break;
+			containerOffset = base + INTALIGN(offset);
+			header = jsonbSliceReadUint32(&reader, containerOffset);
+			continue;
+		}
+
+		/* Last step: copy out the value, as fillJsonbValue would point to it */
+		res = palloc(sizeof(JsonbValue));
+		pad = INTALIGN(offset) - offset;
+		if (JBE_ISNULL(entry))
+			res->type = jbvNull;
+		else if (JBE_ISBOOL_TRUE(entry))
+		{
+			res->type = jbvBool;
+			res->val.boolean = true;
+		}
+		else if (JBE_ISBOOL_FALSE(entry))
+		{
+			res->type = jbvBool;
+			res->val.boolean = false;
+		}
+		else if (JBE_ISSTRING(entry))
+		{
+			char	   *str = palloc(length + 1);
+
+			memcpy(str, jsonbSliceRead(&reader, base + offset, length), length);
+			res->type = jbvString;
+			res->val.string.val = str;
+			res->val.string.len = length;
+		}
+		else
+		{
+			char	   *data;
+
+			Assert(JBE_ISNUMERIC(entry) || JBE_ISCONTAINER(entry));
+			if (length < pad)
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg_internal("jsonb data is corrupt")));
+			data = palloc(length - pad);
+			memcpy(data, jsonbSliceRead(&reader, base + offset + pad,
+										length - pad),
+				   length - pad);
+			if (JBE_ISNUMERIC(entry))
+			{
+				res->type = jbvNumeric;
+				res->val.numeric = (Numeric) data;
+			}
+			else
+			{
+				res->type = jbvBinary;
+				res->val.binary.data = (JsonbContainer *) data;
+				res->val.binary.len = length - pad;
+			}
+		}
+	}
+
+	for (i = 0; i < JSONB_SLICE_NWINDOWS; i++)
+	{
+		if (reader.windows[i].data != NULL)
+			pfree(reader.windows[i].data);
+	}
+
+	*result = res;
+	return true;
+}
+
 /*
  * Push JsonbValue into JsonbParseState.
  *
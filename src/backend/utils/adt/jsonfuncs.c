@@ -822,14 +822,54 @@ json_object_field(PG_FUNCTION_ARGS)
 		PG_RETURN_NULL();
 }
 
+/*
+ * Try to look up a path in the TOASTed jsonb passed as first argument
+ * without detoasting it as a whole; see getJsonbValueFromToasted().
+ *
+ * Returns false if the caller has to detoast the jsonb and look the path up
+ * the regular way.  Otherwise sets *result to the function result, setting
+ * fcinfo->isnull if it's NULL.
+ */
+static bool
+jsonb_get_toasted(FunctionCallInfo fcinfo, JsonbPathStep *path, int npath,
+				  bool as_text, Datum *result)
+{
+	JsonbValue *v;
+
+	if (!getJsonbValueFromToasted((struct varlena *) PG_GETARG_POINTER(0),
+								  path, npath, &v))
+		return false;
+
+	if (v == NULL || (as_text && v->type == jbvNull))
+	{
+		fcinfo->isnull = true;
+		*result = (Datum) 0;
+	}
+	else if (as_text)
+		*result = PointerGetDatum(JsonbValueAsText(v));
+	else
+		*result = JsonbPGetDatum(JsonbValueToJsonb(v));
+
+	return true;
+}
+
 Datum
 jsonb_object_field(PG_FUNCTION_ARGS)
 {
-	Jsonb	   *jb = PG_GETARG_JSONB_P(0);
+	Jsonb	   *jb;
 	text	   *key = PG_GETARG_TEXT_PP(1);
 	JsonbValue *v;
 	JsonbValue	vbuf;
+	JsonbPathStep step;
+	Datum		result;
+
+	step.key = VARDATA_ANY(key);
+	step.keyLen = VARSIZE_ANY_EXHDR(key);
+	step.hasIndex = false;
+	if (jsonb_get_toasted(fcinfo, &step, 1, false, &result))
+		return result;
 
+	jb = PG_GETARG_JSONB_P(0);
 	if (!JB_ROOT_IS_OBJECT(jb))
 		PG_RETURN_NULL();
 
@@ -863,11 +903,20 @@ json_object_field_text(PG_FUNCTION_ARGS)
 Datum
 jsonb_object_field_text(PG_FUNCTION_ARGS)
 {
-	Jsonb	   *jb = PG_GETARG_JSONB_P(0);
+	Jsonb	   *jb;
 	text	   *key = PG_GETARG_TEXT_PP(1);
 	JsonbValue *v;
 	JsonbValue	vbuf;
+	JsonbPathStep step;
+	Datum		result;
+
+	step.key = VARDATA_ANY(key);
+	step.keyLen = VARSIZE_ANY_EXHDR(key);
+	step.hasIndex = false;
+	if (jsonb_get_toasted(fcinfo, &step, 1, true, &result))
+		return result;
 
+	jb = PG_GETARG_JSONB_P(0);
 	if (!JB_ROOT_IS_OBJECT(jb))
 		PG_RETURN_NULL();
 
@@ -900,10 +949,19 @@ json_array_element(PG_FUNCTION_ARGS)
 Datum
 jsonb_array_element(PG_FUNCTION_ARGS)
 {
-	Jsonb	   *jb = PG_GETARG_JSONB_P(0);
+	Jsonb	   *jb;
 	int			element = PG_GETARG_INT32(1);
 	JsonbValue *v;
+	JsonbPathStep step;
+	Datum		result;
+
+	step.key = NULL;
+	step.hasIndex = true;
+	step.index = element;
+	if (jsonb_get_toasted(fcinfo, &step, 1, false, &result))
+		return result;
 
+	jb = PG_GETARG_JSONB_P(0);
 	if (!JB_ROOT_IS_ARRAY(jb))
 		PG_RETURN_NULL();
 
@@ -943,10 +1001,19 @@ json_array_element_text(PG_FUNCTION_ARGS)
 Datum
 jsonb_array_element_text(PG_FUNCTION_ARGS)
 {
-	Jsonb	   *jb = PG_GETARG_JSONB_P(0);
+	Jsonb	   *jb;
 	int			element = PG_GETARG_INT32(1);
 	JsonbValue *v;
+	JsonbPathStep step;
+	Datum		result;
 
+	step.key = NULL;
+	step.hasIndex = true;
+	step.index = element;
+	if (jsonb_get_toasted(fcinfo, &step, 1, true, &result))
+		return result;
+
+	jb = PG_GETARG_JSONB_P(0);
 	if (!JB_ROOT_IS_ARRAY(jb))
 		PG_RETURN_NULL();
 
@@ -1445,13 +1512,15 @@ jsonb_extract_path_text(PG_FUNCTION_ARGS)
 static Datum
 get_jsonb_path_all(FunctionCallInfo fcinfo, bool as_text)
 {
-	Jsonb	   *jb = PG_GETARG_JSONB_P(0);
+	Jsonb	   *jb;
 	ArrayType  *path = PG_GETARG_ARRAYTYPE_P(1);
 	Datum	   *pathtext;
 	bool	   *pathnulls;
 	bool		isnull;
 	int			npath;
 	Datum		res;
+	JsonbPathStep *steps;
+	int			i;
 
 	/*
 	 * If the array contains any null elements, return NULL, on the grounds
@@ -1466,6 +1535,32 @@ get_jsonb_path_all(FunctionCallInfo fcinfo, bool as_text)
 	deconstruct_array(path, TEXTOID, -1, false, TYPALIGN_INT,
 					  &pathtext, &pathnulls, &npath);
 
+	/*
+	 * Each path element is an object key, or an array subscript if it looks
+	 * like an integer; see jsonb_get_element.
+	 */
+	if (npath > 0)
+	{
+		steps = palloc(npath * sizeof(JsonbPathStep));
+		for (i = 0; i < npath; i++)
+		{
+			text	   *subscr = DatumGetTextPP(pathtext[i]);
+			char	   *indextext = TextDatumGetCString(pathtext[i]);
+			char	   *endptr;
+
+			steps[i].key = VARDATA_ANY(subscr);
+			steps[i].keyLen = VARSIZE_ANY_EXHDR(subscr);
+			errno = 0;
+			steps[i].index = strtoint(indextext, &endptr, 10);
+			steps[i].hasIndex = (endptr != indextext && *endptr == '\0' &&
+								 errno == 0);
+		}
+
+		if (jsonb_get_toasted(fcinfo, steps, npath, as_text, &res))
+			return res;
+	}
+
+	jb = PG_GETARG_JSONB_P(0);
 	res = jsonb_get_element(jb, pathtext, npath, &isnull, as_text);
 
 	if (isnull)
@@ -103,6 +103,7 @@
 #include "access/table.h"
 #include "access/tableam.h"
 #include "access/visibilitymap.h"
+#include "catalog/catalog.h"
 #include "catalog/pg_am.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_operator.h"
@@ -6668,6 +6669,92 @@ add_predicate_to_index_quals(IndexOptInfo *index, List *indexQuals)
 }
 
 
+/*
+ * Estimate the number of index tuples read by a btree scan that skips over
+ * runs of leaf pages (see _bt_skip_preprocess()).  This applies when the
+ * index quals constrain the second index column but not the first.  The scan
+ * reads the tuples matching the second column's quals, plus about a leaf
+ * page's worth of tuples around each distinct first column value, where it
+ * re-descends the tree.  *numSkips is set to the number of re-descents.
+ *
+ * Returns -1 if the scan can't skip, or we don't know enough to tell.
+ */
+static double
+btcost_skip_scan(PlannerInfo *root, IndexPath *path, double *numSkips)
+{
+	IndexOptInfo *index = path->indexinfo;
+	List	   *skipQuals = NIL;
+	VariableStatData vardata;
+	double		ndistinct;
+	bool		isdefault;
+	Selectivity skipSelectivity;
+	ListCell   *lc;
+
+	*numSkips = 0;
+
+	/* The executor only skips in non-parallel forward scans */
+	if (index->nkeycolumns < 2 || path->path.parallel_aware ||
+		path->indexscandir == BackwardScanDirection ||
+		index->pages <= 1 || index->tuples <= 0)
+		return -1;
+
+	/*
+	 * Nor in index-only scans that prefetch leaf pages, which visit every
+	 * leaf page in order.  This must match the prefetch setup in _bt_first().
+	 */
+	if (path->path.pathtype == T_IndexOnlyScan &&
+		enable_indexonlyscan_prefetch &&
+		(IsCatalogRelationOid(index->indexoid) ? effective_io_concurrency :
+		 get_tablespace_io_concurrency(index->reltablespace)) > 0)
+		return -1;
+
+	foreach(lc, path->indexclauses)
+	{
+		IndexClause *iclause = lfirst_node(IndexClause, lc);
+		ListCell   *lc2;
+
+		if (iclause->indexcol == 0)
+			return -1;
+
+		foreach(lc2, iclause->indexquals)
+		{
+			RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc2);
+
+			/* Array keys disable skipping on any column */
+			if (IsA(rinfo->clause, ScalarArrayOpExpr))
+				return -1;
+
+			if (iclause->indexcol != 1)
+				continue;
+			/* Only plain operator quals bound the second column */
+			if (!IsA(rinfo->clause, OpExpr))
+				return -1;
+			skipQuals = lappend(skipQuals, rinfo);
+		}
+	}
+	if (skipQuals == NIL)
+		return -1;
+
+	/* Estimate the number of distinct values of the first column */
+	examine_variable(root,
+					 (Node *) ((TargetEntry *) linitial(index->indextlist))->expr,
+					 0, &vardata);
+	ndistinct = get_variable_numdistinct(&vardata, &isdefault);
+	ReleaseVariableStats(vardata);
+	if (isdefault)
+		return -1;
+
+	skipSelectivity = clauselist_selectivity(root,
+											 add_predicate_to_index_quals(index, skipQuals),
+											 index->rel->relid,
+											 JOIN_INNER,
+											 NULL);
+
+	*numSkips = ndistinct;
+	return rint(skipSelectivity * index->rel->tuples +
+				ndistinct * (index->tuples / index->pages));
+}
+
 void
 btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 			   Cost *indexStartupCost, Cost *indexTotalCost,
@@ -6687,6 +6774,7 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	bool		found_saop;
 	bool		found_is_null_op;
 	double		num_sa_scans;
+	double		num_skip_scans = 0;
 	ListCell   *lc;
 
 	/*
@@ -6825,6 +6913,21 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 		 * to integer.
 		 */
 		numIndexTuples = rint(numIndexTuples / num_sa_scans);
+
+		/*
+		 * With no quals on the first column, see whether skipping over runs
+		 * of leaf pages would let the scan read fewer index tuples.
+		 */
+		if (indexBoundQuals == NIL)
+		{
+			double		skipTuples;
+
+			skipTuples = btcost_skip_scan(root, path, &num_skip_scans);
+			if (skipTuples >= 0 && skipTuples < numIndexTuples)
+				numIndexTuples = skipTuples;
+			else
+				num_skip_scans = 0;
+		}
 	}
 
 	/*
@@ -6844,13 +6947,14 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	 *
 	 * If there are ScalarArrayOpExprs, charge this once per SA scan.  The
 	 * ones after the first one are not startup cost so far as the overall
-	 * plan is concerned, so add them only to "total" cost.
+	 * plan is concerned, so add them only to "total" cost.  Likewise, a scan
+	 * that skips re-descends once per distinct first column value.
 	 */
 	if (index->tuples > 1)		/* avoid computing log(0) */
 	{
 		descentCost = ceil(log(index->tuples) / log(2.0)) * cpu_operator_cost;
 		costs.indexStartupCost += descentCost;
-		costs.indexTotalCost += costs.num_sa_scans * descentCost;
+		costs.indexTotalCost += (costs.num_sa_scans + num_skip_scans) * descentCost;
 	}
 
 	/*
@@ -6861,11 +6965,12 @@ btcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	 * in cases where only a single leaf page is expected to be visited.  This
 	 * cost is somewhat arbitrarily set at 50x cpu_operator_cost per page
 	 * touched.  The number of such pages is btree tree height plus one (ie,
-	 * we charge for the leaf page too).  As above, charge once per SA scan.
+	 * we charge for the leaf page too).  As above, charge once per SA scan,
+	 * and once per skip.
 	 */
 	descentCost = (index->tree_height + 1) * 50.0 * cpu_operator_cost;
 	costs.indexStartupCost += descentCost;
-	costs.indexTotalCost += costs.num_sa_scans * descentCost;
+	costs.indexTotalCost += (costs.num_sa_scans + num_skip_scans) * descentCost;
 
 	/*
 	 * If we can get an estimate of the first column's ordering correlation C
@@ -43,6 +43,7 @@
 #include "access/twophase.h"
 #include "access/xact.h"
 #include "access/xlog_internal.h"
+#include "access/xlogprefetch.h"
 #include "catalog/namespace.h"
 #include "catalog/pg_authid.h"
 #include "catalog/storage.h"
@@ -54,6 +55,7 @@
 #include "commands/vacuum.h"
 #include "commands/variable.h"
 #include "common/string.h"
+#include "common/walstream_compression.h"
 #include "funcapi.h"
 #include "jit/jit.h"
 #include "libpq/auth.h"
@@ -237,6 +239,7 @@ static void assign_recovery_target_name(const char *newval, void *extra);
 static bool check_recovery_target_lsn(char **newval, void **extra, GucSource source);
 static void assign_recovery_target_lsn(const char *newval, void *extra);
 static bool check_primary_slot_name(char **newval, void **extra, GucSource source);
+static bool check_wal_receiver_compression(char **newval, void **extra, GucSource source);
 static bool check_default_with_oids(bool *newval, void **extra, GucSource source);
 
 /* Private functions in guc-file.l that need to be called from guc.c */
@@ -537,14 +540,38 @@ static struct config_enum_entry shared_memory_options[] = {
 	{NULL, 0, false}
 };
 
+static const struct config_enum_entry buffer_replacement_policy_options[] = {
+	{"clock", BUFFER_REPLACEMENT_CLOCK, false},
+	{"clock_2q", BUFFER_REPLACEMENT_CLOCK_2Q, false},
+	{NULL, 0, false}
+};
+
 static struct config_enum_entry default_toast_compression_options[] = {
 	{"pglz", TOAST_PGLZ_COMPRESSION, false},
 #ifdef  USE_LZ4
 	{"lz4", TOAST_LZ4_COMPRESSION, false},
+#endif
+#ifdef  USE_ZSTD
+	{"zstd", TOAST_ZSTD_COMPRESSION, false},
 #endif
 	{NULL, 0, false}
 };
 
+static const struct config_enum_entry logical_decoding_spill_compression_options[] = {
+	{"off", REORDER_BUFFER_SPILL_COMPRESSION_OFF, false},
+	{"pglz", REORDER_BUFFER_SPILL_COMPRESSION_PGLZ, false},
+#ifdef  USE_LZ4
+	{"lz4", REORDER_BUFFER_SPILL_COMPRESSION_LZ4, false},
+#endif
+#ifdef  USE_ZSTD
+	{"zstd", REORDER_BUFFER_SPILL_COMPRESSION_ZSTD, false},
+#endif
+	{"false", REORDER_BUFFER_SPILL_COMPRESSION_OFF, true},
+	{"no", REORDER_BUFFER_SPILL_COMPRESSION_OFF, true},
+	{"0", REORDER_BUFFER_SPILL_COMPRESSION_OFF, true},
+	{NULL, 0, false}
+};
+
 /*
  * Options for enum values stored in other modules
  */
@@ -747,6 +774,8 @@ const char *const config_group_names[] =
 	gettext_noop("Write-Ahead Log / Checkpoints"),
 	/* WAL_ARCHIVING */
 	gettext_noop("Write-Ahead Log / Archiving"),
+	/* WAL_RECOVERY */
+	gettext_noop("Write-Ahead Log / Recovery"),
 	/* WAL_ARCHIVE_RECOVERY */
 	gettext_noop("Write-Ahead Log / Archive Recovery"),
 	/* WAL_RECOVERY_TARGET */
@@ -1358,6 +1387,16 @@ static struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"recovery_prefetch", PGC_SIGHUP, WAL_RECOVERY,
+			gettext_noop("Prefetches referenced blocks during recovery."),
+			gettext_noop("Reads ahead in the WAL to find blocks that will be needed soon.")
+		},
+		&recovery_prefetch,
+		true,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"wal_init_zero", PGC_SUSET, WAL_SETTINGS,
 			gettext_noop("Writes zeroes to new WAL files before first use."),
@@ -2404,6 +2443,17 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"buffer_sweep_partitions", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the number of clock sweep partitions used for shared buffer replacement."),
+			gettext_noop("Each partition has its own clock hand, which reduces contention "
+						 "when many backends look for victim buffers at once.")
+		},
+		&buffer_sweep_partitions,
+		1, 1, 128,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"lsn_cache_size", PGC_POSTMASTER, UNGROUPED,
 			gettext_noop("Size of last written LSN cache used by Neon."),
@@ -2857,6 +2907,17 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, assign_max_wal_size, NULL
 	},
 
+	{
+		{"recovery_prefetch_distance", PGC_SIGHUP, WAL_RECOVERY,
+			gettext_noop("Sets how far ahead of replay to look for blocks to prefetch."),
+			gettext_noop("Zero disables prefetching during recovery."),
+			GUC_UNIT_BYTE
+		},
+		&recovery_prefetch_distance,
+		256 * 1024, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"checkpoint_timeout", PGC_SIGHUP, WAL_CHECKPOINTS,
 			gettext_noop("Sets the maximum time between automatic WAL checkpoints."),
@@ -3228,6 +3289,18 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"max_parallel_apply_workers_per_subscription",
+			PGC_SIGHUP,
+			REPLICATION_SUBSCRIBERS,
+			gettext_noop("Maximum number of parallel apply workers per subscription."),
+			NULL,
+		},
+		&max_parallel_apply_workers_per_subscription,
+		0, 0, MAX_BACKENDS,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"log_rotation_age", PGC_SIGHUP, LOGGING_WHERE,
 			gettext_noop("Automatic log file rotation will occur after N minutes."),
@@ -3603,6 +3676,17 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"toast_segmented_min_size", PGC_USERSET, CLIENT_CONN_STATEMENT,
+			gettext_noop("Sets the minimum size of values compressed in independent segments."),
+			gettext_noop("0 means values are always compressed as a whole."),
+			GUC_UNIT_KB
+		},
+		&toast_segmented_min_size,
+		0, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"tcp_user_timeout", PGC_USERSET, CONN_AUTH_SETTINGS,
 			gettext_noop("TCP user timeout."),
@@ -4074,6 +4158,18 @@ static struct config_string ConfigureNamesString[] =
 		check_primary_slot_name, NULL, NULL
 	},
 
+	{
+		{"wal_receiver_compression", PGC_SIGHUP, REPLICATION_STANDBY,
+			gettext_noop("Sets the methods the WAL receiver offers for compressing streamed WAL."),
+			gettext_noop("A comma-separated list in order of preference. "
+						 "An empty string disables compression."),
+			GUC_LIST_INPUT
+		},
+		&wal_receiver_compression,
+		"",
+		check_wal_receiver_compression, NULL, NULL
+	},
+
 	{
 		{"client_encoding", PGC_USERSET, CLIENT_CONN_LOCALE,
 			gettext_noop("Sets the client's character set encoding."),
@@ -4790,6 +4886,17 @@ static struct config_enum ConfigureNamesEnum[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"logical_decoding_spill_compression", PGC_USERSET, RESOURCES_DISK,
+			gettext_noop("Sets the method used to compress changes logical decoding spills to disk."),
+			NULL
+		},
+		&logical_decoding_spill_compression,
+		REORDER_BUFFER_SPILL_COMPRESSION_OFF,
+		logical_decoding_spill_compression_options,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"default_transaction_isolation", PGC_USERSET, CLIENT_CONN_STATEMENT,
 			gettext_noop("Sets the transaction isolation level of each new transaction."),
@@ -4965,6 +5072,16 @@ static struct config_enum ConfigureNamesEnum[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"buffer_replacement_policy", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Selects the replacement policy used for shared buffers."),
+			NULL
+		},
+		&buffer_replacement_policy,
+		BUFFER_REPLACEMENT_CLOCK, buffer_replacement_policy_options,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"shared_memory_type", PGC_POSTMASTER, RESOURCES_MEM,
 			gettext_noop("Selects the shared memory implementation used for the main shared memory region."),
@@ -12644,6 +12761,50 @@ check_primary_slot_name(char **newval, void **extra, GucSource source)
 	return true;
 }
 
+static bool
+check_wal_receiver_compression(char **newval, void **extra, GucSource source)
+{
+	char	   *rawstring;
+	List	   *elemlist;
+	ListCell   *l;
+	bool		result = true;
+
+	/* Need a modifiable copy of string */
+	rawstring = pstrdup(*newval);
+
+	if (!SplitIdentifierString(rawstring, ',', &elemlist))
+	{
+		GUC_check_errdetail("List syntax is invalid.");
+		pfree(rawstring);
+		list_free(elemlist);
+		return false;
+	}
+
+	foreach(l, elemlist)
+	{
+		char	   *name = (char *) lfirst(l);
+		pg_walstream_compression method;
+
+		if (!pg_walstream_parse_compression(name, &method))
+		{
+			GUC_check_errdetail("Unrecognized compression method \"%s\".", name);
+			result = false;
+			break;
+		}
+		if (!pg_walstream_compression_supported(method))
+		{
+			GUC_check_errdetail("Compression method \"%s\" is not supported by this build.", name);
+			result = false;
+			break;
+		}
+	}
+
+	pfree(rawstring);
+	list_free(elemlist);
+
+	return result;
+}
+
 static bool
 check_default_with_oids(bool *newval, void **extra, GucSource source)
 {
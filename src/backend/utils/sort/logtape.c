@@ -125,6 +125,19 @@ typedef struct TapeBlockTrailer
 #define TAPE_WRITE_PREALLOC_MIN 8
 #define TAPE_WRITE_PREALLOC_MAX 128
 
+/*
+ * A range of consecutive block numbers that were allocated to a tape one
+ * after another, so that they are read in that order, too.
+ */
+typedef struct TapeExtent
+{
+	long		first;			/* first block number of the range */
+	long		nblocks;		/* number of blocks in the range */
+} TapeExtent;
+
+#define TapeExtentHolds(ext, blk) \
+	((blk) >= (ext)->first && (blk) < (ext)->first + (ext)->nblocks)
+
 /*
  * This data structure represents a single "logical tape" within the set
  * of logical tapes stored in the same file.
@@ -174,6 +187,20 @@ typedef struct LogicalTape
 	long	   *prealloc;
 	int			nprealloc;		/* number of elements in list */
 	int			prealloc_size;	/* number of elements list can hold */
+
+	/*
+	 * The blocks written to the tape, in the order they are chained, as
+	 * ranges of consecutive block numbers.  This is what lets reads prefetch
+	 * the blocks that follow the current one without touching blocks of
+	 * other tapes or free space.  It is not known for tapes written by
+	 * parallel workers, and tracking is given up if the array grows too
+	 * large; either way, such tapes are read without prefetching.
+	 */
+	TapeExtent *extents;
+	int			nextents;		/* number of elements in list */
+	int			extents_size;	/* number of elements list can hold */
+	bool		forgetExtents;	/* are we remembering extents? */
+	int			readExtent;		/* extent holding nextBlockNumber, if any */
 } LogicalTape;
 
 /*
@@ -225,6 +252,9 @@ static long ltsGetBlock(LogicalTapeSet *lts, LogicalTape *lt);
 static long ltsGetFreeBlock(LogicalTapeSet *lts);
 static long ltsGetPreallocBlock(LogicalTapeSet *lts, LogicalTape *lt);
 static void ltsReleaseBlock(LogicalTapeSet *lts, long blocknum);
+static void ltsRememberBlock(LogicalTape *lt, long blocknum);
+static void ltsPrefetchBlocks(LogicalTapeSet *lts, LogicalTape *lt,
+							  long nblocks);
 static void ltsConcatWorkerTapes(LogicalTapeSet *lts, TapeShare *shared,
 								 SharedFileSet *fileset);
 static void ltsInitTape(LogicalTape *lt);
@@ -339,9 +369,67 @@ ltsReadFillBuffer(LogicalTapeSet *lts, LogicalTape *lt)
 		/* Advance to next block, if we have buffer space left */
 	} while (lt->buffer_size - lt->nbytes > BLCKSZ);
 
+	/*
+	 * Start reading the blocks that the next refill will need, so that they
+	 * are hopefully in the kernel's cache by the time the caller has
+	 * consumed this buffer.
+	 */
+	if (lt->nextBlockNumber != -1L)
+		ltsPrefetchBlocks(lts, lt, lt->buffer_size / BLCKSZ);
+
 	return (lt->nbytes > 0);
 }
 
+/*
+ * Prefetch up to nblocks blocks of the tape, starting at nextBlockNumber.
+ *
+ * Only blocks that the tape's chain is known to visit are prefetched, in
+ * chain order.  Blocks in between that belong to other tapes, or that were
+ * freed by an earlier merge pass and may be reused by the one in progress,
+ * are left alone.
+ */
+static void
+ltsPrefetchBlocks(LogicalTapeSet *lts, LogicalTape *lt, long nblocks)
+{
+	long		blocknum = lt->nextBlockNumber;
+	int			i = lt->readExtent;
+
+	/*
+	 * Sequential reads find the block in the extent we used last time, or in
+	 * the one after it.  Only seeks on frozen tapes need the full search.
+	 */
+	if (i >= lt->nextents || !TapeExtentHolds(&lt->extents[i], blocknum))
+	{
+		if (i + 1 < lt->nextents && TapeExtentHolds(&lt->extents[i + 1], blocknum))
+			i++;
+		else
+		{
+			for (i = 0; i < lt->nextents; i++)
+			{
+				if (TapeExtentHolds(&lt->extents[i], blocknum))
+					break;
+			}
+			if (i >= lt->nextents)
+				return;			/* unknown block, or tape from a worker */
+		}
+	}
+	lt->readExtent = i;
+
+	while (nblocks > 0)
+	{
+		TapeExtent *ext = &lt->extents[i];
+		long		n = Min(nblocks, ext->first + ext->nblocks - blocknum);
+
+		BufFilePrefetchBlock(lts->pfile, blocknum + lt->offsetBlockNumber,
+							 (int) n);
+		nblocks -= n;
+
+		if (++i >= lt->nextents)
+			break;
+		blocknum = lt->extents[i].first;
+	}
+}
+
 static inline void
 swap_nodes(long *heap, unsigned long a, unsigned long b)
 {
@@ -478,6 +566,55 @@ ltsGetPreallocBlock(LogicalTapeSet *lts, LogicalTape *lt)
 	return lt->prealloc[--lt->nprealloc];
 }
 
+/*
+ * Record that blocknum is the next block in the tape's chain.
+ */
+static void
+ltsRememberBlock(LogicalTape *lt, long blocknum)
+{
+	TapeExtent *last;
+
+	if (lt->forgetExtents)
+		return;
+
+	if (lt->nextents > 0)
+	{
+		last = &lt->extents[lt->nextents - 1];
+		if (last->first + last->nblocks == blocknum)
+		{
+			last->nblocks++;
+			return;
+		}
+	}
+
+	if (lt->extents == NULL)
+	{
+		lt->extents_size = 16;	/* reasonable initial guess */
+		lt->extents = (TapeExtent *)
+			palloc(lt->extents_size * sizeof(TapeExtent));
+	}
+	else if (lt->nextents >= lt->extents_size)
+	{
+		/*
+		 * If the array would get too large, stop remembering extents; the
+		 * tape is then read without prefetching.
+		 */
+		if (lt->extents_size * 2 * sizeof(TapeExtent) > MaxAllocSize)
+		{
+			lt->forgetExtents = true;
+			lt->nextents = 0;
+			return;
+		}
+		lt->extents_size *= 2;
+		lt->extents = (TapeExtent *)
+			repalloc(lt->extents, lt->extents_size * sizeof(TapeExtent));
+	}
+
+	last = &lt->extents[lt->nextents++];
+	last->first = blocknum;
+	last->nblocks = 1;
+}
+
 /*
  * Return a block# to the freelist.
  */
@@ -641,6 +778,11 @@ ltsInitTape(LogicalTape *lt)
 	lt->prealloc = NULL;
 	lt->nprealloc = 0;
 	lt->prealloc_size = 0;
+	lt->extents = NULL;
+	lt->nextents = 0;
+	lt->extents_size = 0;
+	lt->forgetExtents = false;
+	lt->readExtent = 0;
 }
 
 /*
@@ -656,6 +798,7 @@ ltsInitReadBuffer(LogicalTapeSet *lts, LogicalTape *lt)
 
 	/* Read the first block, or reset if tape is empty */
 	lt->nextBlockNumber = lt->firstBlockNumber;
+	lt->readExtent = 0;
 	lt->pos = 0;
 	lt->nbytes = 0;
 	ltsReadFillBuffer(lts, lt);
@@ -745,6 +888,8 @@ LogicalTapeSetClose(LogicalTapeSet *lts)
 		lt = &lts->tapes[i];
 		if (lt->buffer)
 			pfree(lt->buffer);
+		if (lt->extents)
+			pfree(lt->extents);
 	}
 	pfree(lts->tapes);
 	pfree(lts->freeBlocks);
@@ -796,6 +941,7 @@ LogicalTapeWrite(LogicalTapeSet *lts, int tapenum,
 
 		lt->curBlockNumber = ltsGetBlock(lts, lt);
 		lt->firstBlockNumber = lt->curBlockNumber;
+		ltsRememberBlock(lt, lt->curBlockNumber);
 
 		TapeBlockGetTrailer(lt->buffer)->prev = -1L;
 	}
@@ -819,6 +965,7 @@ LogicalTapeWrite(LogicalTapeSet *lts, int tapenum,
 			 * 'next' pointer of this block.
 			 */
 			nextBlockNumber = ltsGetBlock(lts, lt);
+			ltsRememberBlock(lt, nextBlockNumber);
 
 			/* set the next-pointer and dump the current block. */
 			TapeBlockGetTrailer(lt->buffer)->next = nextBlockNumber;
@@ -960,6 +1107,9 @@ LogicalTapeRewindForWrite(LogicalTapeSet *lts, int tapenum)
 	lt->dirty = false;
 	lt->firstBlockNumber = -1L;
 	lt->curBlockNumber = -1L;
+	lt->nextents = 0;
+	lt->forgetExtents = false;
+	lt->readExtent = 0;
 	lt->pos = 0;
 	lt->nbytes = 0;
 	if (lt->buffer)
@@ -698,6 +698,47 @@ static void tuplesort_updatemax(Tuplesortstate *state);
 #define ST_DEFINE
 #include "lib/sort_template.h"
 
+/*
+ * Radix sort support.
+ *
+ * When the leading key's comparator (which compares abbreviated keys, if
+ * abbreviation is in use) is one of the ssup_datum_*_cmp functions, datum1
+ * can be mapped to an unsigned integer whose natural order is the sort
+ * order.  Then we can do an in-place MSD radix sort ("American flag sort")
+ * on datum1, byte by byte, instead of a comparison sort.  Small partitions
+ * are finished off with the usual qsort, and groups of tuples with equal
+ * datum1 are handed to qsort_tuple() to be tie-broken on the remaining keys
+ * (or on the full key, when datum1 is abbreviated).
+ */
+typedef enum
+{
+	RADIX_KEY_NONE,				/* can't radix sort */
+	RADIX_KEY_UNSIGNED,			/* ssup_datum_unsigned_cmp */
+	RADIX_KEY_SIGNED,			/* ssup_datum_signed_cmp */
+	RADIX_KEY_INT32				/* ssup_datum_int32_cmp */
+} RadixKeyKind;
+
+typedef struct
+{
+	Tuplesortstate *state;
+	RadixKeyKind kind;
+	bool		reverse;		/* descending sort? */
+	int			nbytes;			/* significant bytes of normalized key */
+} RadixSortContext;
+
+/*
+ * Partitions smaller than this are sorted with qsort; the per-pass overhead
+ * of the radix sort (a 256-entry histogram) isn't worth it for them.
+ */
+#define RADIX_SORT_MIN_TUPLES	64
+
+static RadixKeyKind radix_sort_key_kind(Tuplesortstate *state);
+static void radix_sort_memtuples(Tuplesortstate *state, RadixKeyKind kind);
+static void radix_sort_tuple(SortTuple *data, size_t n, int level,
+							 RadixSortContext *cxt);
+static void radix_sort_fallback(SortTuple *data, size_t n,
+								Tuplesortstate *state);
+
 /*
  *		tuplesort_begin_xxx
  *
@@ -3560,8 +3601,16 @@ tuplesort_sort_memtuples(Tuplesortstate *state)
 
 	if (state->memtupcount > 1)
 	{
+		RadixKeyKind kind = RADIX_KEY_NONE;
+
+		if (state->memtupcount >= RADIX_SORT_MIN_TUPLES)
+			kind = radix_sort_key_kind(state);
+
+		/* Can we radix sort on the leading key? */
+		if (kind != RADIX_KEY_NONE)
+			radix_sort_memtuples(state, kind);
 		/* Can we use the single-key sort function? */
-		if (state->onlyKey != NULL)
+		else if (state->onlyKey != NULL)
 			qsort_ssup(state->memtuples, state->memtupcount,
 					   state->onlyKey);
 		else
@@ -3572,6 +3621,239 @@ tuplesort_sort_memtuples(Tuplesortstate *state)
 	}
 }
 
+/*
+ * Determine whether datum1 of the memtuples can be radix sorted, and how its
+ * values are to be interpreted.
+ */
+static RadixKeyKind
+radix_sort_key_kind(Tuplesortstate *state)
+{
+	SortSupport sortKey = state->sortKeys;
+
+	/* The hash index case has no sort keys */
+	if (sortKey == NULL)
+		return RADIX_KEY_NONE;
+
+	/* CLUSTER doesn't set up datum1 if the leading key is an expression */
+	if (state->comparetup == comparetup_cluster &&
+		state->indexInfo->ii_IndexAttrNumbers[0] == 0)
+		return RADIX_KEY_NONE;
+
+	if (sortKey->comparator == ssup_datum_unsigned_cmp)
+		return RADIX_KEY_UNSIGNED;
+#if SIZEOF_DATUM >= 8
+	if (sortKey->comparator == ssup_datum_signed_cmp)
+		return RADIX_KEY_SIGNED;
+#endif
+	if (sortKey->comparator == ssup_datum_int32_cmp)
+		return RADIX_KEY_INT32;
+
+	return RADIX_KEY_NONE;
+}
+
+/*
+ * Map datum1 to an unsigned integer that sorts in the desired order, with
+ * its significant bytes left-aligned in a uint64.
+ */
+static inline uint64
+radix_sort_normalize(Datum datum, const RadixSortContext *cxt)
+{
+	uint64		key;
+
+	switch (cxt->kind)
+	{
+		case RADIX_KEY_SIGNED:
+			key = (uint64) DatumGetInt64(datum) ^ (UINT64CONST(1) << 63);
+			break;
+		case RADIX_KEY_INT32:
+			key = (uint64) ((uint32) DatumGetInt32(datum) ^ ((uint32) 1 << 31)) << 32;
+			break;
+		default:
+			key = (uint64) datum << (64 - SIZEOF_DATUM * BITS_PER_BYTE);
+			break;
+	}
+
+	return cxt->reverse ? ~key : key;
+}
+
+static inline int
+radix_sort_byte(const SortTuple *tuple, int level, const RadixSortContext *cxt)
+{
+	return (int) ((radix_sort_normalize(tuple->datum1, cxt) >>
+				   (56 - level * BITS_PER_BYTE)) & 0xFF);
+}
+
+/*
+ * Sort the memtuples array by radix sorting on datum1.
+ *
+ * NULLs are moved to the correct end of the array first, and are then only
+ * tie-broken among themselves, since they all compare equal on datum1.
+ */
+static void
+radix_sort_memtuples(Tuplesortstate *state, RadixKeyKind kind)
+{
+	SortSupport sortKey = state->sortKeys;
+	SortTuple  *memtuples = state->memtuples;
+	size_t		n = state->memtupcount;
+	size_t		nnulls = 0;
+	SortTuple  *nonnulls;
+	RadixSortContext cxt;
+	size_t		i;
+
+	/* Partition NULLs to the front, and then rotate if they go last */
+	for (i = 0; i < n; i++)
+	{
+		if (memtuples[i].isnull1)
+		{
+			SortTuple	tmp = memtuples[nnulls];
+
+			memtuples[nnulls++] = memtuples[i];
+			memtuples[i] = tmp;
+		}
+	}
+
+	if (nnulls > 0 && nnulls < n && !sortKey->ssup_nulls_first)
+	{
+		/* Swap the NULLs with the last nnulls non-NULL tuples */
+		size_t		nswap = Min(nnulls, n - nnulls);
+
+		for (i = 0; i < nswap; i++)
+		{
+			SortTuple	tmp = memtuples[i];
+
+			memtuples[i] = memtuples[n - nswap + i];
+			memtuples[n - nswap + i] = tmp;
+		}
+		nonnulls = memtuples;
+		if (nnulls > 1 && state->onlyKey == NULL)
+			qsort_tuple(memtuples + n - nnulls, nnulls,
+						state->comparetup, state);
+	}
+	else
+	{
+		nonnulls = memtuples + nnulls;
+		if (nnulls > 1 && state->onlyKey == NULL)
+			qsort_tuple(memtuples, nnulls, state->comparetup, state);
+	}
+
+	cxt.state = state;
+	cxt.kind = kind;
+	cxt.reverse = sortKey->ssup_reverse;
+	cxt.nbytes = (kind == RADIX_KEY_INT32) ? sizeof(int32) :
+		(kind == RADIX_KEY_SIGNED) ? sizeof(int64) : SIZEOF_DATUM;
+
+	radix_sort_tuple(nonnulls, n - nnulls, 0, &cxt);
+}
+
+/*
+ * Sort data[0..n-1], all of whose normalized keys agree in the bytes before
+ * the level'th, by their remaining bytes.
+ */
+static void
+radix_sort_tuple(SortTuple *data, size_t n, int level, RadixSortContext *cxt)
+{
+	size_t		ends[256];
+	size_t		next[256];
+	size_t		start;
+	int			b;
+	size_t		i;
+
+	CHECK_FOR_INTERRUPTS();
+
+	for (;;)
+	{
+		if (n < RADIX_SORT_MIN_TUPLES)
+		{
+			radix_sort_fallback(data, n, cxt->state);
+			return;
+		}
+
+		/* Build histogram of this level's byte */
+		memset(ends, 0, sizeof(ends));
+		for (i = 0; i < n; i++)
+			ends[radix_sort_byte(&data[i], level, cxt)]++;
+
+		/* If all keys share this byte, there's nothing to do at this level */
+		b = radix_sort_byte(&data[0], level, cxt);
+		if (ends[b] != n)
+			break;
+
+		if (++level >= cxt->nbytes)
+		{
+			/* All keys are equal; only the tie-breaker is left */
+			if (cxt->state->onlyKey == NULL)
+				qsort_tuple(data, n, cxt->state->comparetup, cxt->state);
+			return;
+		}
+	}
+
+	/* Turn counts into bucket boundaries */
+	start = 0;
+	for (b = 0; b < 256; b++)
+	{
+		next[b] = start;
+		start += ends[b];
+		ends[b] = start;
+	}
+
+	/*
+	 * Move each tuple to its bucket.  For each bucket in turn, take the first
+	 * tuple that isn't known to be in place, and keep swapping it into the
+	 * next free slot of the bucket it belongs to until we find a tuple that
+	 * belongs in the starting bucket.
+	 */
+	for (b = 0; b < 256; b++)
+	{
+		while (next[b] < ends[b])
+		{
+			SortTuple	tmp = data[next[b]];
+			int			tb = radix_sort_byte(&tmp, level, cxt);
+
+			while (tb != b)
+			{
+				SortTuple	displaced = data[next[tb]];
+
+				data[next[tb]++] = tmp;
+				tmp = displaced;
+				tb = radix_sort_byte(&tmp, level, cxt);
+			}
+			data[next[b]++] = tmp;
+		}
+	}
+
+	/* Now sort each bucket by the following bytes */
+	start = 0;
+	for (b = 0; b < 256; b++)
+	{
+		size_t		count = ends[b] - start;
+
+		if (count > 1)
+		{
+			if (level + 1 < cxt->nbytes)
+				radix_sort_tuple(data + start, count, level + 1, cxt);
+			else if (cxt->state->onlyKey == NULL)
+				qsort_tuple(data + start, count,
+							cxt->state->comparetup, cxt->state);
+		}
+		start = ends[b];
+	}
+}
+
+/*
+ * Sort a small partition of the memtuples array with qsort.
+ */
+static void
+radix_sort_fallback(SortTuple *data, size_t n, Tuplesortstate *state)
+{
+	if (n < 2)
+		return;
+
+	if (state->onlyKey != NULL)
+		qsort_ssup(data, n, state->onlyKey);
+	else
+		qsort_tuple(data, n, state->comparetup, state);
+}
+
 /*
  * Insert a new tuple into an empty or existing heap, maintaining the
  * heap invariant.  Caller is responsible for ensuring there's room.
@@ -4782,3 +5064,48 @@ free_sort_tuple(Tuplesortstate *state, SortTuple *stup)
 		stup->tuple = NULL;
 	}
 }
+
+/*
+ * Specialized comparators that we can radix sort on; see
+ * radix_sort_key_kind().
+ */
+int
+ssup_datum_unsigned_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	if (x < y)
+		return -1;
+	else if (x > y)
+		return 1;
+	else
+		return 0;
+}
+
+#if SIZEOF_DATUM >= 8
+int
+ssup_datum_signed_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	int64		xx = DatumGetInt64(x);
+	int64		yy = DatumGetInt64(y);
+
+	if (xx < yy)
+		return -1;
+	else if (xx > yy)
+		return 1;
+	else
+		return 0;
+}
+#endif
+
+int
+ssup_datum_int32_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	int32		xx = DatumGetInt32(x);
+	int32		yy = DatumGetInt32(y);
+
+	if (xx < yy)
+		return -1;
+	else if (xx > yy)
+		return 1;
+	else
+		return 0;
+}
@@ -150,6 +150,7 @@ static bool verify_checksums = true;
 static bool manifest = true;
 static bool manifest_force_encode = false;
 static char *manifest_checksums = NULL;
+static char *incremental_from = NULL;
 
 static bool success = false;
 static bool made_new_pgdata = false;
@@ -188,6 +189,7 @@ static PQExpBuffer recoveryconfcontents = NULL;
 /* Function headers */
 static void usage(void);
 static void verify_dir_is_empty_or_create(char *dirname, bool *created, bool *found);
+static char *get_backup_start_lsn(const char *dirname);
 static void progress_report(int tablespacenum, const char *filename, bool force,
 							bool finished);
 
@@ -408,6 +410,8 @@ usage(void)
 	printf(_("  -c, --checkpoint=fast|spread\n"
 			 "                         set fast or spread checkpointing\n"));
 	printf(_("  -C, --create-slot      create replication slot\n"));
+	printf(_("  -i, --incremental=OLDBACKUP\n"
+			 "                         take incremental backup relative to OLDBACKUP\n"));
 	printf(_("  -l, --label=LABEL      set backup label\n"));
 	printf(_("  -n, --no-clean         do not clean up after errors\n"));
 	printf(_("  -N, --no-sync          do not wait for changes to be written safely to disk\n"));
@@ -771,6 +775,53 @@ verify_dir_is_empty_or_create(char *dirname, bool *created, bool *found)
 	}
 }
 
+/*
+ * Read the start LSN of an earlier plain-format backup from its
+ * backup_label file, for use as the reference of an incremental backup.
+ */
+static char *
+get_backup_start_lsn(const char *dirname)
+{
+	char		filename[MAXPGPATH];
+	char		line[MAXPGPATH];
+	FILE	   *fp;
+	uint32		hi,
+				lo;
+	bool		found = false;
+
+	snprintf(filename, sizeof(filename), "%s/backup_label", dirname);
+	fp = fopen(filename, "r");
+	if (fp == NULL)
+	{
+		pg_log_error("could not open file \"%s\": %m", filename);
+		exit(1);
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		if (sscanf(line, "START WAL LOCATION: %X/%X", &hi, &lo) == 2)
+		{
+			found = true;
+			break;
+		}
+	}
+
+	if (ferror(fp))
+	{
+		pg_log_error("could not read file \"%s\": %m", filename);
+		exit(1);
+	}
+	fclose(fp);
+
+	if (!found)
+	{
+		pg_log_error("could not find start WAL location in file \"%s\"",
+					 filename);
+		exit(1);
+	}
+
+	return psprintf("%X/%X", hi, lo);
+}
 
 /*
  * Print a progress report based on the global variables. If verbose output
@@ -1816,6 +1867,7 @@ BaseBackup(void)
 	char	   *maxrate_clause = NULL;
 	char	   *manifest_clause = NULL;
 	char	   *manifest_checksums_clause = "";
+	char	   *incremental_clause = "";
 	int			i;
 	char		xlogstart[64];
 	char		xlogend[64];
@@ -1889,6 +1941,10 @@ BaseBackup(void)
 												 manifest_checksums);
 	}
 
+	if (incremental_from != NULL)
+		incremental_clause = psprintf("INCREMENTAL '%s'",
+									  get_backup_start_lsn(incremental_from));
+
 	if (verbose)
 		pg_log_info("initiating base backup, waiting for checkpoint to complete");
 
@@ -1902,7 +1958,7 @@ BaseBackup(void)
 	}
 
 	basebkp =
-		psprintf("BASE_BACKUP LABEL '%s' %s %s %s %s %s %s %s %s %s",
+		psprintf("BASE_BACKUP LABEL '%s' %s %s %s %s %s %s %s %s %s %s",
 				 escaped_label,
 				 estimatesize ? "PROGRESS" : "",
 				 includewal == FETCH_WAL ? "WAL" : "",
@@ -1912,7 +1968,8 @@ BaseBackup(void)
 				 format == 't' ? "TABLESPACE_MAP" : "",
 				 verify_checksums ? "" : "NOVERIFY_CHECKSUMS",
 				 manifest_clause ? manifest_clause : "",
-				 manifest_checksums_clause);
+				 manifest_checksums_clause,
+				 incremental_clause);
 
 	if (PQsendQuery(conn, basebkp) == 0)
 	{
@@ -2249,6 +2306,7 @@ main(int argc, char **argv)
 		{"wal-method", required_argument, NULL, 'X'},
 		{"gzip", no_argument, NULL, 'z'},
 		{"compress", required_argument, NULL, 'Z'},
+		{"incremental", required_argument, NULL, 'i'},
 		{"label", required_argument, NULL, 'l'},
 		{"no-clean", no_argument, NULL, 'n'},
 		{"no-sync", no_argument, NULL, 'N'},
@@ -2295,7 +2353,7 @@ main(int argc, char **argv)
 
 	atexit(cleanup_directories_atexit);
 
-	while ((c = getopt_long(argc, argv, "CD:F:r:RS:T:X:l:nNzZ:d:c:h:p:U:s:wWkvP",
+	while ((c = getopt_long(argc, argv, "CD:F:r:RS:T:X:i:l:nNzZ:d:c:h:p:U:s:wWkvP",
 							long_options, &option_index)) != -1)
 	{
 		switch (c)
@@ -2365,6 +2423,9 @@ main(int argc, char **argv)
 			case 1:
 				xlog_dir = pg_strdup(optarg);
 				break;
+			case 'i':
+				incremental_from = pg_strdup(optarg);
+				break;
 			case 'l':
 				label = pg_strdup(optarg);
 				break;
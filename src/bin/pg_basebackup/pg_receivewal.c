@@ -22,6 +22,7 @@
 #include "access/xlog_internal.h"
 #include "common/file_perm.h"
 #include "common/logging.h"
+#include "common/walstream_compression.h"
 #include "getopt_long.h"
 #include "libpq-fe.h"
 #include "receivelog.h"
@@ -43,6 +44,7 @@ static bool do_drop_slot = false;
 static bool do_sync = true;
 static bool synchronous = false;
 static char *replication_slot = NULL;
+static char *stream_compression = NULL;
 static XLogRecPtr endpos = InvalidXLogRecPtr;
 
 
@@ -87,6 +89,9 @@ usage(void)
 	printf(_("  -s, --status-interval=SECS\n"
 			 "                         time between status packets sent to server (default: %d)\n"), (standby_message_timeout / 1000));
 	printf(_("  -S, --slot=SLOTNAME    replication slot to use\n"));
+	printf(_("      --stream-compression=METHOD\n"
+			 "                         ask the server to compress streamed WAL with METHOD\n"
+			 "                         (pglz, lz4 or zstd)\n"));
 	printf(_("      --synchronous      flush write-ahead log immediately after writing\n"));
 	printf(_("  -v, --verbose          output verbose messages\n"));
 	printf(_("  -V, --version          output version information, then exit\n"));
@@ -392,6 +397,13 @@ StreamLog(void)
 		exit(1);
 	}
 
+	/*
+	 * Likewise, a server that doesn't support stream compression won't start
+	 * to support it if we retry.
+	 */
+	if (stream_compression != NULL && !CheckServerStreamCompression(conn))
+		exit(1);
+
 	/*
 	 * Identify server, obtaining start LSN position and current timeline ID
 	 * at the same time, necessary if not valid data can be found in the
@@ -433,6 +445,7 @@ StreamLog(void)
 												stream.do_sync);
 	stream.partial_suffix = ".partial";
 	stream.replication_slot = replication_slot;
+	stream.compression = stream_compression;
 
 	ReceiveXlogStream(conn, &stream);
 
@@ -489,6 +502,7 @@ main(int argc, char **argv)
 		{"if-not-exists", no_argument, NULL, 3},
 		{"synchronous", no_argument, NULL, 4},
 		{"no-sync", no_argument, NULL, 5},
+		{"stream-compression", required_argument, NULL, 6},
 		{NULL, 0, NULL, 0}
 	};
 
@@ -597,6 +611,25 @@ main(int argc, char **argv)
 			case 5:
 				do_sync = false;
 				break;
+			case 6:
+				{
+					pg_walstream_compression method;
+
+					if (!pg_walstream_parse_compression(optarg, &method))
+					{
+						pg_log_error("invalid stream compression method \"%s\"",
+									 optarg);
+						exit(1);
+					}
+					if (!pg_walstream_compression_supported(method))
+					{
+						pg_log_error("this build does not support stream compression method \"%s\"",
+									 optarg);
+						exit(1);
+					}
+					stream_compression = pg_strdup(pg_walstream_compression_name(method));
+				}
+				break;
 			default:
 
 				/*
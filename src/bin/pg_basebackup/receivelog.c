@@ -23,7 +23,9 @@
 #include "access/xlog_internal.h"
 #include "common/file_utils.h"
 #include "common/logging.h"
+#include "common/walstream_compression.h"
 #include "libpq-fe.h"
+#include "port/pg_bswap.h"
 #include "receivelog.h"
 #include "streamutil.h"
 
@@ -44,6 +46,8 @@ static bool ProcessKeepaliveMsg(PGconn *conn, StreamCtl *stream, char *copybuf,
 								int len, XLogRecPtr blockpos, TimestampTz *last_status);
 static bool ProcessXLogDataMsg(PGconn *conn, StreamCtl *stream, char *copybuf, int len,
 							   XLogRecPtr *blockpos);
+static bool DecompressXLogDataMsg(char *copybuf, int len, char **msgbuf,
+								  int *msglen);
 static PGresult *HandleEndOfCopyStream(PGconn *conn, StreamCtl *stream, char *copybuf,
 									   XLogRecPtr blockpos, XLogRecPtr *stoppos);
 static bool CheckCopyStreamStop(PGconn *conn, StreamCtl *stream, XLogRecPtr blockpos);
@@ -448,7 +452,7 @@ CheckServerVersionForStreaming(PGconn *conn)
 bool
 ReceiveXlogStream(PGconn *conn, StreamCtl *stream)
 {
-	char		query[128];
+	char		query[256];
 	char		slotcmd[128];
 	PGresult   *res;
 	XLogRecPtr	stoppos;
@@ -576,6 +580,9 @@ ReceiveXlogStream(PGconn *conn, StreamCtl *stream)
 				 slotcmd,
 				 LSN_FORMAT_ARGS(stream->startpos),
 				 stream->timeline);
+		if (stream->compression)
+			snprintf(query + strlen(query), sizeof(query) - strlen(query),
+					 " (compression '%s')", stream->compression);
 		res = PQexec(conn, query);
 		if (PQresultStatus(res) != PGRES_COPY_BOTH)
 		{
@@ -841,6 +848,23 @@ HandleCopyStream(PGconn *conn, StreamCtl *stream,
 				if (!CheckCopyStreamStop(conn, stream, blockpos))
 					goto error;
 			}
+			else if (copybuf[0] == 'z')
+			{
+				char	   *msgbuf;
+				int			msglen;
+
+				if (!DecompressXLogDataMsg(copybuf, r, &msgbuf, &msglen))
+					goto error;
+				if (!ProcessXLogDataMsg(conn, stream, msgbuf, msglen, &blockpos))
+					goto error;
+
+				/*
+				 * Check if we should continue streaming, or abort at this
+				 * point.
+				 */
+				if (!CheckCopyStreamStop(conn, stream, blockpos))
+					goto error;
+			}
 			else
 			{
 				pg_log_error("unrecognized streaming header: \"%c\"",
@@ -1171,6 +1195,68 @@ ProcessXLogDataMsg(PGconn *conn, StreamCtl *stream, char *copybuf, int len,
 	return true;
 }
 
+/*
+ * Decompress a compressed XLogData message.
+ *
+ * The result is returned in *msgbuf and *msglen in the format of a plain
+ * XLogData message, ready for ProcessXLogDataMsg().  The buffer is reused for
+ * the next message.
+ */
+static bool
+DecompressXLogDataMsg(char *copybuf, int len, char **msgbuf, int *msglen)
+{
+	static char *buf = NULL;
+	static int	bufsize = 0;
+	pg_walstream_compression method;
+	uint32		n32;
+	int			rawlen;
+	int			hdr_len;
+
+	hdr_len = 1;				/* msgtype 'z' */
+	hdr_len += 8;				/* dataStart */
+	hdr_len += 8;				/* walEnd */
+	hdr_len += 8;				/* sendTime */
+	if (len < hdr_len + 1 + 4)
+	{
+		pg_log_error("streaming header too small: %d", len);
+		return false;
+	}
+
+	method = (pg_walstream_compression) copybuf[hdr_len];
+	memcpy(&n32, &copybuf[hdr_len + 1], sizeof(n32));
+	rawlen = (int) pg_ntoh32(n32);
+	if (rawlen <= 0 || rawlen > WalSegSz)
+	{
+		pg_log_error("invalid uncompressed size in streaming header: %d",
+					 rawlen);
+		return false;
+	}
+
+	if (bufsize < hdr_len + rawlen)
+	{
+		bufsize = hdr_len + rawlen;
+		buf = pg_realloc(buf, bufsize);
+	}
+
+	/* same header as a plain XLogData message */
+	memcpy(buf, copybuf, hdr_len);
+	buf[0] = 'w';
+
+	if (pg_walstream_decompress(method,
+								copybuf + hdr_len + 1 + 4,
+								len - hdr_len - 1 - 4,
+								buf + hdr_len, rawlen) != rawlen)
+	{
+		pg_log_error("could not decompress write-ahead log data with method %d",
+					 (int) method);
+		return false;
+	}
+
+	*msgbuf = buf;
+	*msglen = hdr_len + rawlen;
+	return true;
+}
+
 /*
  * Handle end of the copy stream.
  */
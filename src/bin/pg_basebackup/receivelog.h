@@ -46,6 +46,7 @@ typedef struct StreamCtl
 	WalWriteMethod *walmethod;	/* How to write the WAL */
 	char	   *partial_suffix; /* Suffix appended to partially received files */
 	char	   *replication_slot;	/* Replication slot to use, or NULL */
+	char	   *compression;	/* Compression methods to offer, or NULL */
 } StreamCtl;
 
 
@@ -30,6 +30,7 @@
 #include "streamutil.h"
 
 #define ERRCODE_DUPLICATE_OBJECT  "42710"
+#define ERRCODE_UNDEFINED_OBJECT  "42704"
 
 uint32		WalSegSz;
 
@@ -340,6 +341,49 @@ RetrieveWalSegSize(PGconn *conn)
 	return true;
 }
 
+/*
+ * Check whether the server accepts the compression option of physical
+ * START_REPLICATION.  That option came with the wal_receiver_compression
+ * setting, so ask for the setting: servers without it reject it as an
+ * unrecognized parameter.
+ *
+ * Returns false after reporting an error if the server doesn't support
+ * stream compression, or if we couldn't find out.
+ */
+bool
+CheckServerStreamCompression(PGconn *conn)
+{
+	PGresult   *res;
+
+	/* check connection existence */
+	Assert(conn != NULL);
+
+	/* older versions can't run SHOW over a replication connection */
+	if (PQserverVersion(conn) < MINIMUM_VERSION_FOR_SHOW_CMD)
+	{
+		pg_log_error("server does not support stream compression");
+		return false;
+	}
+
+	res = PQexec(conn, "SHOW wal_receiver_compression");
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+	{
+		const char *sqlstate = PQresultErrorField(res, PG_DIAG_SQLSTATE);
+
+		if (sqlstate && strcmp(sqlstate, ERRCODE_UNDEFINED_OBJECT) == 0)
+			pg_log_error("server does not support stream compression");
+		else
+			pg_log_error("could not send replication command \"%s\": %s",
+						 "SHOW wal_receiver_compression", PQerrorMessage(conn));
+
+		PQclear(res);
+		return false;
+	}
+
+	PQclear(res);
+	return true;
+}
+
 /*
  * RetrieveDataDirCreatePerm
  *
@@ -5,7 +5,7 @@ use strict;
 use warnings;
 use TestLib;
 use PostgresNode;
-use Test::More tests => 19;
+use Test::More tests => 22;
 
 program_help_ok('pg_receivewal');
 program_version_ok('pg_receivewal');
@@ -33,6 +33,9 @@ $primary->command_fails(
 $primary->command_fails(
 	[ 'pg_receivewal', '-D', $stream_dir, '--synchronous', '--no-sync' ],
 	'failure if --synchronous specified with --no-sync');
+$primary->command_fails(
+	[ 'pg_receivewal', '-D', $stream_dir, '--stream-compression', 'foo' ],
+	'failure if --stream-compression specified with an invalid method');
 
 # Slot creation and drop
 my $slot_name = 'test';
@@ -75,3 +78,31 @@ SKIP:
 	ok(check_mode_recursive($stream_dir, 0700, 0600),
 		"check stream dir permissions");
 }
+
+# Stream some more WAL, asking for the replication stream to be
+# compressed.  The rest of the switched segment compresses well.
+$primary->psql('postgres',
+	'INSERT INTO test_table VALUES (generate_series(101,1000));');
+$primary->psql('postgres', 'SELECT pg_switch_wal();');
+$nextlsn =
+  $primary->safe_psql('postgres', 'SELECT pg_current_wal_insert_lsn();');
+chomp($nextlsn);
+
+# The walsender reports the method it settled on at DEBUG1.
+$primary->append_conf('postgresql.conf', 'log_min_messages = debug1');
+$primary->restart;
+my $logstart = -s $primary->logfile;
+
+$primary->command_ok(
+	[
+		'pg_receivewal',        '-D',
+		$stream_dir,            '--verbose',
+		'--endpos',             $nextlsn,
+		'--stream-compression', 'pglz',
+		'--no-loop'
+	],
+	'streaming some WAL with --stream-compression');
+like(
+	substr(slurp_file($primary->logfile), $logstart),
+	qr/compressing WAL data messages with pglz/,
+	'walsender compressed the stream with pglz');
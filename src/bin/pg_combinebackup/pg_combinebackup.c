@@ -0,0 +1,747 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_combinebackup.c
+ *	  Reconstruct a full backup from a full backup and a chain of
+ *	  incremental backups taken relative to it
+ *
+ * Every file in the newest backup is copied to the output directory, except
+ * that incremental relation files are replaced by the full file they stand
+ * for. For each block of such a file, we use the newest backup that has a
+ * copy of it; blocks that no backup has were never written since the file
+ * was last truncated or extended, so they are filled with zeroes.
+ *
+ * Copyright (c) 2021, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/bin/pg_combinebackup/pg_combinebackup.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres_fe.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "access/xlogdefs.h"
+#include "common/file_perm.h"
+#include "common/file_utils.h"
+#include "common/logging.h"
+#include "getopt_long.h"
+#include "replication/basebackup_incremental.h"
+
+/* Size of the buffer used to copy files that need no reconstruction. */
+#define COPY_BUFFER_SIZE	(128 * 1024)
+
+/*
+ * One of the backups given on the command line, oldest first.
+ */
+typedef struct backup_info
+{
+	char	   *dir;
+	XLogRecPtr	start_lsn;
+	XLogRecPtr	incremental_from;	/* InvalidXLogRecPtr if a full backup */
+} backup_info;
+
+/*
+ * One version of a relation segment, either a full file or an incremental
+ * file, that may supply blocks of the reconstructed file.
+ */
+typedef struct rfile
+{
+	char	   *path;
+	int			fd;
+	bool		incremental;
+	unsigned	num_blocks;		/* blocks contained in the file */
+	BlockNumber *relative_block_numbers;	/* incremental files only */
+	unsigned	truncation_block_length;	/* incremental files only */
+	size_t		header_length;	/* incremental files only */
+} rfile;
+
+static const char *progname;
+static char *output_dir = NULL;
+static bool do_sync = true;
+
+static backup_info *backups;
+static int	nbackups;
+
+static void usage(void);
+static void read_backup_label(backup_info *backup);
+static void check_backup_chain(void);
+static void process_directory(const char *relpath);
+static void copy_file(const char *src, const char *dst);
+static void copy_backup_label(const char *src, const char *dst);
+static void reconstruct_file(const char *relpath, const char *filename);
+static rfile *open_full_file(const char *path);
+static rfile *open_incremental_file(const char *path);
+static void close_rfile(rfile *rf);
+static void read_exactly(int fd, char *buf, size_t nbytes, off_t offset,
+						 const char *path);
+
+static void
+usage(void)
+{
+	printf(_("%s reconstructs a full backup from an incremental backup chain.\n\n"), progname);
+	printf(_("Usage:\n"));
+	printf(_("  %s [OPTION]... BACKUPDIR...\n"), progname);
+	printf(_("\nOptions:\n"));
+	printf(_("  -d, --debug              generate lots of debugging output\n"));
+	printf(_("  -o, --output=DIRECTORY   write the reconstructed backup into DIRECTORY\n"));
+	printf(_("  -N, --no-sync            do not wait for changes to be written safely to disk\n"));
+	printf(_("  -V, --version            output version information, then exit\n"));
+	printf(_("  -?, --help               show this help, then exit\n"));
+	printf(_("\nThe backups must be plain-format backups, given oldest first: a full\n"
+			 "backup followed by incremental backups each taken relative to the one\n"
+			 "before it.\n\n"));
+	printf(_("Report bugs to <%s>.\n"), PACKAGE_BUGREPORT);
+	printf(_("%s home page: <%s>\n"), PACKAGE_NAME, PACKAGE_URL);
+}
+
+/*
+ * Read the start LSN and, for incremental backups, the reference LSN from
+ * the backup_label file of a backup.
+ */
+static void
+read_backup_label(backup_info *backup)
+{
+	char		path[MAXPGPATH];
+	char		line[MAXPGPATH];
+	FILE	   *fp;
+	uint32		hi,
+				lo;
+
+	backup->start_lsn = InvalidXLogRecPtr;
+	backup->incremental_from = InvalidXLogRecPtr;
+
+	snprintf(path, sizeof(path), "%s/backup_label", backup->dir);
+	fp = fopen(path, "r");
+	if (fp == NULL)
+	{
+		pg_log_error("could not open file \"%s\": %m", path);
+		exit(1);
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		if (sscanf(line, "START WAL LOCATION: %X/%X", &hi, &lo) == 2)
+			backup->start_lsn = ((uint64) hi) << 32 | lo;
+		else if (sscanf(line, "INCREMENTAL FROM LSN: %X/%X", &hi, &lo) == 2)
+			backup->incremental_from = ((uint64) hi) << 32 | lo;
+	}
+
+	if (ferror(fp))
+	{
+		pg_log_error("could not read file \"%s\": %m", path);
+		exit(1);
+	}
+	fclose(fp);
+
+	if (XLogRecPtrIsInvalid(backup->start_lsn))
+	{
+		pg_log_error("could not find start WAL location in file \"%s\"", path);
+		exit(1);
+	}
+}
+
+/*
+ * Check that the backups form a chain: a full backup, followed by
+ * incremental backups each taken relative to its predecessor.
+ */
+static void
+check_backup_chain(void)
+{
+	int			i;
+
+	if (!XLogRecPtrIsInvalid(backups[0].incremental_from))
+	{
+		pg_log_error("backup \"%s\" is an incremental backup, but the first backup must be a full backup",
+					 backups[0].dir);
+		exit(1);
+	}
+
+	for (i = 1; i < nbackups; i++)
+	{
+		if (XLogRecPtrIsInvalid(backups[i].incremental_from))
+		{
+			pg_log_error("backup \"%s\" is a full backup, but only the first backup may be a full backup",
+						 backups[i].dir);
+			exit(1);
+		}
+
+		if (backups[i].incremental_from != backups[i - 1].start_lsn)
+		{
+			pg_log_error("backup \"%s\" was taken relative to %X/%X, but backup \"%s\" starts at %X/%X",
+						 backups[i].dir,
+						 LSN_FORMAT_ARGS(backups[i].incremental_from),
+						 backups[i - 1].dir,
+						 LSN_FORMAT_ARGS(backups[i - 1].start_lsn));
+			exit(1);
+		}
+	}
+}
+
+/*
+ * Recreate one directory of the newest backup, given by its path relative
+ * to the top of the backup, in the output directory.
+ *
+ * Symbolic links, such as those for tablespaces in pg_tblspc, are followed,
+ * so a tablespace is reconstructed as a directory inside pg_tblspc.
+ */
+static void
+process_directory(const char *relpath)
+{
+	char		dirpath[MAXPGPATH];
+	DIR		   *dir;
+	struct dirent *de;
+	bool		toplevel = (relpath[0] == '\0');
+
+	snprintf(dirpath, sizeof(dirpath), "%s%s%s", backups[nbackups - 1].dir,
+			 toplevel ? "" : "/", relpath);
+
+	dir = opendir(dirpath);
+	if (dir == NULL)
+	{
+		pg_log_error("could not open directory \"%s\": %m", dirpath);
+		exit(1);
+	}
+
+	while (errno = 0, (de = readdir(dir)) != NULL)
+	{
+		char		childrel[MAXPGPATH];
+		char		srcpath[MAXPGPATH];
+		char		dstpath[MAXPGPATH];
+		struct stat st;
+
+		if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+			continue;
+
+		snprintf(childrel, sizeof(childrel), "%s%s%s", relpath,
+				 toplevel ? "" : "/", de->d_name);
+		snprintf(srcpath, sizeof(srcpath), "%s/%s", dirpath, de->d_name);
+		snprintf(dstpath, sizeof(dstpath), "%s/%s", output_dir, childrel);
+
+		if (stat(srcpath, &st) != 0)
+		{
+			pg_log_error("could not stat file \"%s\": %m", srcpath);
+			exit(1);
+		}
+
+		if (S_ISDIR(st.st_mode))
+		{
+			if (mkdir(dstpath, pg_dir_create_mode) != 0)
+			{
+				pg_log_error("could not create directory \"%s\": %m", dstpath);
+				exit(1);
+			}
+			process_directory(childrel);
+		}
+		else if (!S_ISREG(st.st_mode))
+			pg_log_warning("skipping special file \"%s\"", srcpath);
+		else if (toplevel && strcmp(de->d_name, "backup_manifest") == 0)
+		{
+			/*
+			 * The manifest describes the incremental backup, not the result,
+			 * so it would only confuse pg_verifybackup.
+			 */
+			continue;
+		}
+		else if (toplevel && strcmp(de->d_name, "backup_label") == 0)
+			copy_backup_label(srcpath, dstpath);
+		else if (strncmp(de->d_name, INCREMENTAL_PREFIX,
+						 INCREMENTAL_PREFIX_LENGTH) == 0)
+			reconstruct_file(relpath,
+							 de->d_name + INCREMENTAL_PREFIX_LENGTH);
+		else
+			copy_file(srcpath, dstpath);
+	}
+
+	if (errno)
+	{
+		pg_log_error("could not read directory \"%s\": %m", dirpath);
+		exit(1);
+	}
+
+	if (closedir(dir))
+	{
+		pg_log_error("could not close directory \"%s\": %m", dirpath);
+		exit(1);
+	}
+}
+
+/*
+ * Copy a file unchanged.
+ */
+static void
+copy_file(const char *src, const char *dst)
+{
+	int			srcfd;
+	int			dstfd;
+	char	   *buf;
+	ssize_t		rb;
+
+	pg_log_debug("copying \"%s\" to \"%s\"", src, dst);
+
+	if ((srcfd = open(src, O_RDONLY | PG_BINARY, 0)) < 0)
+	{
+		pg_log_error("could not open file \"%s\": %m", src);
+		exit(1);
+	}
+	if ((dstfd = open(dst, O_WRONLY | O_CREAT | O_EXCL | PG_BINARY,
+					  pg_file_create_mode)) < 0)
+	{
+		pg_log_error("could not create file \"%s\": %m", dst);
+		exit(1);
+	}
+
+	buf = pg_malloc(COPY_BUFFER_SIZE);
+	while ((rb = read(srcfd, buf, COPY_BUFFER_SIZE)) > 0)
+	{
+		ssize_t		wb;
+
+		if ((wb = write(dstfd, buf, rb)) != rb)
+		{
+			if (wb < 0)
+				pg_log_error("could not write file \"%s\": %m", dst);
+			else
+				pg_log_error("could not write file \"%s\": wrote only %d of %d bytes",
+							 dst, (int) wb, (int) rb);
+			exit(1);
+		}
+	}
+	if (rb < 0)
+	{
+		pg_log_error("could not read file \"%s\": %m", src);
+		exit(1);
+	}
+
+	pg_free(buf);
+	close(srcfd);
+	if (close(dstfd) != 0)
+	{
+		pg_log_error("could not close file \"%s\": %m", dst);
+		exit(1);
+	}
+}
+
+/*
+ * Copy backup_label, leaving out the line that marks the backup as
+ * incremental, since the result is a full backup.
+ */
+static void
+copy_backup_label(const char *src, const char *dst)
+{
+	FILE	   *in;
+	FILE	   *out;
+	char		line[MAXPGPATH];
+
+	if ((in = fopen(src, "r")) == NULL)
+	{
+		pg_log_error("could not open file \"%s\": %m", src);
+		exit(1);
+	}
+	if ((out = fopen(dst, "w")) == NULL)
+	{
+		pg_log_error("could not create file \"%s\": %m", dst);
+		exit(1);
+	}
+
+	while (fgets(line, sizeof(line), in) != NULL)
+	{
+		if (strncmp(line, "INCREMENTAL FROM LSN: ", 22) == 0)
+			continue;
+		if (fputs(line, out) < 0)
+		{
+			pg_log_error("could not write file \"%s\": %m", dst);
+			exit(1);
+		}
+	}
+
+	if (ferror(in))
+	{
+		pg_log_error("could not read file \"%s\": %m", src);
+		exit(1);
+	}
+	fclose(in);
+	if (fclose(out) != 0)
+	{
+		pg_log_error("could not write file \"%s\": %m", dst);
+		exit(1);
+	}
+}
+
+/*
+ * Reconstruct the relation segment "filename" in directory "relpath" from
+ * the incremental file in the newest backup and whatever older versions
+ * the earlier backups have.
+ */
+static void
+reconstruct_file(const char *relpath, const char *filename)
+{
+	rfile	  **sources;
+	rfile	  **source_map;
+	off_t	   *offset_map;
+	unsigned	nsources = 0;
+	BlockNumber nblocks;
+	BlockNumber limit;
+	BlockNumber blkno;
+	char		dstpath[MAXPGPATH];
+	char		buf[BLCKSZ];
+	int			dstfd;
+	int			i;
+
+	sources = pg_malloc0(sizeof(rfile *) * nbackups);
+
+	/*
+	 * Find the versions of the file to use, newest first. We can stop at the
+	 * first full copy; if some backup has no copy at all, the relation did
+	 * not exist yet, or the segment was not created yet, at that point.
+	 */
+	for (i = nbackups - 1; i >= 0; i--)
+	{
+		char		path[MAXPGPATH];
+		struct stat st;
+
+		snprintf(path, sizeof(path), "%s/%s%s%s%s", backups[i].dir,
+				 relpath, relpath[0] == '\0' ? "" : "/",
+				 INCREMENTAL_PREFIX, filename);
+		if (stat(path, &st) == 0)
+		{
+			sources[nsources++] = open_incremental_file(path);
+			continue;
+		}
+		else if (errno != ENOENT)
+		{
+			pg_log_error("could not stat file \"%s\": %m", path);
+			exit(1);
+		}
+
+		/* The newest backup is the one we found the incremental file in. */
+		Assert(i != nbackups - 1);
+
+		snprintf(path, sizeof(path), "%s/%s%s%s", backups[i].dir,
+				 relpath, relpath[0] == '\0' ? "" : "/", filename);
+		if (stat(path, &st) == 0)
+			sources[nsources++] = open_full_file(path);
+		else if (errno != ENOENT)
+		{
+			pg_log_error("could not stat file \"%s\": %m", path);
+			exit(1);
+		}
+		break;
+	}
+
+	/*
+	 * Decide where each block comes from. A block can only come from an
+	 * older version if no newer one truncated the file below it.
+	 */
+	nblocks = sources[0]->truncation_block_length;
+	source_map = pg_malloc0(sizeof(rfile *) * Max(nblocks, 1));
+	offset_map = pg_malloc0(sizeof(off_t) * Max(nblocks, 1));
+	limit = nblocks;
+	for (i = 0; i < nsources; i++)
+	{
+		rfile	   *rf = sources[i];
+
+		if (rf->incremental)
+		{
+			unsigned	j;
+
+			for (j = 0; j < rf->num_blocks; j++)
+			{
+				blkno = rf->relative_block_numbers[j];
+				if (blkno < limit && source_map[blkno] == NULL)
+				{
+					source_map[blkno] = rf;
+					offset_map[blkno] = rf->header_length + (off_t) j * BLCKSZ;
+				}
+			}
+			limit = Min(limit, rf->truncation_block_length);
+		}
+		else
+		{
+			for (blkno = 0; blkno < Min(limit, rf->num_blocks); blkno++)
+			{
+				if (source_map[blkno] == NULL)
+				{
+					source_map[blkno] = rf;
+					offset_map[blkno] = (off_t) blkno * BLCKSZ;
+				}
+			}
+		}
+	}
+
+	snprintf(dstpath, sizeof(dstpath), "%s/%s%s%s", output_dir, relpath,
+			 relpath[0] == '\0' ? "" : "/", filename);
+	pg_log_debug("reconstructing \"%s\" from %u versions", dstpath, nsources);
+
+	if ((dstfd = open(dstpath, O_WRONLY | O_CREAT | O_EXCL | PG_BINARY,
+					  pg_file_create_mode)) < 0)
+	{
+		pg_log_error("could not create file \"%s\": %m", dstpath);
+		exit(1);
+	}
+
+	for (blkno = 0; blkno < nblocks; blkno++)
+	{
+		rfile	   *rf = source_map[blkno];
+		ssize_t		wb;
+
+		if (rf == NULL)
+			memset(buf, 0, BLCKSZ);
+		else
+			read_exactly(rf->fd, buf, BLCKSZ, offset_map[blkno], rf->path);
+
+		if ((wb = write(dstfd, buf, BLCKSZ)) != BLCKSZ)
+		{
+			if (wb < 0)
+				pg_log_error("could not write file \"%s\": %m", dstpath);
+			else
+				pg_log_error("could not write file \"%s\": wrote only %d of %d bytes",
+							 dstpath, (int) wb, BLCKSZ);
+			exit(1);
+		}
+	}
+
+	if (close(dstfd) != 0)
+	{
+		pg_log_error("could not close file \"%s\": %m", dstpath);
+		exit(1);
+	}
+
+	for (i = 0; i < nsources; i++)
+		close_rfile(sources[i]);
+	pg_free(sources);
+	pg_free(source_map);
+	pg_free(offset_map);
+}
+
+/*
+ * Open a full copy of a relation segment as a source of blocks.
+ */
+static rfile *
+open_full_file(const char *path)
+{
+	rfile	   *rf = pg_malloc0(sizeof(rfile));
+	struct stat st;
+
+	rf->path = pg_strdup(path);
+	if ((rf->fd = open(path, O_RDONLY | PG_BINARY, 0)) < 0)
+	{
+		pg_log_error("could not open file \"%s\": %m", path);
+		exit(1);
+	}
+	if (fstat(rf->fd, &st) != 0)
+	{
+		pg_log_error("could not stat file \"%s\": %m", path);
+		exit(1);
+	}
+	rf->incremental = false;
+	rf->num_blocks = st.st_size / BLCKSZ;
+
+	return rf;
+}
+
+/*
+ * Open an incremental file and read its header.
+ */
+static rfile *
+open_incremental_file(const char *path)
+{
+	rfile	   *rf = pg_malloc0(sizeof(rfile));
+	uint32		header[3];
+	struct stat st;
+
+	rf->path = pg_strdup(path);
+	if ((rf->fd = open(path, O_RDONLY | PG_BINARY, 0)) < 0)
+	{
+		pg_log_error("could not open file \"%s\": %m", path);
+		exit(1);
+	}
+	rf->incremental = true;
+
+	read_exactly(rf->fd, (char *) header, sizeof(header), 0, path);
+	if (header[0] != INCREMENTAL_MAGIC)
+	{
+		pg_log_error("file \"%s\" has bad incremental magic number (0x%x, expected 0x%x)",
+					 path, header[0], INCREMENTAL_MAGIC);
+		exit(1);
+	}
+	rf->num_blocks = header[1];
+	rf->truncation_block_length = header[2];
+	if (rf->num_blocks > RELSEG_SIZE ||
+		rf->truncation_block_length > RELSEG_SIZE)
+	{
+		pg_log_error("file \"%s\" has invalid incremental header",
+					 path);
+		exit(1);
+	}
+
+	rf->header_length = IncrementalFileHeaderSize(rf->num_blocks);
+	rf->relative_block_numbers =
+		pg_malloc(sizeof(BlockNumber) * Max(rf->num_blocks, 1));
+	read_exactly(rf->fd, (char *) rf->relative_block_numbers,
+				 sizeof(BlockNumber) * rf->num_blocks, sizeof(header), path);
+
+	if (fstat(rf->fd, &st) != 0)
+	{
+		pg_log_error("could not stat file \"%s\": %m", path);
+		exit(1);
+	}
+	if (st.st_size != IncrementalFileSize(rf->num_blocks))
+	{
+		pg_log_error("file \"%s\" has size %lld, but its header describes %u blocks",
+					 path, (long long int) st.st_size, rf->num_blocks);
+		exit(1);
+	}
+
+	return rf;
+}
+
+static void
+close_rfile(rfile *rf)
+{
+	close(rf->fd);
+	pg_free(rf->path);
+	if (rf->relative_block_numbers != NULL)
+		pg_free(rf->relative_block_numbers);
+	pg_free(rf);
+}
+
+/*
+ * Read nbytes at offset, or die trying.
+ */
+static void
+read_exactly(int fd, char *buf, size_t nbytes, off_t offset, const char *path)
+{
+	int			rb;
+
+	rb = pg_pread(fd, buf, nbytes, offset);
+	if (rb < 0)
+	{
+		pg_log_error("could not read file \"%s\": %m", path);
+		exit(1);
+	}
+	if (rb != nbytes)
+	{
+		pg_log_error("could not read file \"%s\": read %d of %zu",
+					 path, rb, nbytes);
+		exit(1);
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	static struct option long_options[] = {
+		{"debug", no_argument, NULL, 'd'},
+		{"no-sync", no_argument, NULL, 'N'},
+		{"output", required_argument, NULL, 'o'},
+		{NULL, 0, NULL, 0}
+	};
+
+	int			c;
+	int			option_index;
+	int			i;
+
+	pg_logging_init(argv[0]);
+	set_pglocale_pgservice(argv[0], PG_TEXTDOMAIN("pg_combinebackup"));
+	progname = get_progname(argv[0]);
+
+	if (argc > 1)
+	{
+		if (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-?") == 0)
+		{
+			usage();
+			exit(0);
+		}
+		if (strcmp(argv[1], "--version") == 0 || strcmp(argv[1], "-V") == 0)
+		{
+			puts("pg_combinebackup (PostgreSQL) " PG_VERSION);
+			exit(0);
+		}
+	}
+
+	while ((c = getopt_long(argc, argv, "dNo:", long_options, &option_index)) != -1)
+	{
+		switch (c)
+		{
+			case 'd':
+				pg_logging_increase_verbosity();
+				break;
+			case 'N':
+				do_sync = false;
+				break;
+			case 'o':
+				output_dir = pg_strdup(optarg);
+				canonicalize_path(output_dir);
+				break;
+			default:
+				fprintf(stderr, _("Try \"%s --help\" for more information.\n"), progname);
+				exit(1);
+		}
+	}
+
+	if (output_dir == NULL)
+	{
+		pg_log_error("no output directory specified");
+		fprintf(stderr, _("Try \"%s --help\" for more information.\n"), progname);
+		exit(1);
+	}
+
+	if (argc - optind < 2)
+	{
+		pg_log_error("at least two backup directories must be specified");
+		fprintf(stderr, _("Try \"%s --help\" for more information.\n"), progname);
+		exit(1);
+	}
+
+	nbackups = argc - optind;
+	backups = pg_malloc0(sizeof(backup_info) * nbackups);
+	for (i = 0; i < nbackups; i++)
+	{
+		backups[i].dir = pg_strdup(argv[optind + i]);
+		canonicalize_path(backups[i].dir);
+		read_backup_label(&backups[i]);
+	}
+	check_backup_chain();
+
+	/* Create the output directory with the same permissions as the input. */
+	if (!GetDataDirectoryCreatePerm(backups[nbackups - 1].dir))
+	{
+		pg_log_error("could not read permissions of directory \"%s\": %m",
+					 backups[nbackups - 1].dir);
+		exit(1);
+	}
+	umask(pg_mode_mask);
+
+	switch (pg_check_dir(output_dir))
+	{
+		case 0:
+			if (pg_mkdir_p(output_dir, pg_dir_create_mode) == -1)
+			{
+				pg_log_error("could not create directory \"%s\": %m",
+							 output_dir);
+				exit(1);
+			}
+			break;
+		case 1:
+			/* Exists and is empty, which is fine. */
+			break;
+		case -1:
+			pg_log_error("could not access directory \"%s\": %m", output_dir);
+			exit(1);
+		default:
+			pg_log_error("directory \"%s\" exists but is not empty",
+						 output_dir);
+			exit(1);
+	}
+
+	process_directory("");
+
+	if (do_sync)
+		fsync_pgdata(output_dir, PG_VERSION_NUM);
+
+	return 0;
+}
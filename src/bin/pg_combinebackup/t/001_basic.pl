@@ -0,0 +1,22 @@
+
+# Copyright (c) 2021, PostgreSQL Global Development Group
+
+use strict;
+use warnings;
+use TestLib;
+use Test::More tests => 12;
+
+my $tempdir = TestLib::tempdir;
+
+program_help_ok('pg_combinebackup');
+program_version_ok('pg_combinebackup');
+program_options_handling_ok('pg_combinebackup');
+
+command_fails_like(
+	[ 'pg_combinebackup', $tempdir, $tempdir ],
+	qr/no output directory specified/,
+	'output directory must be specified');
+command_fails_like(
+	[ 'pg_combinebackup', '-o', "$tempdir/out", $tempdir ],
+	qr/at least two backup directories must be specified/,
+	'at least two backups must be specified');
@@ -0,0 +1,91 @@
+
+# Copyright (c) 2021, PostgreSQL Global Development Group
+
+# Take a full backup and a chain of incremental backups, and check that the
+# reconstructed backup contains everything.
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 10;
+
+my $primary = get_new_node('primary');
+$primary->init(allows_streaming => 1);
+$primary->start;
+
+$primary->safe_psql('postgres', q{
+CREATE TABLE t_updated (a int, b text);
+INSERT INTO t_updated SELECT i, 'initial' FROM generate_series(1, 20000) i;
+CREATE TABLE t_truncated (a int);
+INSERT INTO t_truncated SELECT generate_series(1, 20000);
+CREATE TABLE t_dropped (a int);
+INSERT INTO t_dropped SELECT generate_series(1, 100);
+});
+
+my $full = $primary->backup_dir . '/full';
+$primary->command_ok([ 'pg_basebackup', '-D', $full, '--no-sync' ],
+	'full backup');
+
+# Change a few rows, and shrink a table.
+$primary->safe_psql('postgres', q{
+UPDATE t_updated SET b = 'first' WHERE a % 1000 = 0;
+DELETE FROM t_truncated WHERE a > 1000;
+VACUUM t_truncated;
+CREATE TABLE t_created (a int);
+INSERT INTO t_created SELECT generate_series(1, 500);
+});
+
+my $incr1 = $primary->backup_dir . '/incr1';
+$primary->command_ok(
+	[ 'pg_basebackup', '-D', $incr1, '--no-sync', '--incremental', $full ],
+	'first incremental backup');
+
+my @incremental_files = glob("$incr1/base/*/INCREMENTAL.*");
+ok(@incremental_files > 0, 'incremental backup contains incremental files');
+command_ok([ 'pg_verifybackup', '-n', $incr1 ],
+	'incremental backup verifies');
+
+$primary->safe_psql('postgres', q{
+UPDATE t_updated SET b = 'second' WHERE a % 1000 = 1;
+INSERT INTO t_truncated SELECT generate_series(1001, 1500);
+DROP TABLE t_dropped;
+});
+
+my $incr2 = $primary->backup_dir . '/incr2';
+$primary->command_ok(
+	[ 'pg_basebackup', '-D', $incr2, '--no-sync', '--incremental', $incr1 ],
+	'second incremental backup');
+
+my $expected = $primary->safe_psql('postgres', q{
+SELECT string_agg(b, ',' ORDER BY b), count(*) FROM t_updated WHERE b <> 'initial';
+SELECT count(*), sum(a) FROM t_truncated;
+SELECT count(*) FROM t_created;
+});
+
+# The backups must be given in order.
+command_fails_like(
+	[ 'pg_combinebackup', '-o', $primary->backup_dir . '/bad', $full, $incr2 ],
+	qr/was taken relative to/,
+	'backups out of order are rejected');
+
+my $combined = $primary->backup_dir . '/combined';
+command_ok([ 'pg_combinebackup', '-N', '-o', $combined, $full, $incr1, $incr2 ],
+	'combine backups');
+
+my $restored = get_new_node('restored');
+$restored->init_from_backup($primary, 'combined');
+$restored->start;
+
+my $result = $restored->safe_psql('postgres', q{
+SELECT string_agg(b, ',' ORDER BY b), count(*) FROM t_updated WHERE b <> 'initial';
+SELECT count(*), sum(a) FROM t_truncated;
+SELECT count(*) FROM t_created;
+});
+is($result, $expected, 'reconstructed backup has the expected contents');
+
+$result = $restored->safe_psql('postgres',
+	"SELECT count(*) FROM pg_class WHERE relname = 't_dropped'");
+is($result, '0', 'dropped table is gone');
+
+$restored->stop;
+$primary->stop;
@@ -149,6 +149,8 @@ typedef struct _dumpOptions
 	bool		aclsSkip;
 	const char *lockWaitTimeout;
 	int			dump_inserts;	/* 0 = COPY, otherwise rows per INSERT */
+	int			table_chunk_pages;	/* split table data into chunks of this
+									 * many pages, or 0 */
 
 	/* flags for various command-line long options */
 	int			disable_dollar_quoting;
@@ -904,9 +904,12 @@ restore_toc_entry(ArchiveHandle *AH, TocEntry *te, bool is_parallel)
 					 * because some data might get moved across partition
 					 * boundaries, risking deadlock and/or loss of previously
 					 * loaded data.  (We assume that all partitions of a
-					 * partitioned table will be treated the same way.)
+					 * partitioned table will be treated the same way.)  Nor
+					 * for a table whose data was dumped in chunks, since the
+					 * other chunks may be loading into it concurrently.
 					 */
 					use_truncate = is_parallel && te->created &&
+						!te->isDataChunk &&
 						!is_load_via_partition_root(te);
 
 					if (use_truncate)
@@ -1890,6 +1893,10 @@ buildTocEntryArrays(ArchiveHandle *AH)
 		 * TOC entry that has a DATA item.  We compute this by reversing the
 		 * TABLE DATA item's dependency, knowing that a TABLE DATA item has
 		 * just one dependency and it is the TABLE item.
+		 *
+		 * A table's data may have been dumped in several chunks, each its own
+		 * TABLE DATA item.  tableDataId then points to the first one, and the
+		 * others are chained to it through nextDataChunk.
 		 */
 		if (strcmp(te->desc, "TABLE DATA") == 0 && te->nDeps > 0)
 		{
@@ -1903,7 +1910,18 @@ buildTocEntryArrays(ArchiveHandle *AH)
 			if (tableId <= 0 || tableId > maxDumpId)
 				fatal("bad table dumpId for TABLE DATA item");
 
-			AH->tableDataId[tableId] = te->dumpId;
+			if (AH->tableDataId[tableId] != 0)
+			{
+				TocEntry   *chunkte = AH->tocsByDumpId[AH->tableDataId[tableId]];
+
+				chunkte->isDataChunk = true;
+				while (chunkte->nextDataChunk != NULL)
+					chunkte = chunkte->nextDataChunk;
+				chunkte->nextDataChunk = te;
+				te->isDataChunk = true;
+			}
+			else
+				AH->tableDataId[tableId] = te->dumpId;
 		}
 	}
 }
@@ -4647,11 +4665,27 @@ repoint_table_dependencies(ArchiveHandle *AH)
 			{
 				DumpId		tabledataid = AH->tableDataId[olddep];
 				TocEntry   *tabledatate = AH->tocsByDumpId[tabledataid];
+				pgoff_t		dataLength = tabledatate->dataLength;
+				TocEntry   *chunkte;
 
 				te->dependencies[i] = tabledataid;
-				te->dataLength = Max(te->dataLength, tabledatate->dataLength);
 				pg_log_debug("transferring dependency %d -> %d to %d",
 							 te->dumpId, olddep, tabledataid);
+
+				/* If the data was dumped in chunks, depend on all of them */
+				for (chunkte = tabledatate->nextDataChunk; chunkte != NULL;
+					 chunkte = chunkte->nextDataChunk)
+				{
+					te->dependencies = (DumpId *)
+						pg_realloc(te->dependencies,
+								   (te->nDeps + 1) * sizeof(DumpId));
+					te->dependencies[te->nDeps++] = chunkte->dumpId;
+					dataLength += chunkte->dataLength;
+					pg_log_debug("transferring dependency %d -> %d to %d",
+								 te->dumpId, olddep, chunkte->dumpId);
+				}
+
+				te->dataLength = Max(te->dataLength, dataLength);
 			}
 		}
 	}
@@ -4670,8 +4704,26 @@ identify_locking_dependencies(ArchiveHandle *AH, TocEntry *te)
 	int			i;
 
 	/*
-	 * We only care about this for POST_DATA items.  PRE_DATA items are not
-	 * run in parallel, and DATA items are all independent by assumption.
+	 * Chunks of one table's data are independent of each other, except in a
+	 * data-only restore with --disable-triggers: each chunk then runs ALTER
+	 * TABLE ... DISABLE/ENABLE TRIGGER ALL around its COPY, and one chunk
+	 * finishing would re-enable the triggers under another one still
+	 * loading.  Make each chunk require exclusive lock on the table, so that
+	 * the chunks are restored one at a time.
+	 */
+	if (te->isDataChunk && AH->public.ropt->dataOnly &&
+		AH->public.ropt->disable_triggers)
+	{
+		te->lockDeps = (DumpId *) pg_malloc(sizeof(DumpId));
+		te->lockDeps[0] = te->dependencies[0];
+		te->nLockDeps = 1;
+		return;
+	}
+
+	/*
+	 * Otherwise we only care about this for POST_DATA items.  PRE_DATA items
+	 * are not run in parallel, and DATA items are all independent by
+	 * assumption.
 	 */
 	if (te->section != SECTION_POST_DATA)
 		return;
@@ -4773,7 +4825,8 @@ mark_create_done(ArchiveHandle *AH, TocEntry *te)
 	{
 		TocEntry   *ted = AH->tocsByDumpId[AH->tableDataId[te->dumpId]];
 
-		ted->created = true;
+		for (; ted != NULL; ted = ted->nextDataChunk)
+			ted->created = true;
 	}
 }
 
@@ -4791,7 +4844,8 @@ inhibit_data_for_failed_table(ArchiveHandle *AH, TocEntry *te)
 	{
 		TocEntry   *ted = AH->tocsByDumpId[AH->tableDataId[te->dumpId]];
 
-		ted->reqs = 0;
+		for (; ted != NULL; ted = ted->nextDataChunk)
+			ted->reqs = 0;
 	}
 }
 
@@ -396,6 +396,9 @@ struct _tocEntry
 	int			reqs;			/* do we need schema and/or data of object
 								 * (REQ_* bit mask) */
 	bool		created;		/* set for DATA member if TABLE was created */
+	bool		isDataChunk;	/* DATA member is one of several chunks of the
+								 * table's data */
+	struct _tocEntry *nextDataChunk;	/* next chunk of the same table's data */
 
 	/* working state (needed only for parallel restore) */
 	struct _tocEntry *pending_prev; /* list links for pending-items list; */
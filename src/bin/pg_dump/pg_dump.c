@@ -326,6 +326,7 @@ main(int argc, char **argv)
 	const char *dumpsnapshot = NULL;
 	char	   *use_role = NULL;
 	long		rowsPerInsert;
+	long		tableChunkSize;
 	int			numWorkers = 1;
 	int			compressLevel = -1;
 	int			plainText = 0;
@@ -400,6 +401,7 @@ main(int argc, char **argv)
 		{"on-conflict-do-nothing", no_argument, &dopt.do_nothing, 1},
 		{"rows-per-insert", required_argument, NULL, 10},
 		{"include-foreign-data", required_argument, NULL, 11},
+		{"table-chunk-size", required_argument, NULL, 12},
 
 		{NULL, 0, NULL, 0}
 	};
@@ -622,6 +624,22 @@ main(int argc, char **argv)
 										  optarg);
 				break;
 
+			case 12:			/* table chunk size, in megabytes */
+				errno = 0;
+				tableChunkSize = strtol(optarg, &endptr, 10);
+
+				if (endptr == optarg || *endptr != '\0' ||
+					tableChunkSize <= 0 ||
+					tableChunkSize > INT_MAX / (1024 * 1024 / BLCKSZ) ||
+					errno == ERANGE)
+				{
+					pg_log_error("table-chunk-size must be in range %d..%d",
+								 1, INT_MAX / (1024 * 1024 / BLCKSZ));
+					exit_nicely(1);
+				}
+				dopt.table_chunk_pages = (int) tableChunkSize * (1024 * 1024 / BLCKSZ);
+				break;
+
 			default:
 				fprintf(stderr, _("Try \"%s --help\" for more information.\n"), progname);
 				exit_nicely(1);
@@ -1081,6 +1099,7 @@ help(const char *progname)
 	printf(_("  --snapshot=SNAPSHOT          use given snapshot for the dump\n"));
 	printf(_("  --strict-names               require table and/or schema include patterns to\n"
 			 "                               match at least one entity each\n"));
+	printf(_("  --table-chunk-size=MB        dump data of larger tables in chunks of this size\n"));
 	printf(_("  --use-set-session-authorization\n"
 			 "                               use SET SESSION AUTHORIZATION commands instead of\n"
 			 "                               ALTER OWNER commands to set ownership\n"));
@@ -1978,6 +1997,29 @@ selectDumpableObject(DumpableObject *dobj, Archive *fout)
 			DUMP_COMPONENT_ALL : DUMP_COMPONENT_NONE;
 }
 
+/*
+ * Is this TableDataInfo one of several chunks of a table's data?
+ */
+static bool
+isTableDataChunk(const TableDataInfo *tdinfo)
+{
+	return tdinfo->startBlock != 0 || tdinfo->endBlock != 0;
+}
+
+/*
+ * Append a WHERE clause restricting the rows read to the chunk's range of
+ * blocks.  The server executes this as a TID range scan.
+ */
+static void
+appendTableChunkCondition(PQExpBuffer buf, const TableDataInfo *tdinfo)
+{
+	appendPQExpBuffer(buf, " WHERE ctid >= '(%u,0)'::pg_catalog.tid",
+					  tdinfo->startBlock);
+	if (tdinfo->endBlock != 0)
+		appendPQExpBuffer(buf, " AND ctid < '(%u,0)'::pg_catalog.tid",
+						  tdinfo->endBlock);
+}
+
 /*
  *	Dump a table's contents for loading using the COPY command
  *	- this routine is called by the Archiver when it wants the table
@@ -2002,8 +2044,13 @@ dumpTableData_copy(Archive *fout, const void *dcontext)
 	char	   *copybuf;
 	const char *column_list;
 
-	pg_log_info("dumping contents of table \"%s.%s\"",
-				tbinfo->dobj.namespace->dobj.name, classname);
+	if (isTableDataChunk(tdinfo))
+		pg_log_info("dumping contents of table \"%s.%s\" starting at block %u",
+					tbinfo->dobj.namespace->dobj.name, classname,
+					tdinfo->startBlock);
+	else
+		pg_log_info("dumping contents of table \"%s.%s\"",
+					tbinfo->dobj.namespace->dobj.name, classname);
 
 	/*
 	 * Specify the column list explicitly so that we have no possibility of
@@ -2014,11 +2061,12 @@ dumpTableData_copy(Archive *fout, const void *dcontext)
 	column_list = fmtCopyColumnList(tbinfo, clistBuf);
 
 	/*
-	 * Use COPY (SELECT ...) TO when dumping a foreign table's data, and when
-	 * a filter condition was specified.  For other cases a simple COPY
-	 * suffices.
+	 * Use COPY (SELECT ...) TO when dumping a foreign table's data, when a
+	 * filter condition was specified, and when dumping a chunk of a table.
+	 * For other cases a simple COPY suffices.
 	 */
-	if (tdinfo->filtercond || tbinfo->relkind == RELKIND_FOREIGN_TABLE)
+	if (tdinfo->filtercond || isTableDataChunk(tdinfo) ||
+		tbinfo->relkind == RELKIND_FOREIGN_TABLE)
 	{
 		/* Note: this syntax is only supported in 8.2 and up */
 		appendPQExpBufferStr(q, "COPY (SELECT ");
@@ -2031,9 +2079,17 @@ dumpTableData_copy(Archive *fout, const void *dcontext)
 		else
 			appendPQExpBufferStr(q, "* ");
 
-		appendPQExpBuffer(q, "FROM %s %s) TO stdout;",
-						  fmtQualifiedDumpable(tbinfo),
-						  tdinfo->filtercond ? tdinfo->filtercond : "");
+		if (isTableDataChunk(tdinfo))
+		{
+			appendPQExpBuffer(q, "FROM ONLY %s",
+							  fmtQualifiedDumpable(tbinfo));
+			appendTableChunkCondition(q, tdinfo);
+			appendPQExpBufferStr(q, ") TO stdout;");
+		}
+		else
+			appendPQExpBuffer(q, "FROM %s %s) TO stdout;",
+							  fmtQualifiedDumpable(tbinfo),
+							  tdinfo->filtercond ? tdinfo->filtercond : "");
 	}
 	else
 	{
@@ -2190,6 +2246,8 @@ dumpTableData_insert(Archive *fout, const void *dcontext)
 					  fmtQualifiedDumpable(tbinfo));
 	if (tdinfo->filtercond)
 		appendPQExpBuffer(q, " %s", tdinfo->filtercond);
+	else if (isTableDataChunk(tdinfo))
+		appendTableChunkCondition(q, tdinfo);
 
 	ExecuteSqlStatement(fout, q->data);
 
@@ -2518,31 +2576,84 @@ dumpTableData(Archive *fout, const TableDataInfo *tdinfo)
 	 */
 	if (tdinfo->dobj.dump & DUMP_COMPONENT_DATA)
 	{
-		TocEntry   *te;
-
-		te = ArchiveEntry(fout, tdinfo->dobj.catId, tdinfo->dobj.dumpId,
-						  ARCHIVE_OPTS(.tag = tbinfo->dobj.name,
-									   .namespace = tbinfo->dobj.namespace->dobj.name,
-									   .owner = tbinfo->rolname,
-									   .description = "TABLE DATA",
-									   .section = SECTION_DATA,
-									   .createStmt = tdDefn,
-									   .copyStmt = copyStmt,
-									   .deps = &(tbinfo->dobj.dumpId),
-									   .nDeps = 1,
-									   .dumpFn = dumpFn,
-									   .dumpArg = tdinfo));
+		/*
+		 * relpages is declared as "integer" in pg_class, and hence also in
+		 * TableInfo, but it's really BlockNumber a/k/a unsigned int.  Cast so
+		 * that we get the right interpretation of table sizes exceeding
+		 * INT_MAX pages.
+		 */
+		BlockNumber relpages = (BlockNumber) tbinfo->relpages;
+		BlockNumber chunkPages = relpages;
+		BlockNumber startBlock = 0;
+		BlockNumber endBlock;
+		DumpId		dumpId = tdinfo->dobj.dumpId;
 
 		/*
-		 * Set the TocEntry's dataLength in case we are doing a parallel dump
-		 * and want to order dump jobs by table size.  We choose to measure
-		 * dataLength in table pages during dump, so no scaling is needed.
-		 * However, relpages is declared as "integer" in pg_class, and hence
-		 * also in TableInfo, but it's really BlockNumber a/k/a unsigned int.
-		 * Cast so that we get the right interpretation of table sizes
-		 * exceeding INT_MAX pages.
+		 * If requested, split the data of a large table into several TABLE
+		 * DATA items, each reading a range of blocks with a TID range scan,
+		 * so that a parallel dump or restore can work on one table with
+		 * several workers.  Every item depends on just the TABLE item, which
+		 * is how pg_restore recognizes the chunks of one table.  Only plain
+		 * heap tables dumped in full are split, and TID range scans need
+		 * server version 14.
 		 */
-		te->dataLength = (BlockNumber) tbinfo->relpages;
+		if (dopt->table_chunk_pages > 0 &&
+			relpages > (BlockNumber) dopt->table_chunk_pages &&
+			tbinfo->relkind == RELKIND_RELATION &&
+			tbinfo->amname != NULL && strcmp(tbinfo->amname, "heap") == 0 &&
+			tdinfo->filtercond == NULL &&
+			fout->remoteVersion >= 140000)
+			chunkPages = (BlockNumber) dopt->table_chunk_pages;
+
+		do
+		{
+			const TableDataInfo *dumpArg = tdinfo;
+			TocEntry   *te;
+
+			/* the last chunk is open-ended, in case the table has grown */
+			if (relpages - startBlock > chunkPages)
+				endBlock = startBlock + chunkPages;
+			else
+				endBlock = 0;
+
+			if (chunkPages < relpages)
+			{
+				TableDataInfo *chunk;
+
+				chunk = (TableDataInfo *) pg_malloc(sizeof(TableDataInfo));
+				memcpy(chunk, tdinfo, sizeof(TableDataInfo));
+				chunk->startBlock = startBlock;
+				chunk->endBlock = endBlock;
+				dumpArg = chunk;
+
+				/* the first chunk uses the TableDataInfo's own dump ID */
+				if (startBlock > 0)
+					dumpId = createDumpId();
+			}
+
+			te = ArchiveEntry(fout, tdinfo->dobj.catId, dumpId,
+							  ARCHIVE_OPTS(.tag = tbinfo->dobj.name,
+										   .namespace = tbinfo->dobj.namespace->dobj.name,
+										   .owner = tbinfo->rolname,
+										   .description = "TABLE DATA",
+										   .section = SECTION_DATA,
+										   .createStmt = tdDefn,
+										   .copyStmt = copyStmt,
+										   .deps = &(tbinfo->dobj.dumpId),
+										   .nDeps = 1,
+										   .dumpFn = dumpFn,
+										   .dumpArg = dumpArg));
+
+			/*
+			 * Set the TocEntry's dataLength in case we are doing a parallel
+			 * dump and want to order dump jobs by table size.  We choose to
+			 * measure dataLength in table pages during dump, so no scaling is
+			 * needed.
+			 */
+			te->dataLength = (endBlock != 0 ? endBlock : relpages) - startBlock;
+
+			startBlock = endBlock;
+		} while (endBlock != 0);
 	}
 
 	destroyPQExpBuffer(copyBuf);
@@ -2666,6 +2777,8 @@ makeTableDataInfo(DumpOptions *dopt, TableInfo *tbinfo)
 	tdinfo->dobj.namespace = tbinfo->dobj.namespace;
 	tdinfo->tdtable = tbinfo;
 	tdinfo->filtercond = NULL;	/* might get set later */
+	tdinfo->startBlock = 0;
+	tdinfo->endBlock = 0;
 	addObjectDependency(&tdinfo->dobj, tbinfo->dobj.dumpId);
 
 	tbinfo->dataObj = tdinfo;
@@ -16610,6 +16723,9 @@ dumpTableSchema(Archive *fout, const TableInfo *tbinfo)
 					case 'l':
 						cmname = "lz4";
 						break;
+					case 'z':
+						cmname = "zstd";
+						break;
 					default:
 						cmname = NULL;
 						break;
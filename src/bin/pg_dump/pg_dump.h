@@ -15,6 +15,7 @@
 #define PG_DUMP_H
 
 #include "pg_backup.h"
+#include "storage/block.h"
 
 
 #define oidcmp(x,y) ( ((x) < (y) ? -1 : ((x) > (y)) ?  1 : 0) )
@@ -363,6 +364,10 @@ typedef struct _tableDataInfo
 	DumpableObject dobj;
 	TableInfo  *tdtable;		/* link to table to dump */
 	char	   *filtercond;		/* WHERE condition to limit rows dumped */
+	BlockNumber startBlock;		/* first block of the chunk to dump */
+	BlockNumber endBlock;		/* block after the chunk, or 0 for the end of
+								 * the table; both 0 if the table is not
+								 * dumped in chunks */
 } TableDataInfo;
 
 typedef struct _indxInfo
@@ -11,6 +11,8 @@ use Test::More;
 my $dbname1 = 'regression_src';
 my $dbname2 = 'regression_dest1';
 my $dbname3 = 'regression_dest2';
+my $dbname4 = 'regression_dest3';
+my $dbname5 = 'regression_dest4';
 
 my $node = PostgreSQL::Test::Cluster->new('main');
 $node->init;
@@ -21,6 +23,8 @@ my $backupdir = $node->backup_dir;
 $node->run_log([ 'createdb', $dbname1 ]);
 $node->run_log([ 'createdb', $dbname2 ]);
 $node->run_log([ 'createdb', $dbname3 ]);
+$node->run_log([ 'createdb', $dbname4 ]);
+$node->run_log([ 'createdb', $dbname5 ]);
 
 $node->safe_psql(
 	$dbname1,
@@ -44,6 +48,11 @@ create table tht_p1 partition of tht for values with (modulus 3, remainder 0);
 create table tht_p2 partition of tht for values with (modulus 3, remainder 1);
 create table tht_p3 partition of tht for values with (modulus 3, remainder 2);
 insert into tht select (x%10)::text::digit, x from generate_series(1,1000) x;
+
+-- table large enough to be dumped in several chunks
+create table tbig (id int primary key, data text);
+insert into tbig select x, repeat('x', 100) from generate_series(1,30000) x;
+vacuum analyze tbig;
 	});
 
 $node->command_ok(
@@ -78,4 +87,75 @@ $node->command_ok(
 	],
 	'parallel restore as inserts');
 
+$node->command_ok(
+	[
+		'pg_dump',   '-Fd',
+		'--no-sync', '-j2',
+		'-f',        "$backupdir/dump3",
+		'--table-chunk-size=1', $node->connstr($dbname1)
+	],
+	'parallel dump in table chunks');
+
+# Count the data entries of tbig in the table of contents of a dump
+sub tbig_data_entries
+{
+	my $dumpdir = shift;
+	my ($stdout, $stderr) = run_command([ 'pg_restore', '-l', $dumpdir ]);
+	my $count = () = $stdout =~ /^\d+; \d+ \d+ TABLE DATA public tbig /mg;
+	return $count;
+}
+
+is(tbig_data_entries("$backupdir/dump1"),
+	1, 'table dumped in one piece by default');
+cmp_ok(tbig_data_entries("$backupdir/dump3"),
+	'>', 1, 'table dumped in several chunks');
+
+$node->command_ok(
+	[
+		'pg_restore', '-v',
+		'-d',         $node->connstr($dbname4),
+		'-j3',        "$backupdir/dump3"
+	],
+	'parallel restore of table chunks');
+
+is( $node->safe_psql(
+		$dbname4, 'select count(*), sum(id), min(data) = max(data) from tbig'),
+	'30000|450015000|t',
+	'table restored from chunks is complete');
+
+# A data-only restore with --disable-triggers must keep the table's triggers
+# disabled for as long as any of its chunks is being loaded.
+$node->command_ok(
+	[
+		'pg_restore', '-d', $node->connstr($dbname5),
+		'--schema-only',    "$backupdir/dump3"
+	],
+	'restore of schema for data-only restore');
+
+$node->safe_psql(
+	$dbname5,
+	qq{
+create table tbig_log (id int);
+create function tbig_log_insert() returns trigger language plpgsql as
+  \$\$begin insert into tbig_log values (new.id); return new; end\$\$;
+create trigger tbig_log_insert after insert on tbig
+  for each row execute function tbig_log_insert();
+	});
+
+$node->command_ok(
+	[
+		'pg_restore', '-v',
+		'-d',         $node->connstr($dbname5),
+		'--data-only', '--disable-triggers',
+		'-t',         'tbig',
+		'-j3',        "$backupdir/dump3"
+	],
+	'parallel data-only restore of table chunks with triggers disabled');
+
+is( $node->safe_psql(
+		$dbname5,
+		'select count(*), sum(id) from tbig; select count(*) from tbig_log'),
+	"30000|450015000\n0",
+	'no trigger fired while restoring table chunks');
+
 done_testing();
@@ -31,6 +31,7 @@ static void check_for_jsonb_9_4_usage(ClusterInfo *cluster);
 static void check_for_pg_role_prefix(ClusterInfo *cluster);
 static void check_for_new_tablespace_dir(ClusterInfo *new_cluster);
 static void check_for_user_defined_encoding_conversions(ClusterInfo *cluster);
+static void check_for_zstd_dictionaries(ClusterInfo *cluster);
 static char *get_canonical_locale_name(int category, const char *locale);
 
 
@@ -105,6 +106,7 @@ check_and_dump_old_cluster(bool live_check)
 	check_for_composite_data_type_usage(&old_cluster);
 	check_for_reg_data_type_usage(&old_cluster);
 	check_for_isn_and_int8_passing_mismatch(&old_cluster);
+	check_for_zstd_dictionaries(&old_cluster);
 
 	/*
 	 * PG 14 changed the function signature of encoding conversion functions.
@@ -1184,6 +1186,78 @@ check_for_tables_with_oids(ClusterInfo *cluster)
 }
 
 
+/*
+ * check_for_zstd_dictionaries()
+ *	Verify that no zstd compression dictionaries have been trained.
+ *
+ *	Values compressed with a dictionary can only be decompressed by looking
+ *	the dictionary up in pg_zstd_dictionary, which pg_dump does not carry
+ *	over to the new cluster.
+ */
+static void
+check_for_zstd_dictionaries(ClusterInfo *cluster)
+{
+	int			dbnum;
+	FILE	   *script = NULL;
+	bool		found = false;
+	char		output_path[MAXPGPATH];
+
+	prep_status("Checking for zstd compression dictionaries");
+
+	snprintf(output_path, sizeof(output_path),
+			 "databases_with_zstd_dictionaries.txt");
+
+	for (dbnum = 0; dbnum < cluster->dbarr.ndbs; dbnum++)
+	{
+		PGresult   *res;
+		DbInfo	   *active_db = &cluster->dbarr.dbs[dbnum];
+		PGconn	   *conn = connectToServer(cluster, active_db->db_name);
+
+		/* the catalog doesn't exist in older servers */
+		res = executeQueryOrDie(conn,
+								"SELECT 1 "
+								"FROM	pg_catalog.pg_class c, "
+								"		pg_catalog.pg_namespace n "
+								"WHERE	c.relnamespace = n.oid AND "
+								"		n.nspname = 'pg_catalog' AND "
+								"		c.relname = 'pg_zstd_dictionary'");
+		if (PQntuples(res) > 0)
+		{
+			PQclear(res);
+			res = executeQueryOrDie(conn,
+									"SELECT count(*) FROM pg_catalog.pg_zstd_dictionary");
+			if (atoi(PQgetvalue(res, 0, 0)) > 0)
+			{
+				found = true;
+				if (script == NULL && (script = fopen_priv(output_path, "w")) == NULL)
+					pg_fatal("could not open file \"%s\": %s\n",
+							 output_path, strerror(errno));
+				fprintf(script, "%s\n", active_db->db_name);
+			}
+		}
+
+		PQclear(res);
+
+		PQfinish(conn);
+	}
+
+	if (script)
+		fclose(script);
+
+	if (found)
+	{
+		pg_log(PG_REPORT, "fatal\n");
+		pg_fatal("Your installation contains zstd compression dictionaries.  Values\n"
+				 "compressed with them cannot be read after the upgrade.  Dump and\n"
+				 "restore the affected databases instead.\n"
+				 "A list of databases with the problem is in the file:\n"
+				 "    %s\n\n", output_path);
+	}
+	else
+		check_ok();
+}
+
+
 /*
  * check_for_composite_data_type_usage()
  *	Check for system-defined composite types used in user tables.
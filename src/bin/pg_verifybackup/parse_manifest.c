@@ -33,6 +33,7 @@ typedef enum
 	JM_EXPECT_WAL_RANGES_NEXT,
 	JM_EXPECT_THIS_WAL_RANGE_FIELD,
 	JM_EXPECT_THIS_WAL_RANGE_VALUE,
+	JM_EXPECT_INCREMENTAL_FROM_VALUE,
 	JM_EXPECT_MANIFEST_CHECKSUM_VALUE,
 	JM_EXPECT_EOF
 } JsonManifestSemanticState;
@@ -316,6 +317,13 @@ json_manifest_object_field_start(void *state, char *fname, bool isnull)
 				break;
 			}
 
+			/* Is this the reference of an incremental backup? */
+			if (strcmp(fname, "Incremental-From-LSN") == 0)
+			{
+				parse->state = JM_EXPECT_INCREMENTAL_FROM_VALUE;
+				break;
+			}
+
 			/* Is this the manifest checksum? */
 			if (strcmp(fname, "Manifest-Checksum") == 0)
 			{
@@ -378,11 +386,11 @@ json_manifest_object_field_start(void *state, char *fname, bool isnull)
  * of the field, and we'll get the corresponding value here. When we're in
  * the toplevel object, the parse state itself tells us which field this is.
  *
- * In all cases except for PostgreSQL-Backup-Manifest-Version, which we
- * can just check on the spot, the goal here is just to save the value in
- * the parse state for later use. We don't actually do anything until we
- * reach either the end of the object representing this file, or the end
- * of the manifest, as the case may be.
+ * In all cases except for PostgreSQL-Backup-Manifest-Version and
+ * Incremental-From-LSN, which we can just check on the spot, the goal here
+ * is just to save the value in the parse state for later use. We don't
+ * actually do anything until we reach either the end of the object
+ * representing this file, or the end of the manifest, as the case may be.
  */
 static void
 json_manifest_scalar(void *state, char *token, JsonTokenType tokentype)
@@ -439,6 +447,18 @@ json_manifest_scalar(void *state, char *token, JsonTokenType tokentype)
 			parse->state = JM_EXPECT_THIS_WAL_RANGE_FIELD;
 			break;
 
+		case JM_EXPECT_INCREMENTAL_FROM_VALUE:
+			{
+				XLogRecPtr	reference_lsn;
+
+				if (!parse_xlogrecptr(&reference_lsn, token))
+					json_manifest_parse_failure(parse->context,
+												"could not parse incremental reference LSN");
+				pfree(token);
+				parse->state = JM_EXPECT_TOPLEVEL_FIELD;
+			}
+			break;
+
 		case JM_EXPECT_MANIFEST_CHECKSUM_VALUE:
 			parse->state = JM_EXPECT_TOPLEVEL_END;
 			parse->manifest_checksum = token;
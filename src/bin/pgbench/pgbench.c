@@ -219,6 +219,13 @@ double		throttle_delay = 0;
  */
 int64		latency_limit = 0;
 
+/*
+ * Whether to collect high dynamic range latency histograms, and where to
+ * write them at the end of the run (NULL means only report percentiles).
+ */
+bool		latency_histograms = false;
+char	   *histogram_file = NULL;
+
 /*
  * tablespace selection
  */
@@ -343,6 +350,53 @@ typedef struct StatsData
 	SimpleStats lag;
 } StatsData;
 
+/*
+ * High dynamic range histogram of latencies, in microseconds.
+ *
+ * Values below HIST_SUB_BUCKETS are counted exactly.  Above that, every
+ * power-of-two range is divided into HIST_SUB_BUCKETS / 2 linear buckets,
+ * which keeps the relative error of any recorded value below 1/64, from a
+ * few microseconds up to 2^HIST_MAX_BITS microseconds (about 50 days).
+ * Larger values are counted in the last bucket.
+ */
+#define HIST_SUB_BUCKET_BITS	7
+#define HIST_SUB_BUCKETS		(1 << HIST_SUB_BUCKET_BITS)
+#define HIST_MAX_BITS			42
+#define HIST_NBUCKETS \
+	(HIST_SUB_BUCKETS + (HIST_MAX_BITS - HIST_SUB_BUCKET_BITS) * (HIST_SUB_BUCKETS / 2))
+
+typedef struct LatencyHistogram
+{
+	int64		count;			/* number of recorded values */
+	int64		max;			/* the maximum seen */
+	double		sum;			/* sum of values */
+	int64		buckets[HIST_NBUCKETS];
+} LatencyHistogram;
+
+/*
+ * Workload phases, given with --phase.  Each phase lasts for a number of
+ * seconds and may have its own target rate, which can ramp linearly from
+ * start_rate to end_rate over the phase, and its own script weights.
+ * Without --phase, num_phases is zero and the whole run behaves as a single
+ * phase using the global settings.
+ */
+#define MAX_PHASES		64
+
+typedef struct Phase
+{
+	int			duration;		/* length in seconds */
+	double		start_rate;		/* target tps at start of phase, or 0 */
+	double		end_rate;		/* target tps at end of phase, or 0 */
+	int		   *weights;		/* per-script weights, or NULL */
+	int64		total_weight;	/* sum of weights */
+	pg_time_usec_t start;		/* offset from benchmark start */
+	pg_time_usec_t end;			/* offset from benchmark start */
+} Phase;
+
+static Phase phases[MAX_PHASES];
+static int	num_phases = 0;
+static char *phase_specs[MAX_PHASES];	/* raw --phase option values */
+
 /*
  * For displaying Unix epoch timestamps, as some time functions may have
  * another reference.
@@ -463,6 +517,7 @@ typedef struct
 	RandomState cs_func_rs;
 
 	int			use_file;		/* index in sql_script for this client */
+	int			phase;			/* workload phase of current transaction */
 	int			command;		/* command number in script */
 
 	/* client variables */
@@ -514,8 +569,18 @@ typedef struct
 
 	StatsData	stats;
 	int64		latency_late;	/* count executed but late transactions */
+
+	/*
+	 * Latency histograms, one per phase and script, indexed by HIST_INDEX(),
+	 * or NULL if not collected.
+	 */
+	LatencyHistogram *histograms;
 } TState;
 
+/* number of phases histograms are kept for; the whole run counts as one */
+#define HIST_NPHASES	Max(num_phases, 1)
+#define HIST_INDEX(phase, script)	((phase) * num_scripts + (script))
+
 /*
  * queries read from files
  */
@@ -747,8 +812,14 @@ usage(void)
 		   "  -T, --time=NUM           duration of benchmark test in seconds\n"
 		   "  -v, --vacuum-all         vacuum all four standard tables before tests\n"
 		   "  --aggregate-interval=NUM aggregate data over NUM seconds\n"
+		   "  --histogram              report latency percentiles from HDR histograms\n"
+		   "  --histogram-file=FILENAME\n"
+		   "                           write latency histograms to FILENAME\n"
 		   "  --log-prefix=PREFIX      prefix for transaction time log file\n"
 		   "                           (default: \"pgbench_log\")\n"
+		   "  --phase=SECONDS[,rate=NUM[-NUM]][,weights=W/W...]\n"
+		   "                           add a workload phase with its own rate and\n"
+		   "                           script weights (can be repeated)\n"
 		   "  --progress-timestamp     use Unix epoch timestamps for progress\n"
 		   "  --random-seed=SEED       set random seed (\"time\", \"rand\", integer)\n"
 		   "  --sampling-rate=NUM      fraction of transactions to log (e.g., 0.01 for 1%%)\n"
@@ -1321,6 +1392,97 @@ accumStats(StatsData *stats, bool skipped, double lat, double lag)
 	}
 }
 
+/*
+ * Return the histogram bucket that counts the given value.
+ */
+static int
+histBucket(int64 value)
+{
+	int			shift;
+
+	if (value < HIST_SUB_BUCKETS)
+		return value < 0 ? 0 : (int) value;
+	if (value >= ((int64) 1 << HIST_MAX_BITS))
+		return HIST_NBUCKETS - 1;
+
+	/* keep the HIST_SUB_BUCKET_BITS most significant bits */
+	shift = pg_leftmost_one_pos64((uint64) value) - (HIST_SUB_BUCKET_BITS - 1);
+	return HIST_SUB_BUCKETS + (shift - 1) * (HIST_SUB_BUCKETS / 2) +
+		(int) (value >> shift) - HIST_SUB_BUCKETS / 2;
+}
+
+/*
+ * Return the highest value that is counted in the given histogram bucket.
+ */
+static int64
+histBucketValue(int bucket)
+{
+	int			shift;
+	int64		sub;
+
+	if (bucket < HIST_SUB_BUCKETS)
+		return bucket;
+
+	shift = (bucket - HIST_SUB_BUCKETS) / (HIST_SUB_BUCKETS / 2) + 1;
+	sub = (bucket - HIST_SUB_BUCKETS) % (HIST_SUB_BUCKETS / 2) +
+		HIST_SUB_BUCKETS / 2;
+	return ((sub + 1) << shift) - 1;
+}
+
+/*
+ * Record one value into a histogram.
+ */
+static void
+addToHistogram(LatencyHistogram *hist, int64 value)
+{
+	hist->buckets[histBucket(value)]++;
+	if (hist->count == 0 || value > hist->max)
+		hist->max = value;
+	hist->count++;
+	hist->sum += value;
+}
+
+/*
+ * Merge two histograms
+ */
+static void
+mergeHistogram(LatencyHistogram *acc, LatencyHistogram *hist)
+{
+	if (hist->count == 0)
+		return;
+
+	for (int i = 0; i < HIST_NBUCKETS; i++)
+		acc->buckets[i] += hist->buckets[i];
+	if (acc->count == 0 || hist->max > acc->max)
+		acc->max = hist->max;
+	acc->count += hist->count;
+	acc->sum += hist->sum;
+}
+
+/*
+ * Return the value at the given percentile of a non-empty histogram.  The
+ * result is the highest value counted in the same bucket, but never more
+ * than the maximum actually seen.
+ */
+static int64
+histPercentile(LatencyHistogram *hist, double percentile)
+{
+	int64		target = (int64) ceil(percentile / 100.0 * hist->count);
+	int64		seen = 0;
+
+	if (target < 1)
+		target = 1;
+
+	for (int i = 0; i < HIST_NBUCKETS; i++)
+	{
+		seen += hist->buckets[i];
+		if (seen >= target)
+			return Min(histBucketValue(i), hist->max);
+	}
+
+	return hist->max;
+}
+
 /* call PQexec() and exit() on failure */
 static void
 executeStatement(PGconn *con, const char *sql)
@@ -2838,9 +3000,12 @@ commandFailed(CState *st, const char *cmd, const char *message)
 				 st->id, st->command, cmd, st->use_file, message);
 }
 
-/* return a script number with a weighted choice. */
+/*
+ * Return a script number with a weighted choice, using the weights of the
+ * given phase if it has any.
+ */
 static int
-chooseScript(TState *thread)
+chooseScript(TState *thread, int phase)
 {
 	int			i = 0;
 	int64		w;
@@ -2848,15 +3013,69 @@ chooseScript(TState *thread)
 	if (num_scripts == 1)
 		return 0;
 
-	w = getrand(&thread->ts_choose_rs, 0, total_weight - 1);
-	do
+	if (num_phases > 0 && phases[phase].weights != NULL)
 	{
-		w -= sql_script[i++].weight;
-	} while (w >= 0);
+		int		   *weights = phases[phase].weights;
+
+		w = getrand(&thread->ts_choose_rs, 0, phases[phase].total_weight - 1);
+		do
+		{
+			w -= weights[i++];
+		} while (w >= 0);
+	}
+	else
+	{
+		w = getrand(&thread->ts_choose_rs, 0, total_weight - 1);
+		do
+		{
+			w -= sql_script[i++].weight;
+		} while (w >= 0);
+	}
 
 	return i - 1;
 }
 
+/*
+ * Return the workload phase in effect at the given time.  Times past the
+ * end of the last phase belong to the last phase.
+ */
+static int
+getPhase(TState *thread, pg_time_usec_t when)
+{
+	pg_time_usec_t elapsed = when - thread->bench_start;
+	int			phase;
+
+	for (phase = 0; phase < num_phases - 1; phase++)
+		if (elapsed < phases[phase].end)
+			break;
+
+	return Max(phase, 0);
+}
+
+/*
+ * Return the per-thread throttling delay in usec for a transaction scheduled
+ * at the given time.  Within a phase, the target rate changes linearly from
+ * its start rate to its end rate.
+ */
+static double
+getThrottleDelay(TState *thread, pg_time_usec_t when)
+{
+	Phase	   *phase;
+	double		progress;
+	double		rate;
+
+	if (num_phases == 0)
+		return throttle_delay;
+
+	phase = &phases[getPhase(thread, when)];
+	progress = (double) (when - thread->bench_start - phase->start) /
+		(phase->end - phase->start);
+	progress = Min(Max(progress, 0.0), 1.0);
+	rate = phase->start_rate + (phase->end_rate - phase->start_rate) * progress;
+
+	return 1000000.0 * nthreads / rate;
+}
+
 /*
  * Prepare the SQL command from st->use_file at command_num.
  */
@@ -3198,7 +3417,21 @@ advanceConnectionState(TState *thread, CState *st, StatsData *agg)
 		{
 				/* Select transaction (script) to run.  */
 			case CSTATE_CHOOSE_SCRIPT:
-				st->use_file = chooseScript(thread);
+				if (num_phases > 0)
+				{
+					/*
+					 * Under throttling, the next transaction is due at the
+					 * thread's schedule time rather than now.
+					 */
+					if (throttle_delay)
+						st->phase = getPhase(thread, thread->throttle_trigger);
+					else
+					{
+						pg_time_now_lazy(&now);
+						st->phase = getPhase(thread, now);
+					}
+				}
+				st->use_file = chooseScript(thread, st->phase);
 				Assert(conditional_stack_empty(st->cstack));
 
 				pg_log_debug("client %d executing script \"%s\"",
@@ -3270,9 +3503,26 @@ advanceConnectionState(TState *thread, CState *st, StatsData *agg)
 				Assert(throttle_delay > 0);
 
 				thread->throttle_trigger +=
-					getPoissonRand(&thread->ts_throttle_rs, throttle_delay);
+					getPoissonRand(&thread->ts_throttle_rs,
+								   getThrottleDelay(thread,
+													thread->throttle_trigger));
 				st->txn_scheduled = thread->throttle_trigger;
 
+				/*
+				 * If the transaction now falls into the next phase, pick its
+				 * script according to that phase.
+				 */
+				if (num_phases > 0)
+				{
+					int			phase = getPhase(thread, st->txn_scheduled);
+
+					if (phase != st->phase)
+					{
+						st->phase = phase;
+						st->use_file = chooseScript(thread, phase);
+					}
+				}
+
 				/*
 				 * If --latency-limit is used, and this slot is already late
 				 * so that the transaction will miss the latency limit even if
@@ -3953,7 +4203,8 @@ processXactStats(TState *thread, CState *st, pg_time_usec_t *now,
 {
 	double		latency = 0.0,
 				lag = 0.0;
-	bool		thread_details = progress || throttle_delay || latency_limit,
+	bool		thread_details = (progress || throttle_delay || latency_limit ||
+								  latency_histograms),
 				detailed = thread_details || use_log || per_script_stats;
 
 	if (detailed && !skipped)
@@ -3980,6 +4231,14 @@ processXactStats(TState *thread, CState *st, pg_time_usec_t *now,
 		thread->stats.cnt++;
 	}
 
+	/*
+	 * Under throttling, latency is measured from the scheduled start, so
+	 * that the histogram isn't skewed by coordinated omission.
+	 */
+	if (latency_histograms && !skipped)
+		addToHistogram(&thread->histograms[HIST_INDEX(st->phase, st->use_file)],
+					   (int64) latency);
+
 	/* client stat is just counting */
 	st->cnt++;
 
@@ -5473,6 +5732,103 @@ parseScriptWeight(const char *option, char **script)
 	return weight;
 }
 
+/*
+ * Parse a workload phase specification from --phase, of the form
+ * "SECONDS[,rate=TPS[-TPS]][,weights=W/W/...]".  The weights are given in
+ * the order the scripts were specified, so this must be called after all
+ * scripts have been added.
+ */
+static void
+parsePhase(const char *spec, Phase *phase)
+{
+	char	   *copy = pg_strdup(spec);
+	char	   *tok;
+	char	   *badp;
+	long		ltmp;
+
+	memset(phase, 0, sizeof(Phase));
+
+	tok = strtok(copy, ",");
+	errno = 0;
+	ltmp = tok ? strtol(tok, &badp, 10) : 0;
+	if (tok == NULL || errno != 0 || badp == tok || *badp != '\0' ||
+		ltmp <= 0 || ltmp > INT_MAX)
+	{
+		pg_log_fatal("invalid phase duration in \"%s\"", spec);
+		exit(1);
+	}
+	phase->duration = (int) ltmp;
+
+	while ((tok = strtok(NULL, ",")) != NULL)
+	{
+		if (strncmp(tok, "rate=", 5) == 0)
+		{
+			char	   *p = tok + 5;
+
+			phase->start_rate = strtod(p, &badp);
+			phase->end_rate = phase->start_rate;
+			if (badp != p && *badp == '-')
+			{
+				p = badp + 1;
+				phase->end_rate = strtod(p, &badp);
+			}
+			if (badp == p || *badp != '\0' ||
+				!(phase->start_rate > 0.0) || !(phase->end_rate > 0.0))
+			{
+				pg_log_fatal("invalid phase rate in \"%s\"", spec);
+				exit(1);
+			}
+		}
+		else if (strncmp(tok, "weights=", 8) == 0)
+		{
+			char	   *p = tok + 8;
+			int			n = 0;
+
+			phase->weights = pg_malloc(sizeof(int) * num_scripts);
+			for (;;)
+			{
+				errno = 0;
+				ltmp = strtol(p, &badp, 10);
+				if (errno != 0 || badp == p || ltmp < 0 || ltmp > INT_MAX ||
+					(*badp != '/' && *badp != '\0'))
+				{
+					pg_log_fatal("invalid phase weight in \"%s\"", spec);
+					exit(1);
+				}
+				if (n < num_scripts)
+				{
+					phase->weights[n] = (int) ltmp;
+					phase->total_weight += ltmp;
+				}
+				n++;
+				if (*badp == '\0')
+					break;
+				p = badp + 1;
+			}
+			if (n != num_scripts)
+			{
+				pg_log_fatal("phase weights in \"%s\" must match the number of scripts (%d)",
+							 spec, num_scripts);
+				exit(1);
+			}
+			if (phase->total_weight == 0)
+			{
+				pg_log_fatal("total script weight must not be zero in phase \"%s\"",
+							 spec);
+				exit(1);
+			}
+		}
+		else
+		{
+			pg_log_fatal("unrecognized phase setting \"%s\" in \"%s\"",
+						 tok, spec);
+			exit(1);
+		}
+	}
+
+	pg_free(copy);
+}
+
 /* append a script to the list of scripts to process */
 static void
 addScript(ParsedScript script)
@@ -5593,6 +5949,184 @@ printSimpleStats(const char *prefix, SimpleStats *ss)
 	}
 }
 
+static void
+printPercentiles(const char *prefix, LatencyHistogram *hist)
+{
+	if (hist->count > 0)
+		printf("%s percentiles: p50 = %.3f ms, p90 = %.3f ms, p99 = %.3f ms, p99.9 = %.3f ms, p99.99 = %.3f ms, max = %.3f ms\n",
+			   prefix,
+			   0.001 * histPercentile(hist, 50.0),
+			   0.001 * histPercentile(hist, 90.0),
+			   0.001 * histPercentile(hist, 99.0),
+			   0.001 * histPercentile(hist, 99.9),
+			   0.001 * histPercentile(hist, 99.99),
+			   0.001 * hist->max);
+}
+
+/*
+ * Merge the histograms of the given phase and script into acc.  A phase or
+ * script of -1 means all of them.
+ */
+static void
+mergePhaseHistograms(LatencyHistogram *acc, LatencyHistogram *histograms,
+					 int phase, int script)
+{
+	for (int p = 0; p < HIST_NPHASES; p++)
+	{
+		if (phase >= 0 && p != phase)
+			continue;
+		for (int i = 0; i < num_scripts; i++)
+		{
+			if (script >= 0 && i != script)
+				continue;
+			mergeHistogram(acc, &histograms[HIST_INDEX(p, i)]);
+		}
+	}
+}
+
+/*
+ * Print the per-phase part of the report.
+ */
+static void
+printPhaseResults(LatencyHistogram *histograms)
+{
+	LatencyHistogram *hist = pg_malloc(sizeof(LatencyHistogram));
+
+	for (int p = 0; p < num_phases; p++)
+	{
+		Phase	   *phase = &phases[p];
+
+		printf("phase %d: %d s", p + 1, phase->duration);
+		if (phase->start_rate == 0)
+			printf(", not throttled\n");
+		else if (phase->start_rate == phase->end_rate)
+			printf(", rate %.1f tps\n", phase->start_rate);
+		else
+			printf(", rate %.1f to %.1f tps\n",
+				   phase->start_rate, phase->end_rate);
+
+		memset(hist, 0, sizeof(LatencyHistogram));
+		mergePhaseHistograms(hist, histograms, p, -1);
+		printf(" - " INT64_FORMAT " transactions (tps = %f)\n",
+			   hist->count, hist->count / (double) phase->duration);
+		if (hist->count > 0)
+			printf(" - latency average = %.3f ms\n",
+				   0.001 * hist->sum / hist->count);
+		printPercentiles(" - latency", hist);
+
+		if (per_script_stats)
+		{
+			for (int i = 0; i < num_scripts; i++)
+			{
+				memset(hist, 0, sizeof(LatencyHistogram));
+				mergePhaseHistograms(hist, histograms, p, i);
+				printf(" - SQL script %d: " INT64_FORMAT " transactions\n",
+					   i + 1, hist->count);
+				printPercentiles("   - latency", hist);
+			}
+		}
+	}
+
+	pg_free(hist);
+}
+
+/*
+ * Write one histogram to a file, in the percentile distribution format used
+ * by HdrHistogram, with values in milliseconds.
+ */
+static void
+writeHistogram(FILE *fp, const char *label, LatencyHistogram *hist)
+{
+	int64		seen = 0;
+
+	fprintf(fp, "# %s\n", label);
+	fprintf(fp, "%12s %14s %10s %14s\n\n",
+			"Value", "Percentile", "TotalCount", "1/(1-Percentile)");
+	for (int i = 0; i < HIST_NBUCKETS; i++)
+	{
+		double		percentile;
+
+		if (hist->buckets[i] == 0)
+			continue;
+
+		seen += hist->buckets[i];
+		percentile = (double) seen / hist->count;
+		if (seen < hist->count)
+			fprintf(fp, "%12.3f %14.12f %10" INT64_MODIFIER "d %14.2f\n",
+					0.001 * Min(histBucketValue(i), hist->max), percentile,
+					seen, 1.0 / (1.0 - percentile));
+		else
+			fprintf(fp, "%12.3f %14.12f %10" INT64_MODIFIER "d\n",
+					0.001 * hist->max, percentile, seen);
+	}
+	fprintf(fp, "#[Mean    = %12.3f, Max            = %12.3f]\n",
+			hist->count > 0 ? 0.001 * hist->sum / hist->count : 0.0,
+			0.001 * hist->max);
+	fprintf(fp, "#[Total count    = %12" INT64_MODIFIER "d]\n\n", hist->count);
+}
+
+/*
+ * Write all collected histograms to histogram_file: the total, then one per
+ * script and one per phase, as applicable.
+ */
+static void
+writeHistograms(LatencyHistogram *histograms)
+{
+	LatencyHistogram *hist = pg_malloc0(sizeof(LatencyHistogram));
+	FILE	   *fp;
+	char		label[256];
+
+	fp = fopen(histogram_file, "w");
+	if (fp == NULL)
+	{
+		pg_log_fatal("could not open histogram file \"%s\": %m",
+					 histogram_file);
+		exit(1);
+	}
+
+	mergePhaseHistograms(hist, histograms, -1, -1);
+	writeHistogram(fp, "total", hist);
+
+	if (per_script_stats)
+	{
+		for (int i = 0; i < num_scripts; i++)
+		{
+			memset(hist, 0, sizeof(LatencyHistogram));
+			mergePhaseHistograms(hist, histograms, -1, i);
+			snprintf(label, sizeof(label), "SQL script %d: %s",
+					 i + 1, sql_script[i].desc);
+			writeHistogram(fp, label, hist);
+		}
+	}
+
+	for (int p = 0; p < num_phases; p++)
+	{
+		memset(hist, 0, sizeof(LatencyHistogram));
+		mergePhaseHistograms(hist, histograms, p, -1);
+		snprintf(label, sizeof(label), "phase %d", p + 1);
+		writeHistogram(fp, label, hist);
+
+		if (per_script_stats)
+		{
+			for (int i = 0; i < num_scripts; i++)
+			{
+				snprintf(label, sizeof(label), "phase %d, SQL script %d: %s",
+						 p + 1, i + 1, sql_script[i].desc);
+				writeHistogram(fp, label,
+							   &histograms[HIST_INDEX(p, i)]);
+			}
+		}
+	}
+
+	if (fclose(fp) != 0)
+	{
+		pg_log_fatal("could not write histogram file \"%s\": %m",
+					 histogram_file);
+		exit(1);
+	}
+	pg_free(hist);
+}
+
 /* print version banner */
 static void
 printVersion(PGconn *con)
@@ -5630,8 +6164,11 @@ printResults(StatsData *total,
 			 pg_time_usec_t total_duration, /* benchmarking time */
 			 pg_time_usec_t conn_total_duration,	/* is_connect */
 			 pg_time_usec_t conn_elapsed_duration,	/* !is_connect */
-			 int64 latency_late)
+			 int64 latency_late,
+			 LatencyHistogram *histograms)	/* NULL if not collected */
 {
+	LatencyHistogram *hist = NULL;
+
 	/* tps is about actually executed transactions during benchmarking */
 	int64		ntx = total->cnt - total->skipped;
 	double		bench_duration = PG_TIME_GET_DOUBLE(total_duration);
@@ -5674,7 +6211,7 @@ printResults(StatsData *total,
 			   latency_limit / 1000.0, latency_late, ntx,
 			   (ntx > 0) ? 100.0 * latency_late / ntx : 0.0);
 
-	if (throttle_delay || progress || latency_limit)
+	if (throttle_delay || progress || latency_limit || latency_histograms)
 		printSimpleStats("latency", &total->latency);
 	else
 	{
@@ -5695,6 +6232,13 @@ printResults(StatsData *total,
 			   0.001 * total->lag.sum / total->cnt, 0.001 * total->lag.max);
 	}
 
+	if (histograms)
+	{
+		hist = pg_malloc0(sizeof(LatencyHistogram));
+		mergePhaseHistograms(hist, histograms, -1, -1);
+		printPercentiles("latency", hist);
+	}
+
 	/*
 	 * Under -C/--connect, each transaction incurs a significant connection
 	 * cost, it would not make much sense to ignore it in tps, and it would
@@ -5742,6 +6286,13 @@ printResults(StatsData *total,
 						   100.0 * sstats->skipped / sstats->cnt);
 
 				printSimpleStats(" - latency", &sstats->latency);
+
+				if (histograms)
+				{
+					memset(hist, 0, sizeof(LatencyHistogram));
+					mergePhaseHistograms(hist, histograms, -1, i);
+					printPercentiles(" - latency", hist);
+				}
 			}
 
 			/* Report per-command latencies */
@@ -5768,6 +6319,13 @@ printResults(StatsData *total,
 			}
 		}
 	}
+
+	/* Report per-phase statistics */
+	if (num_phases > 0)
+		printPhaseResults(histograms);
+
+	if (hist)
+		pg_free(hist);
 }
 
 /*
@@ -5866,6 +6424,9 @@ main(int argc, char **argv)
 		{"show-script", required_argument, NULL, 10},
 		{"partitions", required_argument, NULL, 11},
 		{"partition-method", required_argument, NULL, 12},
+		{"phase", required_argument, NULL, 13},
+		{"histogram", no_argument, NULL, 14},
+		{"histogram-file", required_argument, NULL, 15},
 		{NULL, 0, NULL, 0}
 	};
 
@@ -5892,6 +6453,7 @@ main(int argc, char **argv)
 										 * threads */
 	int64		latency_late = 0;
 	StatsData	stats;
+	LatencyHistogram *histograms = NULL;
 	int			weight;
 
 	int			i;
@@ -6242,6 +6804,26 @@ main(int argc, char **argv)
 					exit(1);
 				}
 				break;
+			case 13:			/* phase */
+				benchmarking_option_set = true;
+				if (num_phases >= MAX_PHASES)
+				{
+					pg_log_fatal("at most %d phases can be specified",
+								 MAX_PHASES);
+					exit(1);
+				}
+				/* parsed once all scripts are known */
+				phase_specs[num_phases++] = pg_strdup(optarg);
+				break;
+			case 14:			/* histogram */
+				benchmarking_option_set = true;
+				latency_histograms = true;
+				break;
+			case 15:			/* histogram-file */
+				benchmarking_option_set = true;
+				latency_histograms = true;
+				histogram_file = pg_strdup(optarg);
+				break;
 			default:
 				fprintf(stderr, _("Try \"%s --help\" for more information.\n"), progname);
 				exit(1);
@@ -6280,6 +6862,52 @@ main(int argc, char **argv)
 	if (num_scripts > 1)
 		per_script_stats = true;
 
+	/*
+	 * Set up workload phases.  The phases determine the duration of the run.
+	 * A phase without a rate of its own uses the one given with --rate; they
+	 * must either all be throttled, or none of them.
+	 */
+	if (num_phases > 0 && !is_init_mode)
+	{
+		pg_time_usec_t offset = 0;
+		int			nthrottled = 0;
+
+		if (nxacts > 0 || duration > 0)
+		{
+			pg_log_fatal("--phase cannot be used with -t or -T");
+			exit(1);
+		}
+
+		for (i = 0; i < num_phases; i++)
+		{
+			Phase	   *phase = &phases[i];
+
+			parsePhase(phase_specs[i], phase);
+			if (phase->start_rate == 0 && throttle_delay > 0)
+				phase->start_rate = phase->end_rate = 1000000.0 / throttle_delay;
+			if (phase->start_rate > 0)
+				nthrottled++;
+
+			phase->start = offset;
+			offset += (int64) 1000000 * phase->duration;
+			phase->end = offset;
+			duration += phase->duration;
+		}
+
+		if (nthrottled != 0 && nthrottled != num_phases)
+		{
+			pg_log_fatal("either all phases must have a rate, or none of them");
+			exit(1);
+		}
+
+		/* only used as a flag from now on, see getThrottleDelay() */
+		if (nthrottled > 0)
+			throttle_delay = 1000000.0 / phases[0].start_rate;
+
+		/* phase statistics come from the histograms */
+		latency_histograms = true;
+	}
+
 	/*
 	 * Don't need more threads than there are clients.  (This is not merely an
 	 * optimization; throttle_delay is calculated incorrectly below if some
@@ -6562,6 +7190,9 @@ main(int argc, char **argv)
 		thread->logfile = NULL; /* filled in later */
 		thread->latency_late = 0;
 		initStats(&thread->stats, 0);
+		thread->histograms = latency_histograms ?
+			pg_malloc0(sizeof(LatencyHistogram) * HIST_NPHASES * num_scripts) :
+			NULL;
 
 		nclients_dealt += thread->nstate;
 	}
@@ -6610,6 +7241,8 @@ main(int argc, char **argv)
 	/* wait for other threads and accumulate results */
 	initStats(&stats, 0);
 	conn_total_duration = 0;
+	if (latency_histograms)
+		histograms = pg_malloc0(sizeof(LatencyHistogram) * HIST_NPHASES * num_scripts);
 
 	for (i = 0; i < nthreads; i++)
 	{
@@ -6631,6 +7264,11 @@ main(int argc, char **argv)
 		stats.skipped += thread->stats.skipped;
 		latency_late += thread->latency_late;
 		conn_total_duration += thread->conn_duration;
+		if (histograms)
+		{
+			for (int j = 0; j < HIST_NPHASES * num_scripts; j++)
+				mergeHistogram(&histograms[j], &thread->histograms[j]);
+		}
 
 		/* first recorded benchmarking start time */
 		if (bench_start == 0 || thread->bench_start < bench_start)
@@ -6652,7 +7290,10 @@ main(int argc, char **argv)
 	 * underestimated.
 	 */
 	printResults(&stats, pg_time_now() - bench_start, conn_total_duration,
-				 bench_start - start_time, latency_late);
+				 bench_start - start_time, latency_late, histograms);
+
+	if (histogram_file)
+		writeHistograms(histograms);
 
 	THREAD_BARRIER_DESTROY(&barrier);
 
@@ -1132,6 +1132,28 @@ $node->pgbench(
 	'pgbench late throttling',
 	{ '001_pgbench_sleep' => q{\sleep 2ms} });
 
+# workload phases and latency histograms
+my $histfile = $node->basedir . '/001_pgbench_histogram';
+$node->pgbench(
+	"-n -c 2 -b select-only -b simple-update "
+	  . "--phase=1,rate=100 --phase=1,rate=50-100,weights=1/0 "
+	  . "--histogram-file=$histfile",
+	0,
+	[
+		qr{duration: 2 s},
+		qr{latency percentiles: p50 = [0-9.]+ ms},
+		qr{phase 1: 1 s, rate 100\.0 tps},
+		qr{phase 2: 1 s, rate 50\.0 to 100\.0 tps},
+		qr{SQL script 2: 0 transactions}
+	],
+	[qr{^$}],
+	'pgbench phases and histograms');
+
+my $histogram = slurp_file($histfile);
+like($histogram, qr{^# total\n\s+Value\s+Percentile}, 'histogram file header');
+like($histogram, qr{^# phase 2, SQL script 1: }m, 'histogram file phases');
+like($histogram, qr{^#\[Total count\s+=\s+\d+\]}m, 'histogram file totals');
+
 # return a list of files from directory $dir matching regexpr $re
 # this works around glob portability and escaping issues
 sub list_files
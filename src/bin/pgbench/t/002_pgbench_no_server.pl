@@ -173,6 +173,28 @@ my @options = (
 		'-i --partitions -1',
 		[qr{invalid number of partitions: "-1"}]
 	],
+	[
+		'phase with duration',
+		'--phase=10 -T 5',
+		[qr{--phase cannot be used with -t or -T}]
+	],
+	[ 'invalid phase duration', '--phase=0', [qr{invalid phase duration}] ],
+	[ 'invalid phase rate', '--phase=10,rate=0', [qr{invalid phase rate}] ],
+	[
+		'invalid phase weights',
+		'-b se -b si --phase=10,weights=1',
+		[qr{must match the number of scripts \(2\)}]
+	],
+	[
+		'unrecognized phase setting',
+		'--phase=10,speed=3',
+		[qr{unrecognized phase setting "speed=3"}]
+	],
+	[
+		'partially throttled phases',
+		'--phase=5,rate=10 --phase=5',
+		[qr{either all phases must have a rate}]
+	],
 	[
 		'partition method without partitioning',
 		'-i --partition-method=hash',
@@ -0,0 +1,234 @@
+/*-------------------------------------------------------------------------
+ *
+ * walstream_compression.c
+ *	  Compression of WAL data sent over the replication protocol
+ *
+ * The walsender compresses slices of WAL with these routines when the client
+ * asked for it in START_REPLICATION, and walreceiver and pg_receivewal
+ * decompress them again.  Every compressed message is compressed on its own,
+ * so there is no state to keep in sync between the two sides; the zstd
+ * contexts below are only kept around to avoid allocating them again for
+ * every message.
+ *
+ * Copyright (c) 2021, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		  src/common/walstream_compression.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef FRONTEND
+#include "postgres.h"
+#else
+#include "postgres_fe.h"
+#endif
+
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "common/pg_lzcompress.h"
+#include "common/walstream_compression.h"
+
+/*
+ * WAL is sent while it's being generated, so favor speed over ratio.
+ */
+#define WALSTREAM_ZSTD_LEVEL	1
+
+#ifdef USE_ZSTD
+static ZSTD_CCtx *walstream_zstd_cctx = NULL;
+static ZSTD_DCtx *walstream_zstd_dctx = NULL;
+#endif
+
+/*
+ * If 'name' is a recognized compression method, set *method to the
+ * corresponding constant and return true.  Otherwise, set *method to
+ * WALSTREAM_COMPRESSION_NONE and return false.  A recognized method isn't
+ * necessarily supported by this build, see
+ * pg_walstream_compression_supported().
+ */
+bool
+pg_walstream_parse_compression(const char *name,
+							   pg_walstream_compression *method)
+{
+	pg_walstream_compression result = WALSTREAM_COMPRESSION_NONE;
+	bool		found = true;
+
+	if (pg_strcasecmp(name, "pglz") == 0)
+		result = WALSTREAM_COMPRESSION_PGLZ;
+	else if (pg_strcasecmp(name, "lz4") == 0)
+		result = WALSTREAM_COMPRESSION_LZ4;
+	else if (pg_strcasecmp(name, "zstd") == 0)
+		result = WALSTREAM_COMPRESSION_ZSTD;
+	else
+		found = false;
+
+	*method = result;
+	return found;
+}
+
+/*
+ * Get the canonical human-readable name for a compression method.
+ */
+const char *
+pg_walstream_compression_name(pg_walstream_compression method)
+{
+	switch (method)
+	{
+		case WALSTREAM_COMPRESSION_NONE:
+			return "none";
+		case WALSTREAM_COMPRESSION_PGLZ:
+			return "pglz";
+		case WALSTREAM_COMPRESSION_LZ4:
+			return "lz4";
+		case WALSTREAM_COMPRESSION_ZSTD:
+			return "zstd";
+	}
+
+	Assert(false);
+	return "???";
+}
+
+/*
+ * Can this build compress and decompress with the given method?
+ */
+bool
+pg_walstream_compression_supported(pg_walstream_compression method)
+{
+	switch (method)
+	{
+		case WALSTREAM_COMPRESSION_NONE:
+			return false;
+		case WALSTREAM_COMPRESSION_PGLZ:
+			return true;
+		case WALSTREAM_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			return true;
+#else
+			return false;
+#endif
+		case WALSTREAM_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			return true;
+#else
+			return false;
+#endif
+	}
+
+	return false;
+}
+
+/*
+ * Compress 'slen' bytes at 'source' into 'dest', which must have room for
+ * PG_WALSTREAM_COMPRESS_BOUND(slen) bytes.
+ *
+ * Returns the compressed size, or -1 if the data could not be compressed to
+ * fewer than 'slen' bytes; the caller should then send it uncompressed.
+ */
+int
+pg_walstream_compress(pg_walstream_compression method,
+					  const char *source, int slen, char *dest)
+{
+	int			len = -1;
+
+	switch (method)
+	{
+		case WALSTREAM_COMPRESSION_PGLZ:
+			len = pglz_compress(source, slen, dest, PGLZ_strategy_default);
+			break;
+
+		case WALSTREAM_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			len = LZ4_compress_default(source, dest, slen, slen - 1);
+			if (len <= 0)
+				len = -1;
+#endif
+			break;
+
+		case WALSTREAM_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			{
+				size_t		zlen;
+
+				if (walstream_zstd_cctx == NULL)
+				{
+					walstream_zstd_cctx = ZSTD_createCCtx();
+					if (walstream_zstd_cctx == NULL)
+						return -1;
+				}
+
+				zlen = ZSTD_compressCCtx(walstream_zstd_cctx, dest, slen - 1,
+										 source, slen, WALSTREAM_ZSTD_LEVEL);
+				len = ZSTD_isError(zlen) ? -1 : (int) zlen;
+			}
+#endif
+			break;
+
+		case WALSTREAM_COMPRESSION_NONE:
+			break;
+	}
+
+	if (len >= slen)
+		len = -1;
+
+	return len;
+}
+
+/*
+ * Decompress 'slen' bytes at 'source' into 'dest', which must have room for
+ * the 'rawsize' bytes the data was compressed from.
+ *
+ * Returns the decompressed size, or -1 if the data is corrupt or the method
+ * isn't supported by this build.  Anything but 'rawsize' means the data is
+ * not usable.
+ */
+int
+pg_walstream_decompress(pg_walstream_compression method,
+						const char *source, int slen,
+						char *dest, int rawsize)
+{
+	int			len = -1;
+
+	switch (method)
+	{
+		case WALSTREAM_COMPRESSION_PGLZ:
+			len = pglz_decompress(source, slen, dest, rawsize, true);
+			break;
+
+		case WALSTREAM_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			len = LZ4_decompress_safe(source, dest, slen, rawsize);
+			if (len < 0)
+				len = -1;
+#endif
+			break;
+
+		case WALSTREAM_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			{
+				size_t		zlen;
+
+				if (walstream_zstd_dctx == NULL)
+				{
+					walstream_zstd_dctx = ZSTD_createDCtx();
+					if (walstream_zstd_dctx == NULL)
+						return -1;
+				}
+
+				zlen = ZSTD_decompressDCtx(walstream_zstd_dctx, dest, rawsize,
+										   source, slen);
+				len = ZSTD_isError(zlen) ? -1 : (int) zlen;
+			}
+#endif
+			break;
+
+		case WALSTREAM_COMPRESSION_NONE:
+			break;
+	}
+
+	return len;
+}
@@ -63,6 +63,15 @@ extern struct varlena *detoast_attr_slice(struct varlena *attr,
 										  int32 sliceoffset,
 										  int32 slicelength);
 
+/* ----------
+ * detoast_attr_is_seekable() -
+ *
+ *		True if any part of the datum can be fetched without reading and
+ *		decompressing everything before it.
+ * ----------
+ */
+extern bool detoast_attr_is_seekable(struct varlena *attr);
+
 /* ----------
  * toast_raw_datum_size -
  *
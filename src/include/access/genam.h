@@ -147,6 +147,11 @@ extern bool index_insert(Relation indexRelation,
 						 IndexUniqueCheck checkUnique,
 						 bool indexUnchanged,
 						 struct IndexInfo *indexInfo);
+extern void index_insert_multi(Relation indexRelation,
+							   Datum *values, bool *isnull,
+							   ItemPointer heap_tids, int ntuples,
+							   Relation heapRelation,
+							   struct IndexInfo *indexInfo);
 
 extern IndexScanDesc index_beginscan(Relation heapRelation,
 									 Relation indexRelation,
@@ -18,6 +18,7 @@
 #include "fmgr.h"
 #include "lib/rbtree.h"
 #include "storage/bufmgr.h"
+#include "storage/shm_toc.h"
 
 /*
  * Storage type for GIN's reloptions
@@ -27,9 +28,11 @@ typedef struct GinOptions
 	int32		vl_len_;		/* varlena header (do not touch directly!) */
 	bool		useFastUpdate;	/* use fast updates? */
 	int			pendingListCleanupSize; /* maximum size of pending list */
+	bool		autoCleanup;	/* clean pending list in autovacuum? */
 } GinOptions;
 
 #define GIN_DEFAULT_USE_FASTUPDATE	true
+#define GIN_DEFAULT_AUTOCLEANUP		false
 #define GinGetUseFastUpdate(relation) \
 	(AssertMacro(relation->rd_rel->relkind == RELKIND_INDEX && \
 				 relation->rd_rel->relam == GIN_AM_OID), \
@@ -42,6 +45,11 @@ typedef struct GinOptions
 	 ((GinOptions *) (relation)->rd_options)->pendingListCleanupSize != -1 ? \
 	 ((GinOptions *) (relation)->rd_options)->pendingListCleanupSize : \
 	 gin_pending_list_limit)
+#define GinGetAutoCleanup(relation) \
+	(AssertMacro(relation->rd_rel->relkind == RELKIND_INDEX && \
+				 relation->rd_rel->relam == GIN_AM_OID), \
+	 (relation)->rd_options ? \
+	 ((GinOptions *) (relation)->rd_options)->autoCleanup : GIN_DEFAULT_AUTOCLEANUP)
 
 
 /* Macros for buffer lock/unlock operations */
@@ -122,6 +130,7 @@ extern void ginEntryInsert(GinState *ginstate,
 						   OffsetNumber attnum, Datum key, GinNullCategory category,
 						   ItemPointerData *items, uint32 nitem,
 						   GinStatsData *buildStats);
+extern void _gin_parallel_build_main(dsm_segment *seg, shm_toc *toc);
 
 /* ginbtree.c */
 
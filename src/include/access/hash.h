@@ -268,6 +268,7 @@ typedef struct HashOptions
 {
 	int32		varlena_header_;	/* varlena header (do not touch directly!) */
 	int			fillfactor;		/* page fill factor in percent (0..100) */
+	bool		autosplit;		/* split buckets in autovacuum? */
 } HashOptions;
 
 #define HashGetFillFactor(relation) \
@@ -278,6 +279,17 @@ typedef struct HashOptions
 	 HASH_DEFAULT_FILLFACTOR)
 #define HashGetTargetPageUsage(relation) \
 	(BLCKSZ * HashGetFillFactor(relation) / 100)
+#define HashGetAutoSplit(relation) \
+	(AssertMacro(relation->rd_rel->relkind == RELKIND_INDEX && \
+				 relation->rd_rel->relam == HASH_AM_OID), \
+	 (relation)->rd_options ? \
+	 ((HashOptions *) (relation)->rd_options)->autosplit : false)
+
+/*
+ * With autosplit, inserters leave bucket splits to autovacuum until the
+ * index holds this multiple of the tuples its buckets are sized for.
+ */
+#define HASH_AUTOSPLIT_FALLBACK		2
 
 /*
  * Maximum size of a hash index item (it's okay to have only one per page)
@@ -366,6 +378,9 @@ extern bool hashinsert(Relation rel, Datum *values, bool *isnull,
 					   IndexUniqueCheck checkUnique,
 					   bool indexUnchanged,
 					   struct IndexInfo *indexInfo);
+extern void hashinsertmulti(Relation rel, Datum *values, bool *isnull,
+							ItemPointer ht_ctids, int ntuples,
+							Relation heapRel, struct IndexInfo *indexInfo);
 extern bool hashgettuple(IndexScanDesc scan, ScanDirection dir);
 extern int64 hashgetbitmap(IndexScanDesc scan, TIDBitmap *tbm);
 extern IndexScanDesc hashbeginscan(Relation rel, int nkeys, int norderbys);
@@ -389,6 +404,8 @@ extern void hashadjustmembers(Oid opfamilyoid,
 
 /* hashinsert.c */
 extern void _hash_doinsert(Relation rel, IndexTuple itup, Relation heapRel);
+extern void _hash_doinsert_multi(Relation rel, IndexTuple *itups, int nitups,
+								 Relation heapRel);
 extern OffsetNumber _hash_pgaddtup(Relation rel, Buffer buf,
 								   Size itemsize, IndexTuple itup);
 extern void _hash_pgaddmultitup(Relation rel, Buffer buf, IndexTuple *itups,
@@ -433,6 +450,10 @@ extern void _hash_init_metabuffer(Buffer buf, double num_tuples,
 								  RegProcedure procid, uint16 ffactor, bool initpage);
 extern void _hash_pageinit(Page page, Size size);
 extern void _hash_expandtable(Relation rel, Buffer metabuf);
+extern void _hash_expandtable_all(Relation rel, Buffer metabuf);
+extern bool _hash_defer_expand(Relation rel, double ntuples, uint32 ninserted,
+							   uint16 ffactor, uint32 maxbucket);
+extern void _hash_expand_deferred(Oid indexoid);
 extern void _hash_finish_split(Relation rel, Buffer metabuf, Buffer obuf,
 							   Bucket obucket, uint32 maxbucket, uint32 highmask,
 							   uint32 lowmask);
@@ -1043,6 +1043,24 @@ typedef struct BTScanOpaqueData
 	BTArrayKeyInfo *arrayKeys;	/* info about each equality-type array key */
 	MemoryContext arrayContext; /* scan-lifespan context for array data */
 
+	/*
+	 * Skip scan state, used by forward scans whose keys constrain the second
+	 * index column but not the first (see _bt_skip_preprocess()).  The
+	 * bounds are insertion-format scan keys on the second column, in index
+	 * order.  skipTuple is NULL unless btrescan() saw keys that might allow
+	 * skipping.
+	 */
+	bool		skipEnabled;	/* may we skip over leaf pages? */
+	bool		skipPending;	/* re-descend instead of stepping right? */
+	bool		skipNextPrefix; /* skip past skipTuple's first column value? */
+	bool		skipHasLower;	/* is skipLower valid? */
+	bool		skipLowerStrict;	/* does skipLower exclude equal values? */
+	bool		skipHasUpper;	/* is skipUpper valid? */
+	bool		skipUpperStrict;	/* does skipUpper exclude equal values? */
+	ScanKeyData skipLower;		/* lower bound on second column */
+	ScanKeyData skipUpper;		/* upper bound on second column */
+	IndexTuple	skipTuple;		/* workspace: tuple the skip is relative to */
+
 	/* info about killed items if any (killedItems is NULL if never used) */
 	int		   *killedItems;	/* currPos.items indexes of killed items */
 	int			numKilled;		/* number of currently stored items */
@@ -1262,6 +1280,9 @@ extern void _bt_restore_array_keys(IndexScanDesc scan);
 extern void _bt_preprocess_keys(IndexScanDesc scan);
 extern bool _bt_checkkeys(IndexScanDesc scan, IndexTuple tuple,
 						  int tupnatts, ScanDirection dir, bool *continuescan);
+extern bool _bt_skip_possible(IndexScanDesc scan);
+extern void _bt_skip_preprocess(IndexScanDesc scan, ScanDirection dir);
+extern void _bt_skip_check(IndexScanDesc scan, Page page);
 extern void _bt_killitems(IndexScanDesc scan);
 extern BTCycleId _bt_vacuum_cycleid(Relation rel);
 extern BTCycleId _bt_start_vacuum(Relation rel);
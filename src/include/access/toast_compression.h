@@ -13,6 +13,8 @@
 #ifndef TOAST_COMPRESSION_H
 #define TOAST_COMPRESSION_H
 
+#include "access/attnum.h"
+
 /*
  * GUC support.
  *
@@ -22,6 +24,12 @@
  */
 extern int	default_toast_compression;
 
+/*
+ * toast_segmented_min_size is the size in kB from which values are
+ * compressed in segments (see toast_segment_header); 0 disables that.
+ */
+extern int	toast_segmented_min_size;
+
 /*
  * Built-in compression method ID.  The toast compression header will store
  * this in the first 2 bits of the raw length.  These built-in compression
@@ -31,14 +39,16 @@ extern int	default_toast_compression;
  * of the raw bits from a varlena; in particular, if the goal is to identify
  * a compression method, use the constants TOAST_PGLZ_COMPRESSION, etc.
  * below. We might someday support more than 4 compression methods, but
- * we can never have more than 4 values in this enum, because there are
- * only 2 bits available in the places where this is stored.
+ * we can never have more than 4 stored values in this enum, because there
+ * are only 2 bits available in the places where this is stored.
+ * TOAST_INVALID_COMPRESSION_ID is never stored.
  */
 typedef enum ToastCompressionId
 {
 	TOAST_PGLZ_COMPRESSION_ID = 0,
 	TOAST_LZ4_COMPRESSION_ID = 1,
-	TOAST_INVALID_COMPRESSION_ID = 2
+	TOAST_ZSTD_COMPRESSION_ID = 2,
+	TOAST_INVALID_COMPRESSION_ID = 3
 } ToastCompressionId;
 
 /*
@@ -48,10 +58,18 @@ typedef enum ToastCompressionId
  */
 #define TOAST_PGLZ_COMPRESSION			'p'
 #define TOAST_LZ4_COMPRESSION			'l'
+#define TOAST_ZSTD_COMPRESSION			'z'
 #define InvalidCompressionMethod		'\0'
 
 #define CompressionMethodIsValid(cm)  ((cm) != InvalidCompressionMethod)
 
+/*
+ * Range of the per-column compression_level option, which only applies to
+ * zstd.  The default matches the library's own default level.
+ */
+#define TOAST_ZSTD_DEFAULT_LEVEL		3
+#define TOAST_ZSTD_MAX_LEVEL			22
+
 
 /* pglz compression/decompression routines */
 extern struct varlena *pglz_compress_datum(const struct varlena *value);
@@ -65,8 +83,26 @@ extern struct varlena *lz4_decompress_datum(const struct varlena *value);
 extern struct varlena *lz4_decompress_datum_slice(const struct varlena *value,
 												  int32 slicelength);
 
+/* zstd compression/decompression routines */
+extern struct varlena *zstd_compress_datum(const struct varlena *value,
+										   Oid relid, AttrNumber attnum);
+extern struct varlena *zstd_decompress_datum(const struct varlena *value);
+extern struct varlena *zstd_decompress_datum_slice(const struct varlena *value,
+												   int32 slicelength);
+extern void zstd_set_dictionary_id(bytea *dict, Oid dictid);
+
+/* segmented compression/decompression routines */
+extern struct varlena *segmented_compress_datum(const struct varlena *value,
+												ToastCompressionId cmid,
+												Oid relid, AttrNumber attnum);
+extern struct varlena *segmented_decompress_datum(const struct varlena *value);
+extern struct varlena *segmented_decompress_datum_slice(const struct varlena *value,
+														int32 sliceoffset,
+														int32 slicelength);
+
 /* other stuff */
 extern ToastCompressionId toast_get_compression_id(struct varlena *attr);
+extern bool toast_compressed_needs_dictionary(struct varlena *attr);
 extern char CompressionNameToMethod(const char *compression);
 extern const char *GetCompressionMethodName(char method);
 
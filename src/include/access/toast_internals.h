@@ -40,12 +40,56 @@ typedef struct toast_compress_header
 	do { \
 		Assert((len) > 0 && (len) <= VARLENA_EXTSIZE_MASK); \
 		Assert((cm_method) == TOAST_PGLZ_COMPRESSION_ID || \
-			   (cm_method) == TOAST_LZ4_COMPRESSION_ID); \
+			   (cm_method) == TOAST_LZ4_COMPRESSION_ID || \
+			   (cm_method) == TOAST_ZSTD_COMPRESSION_ID); \
 		((toast_compress_header *) (ptr))->tcinfo = \
 			(len) | ((uint32) (cm_method) << VARLENA_EXTSIZE_BITS); \
 	} while (0)
 
-extern Datum toast_compress_datum(Datum value, char cmethod);
+/*
+ * Values of at least toast_segmented_min_size kB are compressed in segments
+ * of TOAST_SEGMENT_SIZE raw bytes, each compressed on its own (or stored as
+ * is, if it doesn't compress), so that any part of the value can be
+ * decompressed without decompressing what comes before it.  Such values keep
+ * the compression method of their segments in the tcinfo word, and their
+ * compressed data, after the tcinfo word, starts with this header.  The
+ * segments' data follows the header back to back; tsh_ends[i] is the offset
+ * just past segment i's data, counted from the end of the header.  A segment
+ * whose stored length equals its raw length is not compressed.
+ *
+ * The header's first byte, TOAST_SEGMENTED_MARKER, tells it apart from the
+ * data of a value compressed as a whole: a pglz stream starts with a control
+ * byte whose low bit is clear, since its first item can only be a literal,
+ * an LZ4 block starts with a token that has a nonzero literal length, and a
+ * zstd frame starts with its magic number, whose first byte is 0x28.
+ *
+ * The header is not necessarily aligned within a datum, so read it with
+ * memcpy.
+ */
+typedef struct toast_segment_header
+{
+	uint8		tsh_marker;		/* always TOAST_SEGMENTED_MARKER */
+	uint8		tsh_unused[3];
+	uint32		tsh_segsize;	/* raw size of all segments but the last */
+	uint32		tsh_ends[FLEXIBLE_ARRAY_MEMBER];
+} toast_segment_header;
+
+#define TOAST_SEGMENTED_MARKER		0x01
+#define TOAST_SEGMENT_SIZE			(64 * 1024)
+
+/* Does compressed data (following the tcinfo word) start a segment header? */
+#define TOAST_DATA_IS_SEGMENTED(data) \
+	(*((const uint8 *) (data)) == TOAST_SEGMENTED_MARKER)
+#define TOAST_COMPRESS_IS_SEGMENTED(ptr) \
+	TOAST_DATA_IS_SEGMENTED((const char *) (ptr) + VARHDRSZ_COMPRESSED)
+
+#define TOAST_SEGMENT_COUNT(rawsize, segsize) \
+	(((rawsize) + (segsize) - 1) / (segsize))
+#define TOAST_SEGMENT_HEADER_SIZE(nsegments) \
+	(offsetof(toast_segment_header, tsh_ends) + (nsegments) * sizeof(uint32))
+
+extern Datum toast_compress_datum(Datum value, char cmethod,
+								  Oid relid, AttrNumber attnum);
 extern Oid	toast_get_valid_index(Oid toastoid, LOCKMODE lock);
 
 extern void toast_delete_datum(Relation rel, Datum value, bool is_speculative);
@@ -60,4 +104,10 @@ extern void toast_close_indexes(Relation *toastidxs, int num_indexes,
 								LOCKMODE lock);
 extern void init_toast_snapshot(Snapshot toast_snapshot);
 
+extern void segmented_decompress_range(ToastCompressionId cmid,
+									   const toast_segment_header *hdr,
+									   int32 rawsize, const char *data,
+									   int32 offset, int32 length,
+									   char *dest);
+
 #endif							/* TOAST_INTERNALS_H */
@@ -53,6 +53,6 @@
  */
 
 /*							yyyymmddN */
-#define CATALOG_VERSION_NO	202202231
+#define CATALOG_VERSION_NO	202202233
 
 #endif
@@ -0,0 +1,65 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_zstd_dictionary.h
+ *	  definition of the "Zstandard compression dictionary" system catalog
+ *	  (pg_zstd_dictionary)
+ *
+ * Portions Copyright (c) 1996-2021, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/catalog/pg_zstd_dictionary.h
+ *
+ * NOTES
+ *	  The Catalog.pm module reads this file and derives schema
+ *	  information.
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef PG_ZSTD_DICTIONARY_H
+#define PG_ZSTD_DICTIONARY_H
+
+#include "access/attnum.h"
+#include "catalog/genbki.h"
+#include "catalog/pg_zstd_dictionary_d.h"
+
+/* ----------------
+ *		pg_zstd_dictionary definition.  cpp turns this into
+ *		typedef struct FormData_pg_zstd_dictionary
+ * ----------------
+ */
+CATALOG(pg_zstd_dictionary,8682,ZstdDictionaryRelationId)
+{
+	Oid			oid;			/* oid, also the dictionary ID recorded in
+								 * every value compressed with it */
+	Oid			zdictrelid BKI_LOOKUP_OPT(pg_class);	/* table the dictionary
+														 * was trained for, or
+														 * 0 once dropped */
+	int16		zdictattnum;	/* column the dictionary was trained for */
+	int32		zdictversion;	/* counts up from 1 for each dictionary
+								 * trained for the column */
+
+#ifdef CATALOG_VARLEN			/* variable-length fields start here */
+	bytea		zdictdata BKI_FORCE_NOT_NULL;	/* dictionary contents */
+#endif
+} FormData_pg_zstd_dictionary;
+
+/* ----------------
+ *		Form_pg_zstd_dictionary corresponds to a pointer to a tuple with
+ *		the format of pg_zstd_dictionary relation.
+ * ----------------
+ */
+typedef FormData_pg_zstd_dictionary *Form_pg_zstd_dictionary;
+
+DECLARE_TOAST(pg_zstd_dictionary, 8683, 8684);
+
+DECLARE_UNIQUE_INDEX_PKEY(pg_zstd_dictionary_oid_index, 8685, on pg_zstd_dictionary using btree(oid oid_ops));
+#define ZstdDictionaryOidIndexId	8685
+DECLARE_INDEX(pg_zstd_dictionary_relid_index, 8686, on pg_zstd_dictionary using btree(zdictrelid oid_ops, zdictattnum int2_ops));
+#define ZstdDictionaryRelidIndexId	8686
+
+extern Oid	ZstdDictionaryCreate(Oid relid, AttrNumber attnum, bytea *data);
+extern bytea *ZstdDictionaryGetData(Oid dictid);
+extern Oid	ZstdDictionaryGetLatest(Oid relid, AttrNumber attnum);
+extern void ZstdDictionaryDetach(Oid relid, AttrNumber attnum);
+
+#endif							/* PG_ZSTD_DICTIONARY_H */
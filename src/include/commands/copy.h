@@ -19,6 +19,9 @@
 #include "parser/parse_node.h"
 #include "tcop/dest.h"
 
+/* Default number of rows per row group in COPY FORMAT columnar */
+#define COPY_COLUMNAR_DEFAULT_ROW_GROUP_SIZE	65536
+
 /*
  * A struct to hold COPY options, in a parsed form. All of these are related
  * to formatting, except for 'freeze', which doesn't really belong here, but
@@ -48,6 +51,12 @@ typedef struct CopyFormatOptions
 	bool	   *force_null_flags;	/* per-column CSV FN flags */
 	bool		convert_selectively;	/* do selective binary conversion? */
 	List	   *convert_select; /* list of column names (can be NIL) */
+	bool		columnar;		/* columnar binary format? (binary is set
+								 * too) */
+	int			row_group_size; /* max rows per row group, columnar only */
+	char		compression;	/* compression method of column chunks,
+								 * columnar only; InvalidCompressionMethod
+								 * if none */
 } CopyFormatOptions;
 
 /* These are private in commands/copy[from|to].c */
@@ -79,6 +79,7 @@ typedef struct CopyFromStateData
 	/* these are just for error messages, see CopyFromErrorCallback */
 	const char *cur_relname;	/* table name for error messages */
 	uint64		cur_lineno;		/* line number for error messages */
+	uint64		cur_lineno_last;	/* last line of a batch, for error messages */
 	const char *cur_attname;	/* current att for error messages */
 	const char *cur_attval;		/* current att value for error messages */
 
@@ -0,0 +1,46 @@
+/*-------------------------------------------------------------------------
+ *
+ * walstream_compression.h
+ *	  Compression of WAL data sent over the replication protocol
+ *
+ * Copyright (c) 2021, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		  src/include/common/walstream_compression.h
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef WALSTREAM_COMPRESSION_H
+#define WALSTREAM_COMPRESSION_H
+
+/*
+ * Compression methods for compressed WAL data messages.  The values are sent
+ * over the wire, so don't renumber them.
+ */
+typedef enum pg_walstream_compression
+{
+	WALSTREAM_COMPRESSION_NONE = 0,
+	WALSTREAM_COMPRESSION_PGLZ = 1,
+	WALSTREAM_COMPRESSION_LZ4 = 2,
+	WALSTREAM_COMPRESSION_ZSTD = 3
+} pg_walstream_compression;
+
+/*
+ * Space pg_walstream_compress() needs in its output buffer for 'slen' bytes
+ * of input.  pglz may overrun the input size by a few bytes before it notices
+ * that compression failed.
+ */
+#define PG_WALSTREAM_COMPRESS_BOUND(slen)	((slen) + 4)
+
+extern bool pg_walstream_parse_compression(const char *name,
+										   pg_walstream_compression *method);
+extern const char *pg_walstream_compression_name(pg_walstream_compression method);
+extern bool pg_walstream_compression_supported(pg_walstream_compression method);
+extern int	pg_walstream_compress(pg_walstream_compression method,
+								  const char *source, int slen, char *dest);
+extern int	pg_walstream_decompress(pg_walstream_compression method,
+									const char *source, int slen,
+									char *dest, int rawsize);
+
+#endif							/* WALSTREAM_COMPRESSION_H */
@@ -129,6 +129,8 @@ typedef struct TupleTableSlot
 	MemoryContext tts_mcxt;		/* slot itself is in this context */
 	ItemPointerData tts_tid;	/* stored tuple's tid */
 	Oid			tts_tableOid;	/* table oid of tuple */
+	struct TupleDeformProgram *tts_deform;	/* cached deform program for
+											 * tts_tupleDescriptor, or NULL */
 } TupleTableSlot;
 
 /* routines for a TupleTableSlot implementation */
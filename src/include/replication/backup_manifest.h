@@ -47,6 +47,8 @@ extern void AddWALInfoToBackupManifest(backup_manifest_info *manifest,
 									   XLogRecPtr startptr,
 									   TimeLineID starttli, XLogRecPtr endptr,
 									   TimeLineID endtli);
+extern void AddIncrementalInfoToBackupManifest(backup_manifest_info *manifest,
+											   XLogRecPtr reference_lsn);
 extern void SendBackupManifest(backup_manifest_info *manifest);
 extern void FreeBackupManifest(backup_manifest_info *manifest);
 
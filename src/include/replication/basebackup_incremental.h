@@ -0,0 +1,70 @@
+/*-------------------------------------------------------------------------
+ *
+ * basebackup_incremental.h
+ *	  Changed-block tracking for incremental base backups.
+ *
+ * The on-disk format of incremental files is shared with the frontend
+ * tools that reconstruct full files from a chain of backups, so this header
+ * must remain usable from frontend code.
+ *
+ * Copyright (c) 2021, PostgreSQL Global Development Group
+ *
+ * src/include/replication/basebackup_incremental.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef BASEBACKUP_INCREMENTAL_H
+#define BASEBACKUP_INCREMENTAL_H
+
+#include "access/xlogdefs.h"
+#include "common/relpath.h"
+#include "storage/block.h"
+
+/*
+ * An incremental file is stored under the name of the relation segment it
+ * replaces, prefixed with INCREMENTAL_PREFIX. It starts with a header
+ * consisting of INCREMENTAL_MAGIC, the number of blocks it contains, and the
+ * length in blocks the segment had when the backup was taken, followed by
+ * the segment-relative block numbers of the blocks it contains. The block
+ * images follow, in the same order.
+ */
+#define INCREMENTAL_PREFIX			"INCREMENTAL."
+#define INCREMENTAL_PREFIX_LENGTH	(sizeof(INCREMENTAL_PREFIX) - 1)
+#define INCREMENTAL_MAGIC			0xd3ae1f0d
+
+/*
+ * Size of an incremental file containing num_blocks blocks.
+ */
+#define IncrementalFileHeaderSize(num_blocks) \
+	(sizeof(uint32) * 3 + sizeof(BlockNumber) * (num_blocks))
+#define IncrementalFileSize(num_blocks) \
+	(IncrementalFileHeaderSize(num_blocks) + (size_t) BLCKSZ * (num_blocks))
+
+typedef enum
+{
+	BACK_UP_FILE_FULLY,
+	BACK_UP_FILE_INCREMENTALLY
+} FileBackupMethod;
+
+#ifndef FRONTEND
+
+struct IncrementalBackupInfo;
+typedef struct IncrementalBackupInfo IncrementalBackupInfo;
+
+extern IncrementalBackupInfo *CreateIncrementalBackupInfo(XLogRecPtr reference_lsn);
+extern void PrepareForIncrementalBackup(IncrementalBackupInfo *ib,
+										XLogRecPtr backup_start_lsn);
+extern XLogRecPtr GetIncrementalBackupReferenceLSN(IncrementalBackupInfo *ib);
+extern FileBackupMethod GetFileBackupMethod(IncrementalBackupInfo *ib,
+											Oid spcoid, Oid dboid,
+											Oid relfilenode,
+											ForkNumber forknum,
+											unsigned segno, size_t size,
+											unsigned *num_blocks_required,
+											BlockNumber *relative_block_numbers,
+											unsigned *truncation_block_length);
+extern void FreeIncrementalBackupInfo(IncrementalBackupInfo *ib);
+
+#endif							/* FRONTEND */
+
+#endif							/* BASEBACKUP_INCREMENTAL_H */
@@ -92,6 +92,12 @@ typedef struct LogicalDecodingContext
 	 */
 	bool		twophase;
 
+	/*
+	 * Results of filter_by_relation_cb, keyed by relfilenode. Created on
+	 * first use and reset whenever a decoded commit carries invalidations.
+	 */
+	HTAB	   *relation_filter_cache;
+
 	/*
 	 * State for writing output.
 	 */
@@ -131,6 +137,7 @@ extern void LogicalConfirmReceivedLocation(XLogRecPtr lsn);
 extern bool filter_prepare_cb_wrapper(LogicalDecodingContext *ctx,
 									  TransactionId xid, const char *gid);
 extern bool filter_by_origin_cb_wrapper(LogicalDecodingContext *ctx, RepOriginId origin_id);
+extern bool filter_by_relation_cb_wrapper(LogicalDecodingContext *ctx, Relation relation);
 extern void ResetLogicalStreamingState(void);
 extern void UpdateDecodingStats(LogicalDecodingContext *ctx);
 
@@ -94,6 +94,12 @@ typedef void (*LogicalDecodeMessageCB) (struct LogicalDecodingContext *ctx,
 typedef bool (*LogicalDecodeFilterByOriginCB) (struct LogicalDecodingContext *ctx,
 											   RepOriginId origin_id);
 
+/*
+ * Filter changes by relation, while they are being decoded.
+ */
+typedef bool (*LogicalDecodeFilterByRelationCB) (struct LogicalDecodingContext *ctx,
+												 Relation relation);
+
 /*
  * Called to shutdown an output plugin.
  */
@@ -220,6 +226,7 @@ typedef struct OutputPluginCallbacks
 	LogicalDecodeCommitCB commit_cb;
 	LogicalDecodeMessageCB message_cb;
 	LogicalDecodeFilterByOriginCB filter_by_origin_cb;
+	LogicalDecodeFilterByRelationCB filter_by_relation_cb;
 	LogicalDecodeShutdownCB shutdown_cb;
 
 	/* streaming of changes at prepare time */
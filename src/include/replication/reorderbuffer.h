@@ -18,6 +18,16 @@
 #include "utils/timestamp.h"
 
 extern PGDLLIMPORT int logical_decoding_work_mem;
+extern PGDLLIMPORT int logical_decoding_spill_compression;
+
+/* possible values for logical_decoding_spill_compression */
+typedef enum
+{
+	REORDER_BUFFER_SPILL_COMPRESSION_OFF,
+	REORDER_BUFFER_SPILL_COMPRESSION_PGLZ,
+	REORDER_BUFFER_SPILL_COMPRESSION_LZ4,
+	REORDER_BUFFER_SPILL_COMPRESSION_ZSTD
+} ReorderBufferSpillCompression;
 
 /* an individual tuple, stored in one chunk of memory */
 typedef struct ReorderBufferTupleBuf
@@ -586,6 +596,15 @@ struct ReorderBuffer
 	char	   *outbuf;
 	Size		outbufsize;
 
+	/* block of serialized changes not yet written to disk */
+	char	   *spillbuf;
+	Size		spillbufsize;
+	Size		spillbuflen;
+
+	/* buffer for compressed blocks */
+	char	   *compressbuf;
+	Size		compressbufsize;
+
 	/* memory accounting */
 	Size		size;
 
@@ -663,6 +682,8 @@ void		ReorderBufferProcessXid(ReorderBuffer *, TransactionId xid, XLogRecPtr lsn
 
 void		ReorderBufferXidSetCatalogChanges(ReorderBuffer *, TransactionId xid, XLogRecPtr lsn);
 bool		ReorderBufferXidHasCatalogChanges(ReorderBuffer *, TransactionId xid);
+bool		ReorderBufferXactHasCatalogChanges(ReorderBuffer *, TransactionId xid);
+bool		ReorderBufferXactHasPartialChange(ReorderBuffer *, TransactionId xid);
 bool		ReorderBufferXidHasBaseSnapshot(ReorderBuffer *, TransactionId xid);
 
 bool		ReorderBufferRememberPrepareInfo(ReorderBuffer *rb, TransactionId xid,
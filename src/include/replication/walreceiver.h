@@ -28,6 +28,7 @@
 extern int	wal_receiver_status_interval;
 extern int	wal_receiver_timeout;
 extern bool hot_standby_feedback;
+extern char *wal_receiver_compression;
 
 /*
  * MAXCONNINFO: maximum size of a connection string.
@@ -174,6 +175,8 @@ typedef struct
 		struct
 		{
 			TimeLineID	startpointTLI;	/* Starting timeline */
+			char	   *compression;	/* Compression methods to offer, or
+										 * NULL */
 		}			physical;
 		struct
 		{
@@ -17,6 +17,8 @@
 #include "access/xlogdefs.h"
 #include "catalog/pg_subscription.h"
 #include "datatype/timestamp.h"
+#include "lib/stringinfo.h"
+#include "storage/dsm.h"
 #include "storage/lock.h"
 #include "storage/spin.h"
 
@@ -50,6 +52,15 @@ typedef struct LogicalRepWorker
 	XLogRecPtr	relstate_lsn;
 	slock_t		relmutex;
 
+	/*
+	 * Used by parallel apply workers: PID of the apply worker that launched
+	 * this worker (0 for other kinds of workers), the shared memory segment
+	 * through which the two communicate, and this worker's slot in it.
+	 */
+	pid_t		leader_pid;
+	dsm_handle	subworker_dsm;
+	int			subworker_index;
+
 	/* Stats. */
 	XLogRecPtr	last_lsn;
 	TimestampTz last_send_time;
@@ -70,18 +81,26 @@ extern LogicalRepWorker *MyLogicalRepWorker;
 
 extern bool in_remote_transaction;
 
+/* Per-message memory context of the apply loop. */
+extern MemoryContext ApplyMessageContext;
+
 extern void logicalrep_worker_attach(int slot);
 extern LogicalRepWorker *logicalrep_worker_find(Oid subid, Oid relid,
 												bool only_running);
 extern List *logicalrep_workers_find(Oid subid, bool only_running);
-extern void logicalrep_worker_launch(Oid dbid, Oid subid, const char *subname,
-									 Oid userid, Oid relid);
+extern bool logicalrep_worker_launch(Oid dbid, Oid subid, const char *subname,
+									 Oid userid, Oid relid,
+									 dsm_handle subworker_dsm,
+									 int subworker_index);
 extern void logicalrep_worker_stop(Oid subid, Oid relid);
 extern void logicalrep_worker_wakeup(Oid subid, Oid relid);
 extern void logicalrep_worker_wakeup_ptr(LogicalRepWorker *worker);
 
 extern int	logicalrep_sync_worker_count(Oid subid);
 
+extern XLogRecPtr logicalrep_get_serial_apply_lsn(Oid subid);
+extern void logicalrep_set_serial_apply_lsn(Oid subid, XLogRecPtr lsn);
+
 extern void ReplicationOriginNameForTablesync(Oid suboid, Oid relid,
 											  char *originname, int szorgname);
 extern char *LogicalRepSyncTableStart(XLogRecPtr *origin_startpos);
@@ -89,6 +108,20 @@ extern char *LogicalRepSyncTableStart(XLogRecPtr *origin_startpos);
 void		process_syncing_tables(XLogRecPtr current_lsn);
 void		invalidate_syncing_table_states(Datum arg, int cacheid,
 											uint32 hashvalue);
+extern bool AllTablesyncsReady(void);
+
+extern void InitializeApplyWorker(void);
+extern void apply_dispatch(StringInfo s);
+extern void store_flush_position(XLogRecPtr remote_lsn, XLogRecPtr local_lsn);
+
+/* Parallel apply, see applyparallelworker.c */
+extern bool pa_dispatch(StringInfo s);
+extern void pa_process_commits(void);
+extern bool pa_has_pending_work(void);
+extern void pa_wait_for_commit_turn(void);
+extern void pa_transaction_finished(XLogRecPtr commit_end);
+
+#define isParallelApplyWorker(worker) ((worker)->leader_pid != 0)
 
 static inline bool
 am_tablesync_worker(void)
@@ -96,4 +129,10 @@ am_tablesync_worker(void)
 	return OidIsValid(MyLogicalRepWorker->relid);
 }
 
+static inline bool
+am_parallel_apply_worker(void)
+{
+	return isParallelApplyWorker(MyLogicalRepWorker);
+}
+
 #endif							/* WORKER_INTERNAL_H */
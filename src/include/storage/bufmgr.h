@@ -33,6 +33,13 @@ typedef enum BufferAccessStrategyType
 	BAS_VACUUM					/* VACUUM */
 } BufferAccessStrategyType;
 
+/* Possible values for buffer_replacement_policy */
+typedef enum BufferReplacementPolicy
+{
+	BUFFER_REPLACEMENT_CLOCK,	/* Plain clock sweep */
+	BUFFER_REPLACEMENT_CLOCK_2Q /* Clock sweep with probation and ghosts */
+} BufferReplacementPolicy;
+
 /* Possible modes for ReadBufferExtended() */
 typedef enum
 {
@@ -78,6 +85,10 @@ extern int	bgwriter_flush_after;
 
 extern bool	zenith_test_evict;
 
+/* in freelist.c */
+extern int	buffer_replacement_policy;
+extern int	buffer_sweep_partitions;
+
 /* in buf_init.c */
 extern PGDLLIMPORT char *BufferBlocks;
 
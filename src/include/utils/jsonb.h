@@ -374,6 +374,20 @@ typedef struct JsonbIterator
 	struct JsonbIterator *parent;
 } JsonbIterator;
 
+/*
+ * One step of a path looked up by getJsonbValueFromToasted(): an object key,
+ * an array subscript, or both, since the path operators apply text
+ * subscripts to whichever kind of container they meet.
+ */
+typedef struct JsonbPathStep
+{
+	const char *key;			/* object key, or NULL */
+	int			keyLen;
+	bool		hasIndex;		/* is index valid? */
+	int			index;			/* array subscript; negative counts from the
+								 * end */
+} JsonbPathStep;
+
 
 /* Support functions */
 extern uint32 getJsonbOffset(const JsonbContainer *jc, int index);
@@ -387,6 +401,9 @@ extern JsonbValue *getKeyJsonValueFromContainer(JsonbContainer *container,
 												JsonbValue *res);
 extern JsonbValue *getIthJsonbValueFromContainer(JsonbContainer *sheader,
 												 uint32 i);
+extern bool getJsonbValueFromToasted(struct varlena *attr,
+									 JsonbPathStep *path, int npath,
+									 JsonbValue **result);
 extern JsonbValue *pushJsonbValue(JsonbParseState **pstate,
 								  JsonbIteratorToken seq, JsonbValue *jbval);
 extern JsonbIterator *JsonbIteratorInit(JsonbContainer *container);
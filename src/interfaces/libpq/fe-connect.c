@@ -4174,6 +4174,8 @@ freePGconn(PGconn *conn)
 		free(conn->outBuffer);
 	if (conn->rowBuf)
 		free(conn->rowBuf);
+	if (conn->rowBatch)
+		free(conn->rowBatch);
 	if (conn->target_session_attrs)
 		free(conn->target_session_attrs);
 	termPQExpBuffer(&conn->errorMessage);
@@ -1713,8 +1713,9 @@ PQsendQueryStart(PGconn *conn, bool newQuery)
 		 */
 		pqClearAsyncResult(conn);
 
-		/* reset single-row processing mode */
+		/* reset single-row and row batch processing modes */
 		conn->singleRowMode = false;
+		conn->rowBatchMode = false;
 
 	}
 	/* ready to send command message */
@@ -1914,12 +1915,74 @@ PQsetSingleRowMode(PGconn *conn)
 		return 0;
 	if (conn->result)
 		return 0;
+	if (conn->rowBatchMode)
+		return 0;
 
 	/* OK, set flag */
 	conn->singleRowMode = true;
 	return 1;
 }
 
+/*
+ * Select row batch processing mode
+ *
+ * In this mode the rows of the current query's result are fetched with
+ * PQgetRowBatch, which returns them as views into the connection's input
+ * buffer instead of copying them into a PGresult.
+ */
+int
+PQsetRowBatchMode(PGconn *conn)
+{
+	/*
+	 * Only allow setting the flag when we have launched a query and not yet
+	 * received any results.
+	 */
+	if (!conn)
+		return 0;
+	if (conn->asyncStatus != PGASYNC_BUSY)
+		return 0;
+	if (!conn->cmd_queue_head ||
+		(conn->cmd_queue_head->queryclass != PGQUERY_SIMPLE &&
+		 conn->cmd_queue_head->queryclass != PGQUERY_EXTENDED))
+		return 0;
+	if (conn->result)
+		return 0;
+	if (conn->singleRowMode)
+		return 0;
+
+	/* OK, set flag */
+	conn->rowBatchMode = true;
+	return 1;
+}
+
+/*
+ * PQgetRowBatch - read the next rows of a query result in row batch mode
+ *
+ * If successful, fills *batch with the complete rows that have arrived (at
+ * most maxrows of them, if maxrows > 0) and returns their number (always
+ * > 0).  The values point into libpq's input buffer, so they remain valid
+ * only until the next call of a libpq function on this connection.
+ * Returns 0 if no row available yet (only possible if async is true),
+ * -1 if there are no more rows (consult PQgetResult), or -2 if error
+ * (consult PQerrorMessage).
+ */
+int
+PQgetRowBatch(PGconn *conn, PGrowBatch *batch, int maxrows, int async)
+{
+	batch->nrows = 0;			/* for all failure cases */
+	batch->nfields = 0;
+	batch->values = NULL;
+	if (!conn)
+		return -2;
+	if (!conn->rowBatchMode)
+	{
+		appendPQExpBufferStr(&conn->errorMessage,
+							 libpq_gettext("row batch mode is not active\n"));
+		return -2;
+	}
+	return pqGetRowBatch3(conn, batch, maxrows, async);
+}
+
 /*
  * Consume any available input from the backend
  * 0 return: some kind of trouble
@@ -2011,6 +2074,12 @@ PQgetResult(PGconn *conn)
 	if (!conn)
 		return NULL;
 
+	/*
+	 * Rows not yet fetched with PQgetRowBatch are collected into the result
+	 * in the ordinary way.
+	 */
+	conn->rowBatchMode = false;
+
 	/* Parse any available data, if our state permits. */
 	parseInput(conn);
 
@@ -3089,10 +3158,11 @@ pqPipelineProcessQueue(PGconn *conn)
 	}
 
 	/*
-	 * Reset single-row processing mode.  (Client has to set it up for each
-	 * query, if desired.)
+	 * Reset single-row and row batch processing modes.  (Client has to set
+	 * them up for each query, if desired.)
 	 */
 	conn->singleRowMode = false;
+	conn->rowBatchMode = false;
 
 	/*
 	 * If there are no further commands to process in the queue, get us in
@@ -44,6 +44,7 @@ static void handleSyncLoss(PGconn *conn, char id, int msgLength);
 static int	getRowDescriptions(PGconn *conn, int msgLength);
 static int	getParamDescriptions(PGconn *conn, int msgLength);
 static int	getAnotherTuple(PGconn *conn, int msgLength);
+static int	getRowBatch(PGconn *conn, PGrowBatch *batch, int maxrows);
 static int	getParameterStatus(PGconn *conn);
 static int	getNotify(PGconn *conn);
 static int	getCopyStart(PGconn *conn, ExecStatusType copytype);
@@ -387,6 +388,12 @@ pqParseInput3(PGconn *conn)
 					if (conn->result != NULL &&
 						conn->result->resultStatus == PGRES_TUPLES_OK)
 					{
+						/*
+						 * In row batch mode, leave the rows in the buffer for
+						 * PQgetRowBatch to return.
+						 */
+						if (conn->rowBatchMode)
+							return;
 						/* Read another tuple of a normal query response */
 						if (getAnotherTuple(conn, msgLength))
 							return;
@@ -880,6 +887,130 @@ advance_and_error:
 	return 0;
 }
 
+/*
+ * PQgetRowBatch subroutine to collect the complete 'D' (row data) messages
+ * at the start of the input buffer.  Unlike getAnotherTuple, the values are
+ * not copied: batch->values points into the input buffer.
+ * Returns the number of rows collected, or -2 on error.
+ */
+static int
+getRowBatch(PGconn *conn, PGrowBatch *batch, int maxrows)
+{
+	int			nfields = conn->result->numAttributes;
+	int			nrows = 0;
+	char		id;
+	int			msgLength;
+	const char *errmsg;
+
+	while (maxrows <= 0 || nrows < maxrows)
+	{
+		PGrowValue *values;
+		int			tupnfields; /* # fields from tuple */
+		int			vlen;		/* length of the current field value */
+		int			i;
+
+		/*
+		 * Stop at anything but a complete Data Row message; the next call of
+		 * pqParseInput3 will deal with it.
+		 */
+		conn->inCursor = conn->inStart;
+		if (pqGetc(&id, conn))
+			break;
+		if (pqGetInt(&msgLength, 4, conn))
+			break;
+		if (id != 'D' || msgLength < 4 ||
+			conn->inEnd - conn->inCursor < msgLength - 4)
+			break;
+		msgLength -= 4;
+
+		/* Make room for the row's values */
+		values = conn->rowBatch;
+		if ((nrows + 1) * nfields > conn->rowBatchLen)
+		{
+			int			newLen = Max(conn->rowBatchLen * 2, 64);
+
+			while (newLen < (nrows + 1) * nfields)
+				newLen *= 2;
+			values = (PGrowValue *) realloc(values,
+											newLen * sizeof(PGrowValue));
+			if (!values)
+			{
+				errmsg = NULL;	/* means "out of memory", see below */
+				goto advance_and_error;
+			}
+			conn->rowBatch = values;
+			conn->rowBatchLen = newLen;
+		}
+		values += nrows * nfields;
+
+		/* Get the field count and make sure it's what we expect */
+		if (pqGetInt(&tupnfields, 2, conn))
+		{
+			errmsg = libpq_gettext("insufficient data in \"D\" message");
+			goto advance_and_error;
+		}
+		if (tupnfields != nfields)
+		{
+			errmsg = libpq_gettext("unexpected field count in \"D\" message");
+			goto advance_and_error;
+		}
+
+		/* Scan the fields */
+		for (i = 0; i < nfields; i++)
+		{
+			if (pqGetInt(&vlen, 4, conn))
+			{
+				errmsg = libpq_gettext("insufficient data in \"D\" message");
+				goto advance_and_error;
+			}
+			values[i].len = vlen;
+			values[i].value = conn->inBuffer + conn->inCursor;
+
+			if (vlen > 0)
+			{
+				if (pqSkipnchar(vlen, conn))
+				{
+					errmsg = libpq_gettext("insufficient data in \"D\" message");
+					goto advance_and_error;
+				}
+			}
+		}
+
+		if (conn->inCursor != conn->inStart + 5 + msgLength)
+		{
+			errmsg = libpq_gettext("message contents do not agree with length in message type \"D\"");
+			goto advance_and_error;
+		}
+
+		/* trace server-to-client message */
+		if (conn->Pfdebug)
+			pqTraceOutputMessage(conn, conn->inBuffer + conn->inStart, false);
+
+		/* Row is complete, mark the message consumed */
+		conn->inStart = conn->inCursor;
+		nrows++;
+	}
+
+	batch->nrows = nrows;
+	batch->nfields = nfields;
+	batch->values = conn->rowBatch;
+	return nrows;
+
+advance_and_error:
+
+	/*
+	 * As in getAnotherTuple, replace the result with an error result, so
+	 * that the remaining "D" messages are ignored until the end of data.
+	 */
+	pqClearAsyncResult(conn);
+	if (!errmsg)
+		errmsg = libpq_gettext("out of memory for query result");
+	appendPQExpBuffer(&conn->errorMessage, "%s\n", errmsg);
+	pqSaveErrorResult(conn);
+	conn->inStart = conn->inStart + 5 + msgLength;
+	return -2;
+}
+
 
 /*
  * Attempt to read an Error or Notice response message.
@@ -1749,6 +1880,46 @@ pqGetCopyData3(PGconn *conn, char **buffer, int async)
 	}
 }
 
+/*
+ * PQgetRowBatch - read the next rows of a query result in row batch mode
+ *
+ * See fe-exec.c for documentation.
+ */
+int
+pqGetRowBatch3(PGconn *conn, PGrowBatch *batch, int maxrows, int async)
+{
+	int			nrows;
+
+	for (;;)
+	{
+		/*
+		 * Let the regular parser process everything up to the next Data Row
+		 * message; it stops there in row batch mode.  If it gets past the
+		 * end of the rows instead, the caller collects the outcome of the
+		 * query with PQgetResult.
+		 */
+		pqParseInput3(conn);
+		if (conn->asyncStatus != PGASYNC_BUSY)
+			return -1;
+
+		if (conn->result != NULL &&
+			conn->result->resultStatus == PGRES_TUPLES_OK)
+		{
+			nrows = getRowBatch(conn, batch, maxrows);
+			if (nrows != 0)
+				return nrows;
+		}
+
+		/* Don't block if async read requested */
+		if (async)
+			return 0;
+		/* Need to load more data */
+		if (pqWait(true, false, conn) ||
+			pqReadData(conn) < 0)
+			return -2;
+	}
+}
+
 /*
  * PQgetline - gets a newline-terminated string from the backend.
  *
@@ -267,6 +267,29 @@ typedef struct pgresAttDesc
 	int			atttypmod;		/* type-specific modifier info */
 } PGresAttDesc;
 
+/* ----------------
+ * PGrowValue -- A field value returned by PQgetRowBatch.  It points into
+ * libpq's input buffer and is not zero-terminated.  A SQL NULL is
+ * represented by len < 0.
+ * ----------------
+ */
+typedef struct pgRowValue
+{
+	int			len;			/* data length in bytes, or <0 if NULL */
+	const char *value;			/* data value, without zero-termination */
+} PGrowValue;
+
+/* ----------------
+ * PGrowBatch -- A batch of rows returned by PQgetRowBatch
+ * ----------------
+ */
+typedef struct pgRowBatch
+{
+	int			nrows;			/* number of rows in the batch */
+	int			nfields;		/* number of fields in each row */
+	const PGrowValue *values;	/* nrows * nfields values, row by row */
+} PGrowBatch;
+
 /* ----------------
  * Exported functions of libpq
  * ----------------
@@ -460,6 +483,9 @@ extern int	PQsendQueryPrepared(PGconn *conn,
 								const int *paramFormats,
 								int resultFormat);
 extern int	PQsetSingleRowMode(PGconn *conn);
+extern int	PQsetRowBatchMode(PGconn *conn);
+extern int	PQgetRowBatch(PGconn *conn, PGrowBatch *batch, int maxrows,
+						  int async);
 extern PGresult *PQgetResult(PGconn *conn);
 
 /* Routines for managing an asynchronous query */
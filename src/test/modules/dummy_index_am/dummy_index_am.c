@@ -296,6 +296,7 @@ dihandler(PG_FUNCTION_ARGS)
 	amroutine->amclusterable = false;
 	amroutine->ampredlocks = false;
 	amroutine->amcanparallel = false;
+	amroutine->amcanbuildparallel = false;
 	amroutine->amcaninclude = false;
 	amroutine->amusemaintenanceworkmem = false;
 	amroutine->amparallelvacuumoptions = VACUUM_OPTION_NO_PARALLEL;
@@ -304,6 +305,7 @@ dihandler(PG_FUNCTION_ARGS)
 	amroutine->ambuild = dibuild;
 	amroutine->ambuildempty = dibuildempty;
 	amroutine->aminsert = diinsert;
+	amroutine->aminsertmulti = NULL;
 	amroutine->ambulkdelete = dibulkdelete;
 	amroutine->amvacuumcleanup = divacuumcleanup;
 	amroutine->amcanreturn = NULL;
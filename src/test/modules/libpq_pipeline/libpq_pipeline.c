@@ -24,6 +24,7 @@
 #include "common/fe_memutils.h"
 #include "libpq-fe.h"
 #include "pg_getopt.h"
+#include "port/pg_bswap.h"
 #include "portability/instr_time.h"
 
 
@@ -1288,6 +1289,214 @@ test_singlerowmode(PGconn *conn)
 	fprintf(stderr, "ok\n");
 }
 
+/* query for the row batch tests: some NULLs, and values of varying length */
+#define ROWBATCH_QUERY \
+	"SELECT g, CASE WHEN g % 7 <> 0 THEN repeat('x', g % 50) END " \
+	"FROM generate_series(1, $1) g"
+
+static void
+send_rowbatch_query(PGconn *conn, int numrows)
+{
+	char	   *param[1];
+
+	param[0] = psprintf("%d", numrows);
+	if (PQsendQueryParams(conn, ROWBATCH_QUERY,
+						  1, NULL, (const char **) param, NULL, NULL, 1) != 1)
+		pg_fatal("failed to send query: %s", PQerrorMessage(conn));
+	pfree(param[0]);
+}
+
+/*
+ * Check a batch of rows of ROWBATCH_QUERY.  *row is the number of rows seen
+ * before the batch, and is advanced past it.
+ */
+static void
+check_rowbatch(const PGrowBatch *batch, int *row)
+{
+	if (batch->nfields != 2)
+		pg_fatal("unexpected field count %d", batch->nfields);
+
+	for (int i = 0; i < batch->nrows; i++)
+	{
+		const PGrowValue *values = &batch->values[i * batch->nfields];
+		uint32		g;
+
+		(*row)++;
+		if (values[0].len != sizeof(g))
+			pg_fatal("unexpected length %d in row %d", values[0].len, *row);
+		memcpy(&g, values[0].value, sizeof(g));
+		if (pg_ntoh32(g) != *row)
+			pg_fatal("expected %d, got %u", *row, pg_ntoh32(g));
+
+		if (*row % 7 == 0)
+		{
+			if (values[1].len >= 0)
+				pg_fatal("expected NULL in row %d", *row);
+		}
+		else
+		{
+			if (values[1].len != *row % 50)
+				pg_fatal("unexpected length %d in row %d",
+						 values[1].len, *row);
+			for (int j = 0; j < values[1].len; j++)
+			{
+				if (values[1].value[j] != 'x')
+					pg_fatal("unexpected value in row %d", *row);
+			}
+		}
+	}
+}
+
+/*
+ * Check the final result of ROWBATCH_QUERY, after the first 'fetched' rows
+ * were returned by PQgetRowBatch.  It must contain all the other rows.
+ */
+static void
+check_rowbatch_result(PGconn *conn, int numrows, int fetched)
+{
+	PGresult   *res;
+	uint32		g;
+
+	res = PQgetResult(conn);
+	if (res == NULL)
+		pg_fatal("unexpected NULL result");
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+		pg_fatal("Expected PGRES_TUPLES_OK, got %s",
+				 PQresStatus(PQresultStatus(res)));
+	if (PQnfields(res) != 2)
+		pg_fatal("expected row description in final result");
+	if (PQntuples(res) != numrows - fetched)
+		pg_fatal("expected %d rows in final result, got %d",
+				 numrows - fetched, PQntuples(res));
+	if (PQntuples(res) > 0)
+	{
+		memcpy(&g, PQgetvalue(res, 0, 0), sizeof(g));
+		if (pg_ntoh32(g) != fetched + 1)
+			pg_fatal("expected %d in final result, got %u",
+					 fetched + 1, pg_ntoh32(g));
+		memcpy(&g, PQgetvalue(res, PQntuples(res) - 1, 0), sizeof(g));
+		if (pg_ntoh32(g) != numrows)
+			pg_fatal("expected %d in final result, got %u",
+					 numrows, pg_ntoh32(g));
+	}
+	PQclear(res);
+	if (PQgetResult(conn) != NULL)
+		pg_fatal("expected NULL result");
+}
+
+/*
+ * Test row batch mode: all rows must come back through PQgetRowBatch, in
+ * order and without being copied into the final PGresult, both when it
+ * waits for rows and when it doesn't.  Rows not fetched before switching to
+ * PQgetResult must end up in the result.
+ */
+static void
+test_rowbatch(PGconn *conn, int numrows)
+{
+	PGresult   *res;
+	PGrowBatch	batch;
+	int			sock = PQsocket(conn);
+	int			nbatches = 0;
+	int			nwaits = 0;
+	int			row;
+	int			ret;
+
+	fprintf(stderr, "row batch mode... ");
+
+	/* can't use both modes at once */
+	send_rowbatch_query(conn, numrows);
+	if (PQsetSingleRowMode(conn) != 1)
+		pg_fatal("PQsetSingleRowMode() failed");
+	if (PQsetRowBatchMode(conn) != 0)
+		pg_fatal("PQsetRowBatchMode() succeeded in single-row mode");
+	while ((res = PQgetResult(conn)) != NULL)
+		PQclear(res);
+
+	/* wait for rows, in batches of at most 100 */
+	send_rowbatch_query(conn, numrows);
+	if (PQsetRowBatchMode(conn) != 1)
+		pg_fatal("PQsetRowBatchMode() failed");
+
+	row = 0;
+	while ((ret = PQgetRowBatch(conn, &batch, 100, 0)) > 0)
+	{
+		if (batch.nrows != ret || batch.nrows > 100)
+			pg_fatal("unexpected batch size %d", batch.nrows);
+		check_rowbatch(&batch, &row);
+		nbatches++;
+	}
+	if (ret != -1)
+		pg_fatal("PQgetRowBatch failed: %s", PQerrorMessage(conn));
+	if (row != numrows)
+		pg_fatal("expected %d rows, got %d", numrows, row);
+	check_rowbatch_result(conn, numrows, numrows);
+
+	/* the mode only lasts for one query */
+	if (PQgetRowBatch(conn, &batch, 0, 0) != -2)
+		pg_fatal("PQgetRowBatch succeeded outside row batch mode");
+
+	/* don't wait for rows, take whatever has arrived */
+	send_rowbatch_query(conn, numrows);
+	if (PQsetRowBatchMode(conn) != 1)
+		pg_fatal("PQsetRowBatchMode() failed");
+
+	row = 0;
+	for (;;)
+	{
+		fd_set		input_mask;
+
+		ret = PQgetRowBatch(conn, &batch, 0, 1);
+		if (ret > 0)
+		{
+			if (batch.nrows != ret)
+				pg_fatal("unexpected batch size %d", batch.nrows);
+			check_rowbatch(&batch, &row);
+			nbatches++;
+			continue;
+		}
+		if (ret < 0)
+			break;
+
+		/* no complete row yet */
+		nwaits++;
+		FD_ZERO(&input_mask);
+		FD_SET(sock, &input_mask);
+		if (select(sock + 1, &input_mask, NULL, NULL, NULL) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			pg_fatal("select() failed: %m");
+		}
+		if (PQconsumeInput(conn) == 0)
+			pg_fatal("PQconsumeInput failed: %s", PQerrorMessage(conn));
+	}
+	if (ret != -1)
+		pg_fatal("PQgetRowBatch failed: %s", PQerrorMessage(conn));
+	if (row != numrows)
+		pg_fatal("expected %d rows, got %d", numrows, row);
+	if (nwaits == 0)
+		pg_fatal("PQgetRowBatch never found the input buffer empty");
+	check_rowbatch_result(conn, numrows, numrows);
+
+	/* switch to PQgetResult after the first batch */
+	send_rowbatch_query(conn, numrows);
+	if (PQsetRowBatchMode(conn) != 1)
+		pg_fatal("PQsetRowBatchMode() failed");
+
+	row = 0;
+	ret = PQgetRowBatch(conn, &batch, 10, 0);
+	if (ret != Min(numrows, 10))
+		pg_fatal("unexpected batch size %d", ret);
+	check_rowbatch(&batch, &row);
+	nbatches++;
+	check_rowbatch_result(conn, numrows, row);
+
+	if (PQgetRowBatch(conn, &batch, 0, 0) != -2)
+		pg_fatal("PQgetRowBatch succeeded after PQgetResult");
+
+	fprintf(stderr, "ok (%d batches)\n", nbatches);
+}
+
 /*
  * Simple test to verify that a pipeline is discarded as a whole when there's
  * an error, ignoring transaction commands.
@@ -1678,6 +1887,7 @@ print_test_list(void)
 	printf("pipeline_idle\n");
 	printf("pipelined_insert\n");
 	printf("prepared\n");
+	printf("rowbatch\n");
 	printf("simple_pipeline\n");
 	printf("singlerow\n");
 	printf("transaction\n");
@@ -1786,6 +1996,8 @@ main(int argc, char **argv)
 		test_pipelined_insert(conn, numrows);
 	else if (strcmp(testname, "prepared") == 0)
 		test_prepared(conn);
+	else if (strcmp(testname, "rowbatch") == 0)
+		test_rowbatch(conn, numrows);
 	else if (strcmp(testname, "simple_pipeline") == 0)
 		test_simple_pipeline(conn);
 	else if (strcmp(testname, "singlerow") == 0)
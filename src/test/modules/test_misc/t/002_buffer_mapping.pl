@@ -0,0 +1,88 @@
+
+# Copyright (c) 2021, PostgreSQL Global Development Group
+
+# Exercise the lock-free buffer mapping lookup while buffers are being
+# evicted and reused concurrently.  With a tiny buffer pool, nearly every
+# cache hit races against some other backend replacing the buffer, so the
+# pin-and-recheck path gets plenty of stale hits to reject.
+
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 6;
+
+my $node = get_new_node('main');
+$node->init;
+$node->append_conf('postgresql.conf', 'shared_buffers = 512kB');
+$node->start;
+
+$node->safe_psql(
+	'postgres', q{
+CREATE TABLE bufmap (id int PRIMARY KEY, val int NOT NULL, pad text)
+  WITH (fillfactor = 50);
+INSERT INTO bufmap SELECT g, 0, repeat('x', 500) FROM generate_series(1, 10000) g;
+CREATE TABLE bufmap_log (id int NOT NULL);
+});
+
+# Index lookups and updates compete with sequential scans that keep pushing
+# the same blocks out of the pool.
+$node->pgbench(
+	'--no-vacuum --client=5 --transactions=400',
+	0,
+	[qr{actually processed: 2000/2000}],
+	[qr{^$}],
+	'concurrent lookups and evictions',
+	{
+		'002_bufmap_lookup' => q{
+\set id random(1, 10000)
+SELECT 1/(pad = repeat('x', 500))::int FROM bufmap WHERE id = :id;
+},
+		'002_bufmap_update' => q{
+\set id random(1, 10000)
+UPDATE bufmap SET val = val + 1 WHERE id = :id;
+INSERT INTO bufmap_log VALUES (:id);
+},
+		'002_bufmap_scan' => q{
+SELECT count(*) FROM bufmap WHERE val < 0;
+}
+	});
+
+# No update may have been lost to a lookup that found the wrong buffer.
+is( $node->safe_psql(
+		'postgres', q{
+SELECT count(*) FROM bufmap b
+  FULL JOIN (SELECT id, count(*) AS n FROM bufmap_log GROUP BY id) l USING (id)
+  WHERE b.val IS DISTINCT FROM coalesce(l.n, 0);
+}),
+	'0',
+	'all updates applied');
+
+# Truncating the relation drops its tail buffers from the mapping, and
+# extending it again maps the same block numbers to new buffers.  Lookups
+# must not find the dropped buffers.
+$node->safe_psql(
+	'postgres', q{
+DELETE FROM bufmap WHERE id > 5000;
+VACUUM bufmap;
+INSERT INTO bufmap SELECT g, -1, repeat('y', 500) FROM generate_series(5001, 10000) g;
+});
+
+is( $node->safe_psql(
+		'postgres', q{
+SET enable_seqscan = off;
+SELECT count(*) FROM bufmap WHERE id > 5000 AND val = -1 AND pad = repeat('y', 500);
+}),
+	'5000',
+	're-extended blocks found through index');
+
+is( $node->safe_psql(
+		'postgres', q{
+SET enable_indexscan = off;
+SET enable_bitmapscan = off;
+SELECT count(*), sum(id) FROM bufmap;
+}),
+	'10000|50005000',
+	're-extended blocks found through sequential scan');
+
+$node->stop;
@@ -0,0 +1,106 @@
+
+# Copyright (c) 2021, PostgreSQL Global Development Group
+
+# Test the clock_2q buffer replacement policy and the partitioned clock
+# sweep, including the background writer's cleaning of each partition.
+
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 8;
+
+# Report the number of pages of the probe table in shared buffers, and the
+# range of their usage counts.
+my $probe_query = q{
+SELECT count(*), min(usagecount), max(usagecount)
+  FROM pg_buffercache
+  WHERE relfilenode = pg_relation_filenode('probe') AND relforknumber = 0
+    AND reldatabase = (SELECT oid FROM pg_database
+                       WHERE datname = current_database());
+};
+
+# A table of about 90 pages, small enough to be read without a buffer ring
+my $probe_setup = q{
+CREATE EXTENSION pg_buffercache;
+CREATE TABLE probe (id int, pad text);
+INSERT INTO probe SELECT g, repeat('x', 700) FROM generate_series(1, 1000) g;
+};
+
+# With the default policy, pages read once start out with usage count 1.
+my $plain = get_new_node('plain');
+$plain->init;
+$plain->append_conf('postgresql.conf', 'autovacuum = off');
+$plain->start;
+$plain->safe_psql('postgres', $probe_setup);
+$plain->restart;
+$plain->safe_psql('postgres', 'SELECT count(*) FROM probe');
+like($plain->safe_psql('postgres', $probe_query),
+	qr/^\d+\|1\|1$/, 'clock: pages read once have usage count 1');
+$plain->stop;
+
+# 512 buffers, split into four sweep partitions of 128
+my $node = get_new_node('main');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq{
+autovacuum = off
+shared_buffers = 4MB
+buffer_sweep_partitions = 4
+buffer_replacement_policy = clock_2q
+bgwriter_delay = 10ms
+bgwriter_lru_maxpages = 1000
+bgwriter_lru_multiplier = 10
+});
+$node->start;
+$node->safe_psql('postgres', $probe_setup);
+# About 1500 pages, three times the size of the buffer pool
+$node->safe_psql(
+	'postgres', q{
+CREATE TABLE churn (id int PRIMARY KEY, val int NOT NULL, pad text);
+INSERT INTO churn SELECT g, 0, repeat('x', 700) FROM generate_series(1, 16500) g;
+});
+$node->restart;
+
+# Under clock_2q, pages read once start out with usage count 0, and go back
+# to 1 when used again.
+$node->safe_psql('postgres', 'SELECT count(*) FROM probe');
+like($node->safe_psql('postgres', $probe_query),
+	qr/^\d+\|0\|0$/, 'clock_2q: pages read once have usage count 0');
+
+# Read the churn table through its index, which doesn't use a buffer ring,
+# to push the probe table out of the buffer pool.  The probe pages that are
+# still remembered in the ghost table come back with usage count 2.
+$node->safe_psql(
+	'postgres', q{
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT count(*) FROM churn WHERE id > 0;
+});
+$node->safe_psql('postgres', 'SELECT count(*) FROM probe');
+like($node->safe_psql('postgres', $probe_query),
+	qr/^\d+\|\d\|2$/, 'clock_2q: recently evicted pages come back hot');
+
+# Keep all four clock hands moving with random updates of the churn table,
+# and check that the background writer cleans buffers ahead of them.
+$node->pgbench(
+	'--no-vacuum --client=2 --transactions=2000',
+	0,
+	[qr{actually processed: 4000/4000}],
+	[qr{^$}],
+	'random updates with partitioned clock sweep',
+	{
+		'003_churn_update' => q{
+\set id random(1, 16500)
+UPDATE churn SET val = val + 1 WHERE id = :id;
+}
+	});
+
+is($node->safe_psql('postgres', 'SELECT sum(val) FROM churn'),
+	'4000', 'all updates applied');
+
+ok( $node->poll_query_until(
+		'postgres', 'SELECT buffers_clean > 0 FROM pg_stat_bgwriter'),
+	'background writer cleaned buffers');
+
+$node->stop;
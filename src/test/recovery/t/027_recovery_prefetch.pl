@@ -0,0 +1,104 @@
+
+# Copyright (c) 2021, PostgreSQL Global Development Group
+
+# Test crash recovery with and without prefetching of the blocks referenced
+# by upcoming WAL records.
+
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 4;
+
+# Without full page images, redo has to read every block it modifies.  The
+# prefetcher reports its statistics at DEBUG1 when redo is done.
+my $node = get_new_node('main');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq(
+autovacuum = off
+full_page_writes = off
+recovery_prefetch = on
+log_min_messages = debug1
+));
+$node->start;
+
+# About 300 heap pages
+$node->safe_psql(
+	'postgres', q{
+CREATE TABLE prefetch_tab (id int PRIMARY KEY, val int NOT NULL, pad text);
+INSERT INTO prefetch_tab SELECT g, 0, repeat('x', 200) FROM generate_series(1, 10000) g;
+CHECKPOINT;
+});
+
+# Update rows in an order that jumps between pages, so that the references
+# to them are neither repeated nor sequential.
+sub scattered_updates
+{
+	my $remainder = shift;
+
+	$node->safe_psql(
+		'postgres', qq{
+DO \$\$
+DECLARE
+	r record;
+BEGIN
+	FOR r IN SELECT id FROM prefetch_tab WHERE id % 10 = $remainder
+		ORDER BY md5(id::text)
+	LOOP
+		UPDATE prefetch_tab SET val = val + 1 WHERE id = r.id;
+	END LOOP;
+END
+\$\$;
+});
+	return;
+}
+
+# Crash, recover, and return what the server logged from then on.
+sub crash_and_recover
+{
+	my $logstart = -s $node->logfile;
+
+	$node->stop('immediate');
+	$node->start;
+
+	return substr(slurp_file($node->logfile), $logstart);
+}
+
+scattered_updates(0);
+my $log = crash_and_recover();
+
+is( $node->safe_psql(
+		'postgres', 'SELECT count(*), sum(val) FROM prefetch_tab'),
+	'10000|1000',
+	'updates replayed with prefetching');
+
+# maintenance_io_concurrency can only be 0 without support for prefetching
+SKIP:
+{
+	skip "prefetching is not supported on this platform", 1
+	  if $node->safe_psql('postgres', 'SHOW maintenance_io_concurrency') eq
+	  '0';
+
+	like(
+		$log,
+		qr/recovery prefetch: [1-9]\d* blocks prefetched/,
+		'blocks prefetched during recovery');
+}
+
+# The same again with prefetching turned off
+$node->append_conf('postgresql.conf', 'recovery_prefetch = off');
+$node->restart;
+scattered_updates(5);
+$log = crash_and_recover();
+
+is( $node->safe_psql(
+		'postgres', 'SELECT count(*), sum(val) FROM prefetch_tab'),
+	'10000|2000',
+	'updates replayed without prefetching');
+like(
+	$log,
+	qr/recovery prefetch: 0 blocks prefetched/,
+	'no blocks prefetched when recovery_prefetch is off');
+
+$node->stop;
@@ -0,0 +1,52 @@
+
+# Copyright (c) 2021, PostgreSQL Global Development Group
+
+# Test streaming replication with the WAL receiver asking for the stream to
+# be compressed.
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 3;
+
+# The walsender reports the method it settled on at DEBUG1.
+my $node_primary = get_new_node('primary');
+$node_primary->init(allows_streaming => 1);
+$node_primary->append_conf('postgresql.conf', 'log_min_messages = debug1');
+$node_primary->start;
+my $backup_name = 'my_backup';
+$node_primary->backup($backup_name);
+
+my $node_standby = get_new_node('standby');
+$node_standby->init_from_backup($node_primary, $backup_name,
+	has_streaming => 1);
+$node_standby->append_conf('postgresql.conf',
+	"wal_receiver_compression = 'pglz'");
+my $logstart = -s $node_primary->logfile;
+$node_standby->start;
+
+$node_primary->safe_psql('postgres',
+	"CREATE TABLE tab_int AS SELECT generate_series(1, 1000) AS a");
+$node_primary->wait_for_catchup($node_standby, 'replay',
+	$node_primary->lsn('insert'));
+
+like(
+	substr(slurp_file($node_primary->logfile), $logstart),
+	qr/compressing WAL data messages with pglz/,
+	'walsender compressed the stream with pglz');
+is($node_standby->safe_psql('postgres', 'SELECT count(*) FROM tab_int'),
+	'1000', 'standby replayed compressed stream');
+
+# Let the standby fall behind, so that it catches up on full-sized messages
+# of compressible WAL.
+$node_standby->stop;
+$node_primary->safe_psql('postgres',
+	"INSERT INTO tab_int SELECT generate_series(1001, 100000)");
+$node_standby->start;
+$node_primary->wait_for_catchup($node_standby, 'replay',
+	$node_primary->lsn('insert'));
+
+is( $node_standby->safe_psql(
+		'postgres', 'SELECT count(*), sum(a) FROM tab_int'),
+	'100000|5000050000',
+	'standby caught up through compressed stream');
@@ -509,3 +509,29 @@ SELECT * FROM brintest_3 WHERE b < '0';
 
 DROP TABLE brintest_3;
 RESET enable_seqscan;
+
+-- With autosummarize, new page ranges are summarized as they are filled
+-- (use a temp table so that autovacuum can't interfere)
+CREATE TEMP TABLE brin_autosum_tbl (a int);
+CREATE INDEX brin_autosum_idx ON brin_autosum_tbl USING brin (a)
+  WITH (pages_per_range = 1, autosummarize = on);
+INSERT INTO brin_autosum_tbl SELECT g FROM generate_series(1, 2000) g;
+SELECT brin_summarize_new_values('brin_autosum_idx'); -- ok, no change expected
+SET enable_seqscan = off;
+SELECT count(*) FROM brin_autosum_tbl WHERE a BETWEEN 100 AND 199;
+RESET enable_seqscan;
+DROP TABLE brin_autosum_tbl;
+
+-- Test parallel index build
+CREATE TABLE brin_parallel_tbl (a int, b text) WITH (parallel_workers = 2);
+INSERT INTO brin_parallel_tbl SELECT g, md5(g::text) FROM generate_series(1, 20000) g;
+SET max_parallel_maintenance_workers = 2;
+CREATE INDEX brin_parallel_idx ON brin_parallel_tbl USING brin (a, b)
+  WITH (pages_per_range = 2);
+RESET max_parallel_maintenance_workers;
+SELECT brin_summarize_new_values('brin_parallel_idx'); -- ok, no change expected
+SET enable_seqscan = off;
+SELECT count(*) FROM brin_parallel_tbl WHERE a BETWEEN 1000 AND 1099;
+SELECT count(*) FROM brin_parallel_tbl WHERE a > 19990;
+RESET enable_seqscan;
+DROP TABLE brin_parallel_tbl;
@@ -183,3 +183,112 @@ CREATE TABLE btree_part (id int4) PARTITION BY RANGE (id);
 CREATE INDEX btree_part_idx ON btree_part(id);
 ALTER INDEX btree_part_idx ALTER COLUMN id SET (n_distinct=100);
 DROP TABLE btree_part;
+
+-- Test skipping over leaf pages when only the second column is constrained
+CREATE TABLE btree_skip (a int, b int);
+INSERT INTO btree_skip SELECT i % 4, i FROM generate_series(1, 20000) i;
+INSERT INTO btree_skip SELECT NULL, i FROM generate_series(1, 5000) i;
+INSERT INTO btree_skip SELECT i % 4, NULL FROM generate_series(1, 5000) i;
+CREATE INDEX btree_skip_idx ON btree_skip (a, b);
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SET enable_indexonlyscan = off;
+SELECT count(*) FROM btree_skip WHERE b BETWEEN 100 AND 199;
+SELECT count(*) FROM btree_skip WHERE b = 5000;
+SELECT count(*) FROM btree_skip WHERE b > 19990;
+SELECT count(*) FROM btree_skip WHERE b < 10;
+DROP INDEX btree_skip_idx;
+CREATE INDEX btree_skip_idx ON btree_skip (a DESC, b DESC NULLS LAST);
+SELECT count(*) FROM btree_skip WHERE b BETWEEN 100 AND 199;
+SELECT count(*) FROM btree_skip WHERE b = 5000;
+SELECT count(*) FROM btree_skip WHERE b > 19990;
+SELECT count(*) FROM btree_skip WHERE b < 10;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+RESET enable_indexonlyscan;
+DROP TABLE btree_skip;
+
+-- Test binary searches among tuples that share long key prefixes, where
+-- comparisons skip the attributes already known to be equal
+CREATE TABLE btree_prefix (a text, b int, c int, d text);
+INSERT INTO btree_prefix
+  SELECT 'common prefix', i / 100, i % 100, 'v' || (i % 7)
+  FROM generate_series(0, 9999) i;
+CREATE UNIQUE INDEX btree_prefix_idx ON btree_prefix (a, b, c, d);
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT count(*) FROM btree_prefix
+  WHERE a = 'common prefix' AND b = 42 AND c = 17 AND d = 'v3';
+SELECT count(*) FROM btree_prefix
+  WHERE a = 'common prefix' AND b = 42 AND c = 17 AND d = 'v4';
+SELECT count(*) FROM btree_prefix
+  WHERE a = 'common prefix' AND b = 42 AND c = 200;
+SELECT count(*) FROM btree_prefix
+  WHERE a = 'common prefix' AND b = 100;
+SELECT count(*) FROM btree_prefix
+  WHERE a = 'common prefix' AND b = 42 AND c BETWEEN 10 AND 19;
+SELECT count(*) FROM btree_prefix
+  WHERE (a, b, c) > ('common prefix', 99, 97);
+SELECT count(*) FROM btree_prefix WHERE a = 'common prefiw';
+-- insertions search for their position the same way
+INSERT INTO btree_prefix VALUES ('common prefix', 42, 17, 'v3');
+INSERT INTO btree_prefix VALUES ('common prefix', 42, 17, 'v4');
+INSERT INTO btree_prefix VALUES ('common prefix', 42, 100, 'v0');
+SELECT count(*) FROM btree_prefix
+  WHERE a = 'common prefix' AND b = 42 AND c >= 17;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+DROP TABLE btree_prefix;
+
+-- Check that skipping actually saves leaf page reads, by comparing the
+-- buffers touched by a forward scan, which can skip, with those of a
+-- backward scan of the same rows, which can't
+CREATE FUNCTION btree_skip_blocks(query text) RETURNS int
+LANGUAGE plpgsql AS
+$$
+DECLARE
+  plan json;
+BEGIN
+  EXECUTE 'EXPLAIN (ANALYZE, BUFFERS, COSTS OFF, TIMING OFF, SUMMARY OFF, FORMAT JSON) '
+    || query INTO plan;
+  RETURN (plan->0->'Plan'->>'Shared Hit Blocks')::int +
+    (plan->0->'Plan'->>'Shared Read Blocks')::int;
+END;
+$$;
+CREATE TABLE btree_skip_io (a int, b int);
+INSERT INTO btree_skip_io SELECT i % 4, i FROM generate_series(1, 100000) i;
+CREATE INDEX btree_skip_io_idx ON btree_skip_io (a, b);
+VACUUM ANALYZE btree_skip_io;
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SET enable_indexonlyscan = off;
+SET enable_sort = off;
+EXPLAIN (COSTS OFF)
+SELECT b FROM btree_skip_io WHERE b BETWEEN 100 AND 199 ORDER BY a, b;
+EXPLAIN (COSTS OFF)
+SELECT b FROM btree_skip_io WHERE b BETWEEN 100 AND 199 ORDER BY a DESC, b DESC;
+SELECT btree_skip_blocks('SELECT b FROM btree_skip_io WHERE b BETWEEN 100 AND 199 ORDER BY a, b') * 4 <
+  btree_skip_blocks('SELECT b FROM btree_skip_io WHERE b BETWEEN 100 AND 199 ORDER BY a DESC, b DESC')
+  AS skipped;
+-- Index-only scans that prefetch leaf pages (the default) read every leaf
+-- page, so they must not be costed as skipping; a skipping plain index scan
+-- wins instead
+RESET enable_indexonlyscan;
+EXPLAIN (COSTS OFF)
+SELECT b FROM btree_skip_io WHERE b BETWEEN 100 AND 199 ORDER BY a, b;
+SELECT btree_skip_blocks('SELECT b FROM btree_skip_io WHERE b BETWEEN 100 AND 199 ORDER BY a, b') * 4 <
+  btree_skip_blocks('SELECT b FROM btree_skip_io WHERE b BETWEEN 100 AND 199 ORDER BY a DESC, b DESC')
+  AS skipped;
+-- Without prefetching, index-only scans skip as well
+SET enable_indexonlyscan_prefetch = off;
+EXPLAIN (COSTS OFF)
+SELECT b FROM btree_skip_io WHERE b BETWEEN 100 AND 199 ORDER BY a, b;
+SELECT btree_skip_blocks('SELECT b FROM btree_skip_io WHERE b BETWEEN 100 AND 199 ORDER BY a, b') * 4 <
+  btree_skip_blocks('SELECT b FROM btree_skip_io WHERE b BETWEEN 100 AND 199 ORDER BY a DESC, b DESC')
+  AS skipped;
+RESET enable_indexonlyscan_prefetch;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+RESET enable_sort;
+DROP TABLE btree_skip_io;
+DROP FUNCTION btree_skip_blocks(text);
@@ -145,6 +145,24 @@ SELECT length(f1) FROM cmmove1;
 SELECT length(f1) FROM cmmove2;
 SELECT length(f1) FROM cmmove3;
 
+-- with toast_segmented_min_size set, large values are compressed in
+-- segments, which can be sliced without decompressing the whole value; the
+-- second value is compressed as a whole
+CREATE TABLE cmsegment (f1 text COMPRESSION pglz);
+SET toast_segmented_min_size = '128kB';
+INSERT INTO cmsegment
+  SELECT string_agg(md5(g::text) || repeat('x', 32), '')
+  FROM generate_series(1, 5000) g;
+RESET toast_segmented_min_size;
+INSERT INTO cmsegment SELECT f1 || '' FROM cmsegment;
+WITH v AS (SELECT string_agg(md5(g::text) || repeat('x', 32), '') AS s
+           FROM generate_series(1, 5000) g)
+SELECT pg_column_compression(f1), length(f1), f1 = s AS whole,
+       substr(f1, 65500, 100) = substr(s, 65500, 100) AS across_segments,
+       substr(f1, 200001, 40) = substr(s, 200001, 40) AS middle
+FROM cmsegment, v;
+DROP TABLE cmsegment;
+
 CREATE TABLE badcompresstbl (a text COMPRESSION I_Do_Not_Exist_Compression); -- fails
 CREATE TABLE badcompresstbl (a text);
 ALTER TABLE badcompresstbl ALTER a SET COMPRESSION I_Do_Not_Exist_Compression; -- fails
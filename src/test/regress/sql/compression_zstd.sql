@@ -0,0 +1,60 @@
+-- zstd TOAST compression, per-column levels and dictionaries
+-- skip if the server was built without zstd
+SELECT NOT(enumvals @> '{zstd}') AS skip_test FROM pg_settings
+  WHERE name = 'default_toast_compression' \gset
+\if :skip_test
+  \echo '*** skipping zstd compression tests (not supported) ***'
+  \quit
+\endif
+
+-- the wide pad column makes the toaster process rows whose f1 is small,
+-- and the low toast_tuple_target makes it compress f1 too
+CREATE TABLE cmzstd (id int, f1 text COMPRESSION zstd, pad text)
+  WITH (toast_tuple_target = 128);
+SELECT attcompression FROM pg_attribute
+  WHERE attrelid = 'cmzstd'::regclass AND attname = 'f1';
+
+-- compression level is a per-attribute option
+ALTER TABLE cmzstd ALTER COLUMN f1 SET (compression_level = 19);
+ALTER TABLE cmzstd ALTER COLUMN f1 SET (compression_level = 23);
+SELECT attoptions FROM pg_attribute
+  WHERE attrelid = 'cmzstd'::regclass AND attname = 'f1';
+
+INSERT INTO cmzstd VALUES (0, repeat('1234567890', 1000));
+SELECT pg_column_compression(f1) FROM cmzstd;
+SELECT length(f1), substr(f1, 2000, 15) FROM cmzstd;
+
+-- train a dictionary from many small, similar values
+INSERT INTO cmzstd
+  SELECT g, format('{"id": %s, "name": "customer %s", "email": "customer%s@example.com", "status": "active", "tags": ["alpha", "beta", "gamma"], "note": "nothing to report"}', g, g, g),
+    repeat('x', 3000)
+  FROM generate_series(1, 1000) g;
+SELECT pg_zstd_train_dictionary('cmzstd', 'id');
+SELECT pg_zstd_train_dictionary('cmzstd', 'nosuchcol');
+SELECT pg_zstd_train_dictionary('cmzstd', 'f1', 10);
+SELECT pg_zstd_train_dictionary('cmzstd', 'f1', 4096) IS NOT NULL AS trained;
+SELECT count(*) FROM pg_zstd_dictionary
+  WHERE zdictrelid = 'cmzstd'::regclass AND zdictattnum = 2;
+
+-- values compressed afterwards use the dictionary and read back intact
+INSERT INTO cmzstd
+  SELECT g, format('{"id": %s, "name": "customer %s", "email": "customer%s@example.com", "status": "active", "tags": ["alpha", "beta", "gamma"], "note": "nothing to report"}', g, g, g),
+    repeat('x', 3000)
+  FROM generate_series(1001, 1010) g;
+SELECT DISTINCT pg_column_compression(f1) FROM cmzstd WHERE id > 1000;
+SELECT f1 FROM cmzstd WHERE id = 1005;
+SELECT substr(f1, 10, 20) FROM cmzstd WHERE id = 1010;
+
+-- index tuples don't keep values that need a dictionary to decompress
+CREATE INDEX cmzstd_f1_idx ON cmzstd (f1);
+SET enable_seqscan = off;
+SELECT id FROM cmzstd
+  WHERE f1 = '{"id": 1005, "name": "customer 1005", "email": "customer1005@example.com", "status": "active", "tags": ["alpha", "beta", "gamma"], "note": "nothing to report"}';
+RESET enable_seqscan;
+
+-- dictionaries outlive the table, since their data may have been copied
+CREATE TABLE cmzstd_copy (f1 text COMPRESSION zstd);
+INSERT INTO cmzstd_copy SELECT f1 FROM cmzstd WHERE id = 1005;
+DROP TABLE cmzstd;
+SELECT f1 FROM cmzstd_copy;
+DROP TABLE cmzstd_copy;
@@ -67,6 +67,13 @@ COPY x from stdin (force_null (a), force_null (b));
 COPY x from stdin (convert_selectively (a), convert_selectively (b));
 COPY x from stdin (encoding 'sql_ascii', encoding 'sql_ascii');
 
+-- columnar format options: should fail
+COPY x from stdin (format columnar);
+COPY x to stdout (row_group_size 100);
+COPY x to stdout (compression 'pglz');
+COPY x to stdout (format columnar, row_group_size 0);
+COPY x to stdout (format columnar, compression 'foo');
+
 -- too many columns in column list: should fail
 COPY x (a, b, c, d, e, d, c) from stdin;
 
@@ -454,6 +461,19 @@ test1
 SELECT * FROM instead_of_insert_tbl;
 COMMIT;
 
+-- Long lines and fields, to exercise the word-at-a-time scanning in COPY FROM
+CREATE TEMP TABLE copy_long (a text, b text);
+COPY copy_long FROM stdin;
+abcdefghijklmnopqrstuvwxyz	0123456789abcdef\\ghijkl\tmnop
+abcdefg\x41hijklmnopqrstu	vwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ
+\.
+COPY copy_long FROM stdin WITH (FORMAT csv);
+"abcdefghijklmnop
+qrstuvwxyz ""quoted"" text",ABCDEFGHIJKLMNOPQRSTUVWXYZ
+\.
+SELECT replace(a, E'\n', '|') AS a, replace(b, E'\t', '|') AS b
+  FROM copy_long ORDER BY length(a);
+
 -- clean up
 DROP TABLE forcetest;
 DROP TABLE vistest;
@@ -536,6 +536,21 @@ SELECT count(*)
   WHERE attrelid = 'ft1'::regclass AND
     (attmissingval IS NOT NULL OR atthasmissing);
 
+-- Deform tuples with a fixed-offset prefix, nulls, dropped columns and
+-- columns added after the rows were stored.  The qual on a deforms the
+-- start of each tuple first, and the projection resumes from there.
+CREATE TABLE deform (a int2, b int8, c text, d int4, e float8);
+INSERT INTO deform VALUES (1, 10, 'x', 100, 1.5), (2, NULL, 'yy', 200, 2.5),
+  (3, 30, NULL, NULL, 3.5);
+ALTER TABLE deform DROP COLUMN b;
+ALTER TABLE deform ADD COLUMN f int4 DEFAULT 7, ADD COLUMN g text DEFAULT 'new';
+INSERT INTO deform VALUES (4, 'zzz', 400, 4.5, 8, 'row4');
+SELECT a, c, d, e, f, g FROM deform WHERE a > 1 ORDER BY a;
+SELECT e, a FROM deform WHERE d IS NOT NULL ORDER BY a;
+ALTER TABLE deform DROP COLUMN a;
+SELECT * FROM deform ORDER BY e;
+DROP TABLE deform;
+
 -- cleanup
 DROP FOREIGN TABLE ft1;
 DROP SERVER s0;
@@ -171,3 +171,71 @@ reset enable_seqscan;
 reset enable_bitmapscan;
 
 drop table t_gin_test_tbl;
+
+-- Test leaving pending list cleanup to autovacuum
+create table gin_autoclean_tbl(i int4[]) with (autovacuum_enabled = off);
+create index gin_autoclean_idx on gin_autoclean_tbl using gin (i)
+  with (fastupdate = on, gin_pending_list_limit = 64, autocleanup = on);
+insert into gin_autoclean_tbl select array[1, g] from generate_series(1, 3000) g;
+
+set enable_seqscan = off;
+select count(*) from gin_autoclean_tbl where i @> array[1];
+select gin_clean_pending_list('gin_autoclean_idx') > 0 as deferred;
+select count(*) from gin_autoclean_tbl where i @> array[1];
+reset enable_seqscan;
+
+drop table gin_autoclean_tbl;
+
+-- Test parallel index build.  Each participant gets a third of the 64MB of
+-- maintenance_work_mem, and 1.2 million distinct keys are enough for each of
+-- them to write several runs.  The keys 0 to 6 appear in every run, so the
+-- leader has to combine their posting lists while merging.
+create table gin_parallel_tbl(i int4[]) with (parallel_workers = 2);
+insert into gin_parallel_tbl
+select array[g % 7] || array(select g * 100 + k from generate_series(0, 99) k)
+from generate_series(1, 12000) g;
+set max_parallel_maintenance_workers = 2;
+set maintenance_work_mem = '64MB';
+set client_min_messages = debug1;
+create index gin_parallel_idx on gin_parallel_tbl using gin (i);
+reset client_min_messages;
+reset maintenance_work_mem;
+reset max_parallel_maintenance_workers;
+
+set enable_seqscan = off;
+select count(*) from gin_parallel_tbl where i @> array[3];
+select count(*) from gin_parallel_tbl where i @> array[6];
+select count(*) from gin_parallel_tbl where i @> array[4200, 0];
+select count(*) from gin_parallel_tbl where i @> array[4250, 1];
+select count(*) from gin_parallel_tbl where i @> array[1200099];
+reset enable_seqscan;
+
+drop table gin_parallel_tbl;
+
+-- Test posting lists that mix runs of one-byte deltas with longer gaps,
+-- and intersection of frequent keys with rare ones
+create table gin_mixed_tbl(g int4, i int4[]) with (autovacuum_enabled = off);
+insert into gin_mixed_tbl
+select g, array[1, 100 + g % 7, 1000 + g / 50, 100000 + g]
+from generate_series(1, 20000) g;
+delete from gin_mixed_tbl where g % 1000 between 300 and 699;
+vacuum gin_mixed_tbl;
+create index gin_mixed_idx on gin_mixed_tbl using gin (i) with (fastupdate = off);
+insert into gin_mixed_tbl
+select g, array[1, 100 + g % 7, 1000 + g / 50, 100000 + g]
+from generate_series(20001, 21000) g;
+
+set enable_seqscan = off;
+select count(*), sum(g) from gin_mixed_tbl where i @> array[1];
+select count(*), sum(g) from gin_mixed_tbl where i @> array[103];
+select count(*), sum(g) from gin_mixed_tbl where i @> array[1, 103];
+select count(*), sum(g) from gin_mixed_tbl where i @> array[1, 1410];
+select count(*), sum(g) from gin_mixed_tbl where i @> array[1005, 103];
+select count(*), sum(g) from gin_mixed_tbl where i @> array[1010];
+select g from gin_mixed_tbl where i @> array[1, 100015];
+select g from gin_mixed_tbl
+where i @> array[1] and i && array[100010, 100500, 105001, 119999, 120500]
+order by g;
+reset enable_seqscan;
+
+drop table gin_mixed_tbl;
@@ -202,3 +202,52 @@ CREATE INDEX hash_f8_index2 ON hash_f8_heap USING hash (random float8_ops)
 	WITH (fillfactor=9);
 CREATE INDEX hash_f8_index2 ON hash_f8_heap USING hash (random float8_ops)
 	WITH (fillfactor=101);
+
+-- COPY passes each batch of rows to the hash index in one call.
+CREATE TABLE hash_copy_heap (keycol int, val text);
+CREATE INDEX hash_copy_index ON hash_copy_heap USING hash (keycol);
+CREATE INDEX hash_copy_btree ON hash_copy_heap (val);
+COPY hash_copy_heap FROM stdin;
+1	one
+2	two
+3	three
+1	uno
+2	dos
+3	tres
+4	four
+1	eins
+5	five
+6	six
+\.
+SET enable_seqscan = OFF;
+SET enable_bitmapscan = OFF;
+SELECT count(*) FROM hash_copy_heap WHERE keycol = 1;
+SELECT val FROM hash_copy_heap WHERE keycol = 2 ORDER BY val;
+SELECT keycol FROM hash_copy_heap WHERE val = 'six';
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+DROP TABLE hash_copy_heap;
+
+-- An error in a batched index insertion is reported against the batch.
+CREATE TABLE hash_copy_err (keycol int);
+CREATE INDEX hash_copy_err_index ON hash_copy_err USING hash ((100 / keycol));
+COPY hash_copy_err FROM stdin;
+1
+2
+0
+4
+\.
+DROP TABLE hash_copy_err;
+
+-- Bucket splits handed off to autovacuum.
+CREATE TABLE hash_autosplit_heap (keycol int);
+CREATE INDEX hash_autosplit_index ON hash_autosplit_heap USING hash (keycol)
+	WITH (autosplit = on);
+INSERT INTO hash_autosplit_heap SELECT g % 1000 FROM generate_series(1, 20000) g;
+SET enable_seqscan = OFF;
+SET enable_bitmapscan = OFF;
+SELECT count(*) FROM hash_autosplit_heap WHERE keycol = 42;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+ALTER INDEX hash_autosplit_index SET (autosplit = off);
+DROP TABLE hash_autosplit_heap;
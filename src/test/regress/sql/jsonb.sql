@@ -1500,3 +1500,25 @@ select '12345.0000000000000000000000000000000000000000000005'::jsonb::float8;
 select '12345.0000000000000000000000000000000000000000000005'::jsonb::int2;
 select '12345.0000000000000000000000000000000000000000000005'::jsonb::int4;
 select '12345.0000000000000000000000000000000000000000000005'::jsonb::int8;
+
+-- lookups in large out-of-line values only fetch the parts they need
+create table test_jsonb_toasted (plain jsonb, compressed jsonb);
+alter table test_jsonb_toasted alter column plain set storage external;
+set toast_segmented_min_size = '128kB';
+insert into test_jsonb_toasted
+  select j, j from (select jsonb_build_object('id', 1, 'tail', 'end',
+    'items', jsonb_agg(jsonb_build_object('n', g, 'pad', repeat('p', 60))
+                       order by g))
+    as j from generate_series(1, 2000) g) s;
+reset toast_segmented_min_size;
+select plain -> 'id' as a, compressed -> 'id' as b,
+  plain ->> 'tail' as c, compressed ->> 'tail' as d
+  from test_jsonb_toasted;
+select plain #> '{items,1499,n}' as a, compressed #>> '{items,-1,n}' as b,
+  compressed -> 'items' -> 5 ->> 'n' as c, compressed #> '{items,x}' as d,
+  plain -> 'nosuch' as e, plain -> 0 as f
+  from test_jsonb_toasted;
+select plain -> 'items' = compressed -> 'items' as same,
+  jsonb_array_length(compressed -> 'items')
+  from test_jsonb_toasted;
+drop table test_jsonb_toasted;
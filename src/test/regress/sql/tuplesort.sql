@@ -296,3 +296,59 @@ EXPLAIN (COSTS OFF) :qry;
 :qry;
 
 COMMIT;
+
+----
+-- Check radix sorting on fixed-width and abbreviated leading keys
+----
+
+CREATE TEMP TABLE radix_sort_test AS
+    SELECT g AS id,
+        CASE WHEN g % 97 = 0 THEN NULL ELSE (g * 7919) % 2003 - 1000 END AS i4,
+        CASE WHEN g % 89 = 0 THEN NULL
+            ELSE ((g::int8 * 104729) % 1000003) * 1000000 - 500000000000 END AS i8,
+        md5((g % 1500)::text) AS t,
+        g % 7 AS tie
+    FROM generate_series(1, 5000) g;
+
+-- each query counts adjacent output rows that are out of order
+WITH s AS (
+    SELECT i4, tie, row_number() OVER () AS rn
+    FROM (SELECT i4, tie FROM radix_sort_test
+          ORDER BY i4 DESC NULLS LAST, tie) ss)
+SELECT count(*) FROM s a JOIN s b ON b.rn = a.rn + 1
+WHERE a.i4 < b.i4 OR (a.i4 IS NULL AND b.i4 IS NOT NULL) OR
+    (a.i4 IS NOT DISTINCT FROM b.i4 AND a.tie > b.tie);
+
+WITH s AS (
+    SELECT i8, row_number() OVER () AS rn
+    FROM (SELECT i8 FROM radix_sort_test ORDER BY i8 NULLS FIRST) ss)
+SELECT count(*) FROM s a JOIN s b ON b.rn = a.rn + 1
+WHERE a.i8 > b.i8 OR (a.i8 IS NOT NULL AND b.i8 IS NULL);
+
+WITH s AS (
+    SELECT t, id, row_number() OVER () AS rn
+    FROM (SELECT t, id FROM radix_sort_test
+          ORDER BY t COLLATE "C", id DESC) ss)
+SELECT count(*) FROM s a JOIN s b ON b.rn = a.rn + 1
+WHERE a.t > b.t COLLATE "C" OR (a.t = b.t AND a.id < b.id);
+
+----
+-- Check disk sorts that need several merge passes, so that many tape reads
+-- come from blocks prefetched while the merge consumed the previous buffer
+----
+
+BEGIN;
+SET LOCAL work_mem = '64kB';
+
+SELECT count(*) AS n, count(*) FILTER (WHERE prev >= i) AS out_of_order
+FROM (SELECT i, lag(i) OVER () AS prev
+      FROM (SELECT (g * 7919) % 100003 AS i FROM generate_series(1, 100000) g
+            ORDER BY 1) ss) s;
+
+SELECT count(*) AS n, count(*) FILTER (WHERE prev >= t) AS out_of_order
+FROM (SELECT t, lag(t) OVER () AS prev
+      FROM (SELECT md5(g::text) COLLATE "C" AS t
+            FROM generate_series(1, 50000) g
+            ORDER BY 1) ss) s;
+
+COMMIT;
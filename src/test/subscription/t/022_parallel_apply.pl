@@ -0,0 +1,105 @@
+# Copyright (c) 2021, PostgreSQL Global Development Group
+
+# Test applying transactions in parallel apply workers
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 5;
+
+# Create publisher node
+my $node_publisher = get_new_node('publisher');
+$node_publisher->init(allows_streaming => 'logical');
+$node_publisher->append_conf('postgresql.conf',
+	'logical_decoding_work_mem = 64kB');
+$node_publisher->start;
+
+# Create subscriber node
+my $node_subscriber = get_new_node('subscriber');
+$node_subscriber->init(allows_streaming => 'logical');
+$node_subscriber->append_conf('postgresql.conf',
+	'max_parallel_apply_workers_per_subscription = 2');
+$node_subscriber->start;
+
+# Create some preexisting content on publisher
+$node_publisher->safe_psql('postgres',
+	"CREATE TABLE test_tab (a int primary key, b int)");
+$node_publisher->safe_psql('postgres',
+	"INSERT INTO test_tab VALUES (1, 0), (2, 0)");
+
+# Setup structure on subscriber
+$node_subscriber->safe_psql('postgres',
+	"CREATE TABLE test_tab (a int primary key, b int)");
+
+# Setup logical replication
+my $publisher_connstr = $node_publisher->connstr . ' dbname=postgres';
+$node_publisher->safe_psql('postgres',
+	"CREATE PUBLICATION tap_pub FOR TABLE test_tab");
+
+my $appname = 'tap_sub';
+$node_subscriber->safe_psql('postgres',
+	"CREATE SUBSCRIPTION tap_sub CONNECTION '$publisher_connstr application_name=$appname' PUBLICATION tap_pub WITH (streaming = on)"
+);
+
+# Wait for initial table sync to finish
+$node_subscriber->wait_for_subscription_sync($node_publisher, $appname);
+
+my $result =
+  $node_subscriber->safe_psql('postgres', "SELECT count(*) FROM test_tab");
+is($result, qq(2), 'check initial data was copied to subscriber');
+
+# Many small transactions, some of which change the same rows
+$node_publisher->safe_psql(
+	'postgres', q{
+DO $$
+BEGIN
+	FOR i IN 3..200 LOOP
+		INSERT INTO test_tab VALUES (i, 0);
+		UPDATE test_tab SET b = b + 1 WHERE a IN (1, i - 1);
+		COMMIT;
+	END LOOP;
+END $$;
+});
+
+$node_publisher->wait_for_catchup($appname);
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*), sum(b) FROM test_tab");
+is($result, qq(200|396), 'check small transactions were applied in parallel');
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT b FROM test_tab WHERE a = 1");
+is($result, qq(198), 'check conflicting changes were applied in order');
+
+# A streamed transaction with subtransactions and a rollback
+$node_publisher->safe_psql(
+	'postgres', q{
+BEGIN;
+INSERT INTO test_tab SELECT i, 0 FROM generate_series(201, 2000) s(i);
+SAVEPOINT s1;
+INSERT INTO test_tab SELECT i, 0 FROM generate_series(2001, 4000) s(i);
+ROLLBACK TO s1;
+UPDATE test_tab SET b = b + 1 WHERE a = 1;
+COMMIT;
+});
+
+$node_publisher->wait_for_catchup($appname);
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*), max(a) FROM test_tab");
+is($result, qq(2000|2000),
+	'check streamed transaction was applied with subtransaction rolled back');
+
+# TRUNCATE is ordered after earlier changes
+$node_publisher->safe_psql('postgres', "TRUNCATE test_tab");
+$node_publisher->safe_psql('postgres',
+	"INSERT INTO test_tab VALUES (1, 1)");
+
+$node_publisher->wait_for_catchup($appname);
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*), sum(b) FROM test_tab");
+is($result, qq(1|1), 'check changes after TRUNCATE were applied');
+
+$node_subscriber->stop;
+$node_publisher->stop;
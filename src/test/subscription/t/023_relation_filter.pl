@@ -0,0 +1,147 @@
+
+# Copyright (c) 2021, PostgreSQL Global Development Group
+
+# Test that changes to unpublished tables are filtered out while decoding
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 6;
+
+# Create publisher node
+my $node_publisher = get_new_node('publisher');
+$node_publisher->init(allows_streaming => 'logical');
+$node_publisher->append_conf('postgresql.conf',
+	'logical_decoding_work_mem = 64kB');
+$node_publisher->start;
+
+# Create subscriber node
+my $node_subscriber = get_new_node('subscriber');
+$node_subscriber->init(allows_streaming => 'logical');
+$node_subscriber->start;
+
+# Create tables on both nodes, only tab_pub is published for now
+$node_publisher->safe_psql('postgres',
+	"CREATE TABLE tab_pub (a int primary key)");
+$node_publisher->safe_psql('postgres',
+	"CREATE TABLE tab_other (a int primary key, b text)");
+$node_subscriber->safe_psql('postgres',
+	"CREATE TABLE tab_pub (a int primary key)");
+$node_subscriber->safe_psql('postgres',
+	"CREATE TABLE tab_other (a int primary key, b text)");
+
+# Setup logical replication
+my $publisher_connstr = $node_publisher->connstr . ' dbname=postgres';
+$node_publisher->safe_psql('postgres',
+	"CREATE PUBLICATION tap_pub FOR TABLE tab_pub");
+
+my $appname = 'tap_sub';
+$node_subscriber->safe_psql('postgres',
+	"CREATE SUBSCRIPTION tap_sub CONNECTION '$publisher_connstr application_name=$appname' PUBLICATION tap_pub"
+);
+
+# Wait for initial table sync to finish
+$node_subscriber->wait_for_subscription_sync($node_publisher, $appname);
+
+# A transaction that would exceed logical_decoding_work_mem many times over
+# if the changes to tab_other were queued
+$node_publisher->safe_psql(
+	'postgres', q{
+BEGIN;
+INSERT INTO tab_other SELECT i, md5(i::text) FROM generate_series(1, 5000) s(i);
+UPDATE tab_other SET b = b || 'x';
+INSERT INTO tab_pub VALUES (1);
+DELETE FROM tab_other WHERE a > 2500;
+COMMIT;
+});
+
+$node_publisher->wait_for_catchup($appname);
+
+my $result =
+  $node_subscriber->safe_psql('postgres',
+	"SELECT (SELECT count(*) FROM tab_pub), (SELECT count(*) FROM tab_other)");
+is($result, qq(1|0), 'check only published changes were replicated');
+
+# Wait for the statistics of the transaction to arrive
+$node_publisher->poll_query_until('postgres',
+	"SELECT total_txns > 0 FROM pg_stat_replication_slots WHERE slot_name = 'tap_sub'"
+) or die "Timed out while waiting for replication slot statistics";
+
+$result = $node_publisher->safe_psql('postgres',
+	"SELECT spill_txns FROM pg_stat_replication_slots WHERE slot_name = 'tap_sub'"
+);
+is($result, qq(0), 'check changes to unpublished table were not spilled');
+
+# Publishing the table makes its changes flow again
+$node_publisher->safe_psql('postgres',
+	"ALTER PUBLICATION tap_pub ADD TABLE tab_other");
+$node_subscriber->safe_psql('postgres',
+	"ALTER SUBSCRIPTION tap_sub REFRESH PUBLICATION WITH (copy_data = false)");
+$node_subscriber->wait_for_subscription_sync($node_publisher, $appname);
+
+$node_publisher->safe_psql('postgres',
+	"INSERT INTO tab_other VALUES (5001, 'a')");
+$node_publisher->safe_psql('postgres',
+	"UPDATE tab_other SET b = 'b' WHERE a = 5001");
+
+$node_publisher->wait_for_catchup($appname);
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT a, b FROM tab_other");
+is($result, qq(5001|b), 'check changes to newly published table were replicated');
+
+# Stream large transactions from now on
+my $oldpid = $node_publisher->safe_psql('postgres',
+	"SELECT pid FROM pg_stat_replication WHERE application_name = '$appname' AND state = 'streaming';"
+);
+$node_subscriber->safe_psql('postgres',
+	"ALTER SUBSCRIPTION tap_sub SET (streaming = on)");
+$node_publisher->poll_query_until('postgres',
+	"SELECT pid != $oldpid FROM pg_stat_replication WHERE application_name = '$appname' AND state = 'streaming';"
+) or die "Timed out while waiting for apply to restart after changing streaming";
+
+# An unpublished table whose values are always stored in its TOAST table
+$node_publisher->safe_psql('postgres',
+	"CREATE TABLE tab_big (a int primary key, b text)");
+$node_publisher->safe_psql('postgres',
+	"ALTER TABLE tab_big ALTER COLUMN b SET STORAGE EXTERNAL");
+$node_subscriber->safe_psql('postgres',
+	"CREATE TABLE tab_big (a int primary key, b text)");
+
+# A streamed transaction with TOAST data for both a published and an
+# unpublished table.  The TOAST chunks of tab_big must be filtered along with
+# tab_big, or they would be queued without the rows they belong to, and keep
+# the rest of the transaction from being streamed.
+$node_publisher->safe_psql(
+	'postgres', q{
+BEGIN;
+INSERT INTO tab_other
+  SELECT i, (SELECT string_agg(md5((i * j)::text), '') FROM generate_series(1, 100) j)
+  FROM generate_series(6001, 6100) s(i);
+INSERT INTO tab_big
+  SELECT i, (SELECT string_agg(md5((i * j)::text), '') FROM generate_series(1, 100) j)
+  FROM generate_series(1, 100) s(i);
+COMMIT;
+});
+
+$node_publisher->wait_for_catchup($appname);
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*), sum(length(b)), (SELECT count(*) FROM tab_big) FROM tab_other WHERE a > 6000"
+);
+is($result, qq(100|320000|0),
+	'check toasted changes of a streamed transaction were filtered');
+
+ok( $node_publisher->poll_query_until(
+		'postgres',
+		"SELECT stream_txns > 0 FROM pg_stat_replication_slots WHERE slot_name = 'tap_sub'"
+	),
+	'check transaction with filtered TOAST data was streamed');
+
+$result = $node_publisher->safe_psql('postgres',
+	"SELECT spill_txns FROM pg_stat_replication_slots WHERE slot_name = 'tap_sub'"
+);
+is($result, qq(0), 'check transaction with filtered TOAST data was not spilled');
+
+$node_subscriber->stop;
+$node_publisher->stop;